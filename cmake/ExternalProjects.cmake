@@ -107,6 +107,20 @@ FetchContent_MakeAvailable(zstd_ext)
 target_include_directories(libzstd_static INTERFACE $<BUILD_INTERFACE:${zstd_ext_SOURCE_DIR}/lib>)
 add_library(zstd::libzstd_static ALIAS libzstd_static)
 
+if(FAABRIC_BUILD_BENCHMARKS)
+    # Google Benchmark (microbenchmarks)
+    set(BENCHMARK_ENABLE_TESTING OFF CACHE INTERNAL "")
+    set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE INTERNAL "")
+    set(BENCHMARK_ENABLE_INSTALL OFF CACHE INTERNAL "")
+
+    FetchContent_Declare(benchmark_ext
+        GIT_REPOSITORY "https://github.com/google/benchmark"
+        GIT_TAG "v1.7.1"
+    )
+
+    FetchContent_MakeAvailable(benchmark_ext)
+endif()
+
 if(FAABRIC_BUILD_TESTS)
     # Catch (tests)
     set(CATCH_INSTALL_DOCS OFF CACHE INTERNAL "")
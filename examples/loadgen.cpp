@@ -0,0 +1,506 @@
+#include <faabric/executor/FaabricMain.h>
+#include <faabric/scheduler/FunctionCallClient.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/environment.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/metrics.h>
+#include <faabric/util/queue.h>
+#include <faabric/util/testing.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+/**
+ * Open-loop load generator. Drives arrivals at a fixed mean rate against this
+ * host plus a number of simulated hosts in the same process, and reports
+ * throughput and latency for each path a call can take through the scheduler:
+ *
+ * - local: placed on this host
+ * - remote: sent to one of the simulated hosts
+ * - overload: no capacity anywhere, so queued on this host regardless
+ *
+ * Simulated hosts answer the scheduler's resource and execute calls through
+ * the function call client's mock hosts, so no extra processes are needed.
+ * Results still go through Redis, so REDIS_QUEUE_HOST and REDIS_STATE_HOST
+ * must point at a local instance, e.g. the one in docker-compose.
+ *
+ * Configured through the environment:
+ *
+ * - LOADGEN_PATTERN: poisson, bursty or fanout
+ * - LOADGEN_RATE: mean arrivals per second
+ * - LOADGEN_DURATION: seconds to generate load for
+ * - LOADGEN_HOSTS: hosts including this one
+ * - LOADGEN_CORES: cores per host
+ * - LOADGEN_SERVICE_US: how long each call runs for
+ * - LOADGEN_BURST: arrivals per burst in the bursty pattern
+ * - LOADGEN_FANOUT: chained calls per arrival in the fanout pattern
+ */
+
+#define LOADGEN_USER "loadgen"
+#define LOADGEN_FUNC "work"
+#define LOADGEN_SIM_HOST_PREFIX "loadgen-sim-"
+
+// How long to wait for outstanding calls once arrivals have stopped
+#define LOADGEN_DRAIN_TIMEOUT_MS 30000
+
+// How long a fan-out call waits for each of its chained calls
+#define LOADGEN_CHAIN_TIMEOUT_MS 10000
+
+using namespace faabric::executor;
+
+typedef std::chrono::steady_clock::time_point ArrivalTime;
+
+enum class CallPath
+{
+    Unknown,
+    Local,
+    Remote,
+    Overload,
+};
+
+static const std::vector<std::pair<CallPath, std::string>> allPaths = {
+    { CallPath::Local, "local" },
+    { CallPath::Remote, "remote" },
+    { CallPath::Overload, "overload" },
+};
+
+// ----------------------------------
+// Latency tracking
+// ----------------------------------
+
+struct PendingCall
+{
+    ArrivalTime arrival;
+    CallPath path = CallPath::Unknown;
+
+    // Set if the call finishes before its path is known
+    long latencyUs = -1;
+};
+
+static std::mutex pendingMx;
+static std::unordered_map<unsigned int, PendingCall> pendingCalls;
+
+static std::atomic<long> nErrors = 0;
+
+static faabric::util::Histogram& getPathHistogram(CallPath path)
+{
+    static faabric::util::Histogram& localHist =
+      faabric::util::getMetrics().getHistogram("loadgen_local_us");
+    static faabric::util::Histogram& remoteHist =
+      faabric::util::getMetrics().getHistogram("loadgen_remote_us");
+    static faabric::util::Histogram& overloadHist =
+      faabric::util::getMetrics().getHistogram("loadgen_overload_us");
+
+    switch (path) {
+        case CallPath::Local:
+            return localHist;
+        case CallPath::Remote:
+            return remoteHist;
+        default:
+            return overloadHist;
+    }
+}
+
+static void trackCall(unsigned int msgId, ArrivalTime arrival)
+{
+    std::unique_lock<std::mutex> lock(pendingMx);
+    pendingCalls[msgId].arrival = arrival;
+}
+
+static void setCallPath(unsigned int msgId, CallPath path)
+{
+    std::unique_lock<std::mutex> lock(pendingMx);
+    auto it = pendingCalls.find(msgId);
+    if (it == pendingCalls.end()) {
+        return;
+    }
+
+    // Record now if it's already finished
+    if (it->second.latencyUs >= 0) {
+        getPathHistogram(path).record(it->second.latencyUs);
+        pendingCalls.erase(it);
+    } else {
+        it->second.path = path;
+    }
+}
+
+static void finishCall(const faabric::Message& msg)
+{
+    std::unique_lock<std::mutex> lock(pendingMx);
+    auto it = pendingCalls.find(msg.id());
+    if (it == pendingCalls.end()) {
+        // Chained calls aren't tracked, only the calls that made them
+        return;
+    }
+
+    long latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - it->second.arrival)
+                       .count();
+
+    if (it->second.path == CallPath::Unknown) {
+        it->second.latencyUs = latencyUs;
+    } else {
+        getPathHistogram(it->second.path).record(latencyUs);
+        pendingCalls.erase(it);
+    }
+}
+
+static size_t getPendingCount()
+{
+    std::unique_lock<std::mutex> lock(pendingMx);
+    return pendingCalls.size();
+}
+
+// ----------------------------------
+// Submission
+// ----------------------------------
+
+// Submissions are serialised so overloaded calls can be told apart by the
+// scheduler's counter. The scheduler takes a full lock on each call anyway.
+static std::mutex submitMx;
+
+static void submitCalls(faabric::BatchExecuteRequest& req,
+                        bool track,
+                        ArrivalTime arrival = ArrivalTime())
+{
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    faabric::util::Counter& overloadedCounter =
+      faabric::util::getMetrics().getCounter("scheduler_overloaded_calls");
+
+    std::unique_lock<std::mutex> lock(submitMx);
+
+    // Track before submitting, as calls may finish before this returns
+    if (track) {
+        for (const auto& m : req.messages()) {
+            trackCall(m.id(), arrival);
+        }
+    }
+
+    uint64_t overloadedBefore = overloadedCounter.value();
+    std::vector<std::string> hosts = sch.callFunctions(req);
+    uint64_t nOverloaded = overloadedCounter.value() - overloadedBefore;
+
+    if (!track) {
+        return;
+    }
+
+    // Local calls are placed first, so the overloaded ones are the last
+    std::string thisHost = sch.getThisHost();
+    for (int i = req.messages_size() - 1; i >= 0; i--) {
+        CallPath path = CallPath::Remote;
+        if (hosts.at(i) == thisHost) {
+            if (nOverloaded > 0) {
+                path = CallPath::Overload;
+                nOverloaded--;
+            } else {
+                path = CallPath::Local;
+            }
+        }
+
+        setCallPath(req.messages().at(i).id(), path);
+    }
+}
+
+static faabric::Message makeCall(long serviceUs, int nChained)
+{
+    faabric::Message msg =
+      faabric::util::messageFactory(LOADGEN_USER, LOADGEN_FUNC);
+    msg.set_inputdata(std::to_string(serviceUs) + " " +
+                      std::to_string(nChained));
+
+    return msg;
+}
+
+// ----------------------------------
+// Execution
+// ----------------------------------
+
+static void runCall(faabric::Message& msg)
+{
+    long serviceUs = 0;
+    int nChained = 0;
+    sscanf(msg.inputdata().c_str(), "%li %i", &serviceUs, &nChained);
+
+    std::this_thread::sleep_for(std::chrono::microseconds(serviceUs));
+
+    if (nChained == 0) {
+        return;
+    }
+
+    // Fan out and wait for all the chained calls
+    std::vector<faabric::Message> chained;
+    for (int i = 0; i < nChained; i++) {
+        chained.push_back(makeCall(serviceUs, 0));
+    }
+
+    faabric::BatchExecuteRequest req =
+      faabric::util::batchExecFactory(chained);
+    submitCalls(req, false);
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    for (const auto& m : req.messages()) {
+        faabric::Message result =
+          sch.getFunctionResult(m.id(), LOADGEN_CHAIN_TIMEOUT_MS);
+        if (result.type() == faabric::Message_MessageType_EMPTY) {
+            nErrors++;
+        }
+    }
+}
+
+FAABRIC_EXECUTOR()
+{
+    runCall(msg);
+    finishCall(msg);
+
+    return true;
+}
+
+/**
+ * A host with a fixed number of cores, each running one call at a time.
+ */
+class SimulatedHost final : public faabric::scheduler::MockHost
+{
+  public:
+    SimulatedHost(const std::string& hostIn, int coresIn)
+      : host(hostIn)
+      , cores(coresIn)
+    {
+        for (int i = 0; i < cores; i++) {
+            workers.emplace_back([this] { runWorker(); });
+        }
+    }
+
+    ~SimulatedHost() override
+    {
+        shutdown = true;
+        for (auto& t : workers) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+    }
+
+    faabric::HostResources getResources() override
+    {
+        faabric::HostResources res;
+        res.set_cores(cores);
+        res.set_functionsinflight(inFlight);
+        res.set_boundexecutors(std::min<int>(inFlight, cores));
+
+        return res;
+    }
+
+    void executeFunctions(const faabric::BatchExecuteRequest& req) override
+    {
+        inFlight += req.messages_size();
+        for (const auto& m : req.messages()) {
+            queue.enqueue(m);
+        }
+    }
+
+  private:
+    const std::string host;
+    const int cores;
+
+    std::atomic<bool> shutdown = false;
+    std::atomic<int> inFlight = 0;
+    faabric::util::Queue<faabric::Message> queue;
+    std::vector<std::thread> workers;
+
+    void runWorker()
+    {
+        faabric::scheduler::Scheduler& sch =
+          faabric::scheduler::getScheduler();
+
+        while (!shutdown) {
+            faabric::Message msg;
+            try {
+                msg = queue.dequeue(100);
+            } catch (faabric::util::QueueTimeoutException& e) {
+                continue;
+            }
+
+            runCall(msg);
+
+            msg.set_executedhost(host);
+            msg.set_returnvalue(0);
+            sch.setFunctionResult(msg);
+
+            finishCall(msg);
+            inFlight--;
+        }
+    }
+};
+
+// ----------------------------------
+// Arrivals
+// ----------------------------------
+
+struct LoadConfig
+{
+    std::string pattern;
+    double rate = 0;
+    int durationSecs = 0;
+    int nHosts = 0;
+    int cores = 0;
+    long serviceUs = 0;
+    int burstSize = 0;
+    int fanout = 0;
+};
+
+static LoadConfig getLoadConfig()
+{
+    using faabric::util::getEnvVar;
+
+    LoadConfig c;
+    c.pattern = getEnvVar("LOADGEN_PATTERN", "poisson");
+    c.rate = std::stod(getEnvVar("LOADGEN_RATE", "500"));
+    c.durationSecs = std::stoi(getEnvVar("LOADGEN_DURATION", "10"));
+    c.nHosts = std::stoi(getEnvVar("LOADGEN_HOSTS", "4"));
+    c.cores = std::stoi(getEnvVar("LOADGEN_CORES", "4"));
+    c.serviceUs = std::stol(getEnvVar("LOADGEN_SERVICE_US", "5000"));
+    c.burstSize = std::stoi(getEnvVar("LOADGEN_BURST", "20"));
+    c.fanout = std::stoi(getEnvVar("LOADGEN_FANOUT", "4"));
+
+    return c;
+}
+
+/**
+ * Submits arrivals on schedule without waiting for earlier ones to finish.
+ * Latency is measured from when each call was due rather than when it was
+ * submitted, so a slow scheduler shows up in the results.
+ */
+static long generateArrivals(const LoadConfig& c)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    bool isBursty = c.pattern == "bursty";
+    bool isFanout = c.pattern == "fanout";
+    if (!isBursty && !isFanout && c.pattern != "poisson") {
+        logger->error("Unrecognised arrival pattern: {}", c.pattern);
+        throw std::runtime_error("Unrecognised arrival pattern");
+    }
+
+    // Bursts arrive as a Poisson process, keeping the same mean call rate
+    int perArrival = isBursty ? c.burstSize : 1;
+    int nChained = isFanout ? c.fanout : 0;
+    std::exponential_distribution<double> gap(c.rate / perArrival);
+    std::mt19937_64 gen(std::random_device{}());
+
+    ArrivalTime start = std::chrono::steady_clock::now();
+    ArrivalTime end = start + std::chrono::seconds(c.durationSecs);
+    ArrivalTime next = start;
+
+    long nSubmitted = 0;
+    while (next < end) {
+        std::this_thread::sleep_until(next);
+
+        std::vector<faabric::Message> msgs;
+        for (int i = 0; i < perArrival; i++) {
+            msgs.push_back(makeCall(c.serviceUs, nChained));
+        }
+
+        faabric::BatchExecuteRequest req =
+          faabric::util::batchExecFactory(msgs);
+        submitCalls(req, true, next);
+        nSubmitted += perArrival;
+
+        next += std::chrono::duration_cast<ArrivalTime::duration>(
+          std::chrono::duration<double>(gap(gen)));
+    }
+
+    return nSubmitted;
+}
+
+static void printResults(const LoadConfig& c, long nSubmitted)
+{
+    printf("\n%s: %.0f calls/s for %is over %i hosts x %i cores\n",
+           c.pattern.c_str(),
+           c.rate,
+           c.durationSecs,
+           c.nHosts,
+           c.cores);
+    printf("Submitted %li, %li errors, %lu unfinished\n\n",
+           nSubmitted,
+           nErrors.load(),
+           getPendingCount());
+
+    printf("%-10s %10s %10s %10s %10s %10s %10s\n",
+           "Path",
+           "Count",
+           "Calls/s",
+           "p50 (us)",
+           "p99 (us)",
+           "p999 (us)",
+           "Max (us)");
+
+    for (const auto& p : allPaths) {
+        faabric::util::HistogramSnapshot s =
+          getPathHistogram(p.first).snapshot();
+        printf("%-10s %10lu %10.1f %10lu %10lu %10lu %10lu\n",
+               p.second.c_str(),
+               s.count,
+               (double)s.count / c.durationSecs,
+               s.getPercentile(50),
+               s.getPercentile(99),
+               s.getPercentile(99.9),
+               s.max);
+    }
+
+    printf("\n");
+}
+
+int main()
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    LoadConfig c = getLoadConfig();
+
+    // Start this host, with the same cores as the simulated ones
+    _Pool p(c.cores);
+    FaabricMain w(p);
+    w.startBackground();
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    faabric::HostResources res;
+    res.set_cores(c.cores);
+    sch.setThisHostResources(res);
+
+    // Answer calls to other hosts in-process
+    faabric::util::setMockMode(true);
+    std::vector<std::string> simHosts;
+    for (int i = 1; i < c.nHosts; i++) {
+        std::string host = LOADGEN_SIM_HOST_PREFIX + std::to_string(i);
+        faabric::scheduler::registerMockHost(
+          host, std::make_shared<SimulatedHost>(host, c.cores));
+        sch.addHostToGlobalSet(host);
+        simHosts.push_back(host);
+    }
+
+    // The scheduler warns on every overloaded call
+    logger->info("Generating {} load", c.pattern);
+    logger->set_level(spdlog::level::err);
+    long nSubmitted = generateArrivals(c);
+
+    // Wait for the stragglers
+    auto drainStart = std::chrono::steady_clock::now();
+    while (getPendingCount() > 0 &&
+           std::chrono::steady_clock::now() - drainStart <
+             std::chrono::milliseconds(LOADGEN_DRAIN_TIMEOUT_MS)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    logger->set_level(spdlog::level::info);
+    printResults(c, nSubmitted);
+
+    for (const auto& host : simHosts) {
+        sch.removeHostFromGlobalSet(host);
+    }
+    faabric::scheduler::clearMockHosts();
+    faabric::util::setMockMode(false);
+
+    w.shutdown();
+
+    return EXIT_SUCCESS;
+}
@@ -1,9 +1,22 @@
 #pragma once
 
+#include <faabric/endpoint/ResponseSequencer.h>
 #include <faabric/proto/faabric.pb.h>
 #include <pistache/http.h>
 
+#include <functional>
+
+#define METRICS_PATH "/metrics"
+#define BATCH_PATH "/batch"
+
+// Requests with this content type hold a serialised Message
+#define PROTOBUF_CONTENT_TYPE "application/x-protobuf"
+
 namespace faabric::endpoint {
+
+// Sends the response body, possibly after the handler has returned
+typedef std::function<void(const std::string&)> ResponseCallback;
+
 class FaabricEndpointHandler : public Pistache::Http::Handler
 {
   public:
@@ -15,9 +28,39 @@ class FaabricEndpointHandler : public Pistache::Http::Handler
     void onRequest(const Pistache::Http::Request& request,
                    Pistache::Http::ResponseWriter response) override;
 
-    std::string handleFunction(const std::string& requestStr);
+    void onDisconnection(
+      const std::shared_ptr<Pistache::Tcp::Peer>& peer) override;
+
+    // The versions returning a string block until the response is ready
+    std::string handleFunction(std::string requestStr);
+
+    void handleFunction(std::string requestStr,
+                        const ResponseCallback& respond);
+
+    // Handles a serialised Message, responding with a serialised result
+    std::string handleBinaryFunction(const std::string& requestBody);
+
+    void handleBinaryFunction(const std::string& requestBody,
+                              const ResponseCallback& respond);
+
+    // Schedules calls to one function together, streaming back each result
+    // as it arrives
+    std::string handleBatch(const std::string& requestBody, bool isBinary);
+
+    void handleBatch(const std::string& requestBody,
+                     bool isBinary,
+                     const StreamCallback& write);
+
+    // Renders host metrics in the Prometheus text format
+    std::string handleMetrics();
 
   private:
-    std::string executeFunction(faabric::Message& msg);
+    void handleMessage(faabric::Message& msg,
+                       bool isBinary,
+                       const ResponseCallback& respond);
+
+    void executeFunction(faabric::Message& msg,
+                         bool isBinary,
+                         const ResponseCallback& respond);
 };
 }
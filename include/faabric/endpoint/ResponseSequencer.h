@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace faabric::endpoint {
+
+// Sends part of a response, finishing it if it's the last
+typedef std::function<void(const std::string& chunk, bool isLast)>
+  StreamCallback;
+
+/**
+ * Keeps responses on each connection in the order their requests arrived, as
+ * HTTP pipelining requires, even though they may be ready in any order.
+ * Responses that are ready early are buffered until those before them have
+ * finished.
+ *
+ * Slots must be reserved in request order, which holds as long as each
+ * connection's requests are handled on one thread. Connection IDs must not
+ * be reused while responses on the old connection may still be written.
+ */
+class ResponseSequencer
+{
+  public:
+    StreamCallback reserve(uint64_t connectionId, StreamCallback sink);
+
+    // Discards anything still to be sent once the connection has closed
+    void dropConnection(uint64_t connectionId);
+
+    size_t getConnectionCount();
+
+  private:
+    struct Slot
+    {
+        StreamCallback sink;
+        std::string buffered;
+        bool isFinished = false;
+    };
+
+    std::mutex mx;
+    std::unordered_map<uint64_t, std::deque<std::shared_ptr<Slot>>>
+      connections;
+
+    void write(uint64_t connectionId,
+               const std::shared_ptr<Slot>& slot,
+               const std::string& chunk,
+               bool isLast);
+};
+
+ResponseSequencer& getResponseSequencer();
+}
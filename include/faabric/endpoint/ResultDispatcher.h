@@ -0,0 +1,66 @@
+#pragma once
+
+#include <faabric/proto/faabric.pb.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Most result keys checked in one Redis round trip
+#define RESULT_POLL_BATCH_SIZE 1000
+
+namespace faabric::endpoint {
+
+typedef std::function<void(faabric::Message&)> ResultCallback;
+
+/**
+ * Completes callers waiting on function results without tying up a thread for
+ * each. A single background thread polls the result keys of all pending calls
+ * in pipelined batches, and invokes each caller's callback once with either
+ * the result, or an EMPTY message if it times out. Callers awaiting the same
+ * message all get its result.
+ *
+ * Callbacks run on the dispatcher thread so must not block.
+ */
+class ResultDispatcher
+{
+  public:
+    ResultDispatcher();
+
+    ~ResultDispatcher();
+
+    void awaitResult(unsigned int messageId,
+                     int timeoutMs,
+                     ResultCallback callback);
+
+    size_t getPendingCount();
+
+    // Checks all pending calls once, returning how many were completed
+    int poll();
+
+    void shutdown();
+
+  private:
+    struct PendingResult
+    {
+        long deadlineMs;
+        ResultCallback callback;
+    };
+
+    std::mutex mx;
+    std::condition_variable cv;
+    std::unordered_map<unsigned int, std::vector<PendingResult>> pending;
+
+    bool running = false;
+    std::thread pollThread;
+
+    void start();
+
+    void run();
+};
+
+ResultDispatcher& getResultDispatcher();
+}
@@ -19,10 +19,26 @@ class FaabricExecutor
 
     bool isBound();
 
+    void release();
+
+    void rebind();
+
+    void acquire();
+
+    bool isReleased();
+
+    int getExecutionCount();
+
+    const faabric::Message& getBoundMessage();
+
+    std::shared_ptr<faabric::scheduler::InMemoryMessageQueue> getCurrentQueue();
+
     virtual std::string processNextMessage();
 
     std::string executeCall(faabric::Message& call);
 
+    std::string executeBatch(std::vector<faabric::Message>& calls);
+
     void finish();
 
     virtual void flush();
@@ -34,6 +50,9 @@ class FaabricExecutor
   protected:
     virtual bool doExecute(faabric::Message& msg);
 
+    virtual std::vector<std::string> doExecuteBatch(
+      std::vector<faabric::Message>& msgs);
+
     virtual void postBind(const faabric::Message& msg, bool force);
 
     virtual void preFinishCall(faabric::Message& call,
@@ -46,6 +65,8 @@ class FaabricExecutor
 
     bool _isBound = false;
 
+    bool _isReleased = false;
+
     faabric::scheduler::Scheduler& scheduler;
 
     std::shared_ptr<faabric::scheduler::InMemoryMessageQueue> currentQueue;
@@ -55,8 +76,13 @@ class FaabricExecutor
   private:
     faabric::Message boundMessage;
 
+    std::string runCall(faabric::Message& msg);
+
     void finishCall(faabric::Message& msg,
                     bool success,
                     const std::string& errorMsg);
+
+    void finishCalls(std::vector<faabric::Message>& msgs,
+                     const std::vector<std::string>& errors);
 };
 }
@@ -6,7 +6,30 @@
 #include <faabric/state/StateServer.h>
 #include <faabric/util/queue.h>
 
+#include <deque>
+#include <list>
+
 namespace faabric::executor {
+/**
+ * A long-lived pool thread. Workers hold at most one active executor, and a
+ * local queue of messages for that executor's function that other workers can
+ * steal from.
+ */
+struct PoolWorker
+{
+    explicit PoolWorker(int idxIn)
+      : idx(idxIn)
+    {}
+
+    const int idx;
+
+    std::unique_ptr<FaabricExecutor> executor;
+
+    std::mutex mx;
+    std::string funcStr;
+    std::deque<faabric::Message> localQueue;
+};
+
 class FaabricPool
 {
   public:
@@ -26,6 +49,8 @@ class FaabricPool
 
     int getThreadCount();
 
+    int getWarmExecutorCount();
+
     bool isShutdown();
 
     void shutdown();
@@ -42,7 +67,43 @@ class FaabricPool
 
     std::thread mpiThread;
     std::thread poolThread;
+    std::thread prewarmThread;
     std::vector<std::thread> poolThreads;
+
+    std::vector<std::unique_ptr<PoolWorker>> workers;
+
+    // Bound executors not currently in use, most recently used first
+    std::mutex warmMx;
+    std::list<std::unique_ptr<FaabricExecutor>> warmExecutors;
+
+    void runWorker(PoolWorker& w);
+
+    void runPrewarmer();
+
+    bool nextMessage(PoolWorker& w, faabric::Message& msg);
+
+    bool stealMessage(PoolWorker& w, faabric::Message& msg);
+
+    void executeMessage(PoolWorker& w, faabric::Message& msg);
+
+    void bindWorker(PoolWorker& w, const faabric::Message& bindMsg);
+
+    void switchExecutor(PoolWorker& w,
+                        std::unique_ptr<FaabricExecutor> executor);
+
+    void parkExecutor(PoolWorker& w);
+
+    void finishExecutor(PoolWorker& w,
+                        std::vector<faabric::Message> unfinished = {});
+
+    std::unique_ptr<FaabricExecutor> takeWarmExecutor(
+      const std::string& funcStr);
+
+    std::unique_ptr<FaabricExecutor> takeWarmExecutorWithBacklog();
+
+    void returnWarmExecutor(std::unique_ptr<FaabricExecutor> executor);
+
+    void clearWarmExecutors();
 };
 
 class ExecutorPoolFinishedException : public faabric::util::FaabricException
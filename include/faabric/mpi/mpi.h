@@ -247,6 +247,9 @@ enum {
 #define MPI_STATUS_IGNORE ((MPI_Status*)(0))
 #define MPI_STATUSES_IGNORE ((MPI_Status*)(0))
 
+// MPI_Requests
+#define MPI_REQUEST_NULL ((MPI_Request)(0))
+
 // Window attributes
 #define MPI_WIN_BASE 1
 #define MPI_WIN_SIZE 2
@@ -536,6 +539,8 @@ enum {
 
     int MPI_Wait(MPI_Request* request, MPI_Status* status);
 
+    int MPI_Test(MPI_Request* request, int* flag, MPI_Status* status);
+
     int MPI_Waitall(int count,
                     MPI_Request array_of_requests[],
                     MPI_Status* array_of_statuses);
@@ -97,12 +97,26 @@ class Redis
 
     void flushPipeline(long pipelineLength);
 
+    void setPipeline(const std::string& key, const uint8_t* value, size_t size);
+
+    void expirePipeline(const std::string& key, long expiry);
+
+    void enqueueBytesPipeline(const std::string& queueName,
+                              const uint8_t* buffer,
+                              size_t bufferLen);
+
     void getRange(const std::string& key,
                   uint8_t* buffer,
                   size_t bufferLen,
                   long start,
                   long end);
 
+    void getRangePipeline(const std::string& key, long start, long end);
+
+    void readRangePipelineReply(const std::string& key,
+                                uint8_t* buffer,
+                                size_t bufferLen);
+
     void sadd(const std::string& key, const std::string& value);
 
     void srem(const std::string& key, const std::string& value);
@@ -143,6 +157,10 @@ class Redis
 
     void releaseLock(const std::string& key, uint32_t lockId);
 
+    void notifyLockReleased(const std::string& key, int expirySeconds);
+
+    bool waitOnLockRelease(const std::string& key, int timeoutMs);
+
     void delIfEq(const std::string& key, uint32_t value);
 
     bool setnxex(const std::string& key, long value, int expirySeconds);
@@ -174,6 +192,10 @@ class Redis
                       size_t bufferLen,
                       int timeout = DEFAULT_TIMEOUT);
 
+    void dequeueBytesPipeline(const std::string& queueName);
+
+    std::vector<uint8_t> readDequeuePipelineReply(const std::string& queueName);
+
     void dequeueMultiple(const std::string& queueName,
                          uint8_t* buff,
                          long buffLen,
@@ -186,7 +208,14 @@ class Redis
 
     const RedisInstance& instance;
 
+    // Pipelined commands whose replies haven't been read yet
+    long pendingReplies = 0;
+
     redisReply* dequeueBase(const std::string& queueName, int timeout);
+
+    redisReply* readPipelineReply();
+
+    void abortPipeline(void* reply);
 };
 
 class RedisNoResponseException : public faabric::util::FaabricException
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#define CALL_RATE_EWMA_ALPHA 0.2
+
+namespace faabric::scheduler {
+
+struct FunctionCallRate
+{
+    long nArrivals = 0;
+    long lastArrivalMs = 0;
+
+    // Moving averages of the time between calls, and of the time each call
+    // spends queued and executing
+    double interArrivalMs = 0;
+    double residencyMs = 0;
+};
+
+/**
+ * Tracks the arrival rate and duration of calls to each function, to predict
+ * how many executors it will need. This isn't thread-safe, it's expected to be
+ * called with the scheduler's lock held.
+ */
+class CallRateTracker
+{
+  public:
+    explicit CallRateTracker(double alphaIn = CALL_RATE_EWMA_ALPHA);
+
+    void recordArrival(const std::string& funcStr, long nowMs);
+
+    void recordCompletion(const std::string& funcStr, long residencyMs);
+
+    int predictConcurrency(const std::string& funcStr,
+                           long nowMs,
+                           int headroomPct = 0);
+
+    FunctionCallRate getRate(const std::string& funcStr);
+
+    void clear();
+
+  private:
+    double alpha;
+
+    std::unordered_map<std::string, FunctionCallRate> rates;
+};
+}
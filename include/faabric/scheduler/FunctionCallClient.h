@@ -38,6 +38,28 @@ void queueResourceResponse(const std::string& host,
 
 void clearMockRequests();
 
+/**
+ * Answers calls to a host in mock mode, rather than them only being recorded.
+ * Lets a single process stand in for a cluster of hosts.
+ */
+class MockHost
+{
+  public:
+    virtual ~MockHost() = default;
+
+    virtual faabric::HostResources getResources() = 0;
+
+    virtual void executeFunctions(const faabric::BatchExecuteRequest& req) = 0;
+
+    // Hosts not running MPI can ignore messages
+    virtual void sendMPIMessage(std::shared_ptr<faabric::MPIMessage> msg) {}
+};
+
+void registerMockHost(const std::string& host,
+                      std::shared_ptr<MockHost> mockHost);
+
+void clearMockHosts();
+
 // -----------------------------------
 // gRPC client
 // -----------------------------------
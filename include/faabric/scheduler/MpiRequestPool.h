@@ -0,0 +1,61 @@
+#pragma once
+
+#include <faabric/mpi/mpi.h>
+#include <faabric/proto/faabric.pb.h>
+
+#include <deque>
+#include <vector>
+
+#define MPI_REQUEST_SLOT_BITS 16
+#define MPI_MAX_OUTSTANDING_REQUESTS (1 << MPI_REQUEST_SLOT_BITS)
+
+namespace faabric::scheduler {
+
+/**
+ * State for a single non-blocking send or receive. Sends are eager so
+ * complete straight away, receives complete when a message is matched to
+ * them.
+ */
+struct MpiRequest
+{
+    int id = -1;
+    bool inUse = false;
+    bool isRecv = false;
+    bool complete = false;
+
+    int sendRank = -1;
+    int recvRank = -1;
+    uint8_t* buffer = nullptr;
+    faabric_datatype_t* dataType = nullptr;
+    int count = 0;
+    int tag = MPI_ANY_TAG;
+    faabric::MPIMessage::MPIMessageType messageType =
+      faabric::MPIMessage::NORMAL;
+
+    MPI_Status status{};
+};
+
+/**
+ * Recycles request slots to avoid an allocation per request. The slot is
+ * held in the low bits of the request ID and a per-slot generation in the
+ * high bits, so stale IDs aren't mistaken for new requests.
+ */
+class MpiRequestPool
+{
+  public:
+    MpiRequest& acquire();
+
+    // Returns null if the request isn't outstanding
+    MpiRequest* get(int requestId);
+
+    void release(int requestId);
+
+    size_t getOutstandingCount();
+
+  private:
+    // Note, a deque so that references stay valid as it grows
+    std::deque<MpiRequest> slots;
+    std::vector<int> generations;
+    std::vector<int> freeSlots;
+};
+}
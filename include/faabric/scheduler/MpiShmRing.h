@@ -0,0 +1,97 @@
+#pragma once
+
+#include <faabric/proto/faabric.pb.h>
+
+#include <atomic>
+#include <memory>
+#include <pthread.h>
+#include <string>
+
+#define MPI_SHM_RING_SIZE (4 * 1024 * 1024)
+#define MPI_SHM_POLL_TIMEOUT_MS 100
+
+namespace faabric::scheduler {
+
+/**
+ * Lives at the start of the shared segment, followed by the ring data. The
+ * counters are totals, so the used space is always head - tail.
+ */
+struct MpiShmRingHeader
+{
+    std::atomic<uint32_t> ready;
+
+    // Robust, so that a writer dying while holding it can't block the others
+    pthread_mutex_t writeLock;
+
+    // Set while a writer is part way through a fragmented message
+    uint32_t writeOpen;
+
+    // Futex words for wake-ups
+    std::atomic<uint32_t> dataSeq;
+    std::atomic<uint32_t> spaceSeq;
+
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    uint64_t capacity;
+};
+
+/**
+ * Ring buffer of MPI messages in POSIX shared memory, used between ranks
+ * in different processes on the same machine. Any number of processes can
+ * write to a ring, but only its owner reads from it.
+ *
+ * Messages bigger than a fraction of the ring are split into fragments, so
+ * every message goes through the ring in the order it was sent.
+ */
+class MpiShmRing
+{
+  public:
+    static std::string getRingName(int worldId, const std::string& host);
+
+    // Creates the ring, which is unlinked when the owner is destroyed
+    static std::shared_ptr<MpiShmRing> create(const std::string& name,
+                                              size_t capacity);
+
+    // Opens an existing ring, returning null if there isn't one
+    static std::shared_ptr<MpiShmRing> open(const std::string& name);
+
+    ~MpiShmRing();
+
+    // Blocks until the whole message has been written
+    void push(const faabric::MPIMessage& msg);
+
+    // Returns false if nothing arrives before the timeout
+    bool pop(faabric::MPIMessage& msg, int timeoutMs);
+
+    size_t getCapacity();
+
+    size_t getUsedBytes();
+
+  private:
+    MpiShmRing(const std::string& name,
+               uint8_t* region,
+               size_t regionSize,
+               bool isOwner);
+
+    std::string name;
+    uint8_t* region;
+    size_t regionSize;
+    bool isOwner;
+
+    MpiShmRingHeader* header;
+    uint8_t* data;
+
+    // Fragments of the message being read, only used by the owner
+    std::string partial;
+
+    void lockWriters();
+
+    void unlockWriters();
+
+    void writeRecord(uint32_t word, const uint8_t* src, size_t len);
+
+    void copyIn(uint64_t offset, const uint8_t* src, size_t len);
+
+    void copyOut(uint64_t offset, uint8_t* dst, size_t len);
+};
+}
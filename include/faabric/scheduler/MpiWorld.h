@@ -4,8 +4,14 @@
 
 #include <faabric/proto/faabric.pb.h>
 #include <faabric/scheduler/InMemoryMessageQueue.h>
-#include <faabric/scheduler/MpiThreadPool.h>
+#include <faabric/scheduler/MpiShmRing.h>
+#include <faabric/scheduler/MpiRequestPool.h>
 #include <faabric/state/StateKeyValue.h>
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
 #include <thread>
 
 namespace faabric::scheduler {
@@ -17,6 +23,31 @@ struct MpiWorldState
     int worldSize;
 };
 
+/**
+ * Matching state for a single receiving rank. Receives are matched to
+ * messages in the order they're posted, and messages that arrive before a
+ * matching receive is posted are held in arrival order.
+ */
+struct MpiMatchState
+{
+    std::mutex mx;
+    std::deque<int> postedRecvs;
+    std::list<std::shared_ptr<faabric::MPIMessage>> unexpected;
+
+    // Bumped whenever a message is queued for this rank from any sender
+    std::condition_variable arrivedCv;
+    uint64_t nArrived = 0;
+};
+
+/**
+ * Memory registered as an RMA window by a rank on this host.
+ */
+struct MpiWindow
+{
+    uint8_t* ptr = nullptr;
+    size_t size = 0;
+};
+
 std::string getWorldStateKey(int worldId);
 
 std::string getRankStateKey(int worldId, int rankId);
@@ -26,6 +57,8 @@ class MpiWorld
   public:
     MpiWorld();
 
+    ~MpiWorld();
+
     void create(const faabric::Message& call, int newId, int newSize);
 
     void initialiseFromState(const faabric::Message& msg, int worldId);
@@ -66,7 +99,8 @@ class MpiWorld
               faabric_datatype_t* dataType,
               int count,
               faabric::MPIMessage::MPIMessageType messageType =
-                faabric::MPIMessage::NORMAL);
+                faabric::MPIMessage::NORMAL,
+              int tag = 0);
 
     int isend(int sendRank,
               int recvRank,
@@ -74,7 +108,8 @@ class MpiWorld
               faabric_datatype_t* dataType,
               int count,
               faabric::MPIMessage::MPIMessageType messageType =
-                faabric::MPIMessage::NORMAL);
+                faabric::MPIMessage::NORMAL,
+              int tag = 0);
 
     void broadcast(int sendRank,
                    const uint8_t* buffer,
@@ -90,7 +125,8 @@ class MpiWorld
               int count,
               MPI_Status* status,
               faabric::MPIMessage::MPIMessageType messageType =
-                faabric::MPIMessage::NORMAL);
+                faabric::MPIMessage::NORMAL,
+              int tag = MPI_ANY_TAG);
 
     int irecv(int sendRank,
               int recvRank,
@@ -98,9 +134,17 @@ class MpiWorld
               faabric_datatype_t* dataType,
               int count,
               faabric::MPIMessage::MPIMessageType messageType =
-                faabric::MPIMessage::NORMAL);
+                faabric::MPIMessage::NORMAL,
+              int tag = MPI_ANY_TAG);
+
+    void awaitAsyncRequest(int requestId, MPI_Status* status = nullptr);
 
-    void awaitAsyncRequest(int requestId);
+    bool testAsyncRequest(int requestId, MPI_Status* status = nullptr);
+
+    int awaitAnyAsyncRequest(const std::vector<int>& requestIds,
+                             MPI_Status* status = nullptr);
+
+    size_t getOutstandingRequestCount();
 
     void sendRecv(uint8_t* sendBuffer,
                   int sendcount,
@@ -111,7 +155,9 @@ class MpiWorld
                   faabric_datatype_t* recvDataType,
                   int recvRank,
                   int myRank,
-                  MPI_Status* status);
+                  MPI_Status* status,
+                  int sendTag = 0,
+                  int recvTag = MPI_ANY_TAG);
 
     void scatter(int sendRank,
                  int recvRank,
@@ -175,7 +221,10 @@ class MpiWorld
                   faabric_datatype_t* recvType,
                   int recvCount);
 
-    void probe(int sendRank, int recvRank, MPI_Status* status);
+    void probe(int sendRank,
+               int recvRank,
+               MPI_Status* status,
+               int tag = MPI_ANY_TAG);
 
     void barrier(int thisRank);
 
@@ -184,7 +233,8 @@ class MpiWorld
                 int sendCount,
                 uint8_t* recvBuffer,
                 faabric_datatype_t* recvType,
-                int recvCount);
+                int recvCount,
+                long offset = 0);
 
     void rmaPut(int sendRank,
                 uint8_t* sendBuffer,
@@ -192,7 +242,12 @@ class MpiWorld
                 int sendCount,
                 int recvRank,
                 faabric_datatype_t* recvType,
-                int recvCount);
+                int recvCount,
+                long offset = 0);
+
+    void rmaFlush(int sendRank);
+
+    void rmaFence(int rank);
 
     std::shared_ptr<InMemoryMpiQueue> getLocalQueue(int sendRank, int recvRank);
 
@@ -202,7 +257,9 @@ class MpiWorld
 
     void createWindow(const int winRank, const int winSize, uint8_t* windowPtr);
 
-    void synchronizeRmaWrite(const faabric::MPIMessage& msg, bool isRemote);
+    void freeWindow(int winRank);
+
+    void synchronizeRmaWrite(const faabric::MPIMessage& msg);
 
     double getWTime();
 
@@ -220,19 +277,104 @@ class MpiWorld
     std::shared_ptr<state::StateKeyValue> stateKV;
     std::unordered_map<int, std::string> rankHostMap;
 
-    std::unordered_map<std::string, uint8_t*> windowPointerMap;
+    std::unordered_map<int, MpiWindow> windows;
+
+    // Ranges written to windows on this host since they were last published
+    std::unordered_map<int, std::vector<std::pair<long, size_t>>>
+      unpublishedWrites;
+
+    // Whether any rank is on another host, once every rank's host is known
+    bool spreadKnown = false;
+    bool spread = false;
+
+    // Remote RMA puts not yet sent, keyed on sender and target
+    std::unordered_map<std::string, std::shared_ptr<faabric::MPIMessage>>
+      pendingRmaPuts;
 
     std::unordered_map<std::string, std::shared_ptr<InMemoryMpiQueue>>
       localQueueMap;
-    std::shared_ptr<faabric::scheduler::MpiAsyncThreadPool> threadPool;
+
+    std::unordered_map<int, MpiMatchState> matchStates;
 
     std::vector<int> cartProcsPerDim;
 
+    // Shared memory transport to ranks in other processes on this machine
+    std::shared_ptr<MpiShmRing> shmInbox;
+    std::unordered_map<std::string, std::shared_ptr<MpiShmRing>> shmPeers;
+    std::thread shmThread;
+    std::atomic<bool> shmRunning = false;
+
+    void startShmTransport();
+
+    void stopShmTransport();
+
+    bool sendShm(const std::string& otherHost, const faabric::MPIMessage& msg);
+
+    void sendRemote(const std::string& otherHost,
+                    const std::shared_ptr<faabric::MPIMessage>& m);
+
+    void writeWindow(int winRank,
+                     long offset,
+                     const uint8_t* data,
+                     size_t length);
+
+    uint8_t* getWindowRange(int winRank, long offset, size_t length);
+
+    void publishWrites(int winRank);
+
+    void publishWindow(int winRank);
+
+    bool isSpreadAcrossHosts();
+
+    void exchange(int rank,
+                  int sendRank,
+                  const uint8_t* sendBuffer,
+                  faabric_datatype_t* sendType,
+                  int sendCount,
+                  int recvRank,
+                  uint8_t* recvBuffer,
+                  faabric_datatype_t* recvType,
+                  int recvCount,
+                  faabric::MPIMessage::MPIMessageType messageType);
+
+    void bruckAllToAll(int rank,
+                       const uint8_t* sendBuffer,
+                       uint8_t* recvBuffer,
+                       size_t blockSize);
+
     void setUpStateKV();
 
     std::shared_ptr<state::StateKeyValue> getRankHostState(int rank);
 
-    int getMpiThreadPoolSize();
+    MpiMatchState& getMatchState(int recvRank);
+
+    bool pullMessage(int sendRank,
+                     int recvRank,
+                     bool block,
+                     long timeoutMs = 0);
+
+    void pullAllMessages(int recvRank);
+
+    bool waitForMessage(int sendRank, int recvRank, long timeoutMs = 0);
+
+    void notifyArrived(int recvRank);
+
+    void matchArrived(int recvRank, std::shared_ptr<faabric::MPIMessage>& m);
+
+    std::shared_ptr<faabric::MPIMessage> findUnexpected(
+      int sendRank,
+      int recvRank,
+      int tag,
+      faabric::MPIMessage::MPIMessageType messageType,
+      bool remove);
+
+    void doRecv(std::shared_ptr<faabric::MPIMessage>& m,
+                uint8_t* buffer,
+                faabric_datatype_t* dataType,
+                int count,
+                MPI_Status* status);
+
+    void finishAsyncRequest(MpiRequest& req, MPI_Status* status);
 
     void checkRankOnThisHost(int rank);
 
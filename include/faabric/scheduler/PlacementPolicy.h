@@ -0,0 +1,117 @@
+#pragma once
+
+#include <faabric/proto/faabric.pb.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace faabric::scheduler {
+
+/**
+ * What a placement policy knows about a batch request and the hosts it could
+ * go on. Host lists and resources are fetched lazily, as they may need remote
+ * calls.
+ */
+class PlacementContext
+{
+  public:
+    std::string thisHost;
+    std::string funcStr;
+    int nMessages = 0;
+    bool isMpi = false;
+
+    // Hosts already registered for this function, and holding the snapshot
+    std::vector<std::string> registeredHosts;
+    std::unordered_set<std::string> snapshotHosts;
+
+    std::function<std::vector<std::string>()> allHostsGetter;
+    std::function<faabric::HostResources(const std::string&)> resourcesGetter;
+
+    const std::vector<std::string>& getAllHosts();
+
+    std::vector<std::string> getCandidateHosts();
+
+    int getAvailable(const std::string& host);
+
+    void assign(const std::string& host, int n);
+
+  private:
+    bool fetchedAllHosts = false;
+    std::vector<std::string> allHosts;
+
+    std::unordered_map<std::string, int> available;
+};
+
+class PlacementPolicy
+{
+  public:
+    virtual ~PlacementPolicy() = default;
+
+    /**
+     * Returns the host for each message in the request, or an empty string if
+     * there's no capacity for it anywhere.
+     */
+    virtual std::vector<std::string> place(PlacementContext& ctx) = 0;
+
+  protected:
+    static void fillHost(PlacementContext& ctx,
+                         const std::string& host,
+                         std::vector<std::string>& placement,
+                         int& nextIdx);
+};
+
+/**
+ * Fills this host, then hosts registered for the function, then any others.
+ */
+class GreedyPolicy : public PlacementPolicy
+{
+  public:
+    std::vector<std::string> place(PlacementContext& ctx) override;
+};
+
+/**
+ * Uses as few hosts as possible, putting the request on the host it fits
+ * most tightly, or the emptiest host if it fits nowhere.
+ */
+class BinPackPolicy : public PlacementPolicy
+{
+  public:
+    std::vector<std::string> place(PlacementContext& ctx) override;
+};
+
+/**
+ * Spreads messages one at a time across the hosts with most free capacity.
+ */
+class SpreadPolicy : public PlacementPolicy
+{
+  public:
+    std::vector<std::string> place(PlacementContext& ctx) override;
+};
+
+/**
+ * Prefers this host, then hosts holding the request's snapshot, then hosts
+ * already registered for the function.
+ */
+class LocalityPolicy : public PlacementPolicy
+{
+  public:
+    std::vector<std::string> place(PlacementContext& ctx) override;
+};
+
+/**
+ * Keeps consecutive MPI ranks together, filling this host (where rank zero
+ * runs) then the hosts with most free capacity. Other requests are placed
+ * greedily.
+ */
+class MpiPackPolicy : public PlacementPolicy
+{
+  public:
+    std::vector<std::string> place(PlacementContext& ctx) override;
+};
+
+std::unique_ptr<PlacementPolicy> getPlacementPolicy(const std::string& name);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <faabric/scheduler/PlacementPolicy.h>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace faabric::scheduler {
+
+struct SimulatedRequest
+{
+    std::string funcStr;
+    int nMessages = 1;
+    int masterIdx = 0;
+    std::string snapshotKey;
+    bool isMpi = false;
+
+    // Arrival time and how long each message runs for, in ticks
+    int arrivalTick = 0;
+    int durationTicks = 1;
+};
+
+struct PlacementStats
+{
+    long nRequests = 0;
+    long nMessages = 0;
+
+    // Messages sent away from the request's master host
+    long nRemoteMessages = 0;
+
+    // Messages with no capacity anywhere
+    long nOverloaded = 0;
+
+    // Snapshots sent to hosts that didn't hold them already
+    long nSnapshotPushes = 0;
+
+    // Hosts each request was spread over
+    long totalHostsUsed = 0;
+    int maxHostsUsed = 0;
+
+    // Highest difference in load between the busiest and idlest host
+    int maxLoadImbalance = 0;
+
+    double meanHostsUsed() const;
+};
+
+/**
+ * Replays a stream of requests against a simulated cluster, to compare how
+ * placement policies behave without needing real hosts.
+ */
+class PlacementSimulator
+{
+  public:
+    PlacementSimulator(int nHostsIn, int coresPerHostIn);
+
+    PlacementStats run(PlacementPolicy& policy,
+                       const std::vector<SimulatedRequest>& requests);
+
+    static std::string hostName(int idx);
+
+  private:
+    int nHosts;
+    int coresPerHost;
+};
+}
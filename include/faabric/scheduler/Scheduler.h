@@ -1,18 +1,32 @@
 #pragma once
 
+#include <faabric/scheduler/CallRateTracker.h>
 #include <faabric/scheduler/ExecGraph.h>
 #include <faabric/scheduler/InMemoryMessageQueue.h>
+#include <faabric/scheduler/PlacementPolicy.h>
 
 #include <faabric/util/config.h>
 #include <faabric/util/func.h>
 #include <faabric/util/queue.h>
 
+#include <condition_variable>
 #include <shared_mutex>
 
 #define AVAILABLE_HOST_SET "available_hosts"
 
 namespace faabric::scheduler {
 
+/**
+ * Point-in-time view of a single function on this host, used for reporting.
+ */
+struct FunctionMetrics
+{
+    std::string funcStr;
+    long inFlight = 0;
+    long faaslets = 0;
+    long queueDepth = 0;
+};
+
 class Scheduler
 {
   public:
@@ -23,9 +37,16 @@ class Scheduler
     // ----------------------------------
     void callFunction(faabric::Message& msg, bool forceLocal = false);
 
+    void callFunction(faabric::Message&& msg, bool forceLocal = false);
+
     std::vector<std::string> callFunctions(faabric::BatchExecuteRequest& req,
                                            bool forceLocal = false);
 
+    // Moves messages executed on this host out of the request rather than
+    // copying them, so the request can't be used afterwards
+    std::vector<std::string> callFunctions(faabric::BatchExecuteRequest&& req,
+                                           bool forceLocal = false);
+
     void broadcastSnapshotDelete(const faabric::Message& msg,
                                  const std::string& snapshotKey);
 
@@ -35,12 +56,30 @@ class Scheduler
 
     void notifyCallFinished(const faabric::Message& msg);
 
+    void notifyCallsFinished(const std::vector<faabric::Message>& msgs);
+
     void notifyFaasletFinished(const faabric::Message& msg);
 
+    // Takes a slot for an executor that's already bound to the function and
+    // picks up work without a bind message
+    void notifyFaasletStarted(const faabric::Message& msg);
+
+    // Puts calls an executor couldn't run back on their function's queue,
+    // binding new faaslets to run them if needed
+    void requeueCalls(std::vector<faabric::Message>& msgs);
+
     long getFunctionInFlightCount(const faabric::Message& msg);
 
     long getFunctionFaasletCount(const faabric::Message& msg);
 
+    long getFunctionPrewarmCount(const faabric::Message& msg);
+
+    // Binds faaslets ahead of the load predicted from recent calls, run
+    // periodically when prewarming is on
+    void prewarmFaaslets();
+
+    FunctionCallRate getFunctionCallRate(const faabric::Message& msg);
+
     int getFunctionRegisteredHostCount(const faabric::Message& msg);
 
     std::unordered_set<std::string> getFunctionRegisteredHosts(
@@ -54,6 +93,8 @@ class Scheduler
 
     void setFunctionResult(faabric::Message& msg);
 
+    void setFunctionResults(std::vector<faabric::Message>& msgs);
+
     faabric::Message getFunctionResult(unsigned int messageId, int timeout);
 
     std::string getThisHost();
@@ -63,6 +104,15 @@ class Scheduler
 
     std::shared_ptr<InMemoryMessageQueue> getBindQueue();
 
+    // Lets idle executors wait for work on this host rather than polling.
+    // Callers get the epoch before looking for work, then wait for it to
+    // change, so nothing queued in between is missed.
+    uint64_t getWorkEpoch();
+
+    bool awaitWork(uint64_t epoch, long timeoutMs);
+
+    void notifyWork();
+
     std::unordered_set<std::string> getAvailableHosts();
 
     void addHostToGlobalSet();
@@ -78,6 +128,8 @@ class Scheduler
 
     void setThisHostResources(faabric::HostResources& res);
 
+    std::vector<FunctionMetrics> getFunctionMetrics();
+
     // ----------------------------------
     // Testing
     // ----------------------------------
@@ -107,14 +159,28 @@ class Scheduler
 
     std::shared_mutex mx;
 
+    std::mutex workMx;
+    std::condition_variable workCv;
+    uint64_t workEpoch = 0;
+
     std::unordered_map<std::string, std::shared_ptr<InMemoryMessageQueue>>
       queueMap;
     std::unordered_map<std::string, long> faasletCounts;
     std::unordered_map<std::string, long> inFlightCounts;
 
+    CallRateTracker callRates;
+    std::unordered_map<std::string, long> prewarmCounts;
+    std::unordered_map<std::string, faabric::Message> prewarmBindMsgs;
+
     faabric::HostResources thisHostResources;
     std::unordered_map<std::string, std::unordered_set<std::string>>
       registeredHosts;
+    std::unordered_map<std::string, std::unordered_set<std::string>>
+      snapshotHosts;
+
+    std::string placementPolicyName;
+    std::unique_ptr<PlacementPolicy> placementPolicy;
+    MpiPackPolicy mpiPlacementPolicy;
 
     std::vector<unsigned int> recordedMessagesAll;
     std::vector<unsigned int> recordedMessagesLocal;
@@ -124,14 +190,31 @@ class Scheduler
 
     void incrementInFlightCount(const faabric::Message& msg);
 
+    void decrementInFlightCount(const faabric::Message& msg);
+
     void addFaaslets(const faabric::Message& msg);
 
+    faabric::Message getBindMessage(const faabric::Message& msg);
+
+    void sendBindMessage(const faabric::Message& msg);
+
     ExecGraphNode getFunctionExecGraphNode(unsigned int msgId);
 
-    int scheduleFunctionsOnHost(const std::string& host,
-                                faabric::BatchExecuteRequest& req,
-                                std::vector<std::string>& records,
-                                int offset);
+    std::vector<std::string> doCallFunctions(faabric::BatchExecuteRequest& req,
+                                             bool forceLocal,
+                                             bool isOwned);
+
+    std::vector<std::string> placeFunctions(
+      const faabric::BatchExecuteRequest& req);
+
+    void setMpiRankHosts(faabric::BatchExecuteRequest& req,
+                         const std::vector<std::string>& placement);
+
+    void scheduleFunctionsOnHost(const std::string& host,
+                                 const std::string& funcStr,
+                                 faabric::BatchExecuteRequest& req,
+                                 std::vector<std::string>& records,
+                                 const std::vector<int>& idxs);
 };
 
 Scheduler& getScheduler();
@@ -26,6 +26,8 @@ class SnapshotRegistry
 
     size_t getSnapshotCount();
 
+    size_t getSnapshotBytes();
+
     void clear();
 
   private:
@@ -34,6 +36,9 @@ class SnapshotRegistry
     std::mutex snapshotsMx;
 
     int writeSnapshotToFd(const std::string& key);
+
+    void* copySnapshotFromFd(const faabric::util::SnapshotData& d,
+                             uint8_t* target);
 };
 
 SnapshotRegistry& getSnapshotRegistry();
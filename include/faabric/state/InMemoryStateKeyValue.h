@@ -9,6 +9,9 @@
 
 #include <faabric/util/clock.h>
 
+#include <condition_variable>
+#include <mutex>
+
 namespace faabric::state {
 enum InMemoryStateKeyStatus
 {
@@ -54,6 +57,16 @@ class InMemoryStateKeyValue final : public StateKeyValue
 
     AppendedInMemoryState& getAppendedValue(uint idx);
 
+    void lockGlobal() override;
+
+    void unlockGlobal() override;
+
+    StateLease acquireLease(const std::string& host, bool isRemote);
+
+    void releaseLease(const std::string& host, uint64_t leaseId);
+
+    bool revokeLease(uint64_t leaseId, int timeoutMs);
+
   private:
     const std::string thisIP;
     const std::string masterIP;
@@ -62,14 +75,38 @@ class InMemoryStateKeyValue final : public StateKeyValue
 
     InMemoryStateRegistry& stateRegistry;
 
-    std::shared_mutex globalLock;
+    // Master-side lease management. Lock requests are served in FIFO order,
+    // and remote holders are asked to give up their lease when others queue
+    std::mutex leaseMx;
+    std::condition_variable leaseCv;
+    uint64_t nextTicket = 0;
+    uint64_t servingTicket = 0;
+    uint64_t nextLeaseId = 1;
+    std::string leaseHolder;
+    uint64_t leaseHolderId = 0;
+    bool leaseHolderRemote = false;
+    std::chrono::steady_clock::time_point leaseExpiry;
+    uint64_t masterLeaseId = 0;
+
+    // Lease cached by a non-master host, re-entered without going to the
+    // master while it's valid
+    std::mutex localLockMx;
+    std::mutex cachedLeaseMx;
+    std::condition_variable cachedLeaseCv;
+    uint64_t cachedLeaseId = 0;
+    uint64_t revokedLeaseId = 0;
+    bool cachedLeaseContended = false;
+    std::chrono::steady_clock::time_point cachedLeaseExpiry;
+    bool inCriticalSection = false;
+
+    bool hasValidCachedLease();
+
+    bool revokeRemoteLease(const std::string& holder,
+                           uint64_t leaseId,
+                           int leaseMs);
 
     std::vector<AppendedInMemoryState> appendedData;
 
-    void lockGlobal() override;
-
-    void unlockGlobal() override;
-
     void pullFromRemote() override;
 
     void pullChunkFromRemote(long offset, size_t length) override;
@@ -7,6 +7,12 @@
 #include <faabric/util/locks.h>
 
 namespace faabric::state {
+/**
+ * Whole values are pulled and pushed with a single command, so are atomic.
+ * Chunk pulls and partial pushes are split into pipelined ranges, possibly
+ * over several connections, so readers may see some ranges updated and others
+ * not until the push completes.
+ */
 class RedisStateKeyValue final : public StateKeyValue
 {
   public:
@@ -16,6 +22,8 @@ class RedisStateKeyValue final : public StateKeyValue
 
     RedisStateKeyValue(const std::string& userIn, const std::string& keyIn);
 
+    ~RedisStateKeyValue() override;
+
     static size_t getStateSizeFromRemote(const std::string& userIn,
                                          const std::string& keyIn);
 
@@ -24,10 +32,23 @@ class RedisStateKeyValue final : public StateKeyValue
 
     static void clearAll(bool global);
 
+    // Gives back the remote lock if its lease has run out and nobody on this
+    // host holds it. Called when the lease expires.
+    void releaseExpiredLease();
+
   private:
     const std::string joinedKey;
 
+    std::mutex globalLockMutex;
     uint32_t lastRemoteLockId = 0;
+    faabric::util::TimePoint remoteLockAcquired;
+    bool remoteLockContended = false;
+
+    void releaseRemoteLock();
+
+    bool hasRemoteLease();
+
+    int getLeaseMs();
 
     void lockGlobal() override;
 
@@ -49,5 +70,17 @@ class RedisStateKeyValue final : public StateKeyValue
                                 long nValues) override;
 
     void clearAppendedFromRemote() override;
+
+    std::vector<StateChunk> splitIntoChunks(long offset, size_t length);
+
+    std::vector<StateChunk> splitIntoChunks(
+      const std::vector<StateChunk>& chunks);
+
+    void transferChunks(const std::vector<StateChunk>& chunks, bool isPush);
+
+    void transferChunksOnConnection(redis::Redis& redis,
+                                    const StateChunk* chunks,
+                                    size_t nChunks,
+                                    bool isPush);
 };
 }
@@ -2,8 +2,14 @@
 
 #include <faabric/state/StateKeyValue.h>
 
+#include <array>
+#include <atomic>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
+
+#define STATE_KV_MAP_SHARDS 32
+#define STATE_KV_THREAD_CACHE_SIZE 64
 
 namespace faabric::state {
 class State
@@ -28,13 +34,39 @@ class State
 
     size_t getKVCount();
 
+    // Total size of the values held locally
+    size_t getLocalBytes();
+
     std::string getThisIP();
 
   private:
     const std::string thisIP;
 
-    std::unordered_map<std::string, std::shared_ptr<StateKeyValue>> kvMap;
-    std::shared_mutex mapMutex;
+    // Keys are views onto the user and key held by each key-value, so lookups
+    // don't need to build a string
+    typedef std::pair<std::string_view, std::string_view> KVMapKey;
+
+    struct KVMapKeyHash
+    {
+        size_t operator()(const KVMapKey& k) const;
+    };
+
+    struct KVMapShard
+    {
+        std::shared_mutex mx;
+        std::unordered_map<KVMapKey,
+                           std::shared_ptr<StateKeyValue>,
+                           KVMapKeyHash>
+          kvMap;
+    };
+
+    std::array<KVMapShard, STATE_KV_MAP_SHARDS> shards;
+
+    // Changed whenever key-values are removed, which invalidates the handles
+    // cached by each thread
+    std::atomic<uint64_t> cacheEpoch;
+
+    KVMapShard& getShard(size_t hash);
 
     std::shared_ptr<StateKeyValue> doGetKV(const std::string& user,
                                            const std::string& key,
@@ -50,8 +50,10 @@ class StateClient
 
     void deleteState();
 
-    void lock();
+    StateLease lock(const std::string& requestHost);
 
-    void unlock();
+    void unlock(const std::string& requestHost, uint64_t leaseId);
+
+    bool releaseLease(uint64_t leaseId, int timeoutMs);
 };
 }
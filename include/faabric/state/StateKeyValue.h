@@ -41,6 +41,20 @@ class StateChunk
     uint8_t* data;
 };
 
+/**
+ * A time-limited grant of the global lock on a key. The holder can re-enter
+ * the lock locally until the lease expires or is revoked by the master.
+ */
+class StateLease
+{
+  public:
+    uint64_t id = 0;
+    int leaseMs = 0;
+
+    // Whether other hosts were already queued when this lease was granted
+    bool contended = false;
+};
+
 class StateKeyValue
 {
   public:
@@ -50,6 +64,8 @@ class StateKeyValue
 
     StateKeyValue(const std::string& userIn, const std::string& keyIn);
 
+    virtual ~StateKeyValue();
+
     const std::string user;
 
     const std::string key;
@@ -82,6 +98,9 @@ class StateKeyValue
 
     void pull();
 
+    // Pulls the chunk even if it's been pulled before
+    void pullChunk(long offset, size_t length);
+
     void pushPartial();
 
     void pushPartialMask(const std::shared_ptr<StateKeyValue>& maskKv);
@@ -102,6 +121,8 @@ class StateKeyValue
 
     size_t getSharedMemorySize() const;
 
+    size_t getResidentSize();
+
     void pushFull();
 
     virtual void lockGlobal() = 0;
@@ -118,6 +139,9 @@ class StateKeyValue
 
     void* sharedMemory = nullptr;
 
+    // Whether this host's copy can be dropped and pulled again later
+    std::atomic<bool> evictable = false;
+
     void doSet(const uint8_t* data);
 
     void doSetChunk(long offset, const uint8_t* buffer, size_t length);
@@ -140,6 +164,8 @@ class StateKeyValue
       const std::vector<StateChunk>& dirtyChunks) = 0;
 
   private:
+    friend class StateMemoryManager;
+
     // Flags for tracking allocation and initial pull
     std::atomic<bool> fullyAllocated = false;
     std::atomic<bool> fullyPulled = false;
@@ -147,6 +173,30 @@ class StateKeyValue
     void* dirtyMask = nullptr;
     bool isDirty = false;
 
+    // Residency tracking for eviction
+    std::vector<uint8_t> allocatedPages;
+    size_t residentSize = 0;
+    std::atomic<bool> referenced = false;
+    std::atomic<bool> pinned = false;
+    std::atomic<int> nMappings = 0;
+    std::atomic<int> nActiveReads = 0;
+
+    size_t evict();
+
+    void pin();
+
+    // Counts as an active read until it goes out of scope, even on error
+    class ActiveRead
+    {
+      public:
+        explicit ActiveRead(StateKeyValue& kvIn);
+
+        ~ActiveRead();
+
+      private:
+        StateKeyValue& kv;
+    };
+
     void zeroDirtyMask();
 
     void configureSize();
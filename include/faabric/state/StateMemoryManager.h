@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace faabric::state {
+class StateKeyValue;
+
+/**
+ * Tracks how much state memory is resident on this host, and evicts clean,
+ * non-master, unmapped key-values when over the configured budget. Victims
+ * are chosen with the CLOCK algorithm, and evicted values are pulled again
+ * lazily when next accessed.
+ */
+class StateMemoryManager
+{
+  public:
+    void registerKV(StateKeyValue* kv);
+
+    void unregisterKV(StateKeyValue* kv);
+
+    void addResident(StateKeyValue* kv, size_t nBytes);
+
+    size_t getResidentBytes();
+
+    size_t getEvictionCount();
+
+    size_t getEvictedBytes();
+
+  private:
+    std::mutex managerMutex;
+    std::vector<StateKeyValue*> kvs;
+    size_t clockHand = 0;
+
+    std::atomic<size_t> residentBytes = 0;
+    std::atomic<size_t> evictionCount = 0;
+    std::atomic<size_t> evictedBytes = 0;
+};
+
+StateMemoryManager& getStateMemoryManager();
+}
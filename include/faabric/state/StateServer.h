@@ -49,6 +49,10 @@ class StateServer final
                   const faabric::StateRequest* request,
                   faabric::StateResponse* response) override;
 
+    Status ReleaseLease(grpc::ServerContext* context,
+                        const faabric::StateRequest* request,
+                        faabric::StateResponse* response) override;
+
     Status Delete(grpc::ServerContext* context,
                   const faabric::StateRequest* request,
                   faabric::StateResponse* response) override;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <faabric/util/memory.h>
+
 #include <string>
 
 #define MPI_HOST_STATE_LEN 20
@@ -27,15 +29,31 @@ class SystemConfig
     std::string stateMode;
     std::string wasmVm;
     std::string deltaSnapshotEncoding;
+    AllocationPolicy memoryAllocPolicy;
 
     // Redis
     std::string redisStateHost;
     std::string redisQueueHost;
     std::string redisPort;
+    int redisStateChunkSize;
+    int redisStateWindow;
+    int redisStateConnections;
+
+    // State
+    int stateLockLeaseMs;
+    int stateMemoryBudgetMb;
 
     // Scheduling
     int noScheduler;
     int overrideCpuCount;
+    std::string placementPolicy;
+    int executorWarmCacheSize;
+    int executorLocalQueueSize;
+    int executorBatchSize;
+    std::string prewarmMode;
+    int prewarmMinExecutors;
+    int prewarmHeadroomPct;
+    int prewarmIntervalMs;
 
     // Worker-related timeouts
     int globalMessageTimeout;
@@ -52,12 +70,22 @@ class SystemConfig
 
     // MPI
     int defaultMpiWorldSize;
+    std::string mpiShmTransport;
+
+    // Tracing
+    std::string traceMode;
+    std::string traceFile;
+    std::string traceCollectorUrl;
 
     // Endpoint
     std::string endpointInterface;
     std::string endpointHost;
     int endpointPort;
     int endpointNumThreads;
+    int endpointResultPollMs;
+    int endpointBacklog;
+    int endpointMaxRequestSize;
+    std::string endpointPinThreads;
 
     SystemConfig();
 
@@ -10,4 +10,6 @@ std::string setEnvVar(const std::string& varName, const std::string& value);
 void unsetEnvVar(const std::string& varName);
 
 unsigned int getUsableCores();
+
+void pinThreadToCore(unsigned int core);
 }
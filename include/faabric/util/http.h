@@ -16,6 +16,10 @@ std::vector<uint8_t> readFileFromUrlWithHeader(
   const std::string& url,
   const std::shared_ptr<Http::Header::Header>& header);
 
+void postToUrl(const std::string& url,
+               const std::string& body,
+               const std::string& contentType = "application/json");
+
 class FaabricHttpException : public faabric::util::FaabricException
 {
   public:
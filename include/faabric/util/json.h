@@ -8,6 +8,9 @@ std::string messageToJson(const faabric::Message& msg);
 
 faabric::Message jsonToMessage(const std::string& jsonIn);
 
+// Parses without copying strings, overwriting the input
+faabric::Message jsonToMessageInPlace(std::string& jsonIn);
+
 class JsonFieldNotFound : public faabric::util::FaabricException
 {
   public:
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <string>
 #include <unistd.h>
+#include <vector>
+
+#define DEFAULT_HUGE_PAGE_SIZE (2 * 1024 * 1024)
 
 namespace faabric::util {
 struct AlignedChunk
@@ -25,4 +29,64 @@ size_t getRequiredHostPagesRoundDown(size_t nBytes);
 size_t alignOffsetDown(size_t offset);
 
 AlignedChunk getPageAlignedChunk(long offset, long length);
+
+// ----------------------------------------
+// Allocation policies
+// ----------------------------------------
+
+enum class HugePageMode
+{
+    None,
+    Transparent,
+    Explicit,
+};
+
+enum class NumaMode
+{
+    Default,
+    Local,
+    Interleave,
+    Bind,
+};
+
+struct AllocationClass
+{
+    // Applies to allocations of at least this many bytes
+    size_t minSize = 0;
+    HugePageMode hugePages = HugePageMode::None;
+    NumaMode numa = NumaMode::Default;
+    int numaNode = -1;
+};
+
+/**
+ * Allocation policies per size class, defined as e.g.
+ * "1048576:thp,local;1073741824:hugetlb,interleave". Options are none, thp,
+ * hugetlb, local, interleave and node=N.
+ */
+struct AllocationPolicy
+{
+    std::vector<AllocationClass> classes;
+
+    AllocationPolicy() = default;
+
+    explicit AllocationPolicy(const std::string& definition);
+
+    AllocationClass getClass(size_t size) const;
+
+    std::string toString() const;
+};
+
+size_t getHugePageAlignedSize(size_t size);
+
+// Looks up the class in the policy parsed from MEMORY_ALLOC_POLICY
+AllocationClass getAllocationClass(size_t size);
+
+void* allocateSharedMemory(size_t size, const AllocationClass& cls);
+
+int createMemoryFd(const std::string& name,
+                   size_t size,
+                   const AllocationClass& cls,
+                   bool& isHugeTlb);
+
+void applyAllocationClass(void* ptr, size_t size, const AllocationClass& cls);
 }
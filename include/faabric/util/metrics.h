@@ -0,0 +1,200 @@
+#pragma once
+
+#include <faabric/util/clock.h>
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define METRICS_SHARDS 16
+#define HISTOGRAM_SHARDS 4
+
+// Each power of two is split into 2^HISTOGRAM_SUB_BITS buckets, so recorded
+// values are accurate to within 1/16th
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS                                                      \
+    ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+namespace faabric::util {
+
+/**
+ * Counter split into per-thread shards so that hot paths on different
+ * threads don't contend on the same cache line. Reads sum the shards.
+ */
+class Counter
+{
+  public:
+    void inc(uint64_t n = 1);
+
+    uint64_t value() const;
+
+    void reset();
+
+  private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> value = 0;
+    };
+
+    std::array<Shard, METRICS_SHARDS> shards;
+};
+
+class Gauge
+{
+  public:
+    void set(int64_t v);
+
+    void inc(int64_t n = 1);
+
+    void dec(int64_t n = 1);
+
+    int64_t value() const;
+
+  private:
+    std::atomic<int64_t> v = 0;
+};
+
+/**
+ * Point-in-time copy of a histogram, used for reporting.
+ */
+struct HistogramSnapshot
+{
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    // Returns an upper bound on the value at the given percentile (0-100)
+    uint64_t getPercentile(double percentile) const;
+
+    double getMean() const;
+};
+
+/**
+ * Log-linear histogram in the style of HDR histograms, covering the full
+ * range of 64-bit values with fixed relative precision.
+ */
+class Histogram
+{
+  public:
+    void record(uint64_t value);
+
+    HistogramSnapshot snapshot() const;
+
+    uint64_t getCount() const;
+
+    void reset();
+
+    static size_t getBucketIndex(uint64_t value);
+
+    static uint64_t getBucketUpperBound(size_t idx);
+
+  private:
+    struct alignas(64) Shard
+    {
+        std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets{};
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> sum = 0;
+    };
+
+    std::array<Shard, HISTOGRAM_SHARDS> shards;
+    std::atomic<uint64_t> max = 0;
+};
+
+/**
+ * Records the time in microseconds between construction and destruction.
+ */
+class ScopedTimer
+{
+  public:
+    explicit ScopedTimer(Histogram& histIn);
+
+    ~ScopedTimer();
+
+  private:
+    Histogram& hist;
+    const TimePoint start;
+};
+
+/**
+ * Builds a response in the Prometheus text exposition format. All series for
+ * a given metric must be added together, as the type line is only written
+ * when the metric name changes.
+ */
+class PrometheusBuilder
+{
+  public:
+    void addCounter(const std::string& name,
+                    uint64_t value,
+                    const std::string& labels = "");
+
+    void addGauge(const std::string& name,
+                  int64_t value,
+                  const std::string& labels = "");
+
+    // Buckets are collapsed to powers of two to keep the output small
+    void addHistogram(const std::string& name, const HistogramSnapshot& snap);
+
+    std::string str() const;
+
+    // Formats a single label, escaping the value as required
+    static std::string label(const std::string& name, const std::string& value);
+
+    // Replaces any characters not allowed in metric names
+    static std::string sanitiseName(const std::string& name);
+
+  private:
+    std::string out;
+    std::string lastName;
+
+    void addType(const std::string& name, const char* type);
+
+    void addSample(const std::string& name,
+                   const std::string& labels,
+                   const std::string& value);
+};
+
+/**
+ * Named metrics for the whole process. Metrics are created on first use and
+ * never removed, so callers on hot paths can hold on to the reference.
+ */
+class MetricsRegistry
+{
+  public:
+    Counter& getCounter(const std::string& name);
+
+    Gauge& getGauge(const std::string& name);
+
+    Histogram& getHistogram(const std::string& name);
+
+    std::map<std::string, uint64_t> getCounterValues();
+
+    std::map<std::string, int64_t> getGaugeValues();
+
+    std::map<std::string, HistogramSnapshot> getHistogramSnapshots();
+
+    void printMetrics();
+
+    // Adds all metrics to the builder, with the given prefix on their names
+    void writePrometheus(PrometheusBuilder& builder,
+                         const std::string& prefix = "faabric_");
+
+    // Zeroes all metrics, keeping references valid
+    void reset();
+
+  private:
+    std::shared_mutex mx;
+
+    std::unordered_map<std::string, std::unique_ptr<Counter>> counters;
+    std::unordered_map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::unordered_map<std::string, std::unique_ptr<Histogram>> histograms;
+};
+
+MetricsRegistry& getMetrics();
+}
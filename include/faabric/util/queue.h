@@ -3,7 +3,9 @@
 #include <faabric/util/exception.h>
 #include <faabric/util/locks.h>
 
+#include <algorithm>
 #include <queue>
+#include <vector>
 
 namespace faabric::util {
 class QueueTimeoutException : public faabric::util::FaabricException
@@ -60,6 +62,54 @@ class Queue
         return value;
     }
 
+    /**
+     * Waits for at least one value, then takes up to maxValues without
+     * waiting for more
+     */
+    std::vector<T> dequeueBatch(size_t maxValues, long timeoutMs = 0)
+    {
+        UniqueLock lock(mx);
+
+        while (mq.empty()) {
+            if (timeoutMs > 0) {
+                std::cv_status returnVal = enqueueNotifier.wait_for(
+                  lock, std::chrono::milliseconds(timeoutMs));
+
+                if (returnVal == std::cv_status::timeout) {
+                    throw QueueTimeoutException("Timeout waiting for dequeue");
+                }
+            } else {
+                enqueueNotifier.wait(lock);
+            }
+        }
+
+        std::vector<T> values;
+        values.reserve(std::min(maxValues, mq.size()));
+        while (!mq.empty() && values.size() < maxValues) {
+            values.emplace_back(std::move(mq.front()));
+            mq.pop();
+        }
+
+        emptyNotifier.notify_one();
+
+        return values;
+    }
+
+    bool tryDequeue(T& value)
+    {
+        UniqueLock lock(mx);
+
+        if (mq.empty()) {
+            return false;
+        }
+
+        value = std::move(mq.front());
+        mq.pop();
+        emptyNotifier.notify_one();
+
+        return true;
+    }
+
     T* peek(long timeoutMs = 0)
     {
         UniqueLock lock(mx);
@@ -9,5 +9,8 @@ struct SnapshotData
     size_t size = 0;
     const uint8_t* data = nullptr;
     int fd = 0;
+
+    // Whether the fd is backed by explicit huge pages
+    bool hugeTlb = false;
 };
 }
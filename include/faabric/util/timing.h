@@ -1,20 +1,22 @@
 #pragma once
 
 #include <faabric/util/clock.h>
+#include <faabric/util/metrics.h>
+
 #include <string>
 
-#ifdef TRACE_ALL
+// Timings are always recorded, in microseconds, to a histogram named after
+// the timer. Each call site looks up its histogram once.
 #define PROF_BEGIN faabric::util::startGlobalTimer();
 #define PROF_START(name)                                                       \
     const faabric::util::TimePoint name = faabric::util::startTimer();
-#define PROF_END(name) faabric::util::logEndTimer(#name, name);
+#define PROF_END(name)                                                         \
+    {                                                                          \
+        static faabric::util::Histogram& name##Hist =                          \
+          faabric::util::getMetrics().getHistogram(#name "_us");               \
+        name##Hist.record(faabric::util::getTimeDiffMicros(name));             \
+    }
 #define PROF_SUMMARY faabric::util::printTimerTotals();
-#else
-#define PROF_BEGIN
-#define PROF_START(name)
-#define PROF_END(name)
-#define PROF_SUMMARY
-#endif
 
 namespace faabric::util {
 faabric::util::TimePoint startTimer();
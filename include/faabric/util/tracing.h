@@ -0,0 +1,190 @@
+#pragma once
+
+#include <faabric/proto/faabric.pb.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Finished spans are buffered and handed to the exporter in batches
+#define TRACE_EXPORT_BATCH_SIZE 64
+
+// Full batches beyond this many waiting to be exported are dropped
+#define TRACE_EXPORT_MAX_QUEUED_BATCHES 16
+
+namespace faabric::util {
+
+/**
+ * A single timed operation within a trace. Spans are linked to their parent
+ * through the parent's span ID, which may have been recorded on another host.
+ */
+struct Span
+{
+    uint64_t traceId = 0;
+    uint64_t spanId = 0;
+    uint64_t parentSpanId = 0;
+
+    std::string name;
+    std::string host;
+
+    // Microseconds since the epoch
+    uint64_t startMicros = 0;
+    uint64_t endMicros = 0;
+
+    std::map<std::string, std::string> attributes;
+};
+
+// Renders a span in the OTLP JSON encoding
+std::string spanToJson(const Span& span);
+
+class SpanExporter
+{
+  public:
+    virtual ~SpanExporter() = default;
+
+    virtual void exportSpans(const std::vector<Span>& spans) = 0;
+};
+
+/**
+ * Appends spans to a local file, one JSON object per line.
+ */
+class FileSpanExporter : public SpanExporter
+{
+  public:
+    explicit FileSpanExporter(const std::string& filePath);
+
+    void exportSpans(const std::vector<Span>& spans) override;
+
+  private:
+    std::mutex mx;
+    std::ofstream out;
+};
+
+/**
+ * Posts spans to an OpenTelemetry collector over OTLP/HTTP with JSON bodies.
+ */
+class OtlpSpanExporter : public SpanExporter
+{
+  public:
+    explicit OtlpSpanExporter(const std::string& urlIn);
+
+    void exportSpans(const std::vector<Span>& spans) override;
+
+  private:
+    const std::string url;
+};
+
+/**
+ * Keeps spans in memory. Used in tests in place of a collector.
+ */
+class InMemorySpanExporter : public SpanExporter
+{
+  public:
+    void exportSpans(const std::vector<Span>& spans) override;
+
+    std::vector<Span> getSpans();
+
+    void clear();
+
+  private:
+    std::mutex mx;
+    std::vector<Span> spans;
+};
+
+/**
+ * Records spans for this process. Tracing is off unless an exporter is set,
+ * either through TRACE_MODE or explicitly, in which case spans cost a single
+ * check of an atomic flag.
+ *
+ * Batches are exported on a background thread, so recording never waits on
+ * I/O. If the exporter falls behind, new batches are dropped and counted in
+ * the trace_dropped_spans metric.
+ */
+class Tracer
+{
+  public:
+    Tracer();
+
+    bool isEnabled() const;
+
+    // Setting a null exporter turns tracing off
+    void setExporter(std::shared_ptr<SpanExporter> exporterIn);
+
+    // Starts a child of the given context, or a new trace if it's empty
+    Span startSpan(const std::string& name,
+                   const faabric::TraceContext& parent);
+
+    void finishSpan(Span& span);
+
+    // Buffers a span that has already been timed
+    void recordSpan(Span span);
+
+    // Queues buffered spans and waits until everything queued is exported
+    void flush();
+
+    // Flushes and sets up the exporter from the system config again
+    void reset();
+
+  private:
+    std::atomic<bool> enabled = false;
+    std::string thisHost;
+
+    std::mutex mx;
+    std::shared_ptr<SpanExporter> exporter;
+    std::vector<Span> pending;
+
+    std::condition_variable queuedCv;
+    std::condition_variable exportedCv;
+    std::deque<std::pair<std::shared_ptr<SpanExporter>, std::vector<Span>>>
+      queued;
+    bool exporting = false;
+
+    void runExporter();
+};
+
+Tracer& getTracer();
+
+// Context of the innermost scoped span open on this thread, empty if none
+faabric::TraceContext getCurrentTraceContext();
+
+/**
+ * Times the enclosing scope as a span. Without an explicit parent the span is
+ * a child of the innermost span open on this thread. While open, the span
+ * becomes the current context for this thread.
+ */
+class ScopedSpan
+{
+  public:
+    explicit ScopedSpan(
+      const char* name,
+      const faabric::TraceContext& parent = faabric::TraceContext());
+
+    ~ScopedSpan();
+
+    ScopedSpan(const ScopedSpan&) = delete;
+
+    ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+    bool isActive() const;
+
+    // Context to propagate to calls and messages caused by this span
+    faabric::TraceContext context() const;
+
+    void setAttribute(const std::string& key, const std::string& value);
+
+  private:
+    bool active = false;
+    Span span;
+
+    uint64_t previousTraceId = 0;
+    uint64_t previousSpanId = 0;
+};
+
+uint64_t getEpochMicros();
+}
@@ -0,0 +1,415 @@
+#include <faabric/mpi/mpi.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <faabric/mpi-native/MpiExecutor.h>
+#include <faabric/util/environment.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+/**
+ * OSU-style point-to-point and collective benchmarks, with one rank per
+ * container. Output matches the in-process version, faabric_mpi_osu, so the
+ * two can be compared. Set OSU_MAX_SIZE, OSU_ITERATIONS and OSU_BENCHMARKS in
+ * mpi-native.env to change what's run.
+ */
+
+// Messages in flight in each iteration of the bandwidth tests
+#define OSU_WINDOW_SIZE 64
+
+// Messages larger than this run a tenth of the iterations
+#define OSU_LARGE_MESSAGE 8192
+
+int main(int argc, char** argv)
+{
+    auto logger = faabric::util::getLogger();
+    auto& scheduler = faabric::scheduler::getScheduler();
+    auto& conf = faabric::util::getSystemConfig();
+
+    bool __isRoot;
+    int __worldSize;
+    if (argc < 2) {
+        logger->debug("Non-root process started");
+        __isRoot = false;
+    } else if (argc < 3) {
+        logger->error("Root process started without specifying world size!");
+        return 1;
+    } else {
+        logger->debug("Root process started");
+        __worldSize = std::stoi(argv[2]);
+        __isRoot = true;
+        logger->debug("MPI World Size: {}", __worldSize);
+    }
+
+    // Pre-load message to bootstrap execution
+    if (__isRoot) {
+        faabric::Message msg = faabric::util::messageFactory("mpi", "exec");
+        msg.set_mpiworldsize(__worldSize);
+        scheduler.callFunction(msg);
+    }
+
+    {
+        faabric::executor::SingletonPool p;
+        p.startPool();
+    }
+
+    return 0;
+}
+
+static int maxSize;
+static int iterations;
+static std::vector<std::string> benchmarks;
+
+static int getIterations(int size)
+{
+    return size > OSU_LARGE_MESSAGE ? std::max(iterations / 10, 1)
+                                    : iterations;
+}
+
+static int getWarmup(int size)
+{
+    return std::max(getIterations(size) / 10, 1);
+}
+
+static bool shouldRun(const std::string& name)
+{
+    return benchmarks.empty() ||
+           std::find(benchmarks.begin(), benchmarks.end(), name) !=
+             benchmarks.end();
+}
+
+static void printHeader(int rank,
+                        int worldSize,
+                        const char* title,
+                        const char* valueLabel)
+{
+    if (rank == 0) {
+        printf("\n# %s\n", title);
+        printf("# Ranks: %i\n", worldSize);
+        printf("# %-10s %18s\n", "Size", valueLabel);
+    }
+}
+
+static void printRow(int size, double value)
+{
+    printf("%-12i %18.2f\n", size, value);
+    fflush(stdout);
+}
+
+// Point-to-point tests run between the first and last ranks
+static void runLatency(int rank, int worldSize)
+{
+    printHeader(rank, worldSize, "OSU MPI Latency Test", "Latency (us)");
+
+    int peer = worldSize - 1;
+    std::vector<char> sendBuf(maxSize, 'a');
+    std::vector<char> recvBuf(maxSize);
+
+    for (int size = 1; size <= maxSize; size *= 2) {
+        int iters = getIterations(size);
+        int warmup = getWarmup(size);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            double start = 0;
+            for (int i = 0; i < warmup + iters; i++) {
+                if (i == warmup) {
+                    start = MPI_Wtime();
+                }
+
+                MPI_Send(
+                  sendBuf.data(), size, MPI_CHAR, peer, 0, MPI_COMM_WORLD);
+                MPI_Recv(recvBuf.data(),
+                         size,
+                         MPI_CHAR,
+                         peer,
+                         0,
+                         MPI_COMM_WORLD,
+                         MPI_STATUS_IGNORE);
+            }
+
+            double elapsed = MPI_Wtime() - start;
+            printRow(size, elapsed * 1e6 / (2.0 * iters));
+        } else if (rank == peer) {
+            for (int i = 0; i < warmup + iters; i++) {
+                MPI_Recv(recvBuf.data(),
+                         size,
+                         MPI_CHAR,
+                         0,
+                         0,
+                         MPI_COMM_WORLD,
+                         MPI_STATUS_IGNORE);
+                MPI_Send(sendBuf.data(), size, MPI_CHAR, 0, 0, MPI_COMM_WORLD);
+            }
+        }
+    }
+}
+
+static void runBandwidth(int rank, int worldSize, bool bidirectional)
+{
+    printHeader(rank,
+                worldSize,
+                bidirectional ? "OSU MPI Bi-Directional Bandwidth Test"
+                              : "OSU MPI Bandwidth Test",
+                "Bandwidth (MB/s)");
+
+    int peer = worldSize - 1;
+    std::vector<char> sendBuf(maxSize, 'a');
+    std::vector<char> recvBuf(maxSize);
+    char ack = 0;
+    std::vector<MPI_Request> reqs;
+
+    bool isSender = rank == 0;
+    int other = isSender ? peer : 0;
+
+    for (int size = 1; size <= maxSize; size *= 2) {
+        int iters = getIterations(size);
+        int warmup = getWarmup(size);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        if (rank != 0 && rank != peer) {
+            continue;
+        }
+
+        double start = 0;
+        for (int i = 0; i < warmup + iters; i++) {
+            if (i == warmup) {
+                start = MPI_Wtime();
+            }
+
+            reqs.clear();
+            if (!isSender || bidirectional) {
+                for (int w = 0; w < OSU_WINDOW_SIZE; w++) {
+                    reqs.emplace_back();
+                    MPI_Irecv(recvBuf.data(),
+                              size,
+                              MPI_CHAR,
+                              other,
+                              0,
+                              MPI_COMM_WORLD,
+                              &reqs.back());
+                }
+            }
+
+            if (isSender || bidirectional) {
+                for (int w = 0; w < OSU_WINDOW_SIZE; w++) {
+                    reqs.emplace_back();
+                    MPI_Isend(sendBuf.data(),
+                              size,
+                              MPI_CHAR,
+                              other,
+                              0,
+                              MPI_COMM_WORLD,
+                              &reqs.back());
+                }
+            }
+
+            MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+
+            // Unidirectional senders wait for the whole window to land
+            if (!bidirectional && isSender) {
+                MPI_Recv(&ack,
+                         1,
+                         MPI_CHAR,
+                         other,
+                         0,
+                         MPI_COMM_WORLD,
+                         MPI_STATUS_IGNORE);
+            } else if (!bidirectional) {
+                MPI_Send(&ack, 1, MPI_CHAR, other, 0, MPI_COMM_WORLD);
+            }
+        }
+
+        if (isSender) {
+            double elapsed = MPI_Wtime() - start;
+            double bytes = (double)size * iters * OSU_WINDOW_SIZE;
+            if (bidirectional) {
+                bytes *= 2;
+            }
+
+            printRow(size, bytes / (elapsed * 1e6));
+        }
+    }
+}
+
+// Reports the latency of the operation averaged over all ranks
+template<typename F>
+static void runCollective(int rank,
+                          int worldSize,
+                          const char* title,
+                          int minSize,
+                          F op)
+{
+    printHeader(rank, worldSize, title, "Avg Latency (us)");
+
+    size_t bufSize = (size_t)maxSize * worldSize;
+    std::vector<char> sendBuf(bufSize, 1);
+    std::vector<char> recvBuf(bufSize);
+
+    for (int size = minSize; size <= maxSize; size *= 2) {
+        int iters = getIterations(size);
+        int warmup = getWarmup(size);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        double start = 0;
+        for (int i = 0; i < warmup + iters; i++) {
+            if (i == warmup) {
+                start = MPI_Wtime();
+            }
+
+            op(size, sendBuf.data(), recvBuf.data());
+        }
+
+        double latency = (MPI_Wtime() - start) * 1e6 / iters;
+        double total = 0;
+        MPI_Reduce(&latency, &total, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            printRow(size, total / worldSize);
+        }
+    }
+}
+
+static void runBarrier(int rank, int worldSize)
+{
+    if (rank == 0) {
+        printf("\n# OSU MPI Barrier Latency Test\n");
+        printf("# Ranks: %i\n", worldSize);
+        printf("# %18s\n", "Avg Latency (us)");
+    }
+
+    int iters = getIterations(0);
+    int warmup = getWarmup(0);
+
+    double start = 0;
+    for (int i = 0; i < warmup + iters; i++) {
+        if (i == warmup) {
+            start = MPI_Wtime();
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    double latency = (MPI_Wtime() - start) * 1e6 / iters;
+    double total = 0;
+    MPI_Reduce(&latency, &total, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        printf("  %18.2f\n", total / worldSize);
+    }
+}
+
+int faabric::executor::mpiFunc()
+{
+    // Keep logging out of the timings
+    spdlog::set_level(spdlog::level::err);
+
+    MPI_Init(NULL, NULL);
+
+    int rank;
+    int worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    if (worldSize < 2) {
+        printf("Need at least two ranks\n");
+        return 1;
+    }
+
+    maxSize = std::stoi(faabric::util::getEnvVar("OSU_MAX_SIZE", "1048576"));
+    iterations = std::stoi(faabric::util::getEnvVar("OSU_ITERATIONS", "100"));
+
+    std::stringstream names(faabric::util::getEnvVar("OSU_BENCHMARKS", ""));
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        benchmarks.push_back(name);
+    }
+
+    if (shouldRun("latency")) {
+        runLatency(rank, worldSize);
+    }
+
+    if (shouldRun("bw")) {
+        runBandwidth(rank, worldSize, false);
+    }
+
+    if (shouldRun("bibw")) {
+        runBandwidth(rank, worldSize, true);
+    }
+
+    if (shouldRun("barrier")) {
+        runBarrier(rank, worldSize);
+    }
+
+    if (shouldRun("bcast")) {
+        runCollective(rank,
+                      worldSize,
+                      "OSU MPI Broadcast Latency Test",
+                      1,
+                      [](int size, char* s, char* r) {
+                          MPI_Bcast(s, size, MPI_CHAR, 0, MPI_COMM_WORLD);
+                      });
+    }
+
+    // Reductions are over ints, so start at one int
+    if (shouldRun("reduce")) {
+        runCollective(rank,
+                      worldSize,
+                      "OSU MPI Reduce Latency Test",
+                      sizeof(int),
+                      [](int size, char* s, char* r) {
+                          MPI_Reduce(s,
+                                     r,
+                                     size / sizeof(int),
+                                     MPI_INT,
+                                     MPI_SUM,
+                                     0,
+                                     MPI_COMM_WORLD);
+                      });
+    }
+
+    if (shouldRun("allreduce")) {
+        runCollective(rank,
+                      worldSize,
+                      "OSU MPI Allreduce Latency Test",
+                      sizeof(int),
+                      [](int size, char* s, char* r) {
+                          MPI_Allreduce(s,
+                                        r,
+                                        size / sizeof(int),
+                                        MPI_INT,
+                                        MPI_SUM,
+                                        MPI_COMM_WORLD);
+                      });
+    }
+
+    if (shouldRun("allgather")) {
+        runCollective(
+          rank,
+          worldSize,
+          "OSU MPI Allgather Latency Test",
+          1,
+          [](int size, char* s, char* r) {
+              MPI_Allgather(
+                s, size, MPI_CHAR, r, size, MPI_CHAR, MPI_COMM_WORLD);
+          });
+    }
+
+    if (shouldRun("alltoall")) {
+        runCollective(
+          rank,
+          worldSize,
+          "OSU MPI All-to-All Latency Test",
+          1,
+          [](int size, char* s, char* r) {
+              MPI_Alltoall(
+                s, size, MPI_CHAR, r, size, MPI_CHAR, MPI_COMM_WORLD);
+          });
+    }
+
+    MPI_Finalize();
+
+    return MPI_SUCCESS;
+}
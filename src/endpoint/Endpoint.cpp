@@ -29,11 +29,16 @@ void Endpoint::start()
 
     Pistache::Address addr(Pistache::Ipv4::any(), Pistache::Port(this->port));
 
-    // Configure endpoint
-    auto opts = Pistache::Http::Endpoint::options()
-                  .threads(threadCount)
-                  .backlog(256)
-                  .flags(Pistache::Tcp::Options::ReuseAddr);
+    // Configure endpoint. Connections are kept alive between requests, and
+    // responses are small so shouldn't wait to be coalesced.
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    auto opts =
+      Pistache::Http::Endpoint::options()
+        .threads(threadCount)
+        .backlog(conf.endpointBacklog)
+        .maxRequestSize(conf.endpointMaxRequestSize)
+        .flags(Pistache::Tcp::Options::ReuseAddr |
+               Pistache::Tcp::Options::NoDelay);
 
     Pistache::Http::Endpoint httpEndpoint(addr);
     httpEndpoint.init(opts);
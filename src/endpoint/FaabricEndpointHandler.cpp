@@ -1,24 +1,227 @@
 #include <faabric/endpoint/FaabricEndpointHandler.h>
 
-#include <faabric/redis/Redis.h>
+#include <faabric/endpoint/ResultDispatcher.h>
 #include <faabric/scheduler/Scheduler.h>
+#include <faabric/snapshot/SnapshotRegistry.h>
+#include <faabric/state/State.h>
+#include <faabric/util/environment.h>
 #include <faabric/util/json.h>
 #include <faabric/util/logging.h>
+#include <faabric/util/metrics.h>
 #include <faabric/util/timing.h>
 
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/util/delimited_message_util.h>
+
+#include <atomic>
+#include <future>
+
 namespace faabric::endpoint {
+
+// Key for the connection ID in the peer's data
+#define CONNECTION_ID_KEY "faabric_connection_id"
+
+// Peer addresses are reused once they're freed, so connections get their own
+// IDs. Each connection is only handled on one thread, so it's set up lazily.
+static uint64_t getConnectionId(
+  const std::shared_ptr<Pistache::Tcp::Peer>& peer)
+{
+    static std::atomic<uint64_t> nextConnectionId = 1;
+
+    std::shared_ptr<void> data = peer->tryGetData(CONNECTION_ID_KEY);
+    if (data == nullptr) {
+        data = std::make_shared<uint64_t>(nextConnectionId++);
+        peer->putData(CONNECTION_ID_KEY, data);
+    }
+
+    return *std::static_pointer_cast<uint64_t>(data);
+}
+
+// Blocks until the handler responds, for callers outside the HTTP server
+static std::string waitForResponse(
+  const std::function<void(const ResponseCallback&)>& handle)
+{
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    handle([promise](const std::string& responseStr) {
+        promise->set_value(responseStr);
+    });
+
+    return future.get();
+}
+
+static std::string getResultResponse(const faabric::Message& result,
+                                     bool isBinary)
+{
+    // Binary callers get the empty result on timeout, as the scheduler gives
+    if (isBinary) {
+        return result.SerializeAsString();
+    } else if (result.type() == faabric::Message_MessageType_EMPTY) {
+        return "No response from function\n";
+    } else if (result.sgxresult().empty()) {
+        return result.outputdata() + "\n";
+    } else {
+        return faabric::util::getJsonOutput(result);
+    }
+}
+
+// Results in a batch are newline-delimited JSON, or length-delimited messages
+static std::string encodeBatchResult(const faabric::Message& msg, bool isBinary)
+{
+    if (!isBinary) {
+        return faabric::util::messageToJson(msg) + "\n";
+    }
+
+    std::string out;
+    {
+        google::protobuf::io::StringOutputStream stream(&out);
+        google::protobuf::util::SerializeDelimitedToZeroCopyStream(msg,
+                                                                   &stream);
+    }
+
+    return out;
+}
+
+// Returns an error response, or an empty string if the batch is valid
+static std::string parseBatch(const std::string& requestBody,
+                              bool isBinary,
+                              faabric::BatchExecuteRequest& req)
+{
+    if (requestBody.empty()) {
+        return "Empty request";
+    }
+
+    if (isBinary) {
+        if (!req.ParseFromArray(requestBody.data(), (int)requestBody.size())) {
+            return "Invalid request";
+        }
+    } else {
+        // One message per line
+        size_t start = 0;
+        while (start < requestBody.size()) {
+            size_t end = requestBody.find('\n', start);
+            if (end == std::string::npos) {
+                end = requestBody.size();
+            }
+
+            std::string line = requestBody.substr(start, end - start);
+            start = end + 1;
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+
+            try {
+                *req.add_messages() = faabric::util::jsonToMessageInPlace(line);
+            } catch (std::runtime_error& e) {
+                return "Invalid request";
+            }
+        }
+    }
+
+    if (req.messages_size() == 0) {
+        return "Empty request";
+    } else if (req.type() != faabric::BatchExecuteRequest::FUNCTIONS) {
+        return "Invalid request";
+    }
+
+    // The scheduler expects a batch to be for one function
+    const faabric::Message& firstMsg = req.messages().at(0);
+    for (const auto& m : req.messages()) {
+        if (m.user().empty()) {
+            return "Empty user";
+        } else if (m.function().empty()) {
+            return "Empty function";
+        } else if (m.user() != firstMsg.user() ||
+                   m.function() != firstMsg.function()) {
+            return "Batch must be for a single function";
+        }
+    }
+
+    return "";
+}
+
+// Spreads HTTP worker threads over the cores, each on its first request
+static void pinWorkerThread()
+{
+    static thread_local bool isPinned = false;
+    if (isPinned) {
+        return;
+    }
+    isPinned = true;
+
+    if (faabric::util::getSystemConfig().endpointPinThreads != "on") {
+        return;
+    }
+
+    static std::atomic<unsigned int> nextCore = 0;
+    unsigned int core = nextCore++ % faabric::util::getUsableCores();
+    faabric::util::pinThreadToCore(core);
+
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    logger->debug("Pinned HTTP worker thread to core {}", core);
+}
+
+/**
+ * Sends a response with chunked encoding, starting it on the first write.
+ */
+class ChunkedResponse
+{
+  public:
+    explicit ChunkedResponse(Pistache::Http::ResponseWriter writerIn)
+      : writer(std::move(writerIn))
+    {}
+
+    void write(const std::string& chunk, bool isLast)
+    {
+        if (stream == nullptr) {
+            stream = std::make_unique<Pistache::Http::ResponseStream>(
+              writer.stream(Pistache::Http::Code::Ok));
+        }
+
+        // An empty chunk would end the response
+        if (!chunk.empty()) {
+            *stream << chunk;
+        }
+
+        if (isLast) {
+            stream->ends();
+        } else {
+            stream->flush();
+        }
+    }
+
+  private:
+    Pistache::Http::ResponseWriter writer;
+    std::unique_ptr<Pistache::Http::ResponseStream> stream;
+};
+
 void FaabricEndpointHandler::onTimeout(const Pistache::Http::Request& request,
                                        Pistache::Http::ResponseWriter writer)
 {
     writer.send(Pistache::Http::Code::No_Content);
 }
 
+void FaabricEndpointHandler::onDisconnection(
+  const std::shared_ptr<Pistache::Tcp::Peer>& peer)
+{
+    // Responses still in flight have nowhere to go
+    std::shared_ptr<void> data = peer->tryGetData(CONNECTION_ID_KEY);
+    if (data != nullptr) {
+        getResponseSequencer().dropConnection(
+          *std::static_pointer_cast<uint64_t>(data));
+    }
+
+    Pistache::Http::Handler::onDisconnection(peer);
+}
+
 void FaabricEndpointHandler::onRequest(const Pistache::Http::Request& request,
                                        Pistache::Http::ResponseWriter response)
 {
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
     logger->debug("Faabric handler received request");
 
+    pinWorkerThread();
+
     // Very permissive CORS
     response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>(
       "*");
@@ -27,66 +230,295 @@ void FaabricEndpointHandler::onRequest(const Pistache::Http::Request& request,
     response.headers().add<Pistache::Http::Header::AccessControlAllowHeaders>(
       "User-Agent,Content-Type");
 
-    // Text response type
+    // Binary requests get binary responses, everything else is text
+    auto contentType =
+      request.headers().tryGet<Pistache::Http::Header::ContentType>();
+    static const Pistache::Http::Mime::MediaType protobufType =
+      Pistache::Http::Mime::MediaType::fromString(PROTOBUF_CONTENT_TYPE);
+    bool isBinary =
+      contentType != nullptr && contentType->mime() == protobufType;
+
     response.headers().add<Pistache::Http::Header::ContentType>(
-      Pistache::Http::Mime::MediaType("text/plain"));
+      Pistache::Http::Mime::MediaType(isBinary ? PROTOBUF_CONTENT_TYPE
+                                               : "text/plain"));
+
+    // Connections are kept alive, so requests may be pipelined. Responses are
+    // ready in any order, but must be sent in the order requests arrived.
+    uint64_t connectionId = getConnectionId(response.peer());
+    ResponseSequencer& sequencer = getResponseSequencer();
+
+    if (request.resource() == BATCH_PATH) {
+        auto chunked = std::make_shared<ChunkedResponse>(std::move(response));
+        StreamCallback write = sequencer.reserve(
+          connectionId, [chunked](const std::string& chunk, bool isLast) {
+              chunked->write(chunk, isLast);
+          });
+
+        handleBatch(request.body(), isBinary, write);
+        return;
+    }
+
+    // Synchronous calls are answered from the result dispatcher once their
+    // result arrives, so the writer has to outlive this call. The dispatcher
+    // also handles timeouts.
+    auto writer =
+      std::make_shared<Pistache::Http::ResponseWriter>(std::move(response));
+
+    // Metrics scrapes don't carry a message
+    if (request.resource() == METRICS_PATH) {
+        StreamCallback write = sequencer.reserve(
+          connectionId, [writer](const std::string& chunk, bool isLast) {
+              writer->send(Pistache::Http::Code::Ok, chunk);
+          });
+
+        write(handleMetrics(), true);
+        return;
+    }
 
     PROF_START(endpointRoundTrip)
 
-    // Set response timeout
-    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
-    response.timeoutAfter(std::chrono::milliseconds(conf.globalMessageTimeout));
+    StreamCallback write = sequencer.reserve(
+      connectionId,
+      [writer, endpointRoundTrip](const std::string& chunk, bool isLast) {
+          PROF_END(endpointRoundTrip)
+          writer->send(Pistache::Http::Code::Ok, chunk);
+      });
+    ResponseCallback respond = [write](const std::string& responseStr) {
+        write(responseStr, true);
+    };
 
-    // Parse message from JSON in request
-    const std::string requestStr = request.body();
-    std::string responseStr = handleFunction(requestStr);
+    if (isBinary) {
+        handleBinaryFunction(request.body(), respond);
+    } else {
+        handleFunction(request.body(), respond);
+    }
+}
 
-    PROF_END(endpointRoundTrip)
-    response.send(Pistache::Http::Code::Ok, responseStr);
+std::string FaabricEndpointHandler::handleFunction(std::string requestStr)
+{
+    return waitForResponse([this, &requestStr](const ResponseCallback& r) {
+        handleFunction(std::move(requestStr), r);
+    });
 }
 
-std::string FaabricEndpointHandler::handleFunction(
-  const std::string& requestStr)
+void FaabricEndpointHandler::handleFunction(std::string requestStr,
+                                            const ResponseCallback& respond)
 {
-    std::string responseStr;
     if (requestStr.empty()) {
-        responseStr = "Empty request";
-    } else {
-        faabric::Message msg = faabric::util::jsonToMessage(requestStr);
-        faabric::scheduler::Scheduler& sched =
-          faabric::scheduler::getScheduler();
+        respond("Empty request");
+        return;
+    }
+
+    // The request is our own copy, so can be parsed in place
+    faabric::Message msg;
+    try {
+        msg = faabric::util::jsonToMessageInPlace(requestStr);
+    } catch (std::runtime_error& e) {
+        respond("Invalid request");
+        return;
+    }
+
+    handleMessage(msg, false, respond);
+}
+
+std::string FaabricEndpointHandler::handleBinaryFunction(
+  const std::string& requestBody)
+{
+    return waitForResponse([this, &requestBody](const ResponseCallback& r) {
+        handleBinaryFunction(requestBody, r);
+    });
+}
 
-        if (msg.isstatusrequest()) {
-            responseStr = sched.getMessageStatus(msg.id());
+void FaabricEndpointHandler::handleBinaryFunction(
+  const std::string& requestBody,
+  const ResponseCallback& respond)
+{
+    if (requestBody.empty()) {
+        respond("Empty request");
+        return;
+    }
+
+    faabric::Message msg;
+    if (!msg.ParseFromArray(requestBody.data(), (int)requestBody.size())) {
+        respond("Invalid request");
+        return;
+    }
+
+    handleMessage(msg, true, respond);
+}
 
-        } else if (msg.isexecgraphrequest()) {
-            faabric::scheduler::ExecGraph execGraph =
-              sched.getFunctionExecGraph(msg.id());
-            responseStr = faabric::scheduler::execGraphToJson(execGraph);
+std::string FaabricEndpointHandler::handleBatch(const std::string& requestBody,
+                                               bool isBinary)
+{
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    auto responseStr = std::make_shared<std::string>();
 
-        } else if (msg.type() == faabric::Message_MessageType_FLUSH) {
-            const std::shared_ptr<spdlog::logger>& logger =
-              faabric::util::getLogger();
-            logger->debug("Broadcasting flush request");
+    handleBatch(requestBody,
+                isBinary,
+                [promise, responseStr](const std::string& chunk, bool isLast) {
+                    *responseStr += chunk;
+                    if (isLast) {
+                        promise->set_value(*responseStr);
+                    }
+                });
 
-            sched.broadcastFlush();
+    return future.get();
+}
+
+void FaabricEndpointHandler::handleBatch(const std::string& requestBody,
+                                         bool isBinary,
+                                         const StreamCallback& write)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+
+    faabric::BatchExecuteRequest req;
+    std::string errorStr = parseBatch(requestBody, isBinary, req);
+    if (!errorStr.empty()) {
+        write(errorStr, true);
+        return;
+    }
+
+    for (auto& m : *req.mutable_messages()) {
+        faabric::util::setMessageId(m);
+        m.set_masterhost(conf.endpointHost);
+    }
+
+    const std::string funcStr =
+      faabric::util::funcToString(req.messages().at(0), false);
+    logger->debug("Scheduling batch of {} {}", req.messages_size(), funcStr);
+
+    // Async calls get their message back straight away, the rest follow as
+    // they finish. This is worked out first, as the request is handed over.
+    std::string asyncResponses;
+    std::vector<unsigned int> syncIds;
+    for (const auto& m : req.messages()) {
+        if (m.isasync()) {
+            asyncResponses += encodeBatchResult(m, isBinary);
         } else {
-            responseStr = executeFunction(msg);
+            syncIds.push_back(m.id());
         }
     }
 
-    return responseStr;
+    // One scheduling decision for the whole batch
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    sch.callFunctions(std::move(req));
+
+    bool isFinished = syncIds.empty();
+    write(asyncResponses, isFinished);
+    if (isFinished) {
+        return;
+    }
+
+    auto nPending = std::make_shared<std::atomic<int>>((int)syncIds.size());
+    for (unsigned int msgId : syncIds) {
+        getResultDispatcher().awaitResult(
+          msgId,
+          conf.globalMessageTimeout,
+          [isBinary, nPending, write](faabric::Message& result) {
+              bool isLast = --(*nPending) == 0;
+              write(encodeBatchResult(result, isBinary), isLast);
+          });
+    }
+}
+
+void FaabricEndpointHandler::handleMessage(faabric::Message& msg,
+                                           bool isBinary,
+                                           const ResponseCallback& respond)
+{
+    faabric::scheduler::Scheduler& sched = faabric::scheduler::getScheduler();
+
+    if (msg.isstatusrequest()) {
+        respond(sched.getMessageStatus(msg.id()));
+
+    } else if (msg.isexecgraphrequest()) {
+        faabric::scheduler::ExecGraph execGraph =
+          sched.getFunctionExecGraph(msg.id());
+        respond(faabric::scheduler::execGraphToJson(execGraph));
+
+    } else if (msg.type() == faabric::Message_MessageType_FLUSH) {
+        const std::shared_ptr<spdlog::logger>& logger =
+          faabric::util::getLogger();
+        logger->debug("Broadcasting flush request");
+
+        sched.broadcastFlush();
+        respond("");
+    } else {
+        executeFunction(msg, isBinary, respond);
+    }
+}
+
+std::string FaabricEndpointHandler::handleMetrics()
+{
+    faabric::util::PrometheusBuilder builder;
+
+    // Host resources
+    faabric::scheduler::Scheduler& sched = faabric::scheduler::getScheduler();
+    faabric::HostResources res = sched.getThisHostResources();
+    builder.addGauge("faabric_host_cores", res.cores());
+    builder.addGauge("faabric_host_functions_in_flight",
+                     res.functionsinflight());
+    builder.addGauge("faabric_host_bound_executors", res.boundexecutors());
+    builder.addGauge("faabric_bind_queue_depth", sched.getBindQueue()->size());
+
+    // Per-function counts, each metric's series must be grouped together
+    std::vector<faabric::scheduler::FunctionMetrics> funcs =
+      sched.getFunctionMetrics();
+    std::vector<std::string> labels;
+    labels.reserve(funcs.size());
+    for (const auto& f : funcs) {
+        labels.emplace_back(
+          faabric::util::PrometheusBuilder::label("function", f.funcStr));
+    }
+
+    for (size_t i = 0; i < funcs.size(); i++) {
+        builder.addGauge(
+          "faabric_function_in_flight", funcs.at(i).inFlight, labels.at(i));
+    }
+
+    for (size_t i = 0; i < funcs.size(); i++) {
+        builder.addGauge(
+          "faabric_function_faaslets", funcs.at(i).faaslets, labels.at(i));
+    }
+
+    for (size_t i = 0; i < funcs.size(); i++) {
+        builder.addGauge(
+          "faabric_function_queue_depth", funcs.at(i).queueDepth, labels.at(i));
+    }
+
+    builder.addGauge("faabric_endpoint_pending_results",
+                     getResultDispatcher().getPendingCount());
+
+    // State and snapshots
+    faabric::state::State& state = faabric::state::getGlobalState();
+    builder.addGauge("faabric_state_kv_count", state.getKVCount());
+    builder.addGauge("faabric_state_bytes", state.getLocalBytes());
+
+    faabric::snapshot::SnapshotRegistry& reg =
+      faabric::snapshot::getSnapshotRegistry();
+    builder.addGauge("faabric_snapshot_count", reg.getSnapshotCount());
+    builder.addGauge("faabric_snapshot_bytes", reg.getSnapshotBytes());
+
+    // Counters and latency histograms from the rest of the process
+    faabric::util::getMetrics().writePrometheus(builder);
+
+    return builder.str();
 }
 
-std::string FaabricEndpointHandler::executeFunction(faabric::Message& msg)
+void FaabricEndpointHandler::executeFunction(faabric::Message& msg,
+                                             bool isBinary,
+                                             const ResponseCallback& respond)
 {
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
     faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
 
     if (msg.user().empty()) {
-        return "Empty user";
+        respond("Empty user");
+        return;
     } else if (msg.function().empty()) {
-        return "Empty function";
+        respond("Empty function");
+        return;
     }
 
     // Set message ID and master host
@@ -99,29 +531,34 @@ std::string FaabricEndpointHandler::executeFunction(faabric::Message& msg)
     const std::string funcStr = faabric::util::funcToString(msg, true);
     logger->debug("Worker HTTP thread {} scheduling {}", tid, funcStr);
 
+    // The message is handed over to the scheduler, so build the async
+    // response first. Binary callers get the message back, including its ID.
+    unsigned int msgId = msg.id();
+    bool isAsync = msg.isasync();
+    std::string asyncResponse;
+    if (isAsync && isBinary) {
+        asyncResponse = msg.SerializeAsString();
+    } else if (isAsync) {
+        asyncResponse = faabric::util::buildAsyncResponse(msg);
+    }
+
     // Schedule it
     faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
-    sch.callFunction(msg);
-
-    // Await result on global bus (may have been executed on a different worker)
-    if (msg.isasync()) {
-        return faabric::util::buildAsyncResponse(msg);
-    } else {
-        logger->debug("Worker thread {} awaiting {}", tid, funcStr);
+    sch.callFunction(std::move(msg));
 
-        try {
-            const faabric::Message result =
-              sch.getFunctionResult(msg.id(), conf.globalMessageTimeout);
-            logger->debug("Worker thread {} result {}", tid, funcStr);
-
-            if (result.sgxresult().empty()) {
-                return result.outputdata() + "\n";
-            } else {
-                return faabric::util::getJsonOutput(result);
-            }
-        } catch (faabric::redis::RedisNoResponseException& ex) {
-            return "No response from function\n";
-        }
+    if (isAsync) {
+        respond(asyncResponse);
+        return;
     }
+
+    // Await result on global bus (may have been executed on a different
+    // worker), without holding up this thread
+    logger->debug("Worker thread {} deferring {}", tid, funcStr);
+    getResultDispatcher().awaitResult(
+      msgId,
+      conf.globalMessageTimeout,
+      [isBinary, respond](faabric::Message& result) {
+          respond(getResultResponse(result, isBinary));
+      });
 }
 }
@@ -0,0 +1,84 @@
+#include <faabric/endpoint/ResponseSequencer.h>
+
+namespace faabric::endpoint {
+
+StreamCallback ResponseSequencer::reserve(uint64_t connectionId,
+                                          StreamCallback sink)
+{
+    auto slot = std::make_shared<Slot>();
+    slot->sink = std::move(sink);
+
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        connections[connectionId].push_back(slot);
+    }
+
+    return [this, connectionId, slot](const std::string& chunk, bool isLast) {
+        write(connectionId, slot, chunk, isLast);
+    };
+}
+
+void ResponseSequencer::dropConnection(uint64_t connectionId)
+{
+    std::unique_lock<std::mutex> lock(mx);
+    connections.erase(connectionId);
+}
+
+size_t ResponseSequencer::getConnectionCount()
+{
+    std::unique_lock<std::mutex> lock(mx);
+    return connections.size();
+}
+
+void ResponseSequencer::write(uint64_t connectionId,
+                              const std::shared_ptr<Slot>& slot,
+                              const std::string& chunk,
+                              bool isLast)
+{
+    // Sinks don't block, so are called with the lock held to keep the order
+    std::unique_lock<std::mutex> lock(mx);
+    auto it = connections.find(connectionId);
+    if (it == connections.end()) {
+        // Already finished, or the connection has closed
+        return;
+    }
+
+    std::deque<std::shared_ptr<Slot>>& slots = it->second;
+    if (slots.front() != slot) {
+        slot->buffered += chunk;
+        slot->isFinished = isLast;
+        return;
+    }
+
+    slot->sink(chunk, isLast);
+    if (!isLast) {
+        return;
+    }
+
+    // Send on anything that was waiting behind this response
+    slots.pop_front();
+    while (!slots.empty()) {
+        std::shared_ptr<Slot>& next = slots.front();
+        if (!next->buffered.empty() || next->isFinished) {
+            next->sink(next->buffered, next->isFinished);
+            next->buffered.clear();
+        }
+
+        if (!next->isFinished) {
+            break;
+        }
+
+        slots.pop_front();
+    }
+
+    if (slots.empty()) {
+        connections.erase(it);
+    }
+}
+
+ResponseSequencer& getResponseSequencer()
+{
+    static ResponseSequencer sequencer;
+    return sequencer;
+}
+}
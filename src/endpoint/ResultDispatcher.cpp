@@ -0,0 +1,225 @@
+#include <faabric/endpoint/ResultDispatcher.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/clock.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+namespace faabric::endpoint {
+
+typedef std::pair<ResultCallback, faabric::Message> CompletedResult;
+
+static faabric::Message emptyResult(unsigned int messageId)
+{
+    faabric::Message msg;
+    msg.set_id(messageId);
+    msg.set_type(faabric::Message_MessageType_EMPTY);
+    return msg;
+}
+
+static void invokeCallbacks(std::vector<CompletedResult>& completed)
+{
+    for (auto& c : completed) {
+        try {
+            c.first(c.second);
+        } catch (std::exception& e) {
+            const std::shared_ptr<spdlog::logger>& logger =
+              faabric::util::getLogger();
+            logger->error(
+              "Result callback for {} failed: {}", c.second.id(), e.what());
+        }
+    }
+}
+
+ResultDispatcher::ResultDispatcher() = default;
+
+ResultDispatcher::~ResultDispatcher()
+{
+    shutdown();
+}
+
+void ResultDispatcher::awaitResult(unsigned int messageId,
+                                   int timeoutMs,
+                                   ResultCallback callback)
+{
+    if (messageId == 0) {
+        throw std::runtime_error("Must provide non-zero message ID");
+    }
+
+    long deadlineMs = faabric::util::getGlobalClock().epochMillis() + timeoutMs;
+
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        pending[messageId].push_back({ deadlineMs, std::move(callback) });
+
+        if (!running) {
+            start();
+        }
+    }
+
+    cv.notify_one();
+}
+
+size_t ResultDispatcher::getPendingCount()
+{
+    std::unique_lock<std::mutex> lock(mx);
+
+    size_t count = 0;
+    for (const auto& p : pending) {
+        count += p.second.size();
+    }
+
+    return count;
+}
+
+int ResultDispatcher::poll()
+{
+    long nowMs = faabric::util::getGlobalClock().epochMillis();
+
+    // Expire overdue calls and take a snapshot of the rest
+    std::vector<CompletedResult> completed;
+    std::vector<unsigned int> messageIds;
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        messageIds.reserve(pending.size());
+
+        for (auto it = pending.begin(); it != pending.end();) {
+            std::vector<PendingResult>& waiters = it->second;
+            for (auto w = waiters.begin(); w != waiters.end();) {
+                if (w->deadlineMs <= nowMs) {
+                    completed.emplace_back(std::move(w->callback),
+                                           emptyResult(it->first));
+                    w = waiters.erase(w);
+                } else {
+                    w++;
+                }
+            }
+
+            if (waiters.empty()) {
+                it = pending.erase(it);
+            } else {
+                messageIds.push_back(it->first);
+                it++;
+            }
+        }
+    }
+
+    // Check the result keys in batches, each batch in one round trip
+    redis::Redis& redis = redis::Redis::getQueue();
+    std::vector<std::string> keys;
+    std::vector<faabric::Message> results;
+    for (size_t start = 0; start < messageIds.size();
+         start += RESULT_POLL_BATCH_SIZE) {
+        size_t end =
+          std::min<size_t>(start + RESULT_POLL_BATCH_SIZE, messageIds.size());
+
+        keys.clear();
+        for (size_t i = start; i < end; i++) {
+            keys.emplace_back(
+              faabric::util::resultKeyFromMessageId(messageIds.at(i)));
+            redis.dequeueBytesPipeline(keys.back());
+        }
+
+        results.clear();
+        for (const auto& key : keys) {
+            std::vector<uint8_t> bytes = redis.readDequeuePipelineReply(key);
+            if (!bytes.empty()) {
+                results.emplace_back();
+                results.back().ParseFromArray(bytes.data(), (int)bytes.size());
+            }
+        }
+
+        if (results.empty()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mx);
+        for (auto& result : results) {
+            auto it = pending.find(result.id());
+            if (it == pending.end()) {
+                continue;
+            }
+
+            for (auto& w : it->second) {
+                completed.emplace_back(std::move(w.callback), result);
+            }
+            pending.erase(it);
+        }
+    }
+
+    invokeCallbacks(completed);
+
+    return (int)completed.size();
+}
+
+void ResultDispatcher::shutdown()
+{
+    std::unordered_map<unsigned int, std::vector<PendingResult>> remaining;
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        running = false;
+        remaining.swap(pending);
+    }
+
+    cv.notify_all();
+    if (pollThread.joinable()) {
+        pollThread.join();
+    }
+
+    // Don't leave anyone waiting
+    std::vector<CompletedResult> completed;
+    for (auto& p : remaining) {
+        for (auto& w : p.second) {
+            completed.emplace_back(std::move(w.callback), emptyResult(p.first));
+        }
+    }
+
+    invokeCallbacks(completed);
+}
+
+void ResultDispatcher::start()
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    logger->debug("Starting result dispatcher");
+
+    if (pollThread.joinable()) {
+        pollThread.join();
+    }
+
+    running = true;
+    pollThread = std::thread([this] { run(); });
+}
+
+void ResultDispatcher::run()
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    auto interval = std::chrono::milliseconds(
+      faabric::util::getSystemConfig().endpointResultPollMs);
+
+    std::unique_lock<std::mutex> lock(mx);
+    while (running) {
+        if (pending.empty()) {
+            cv.wait(lock, [this] { return !running || !pending.empty(); });
+            continue;
+        }
+
+        lock.unlock();
+        try {
+            poll();
+        } catch (std::runtime_error& e) {
+            // Calls still time out if Redis stays unavailable
+            logger->error("Failed polling for results: {}", e.what());
+        }
+        lock.lock();
+
+        cv.wait_for(lock, interval, [this] { return !running; });
+    }
+}
+
+ResultDispatcher& getResultDispatcher()
+{
+    static ResultDispatcher dispatcher;
+    return dispatcher;
+}
+}
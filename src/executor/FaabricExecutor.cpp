@@ -2,7 +2,10 @@
 #include <faabric/executor/FaabricExecutor.h>
 
 #include <faabric/state/State.h>
+#include <faabric/util/clock.h>
 #include <faabric/util/config.h>
+#include <faabric/util/metrics.h>
+#include <faabric/util/tracing.h>
 
 namespace faabric::executor {
 FaabricExecutor::FaabricExecutor(int threadIdxIn)
@@ -53,12 +56,69 @@ bool FaabricExecutor::isBound()
     return _isBound;
 }
 
-void FaabricExecutor::finish()
+/**
+ * Gives up this executor's slot with the scheduler, but keeps it bound so that
+ * it can be reused without binding again.
+ */
+void FaabricExecutor::release()
 {
-    if (_isBound) {
-        // Notify scheduler if this thread was bound to a function
+    if (_isBound && !_isReleased) {
         scheduler.notifyFaasletFinished(boundMessage);
+        _isReleased = true;
+    }
+}
+
+/**
+ * Marks this executor as holding a slot again when it's reused to handle a
+ * bind message. The slot itself was taken by the scheduler when it sent the
+ * bind, so nothing is claimed here.
+ */
+void FaabricExecutor::rebind()
+{
+    if (!_isBound) {
+        throw std::runtime_error("Cannot rebind unbound executor");
+    }
+
+    _isReleased = false;
+}
+
+/**
+ * Takes up a new slot with the scheduler for the function this executor is
+ * already bound to, for when it picks up work without a bind message.
+ */
+void FaabricExecutor::acquire()
+{
+    if (_isBound && _isReleased) {
+        scheduler.notifyFaasletStarted(boundMessage);
+        _isReleased = false;
     }
+}
+
+bool FaabricExecutor::isReleased()
+{
+    return _isReleased;
+}
+
+int FaabricExecutor::getExecutionCount()
+{
+    return executionCount;
+}
+
+const faabric::Message& FaabricExecutor::getBoundMessage()
+{
+    return boundMessage;
+}
+
+std::shared_ptr<faabric::scheduler::InMemoryMessageQueue>
+FaabricExecutor::getCurrentQueue()
+{
+    return currentQueue;
+}
+
+void FaabricExecutor::finish()
+{
+    // Notify scheduler if this thread was bound to a function
+    release();
 
     // Hook
     this->postFinish();
@@ -96,6 +156,39 @@ void FaabricExecutor::finishCall(faabric::Message& msg,
     this->postFinishCall();
 }
 
+void FaabricExecutor::finishCalls(std::vector<faabric::Message>& msgs,
+                                  const std::vector<std::string>& errors)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    for (size_t i = 0; i < msgs.size(); i++) {
+        bool success = errors.at(i).empty();
+
+        // Hook
+        this->preFinishCall(msgs.at(i), success, errors.at(i));
+
+        const std::string funcStr =
+          faabric::util::funcToString(msgs.at(i), true);
+        logger->info("Finished {}", funcStr);
+        if (!success) {
+            msgs.at(i).set_outputdata(errors.at(i));
+        }
+    }
+
+    fflush(stdout);
+
+    // Update the scheduler and publish all the results at once
+    scheduler.notifyCallsFinished(msgs);
+    scheduler.setFunctionResults(msgs);
+
+    executionCount += msgs.size();
+
+    // Hook
+    for (size_t i = 0; i < msgs.size(); i++) {
+        this->postFinishCall();
+    }
+}
+
 void FaabricExecutor::run()
 {
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
@@ -130,13 +223,41 @@ std::string FaabricExecutor::processNextMessage()
 
     // Work out which timeout
     int timeoutMs;
-    faabric::util::SystemConfig conf = faabric::util::getSystemConfig();
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
     if (_isBound) {
         timeoutMs = conf.boundTimeout;
     } else {
         timeoutMs = conf.unboundTimeout;
     }
 
+    // Once bound, take as many calls as are queued, up to the batch size
+    if (_isBound && conf.executorBatchSize > 1) {
+        std::vector<faabric::Message> msgs =
+          currentQueue->dequeueBatch(conf.executorBatchSize, timeoutMs);
+
+        std::string errorMessage;
+        std::vector<faabric::Message> calls;
+        for (auto& msg : msgs) {
+            if (msg.type() != faabric::Message_MessageType_FLUSH) {
+                calls.emplace_back(std::move(msg));
+                continue;
+            }
+
+            if (!calls.empty()) {
+                errorMessage = this->executeBatch(calls);
+                calls.clear();
+            }
+
+            flush();
+        }
+
+        if (!calls.empty()) {
+            errorMessage = this->executeBatch(calls);
+        }
+
+        return errorMessage;
+    }
+
     faabric::Message msg = currentQueue->dequeue(timeoutMs);
 
     std::string errorMessage;
@@ -167,6 +288,75 @@ std::string FaabricExecutor::executeCall(faabric::Message& call)
     const std::string funcStr = faabric::util::funcToString(call, true);
     logger->info("Faaslet executing {}", funcStr);
 
+    std::string errorMessage = runCall(call);
+
+    this->finishCall(call, errorMessage.empty(), errorMessage);
+    return errorMessage;
+}
+
+std::string FaabricExecutor::executeBatch(std::vector<faabric::Message>& calls)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    const std::string funcStr =
+      faabric::util::funcToString(boundMessage, false);
+    logger->info("Faaslet executing batch of {} {}", calls.size(), funcStr);
+
+    std::vector<std::string> errors = this->doExecuteBatch(calls);
+    if (errors.size() != calls.size()) {
+        logger->error("Batch of {} calls returned {} results",
+                      calls.size(),
+                      errors.size());
+        throw std::runtime_error("Batch execution returned wrong result count");
+    }
+
+    this->finishCalls(calls, errors);
+
+    // Report the first failure
+    for (const auto& e : errors) {
+        if (!e.empty()) {
+            return e;
+        }
+    }
+
+    return "";
+}
+
+std::string FaabricExecutor::runCall(faabric::Message& call)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    static faabric::util::Histogram& queueWaitHist =
+      faabric::util::getMetrics().getHistogram("executor_queue_wait_us");
+    static faabric::util::Histogram& runHist =
+      faabric::util::getMetrics().getHistogram("executor_run_us");
+
+    // Note, the call timestamp is only accurate to the millisecond
+    if (call.timestamp() > 0) {
+        long waitMillis =
+          faabric::util::getGlobalClock().epochMillis() - call.timestamp();
+        queueWaitHist.record(std::max<long>(waitMillis, 0) * 1000);
+    }
+
+    // Time from the call being made to it being picked up here
+    faabric::util::Tracer& tracer = faabric::util::getTracer();
+    if (tracer.isEnabled() && call.timestamp() > 0) {
+        faabric::util::Span queueSpan =
+          tracer.startSpan("executor_queue", call.tracecontext());
+        queueSpan.startMicros = (uint64_t)call.timestamp() * 1000;
+        queueSpan.attributes["executor"] = id;
+        tracer.finishSpan(queueSpan);
+    }
+
+    // Any calls chained from this one are recorded as its children
+    faabric::util::ScopedSpan span("executor_execute", call.tracecontext());
+    if (span.isActive()) {
+        span.setAttribute("function", faabric::util::funcToString(call, true));
+        span.setAttribute("executor", id);
+    }
+
+    faabric::util::ScopedTimer timer(runHist);
+
     // Create and execute the module
     bool success;
     std::string errorMessage;
@@ -185,7 +375,6 @@ std::string FaabricExecutor::executeCall(faabric::Message& call)
           ")";
     }
 
-    this->finishCall(call, success, errorMessage);
     return errorMessage;
 }
 
@@ -198,6 +387,23 @@ bool FaabricExecutor::doExecute(faabric::Message& msg)
     return true;
 }
 
+/**
+ * Executes a batch of calls to the bound function, returning an error message
+ * for each failed call, or an empty string if it succeeded. By default calls
+ * are executed one at a time.
+ */
+std::vector<std::string> FaabricExecutor::doExecuteBatch(
+  std::vector<faabric::Message>& msgs)
+{
+    std::vector<std::string> errors;
+    errors.reserve(msgs.size());
+    for (auto& msg : msgs) {
+        errors.emplace_back(runCall(msg));
+    }
+
+    return errors;
+}
+
 void FaabricExecutor::postBind(const faabric::Message& msg, bool force) {}
 
 void FaabricExecutor::preFinishCall(faabric::Message& call,
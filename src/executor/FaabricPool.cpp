@@ -1,14 +1,31 @@
 #include <faabric/executor/FaabricExecutor.h>
 #include <faabric/executor/FaabricPool.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
 
+#include <iterator>
+
 namespace faabric::executor {
+static std::string getExecutorFuncStr(FaabricExecutor* executor)
+{
+    if (executor == nullptr || !executor->isBound()) {
+        return "";
+    }
+
+    return faabric::util::funcToString(executor->getBoundMessage(), false);
+}
+
 FaabricPool::FaabricPool(int nThreads)
   : _shutdown(false)
   , scheduler(faabric::scheduler::getScheduler())
   , threadTokenPool(nThreads)
   , stateServer(faabric::state::getGlobalState())
 {
+    for (int i = 0; i < nThreads; i++) {
+        workers.emplace_back(std::make_unique<PoolWorker>(i));
+    }
 
     // Ensure we can ping both redis instances
     faabric::redis::Redis::getQueue().ping();
@@ -50,35 +67,19 @@ void FaabricPool::startThreadPool(bool background)
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
     logger->info("Starting executor thread pool");
 
-    // Spawn worker threads until we've hit the worker limit, thus creating a
-    // pool that will replenish when one releases its token
+    // Spawn long-lived worker threads, which pick up executors for whichever
+    // functions have work, rather than binding a new thread to each function
     poolThread = std::thread([this] {
         const std::shared_ptr<spdlog::logger>& logger =
           faabric::util::getLogger();
 
-        while (!this->isShutdown()) {
-            // Try to get an available slot (blocks if none available)
+        for (int i = 0; i < (int)workers.size(); i++) {
             int threadIdx = this->getThreadToken();
 
-            // Double check shutdown condition
-            if (this->isShutdown()) {
-                break;
-            }
-
-            // Spawn thread to execute function
             poolThreads.emplace_back(std::thread([this, threadIdx] {
-                std::unique_ptr<FaabricExecutor> executor =
-                  createExecutor(threadIdx);
-
-                // Worker will now run for a long time
-                try {
-                    executor.get()->run();
-                } catch (faabric::executor::ExecutorPoolFinishedException& e) {
-                    this->_shutdown = true;
-                }
+                runWorker(*workers.at(threadIdx));
 
-                // Handle thread finishing
-                threadTokenPool.releaseToken(executor.get()->threadIdx);
+                threadTokenPool.releaseToken(threadIdx);
             }));
         }
 
@@ -90,18 +91,459 @@ void FaabricPool::startThreadPool(bool background)
             }
         }
 
+        clearWarmExecutors();
+
         // Will die gracefully at this point
     });
 
+    // Keep executors warm ahead of the predicted load, whether or not calls
+    // are arriving
+    if (faabric::util::getSystemConfig().prewarmMode == "rate") {
+        prewarmThread = std::thread([this] { runPrewarmer(); });
+    }
+
     // Block if in foreground
     if (!background) {
         poolThread.join();
     }
 }
 
+void FaabricPool::runPrewarmer()
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+
+    logger->debug("Starting prewarmer");
+    while (!this->isShutdown()) {
+        scheduler.prewarmFaaslets();
+
+        std::this_thread::sleep_for(
+          std::chrono::milliseconds(std::max(conf.prewarmIntervalMs, 1)));
+    }
+}
+
+void FaabricPool::runWorker(PoolWorker& w)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+
+    logger->debug("Starting pool worker {}", w.idx);
+    auto lastWork = std::chrono::steady_clock::now();
+
+    while (!this->isShutdown()) {
+        try {
+            // Taken before looking, so work queued in between wakes us
+            uint64_t epoch = scheduler.getWorkEpoch();
+
+            faabric::Message msg;
+            if (!nextMessage(w, msg)) {
+                // Park the executor if it's been idle too long, freeing up its
+                // slot for other functions
+                auto idleMs =
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - lastWork)
+                    .count();
+                if (w.executor != nullptr && idleMs > conf.boundTimeout) {
+                    logger->debug("Worker {} idle, parking executor", w.idx);
+                    parkExecutor(w);
+                }
+
+                // Sleep until there's work, waking in time to park the
+                // executor if none arrives
+                long timeoutMs = 0;
+                if (w.executor != nullptr) {
+                    timeoutMs = std::max<long>(conf.boundTimeout - idleMs, 1);
+                }
+
+                scheduler.awaitWork(epoch, timeoutMs);
+                continue;
+            }
+
+            if (msg.type() == faabric::Message_MessageType_BIND) {
+                bindWorker(w, msg);
+            } else {
+                executeMessage(w, msg);
+            }
+
+            lastWork = std::chrono::steady_clock::now();
+        } catch (faabric::executor::ExecutorPoolFinishedException& e) {
+            this->_shutdown = true;
+            scheduler.notifyWork();
+        }
+    }
+
+    try {
+        finishExecutor(w);
+    } catch (faabric::executor::ExecutorPoolFinishedException& e) {
+        this->_shutdown = true;
+    }
+
+    logger->debug("Pool worker {} finished", w.idx);
+}
+
+bool FaabricPool::nextMessage(PoolWorker& w, faabric::Message& msg)
+{
+    // Own local queue first
+    {
+        faabric::util::UniqueLock lock(w.mx);
+        if (!w.localQueue.empty()) {
+            msg = std::move(w.localQueue.front());
+            w.localQueue.pop_front();
+            return true;
+        }
+    }
+
+    // Then the queue for our executor's function, taking a few more messages
+    // into the local queue if there's a backlog
+    if (w.executor != nullptr) {
+        auto queue = w.executor->getCurrentQueue();
+        if (queue->tryDequeue(msg)) {
+            faabric::util::SystemConfig& conf =
+              faabric::util::getSystemConfig();
+
+            int nLocal = 1;
+            {
+                faabric::util::UniqueLock lock(w.mx);
+                w.funcStr = getExecutorFuncStr(w.executor.get());
+
+                faabric::Message extra;
+                while (nLocal < conf.executorLocalQueueSize &&
+                       queue->tryDequeue(extra)) {
+                    nLocal++;
+                    w.localQueue.emplace_back(std::move(extra));
+                }
+            }
+
+            // Idle workers may be able to steal what we've taken
+            if (nLocal > 1) {
+                scheduler.notifyWork();
+            }
+
+            return true;
+        }
+    }
+
+    // Then requests to bind to a new function
+    if (scheduler.getBindQueue()->tryDequeue(msg)) {
+        return true;
+    }
+
+    return stealMessage(w, msg);
+}
+
+bool FaabricPool::stealMessage(PoolWorker& w, faabric::Message& msg)
+{
+    std::string ownFuncStr = getExecutorFuncStr(w.executor.get());
+
+    // Steal from the back of other workers' local queues, as long as we have
+    // or can pick up a warm executor for the function
+    int nWorkers = workers.size();
+    for (int i = 1; i < nWorkers; i++) {
+        PoolWorker& victim = *workers.at((w.idx + i) % nWorkers);
+
+        std::string victimFuncStr;
+        {
+            faabric::util::UniqueLock lock(victim.mx);
+            if (victim.localQueue.empty()) {
+                continue;
+            }
+            victimFuncStr = victim.funcStr;
+        }
+
+        std::unique_ptr<FaabricExecutor> warm;
+        if (victimFuncStr != ownFuncStr) {
+            warm = takeWarmExecutor(victimFuncStr);
+            if (warm == nullptr) {
+                continue;
+            }
+        }
+
+        bool stolen = false;
+        {
+            faabric::util::UniqueLock lock(victim.mx);
+            if (!victim.localQueue.empty() &&
+                victim.funcStr == victimFuncStr) {
+                msg = std::move(victim.localQueue.back());
+                victim.localQueue.pop_back();
+                stolen = true;
+            }
+        }
+
+        if (!stolen) {
+            if (warm != nullptr) {
+                returnWarmExecutor(std::move(warm));
+            }
+            continue;
+        }
+
+        // Warm executors gave up their slot when they were parked
+        if (warm != nullptr) {
+            switchExecutor(w, std::move(warm));
+            w.executor->acquire();
+        }
+
+        return true;
+    }
+
+    // Steal from the queues of other functions with warm executors
+    std::unique_ptr<FaabricExecutor> warm = takeWarmExecutorWithBacklog();
+    if (warm == nullptr) {
+        return false;
+    }
+
+    if (!warm->getCurrentQueue()->tryDequeue(msg)) {
+        returnWarmExecutor(std::move(warm));
+        return false;
+    }
+
+    switchExecutor(w, std::move(warm));
+    w.executor->acquire();
+    return true;
+}
+
+void FaabricPool::executeMessage(PoolWorker& w, faabric::Message& msg)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    if (msg.type() == faabric::Message_MessageType_FLUSH) {
+        // Warm executors would hold on to stale state, so drop them too
+        if (w.executor != nullptr) {
+            w.executor->flush();
+        }
+        clearWarmExecutors();
+        return;
+    }
+
+    // If our executor has gone, e.g. because it finished, hand the call back
+    // so that another executor can pick it up
+    if (w.executor == nullptr) {
+        logger->warn("Worker {} has no executor for {}, requeueing",
+                     w.idx,
+                     faabric::util::funcToString(msg, true));
+        std::vector<faabric::Message> unfinished;
+        unfinished.emplace_back(std::move(msg));
+        scheduler.requeueCalls(unfinished);
+        return;
+    }
+
+    // Batch up any more calls we can take without waiting, first from our
+    // local queue, then from the function's queue
+    int batchSize = faabric::util::getSystemConfig().executorBatchSize;
+    std::vector<faabric::Message> batch;
+    if (batchSize > 1) {
+        batch.emplace_back(std::move(msg));
+
+        {
+            faabric::util::UniqueLock lock(w.mx);
+            while ((int)batch.size() < batchSize && !w.localQueue.empty() &&
+                   w.localQueue.front().type() ==
+                     faabric::Message_MessageType_CALL) {
+                batch.emplace_back(std::move(w.localQueue.front()));
+                w.localQueue.pop_front();
+            }
+        }
+
+        auto queue = w.executor->getCurrentQueue();
+        faabric::Message next;
+        while ((int)batch.size() < batchSize && queue->tryDequeue(next)) {
+            if (next.type() != faabric::Message_MessageType_CALL) {
+                // Leave anything else for later
+                faabric::util::UniqueLock lock(w.mx);
+                w.funcStr = getExecutorFuncStr(w.executor.get());
+                w.localQueue.emplace_front(std::move(next));
+                break;
+            }
+
+            batch.emplace_back(std::move(next));
+        }
+    }
+
+    if (batch.empty()) {
+        batch.emplace_back(std::move(msg));
+    }
+
+    int nExecutedBefore = w.executor->getExecutionCount();
+    try {
+        if (batch.size() > 1) {
+            w.executor->executeBatch(batch);
+        } else {
+            w.executor->executeCall(batch.front());
+        }
+    } catch (faabric::util::ExecutorFinishedException& e) {
+        // Executor has notified us it's finished. Any calls it didn't finish
+        // must go to another executor.
+        logger->debug("{} finished", w.executor->id);
+
+        int nExecuted = w.executor->getExecutionCount() - nExecutedBefore;
+        std::vector<faabric::Message> unfinished(
+          std::make_move_iterator(batch.begin() + std::min<int>(
+                                                    nExecuted, batch.size())),
+          std::make_move_iterator(batch.end()));
+
+        finishExecutor(w, std::move(unfinished));
+    }
+}
+
+void FaabricPool::bindWorker(PoolWorker& w, const faabric::Message& bindMsg)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    const std::string funcStr = faabric::util::funcToString(bindMsg, false);
+
+    // Our executor already holds a slot for this function, so hand this one
+    // back
+    if (getExecutorFuncStr(w.executor.get()) == funcStr) {
+        scheduler.notifyFaasletFinished(bindMsg);
+        return;
+    }
+
+    std::unique_ptr<FaabricExecutor> executor = takeWarmExecutor(funcStr);
+    if (executor != nullptr) {
+        logger->debug("Worker {} reusing warm executor for {}", w.idx, funcStr);
+        executor->rebind();
+        switchExecutor(w, std::move(executor));
+        return;
+    }
+
+    logger->info("Worker {} binding to {}", w.idx, funcStr);
+    executor = createExecutor(w.idx);
+
+    try {
+        executor->bindToFunction(bindMsg);
+    } catch (faabric::util::InvalidFunctionException& e) {
+        logger->error("Invalid function: {}", funcStr);
+        executor->finish();
+        return;
+    }
+
+    switchExecutor(w, std::move(executor));
+}
+
+void FaabricPool::switchExecutor(PoolWorker& w,
+                                 std::unique_ptr<FaabricExecutor> executor)
+{
+    parkExecutor(w);
+    w.executor = std::move(executor);
+}
+
+void FaabricPool::parkExecutor(PoolWorker& w)
+{
+    if (w.executor == nullptr) {
+        return;
+    }
+
+    w.executor->release();
+    returnWarmExecutor(std::move(w.executor));
+}
+
+void FaabricPool::finishExecutor(PoolWorker& w,
+                                 std::vector<faabric::Message> unfinished)
+{
+    // Calls queued up locally can no longer run on this worker. Anything else
+    // queued, e.g. a flush, only applied to the executor that's finishing.
+    {
+        faabric::util::UniqueLock lock(w.mx);
+        for (auto& m : w.localQueue) {
+            if (m.type() == faabric::Message_MessageType_CALL) {
+                unfinished.emplace_back(std::move(m));
+            }
+        }
+        w.localQueue.clear();
+        w.funcStr = "";
+    }
+
+    if (w.executor == nullptr) {
+        if (!unfinished.empty()) {
+            scheduler.requeueCalls(unfinished);
+        }
+        return;
+    }
+
+    // Give up the executor's slot before requeueing, so that a new executor
+    // is bound to run the calls if this was the last one
+    std::unique_ptr<FaabricExecutor> executor = std::move(w.executor);
+    executor->release();
+
+    if (!unfinished.empty()) {
+        scheduler.requeueCalls(unfinished);
+    }
+
+    executor->finish();
+}
+
+std::unique_ptr<FaabricExecutor> FaabricPool::takeWarmExecutor(
+  const std::string& funcStr)
+{
+    faabric::util::UniqueLock lock(warmMx);
+    for (auto it = warmExecutors.begin(); it != warmExecutors.end(); ++it) {
+        if (getExecutorFuncStr(it->get()) == funcStr) {
+            std::unique_ptr<FaabricExecutor> executor = std::move(*it);
+            warmExecutors.erase(it);
+            return executor;
+        }
+    }
+
+    return nullptr;
+}
+
+std::unique_ptr<FaabricExecutor> FaabricPool::takeWarmExecutorWithBacklog()
+{
+    faabric::util::UniqueLock lock(warmMx);
+    for (auto it = warmExecutors.begin(); it != warmExecutors.end(); ++it) {
+        if ((*it)->getCurrentQueue()->size() > 0) {
+            std::unique_ptr<FaabricExecutor> executor = std::move(*it);
+            warmExecutors.erase(it);
+            return executor;
+        }
+    }
+
+    return nullptr;
+}
+
+void FaabricPool::returnWarmExecutor(std::unique_ptr<FaabricExecutor> executor)
+{
+    int maxWarm = faabric::util::getSystemConfig().executorWarmCacheSize;
+
+    // Evict the least recently used executors outside the lock, as finishing
+    // them may be expensive
+    std::vector<std::unique_ptr<FaabricExecutor>> evicted;
+    {
+        faabric::util::UniqueLock lock(warmMx);
+        warmExecutors.emplace_front(std::move(executor));
+
+        while ((int)warmExecutors.size() > std::max<int>(maxWarm, 0)) {
+            evicted.emplace_back(std::move(warmExecutors.back()));
+            warmExecutors.pop_back();
+        }
+    }
+
+    for (auto& e : evicted) {
+        e->finish();
+    }
+}
+
+void FaabricPool::clearWarmExecutors()
+{
+    std::list<std::unique_ptr<FaabricExecutor>> evicted;
+    {
+        faabric::util::UniqueLock lock(warmMx);
+        std::swap(evicted, warmExecutors);
+    }
+
+    for (auto& e : evicted) {
+        e->finish();
+    }
+}
+
+int FaabricPool::getWarmExecutorCount()
+{
+    faabric::util::UniqueLock lock(warmMx);
+    return warmExecutors.size();
+}
+
 void FaabricPool::reset()
 {
     threadTokenPool.reset();
+    clearWarmExecutors();
 }
 
 int FaabricPool::getThreadToken()
@@ -122,6 +564,7 @@ bool FaabricPool::isShutdown()
 void FaabricPool::shutdown()
 {
     _shutdown = true;
+    scheduler.notifyWork();
 
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
 
@@ -141,6 +584,10 @@ void FaabricPool::shutdown()
         mpiThread.join();
     }
 
+    if (prewarmThread.joinable()) {
+        prewarmThread.join();
+    }
+
     logger->info("Faabric pool successfully shut down");
 }
 }
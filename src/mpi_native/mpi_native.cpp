@@ -110,7 +110,8 @@ int MPI_Send(const void* buf,
                              (uint8_t*)buf,
                              datatype,
                              count,
-                             faabric::MPIMessage::NORMAL);
+                             faabric::MPIMessage::NORMAL,
+                             tag);
 
     return MPI_SUCCESS;
 }
@@ -143,7 +144,8 @@ int MPI_Recv(void* buf,
                              datatype,
                              count,
                              status,
-                             faabric::MPIMessage::NORMAL);
+                             faabric::MPIMessage::NORMAL,
+                             tag);
 
     return MPI_SUCCESS;
 }
@@ -175,7 +177,9 @@ int MPI_Sendrecv(const void* sendbuf,
                                  recvtype,
                                  source,
                                  executingContext.getRank(),
-                                 status);
+                                 status,
+                                 sendtag,
+                                 recvtag);
 
     return MPI_SUCCESS;
 }
@@ -207,7 +211,8 @@ int MPI_Get_count(const MPI_Status* status, MPI_Datatype datatype, int* count)
 int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status* status)
 {
     getMpiLogger()->debug("MPI_Probe");
-    getExecutingWorld().probe(source, executingContext.getRank(), status);
+    getExecutingWorld().probe(
+      source, executingContext.getRank(), status, tag);
 
     return MPI_SUCCESS;
 }
@@ -515,7 +520,7 @@ int MPI_Alloc_mem(MPI_Aint size, MPI_Info info, void* baseptr)
 int MPI_Win_fence(int assert, MPI_Win win)
 {
     getMpiLogger()->debug("MPI_Win_fence");
-    getExecutingWorld().barrier(executingContext.getRank());
+    getExecutingWorld().rmaFence(executingContext.getRank());
 
     return MPI_SUCCESS;
 }
@@ -535,7 +540,8 @@ int MPI_Get(void* origin_addr,
                                target_count,
                                (uint8_t*)origin_addr,
                                origin_datatype,
-                               origin_count);
+                               origin_count,
+                               target_disp * win->dispUnit);
 
     return MPI_SUCCESS;
 }
@@ -556,7 +562,8 @@ int MPI_Put(const void* origin_addr,
                                origin_count,
                                target_rank,
                                target_datatype,
-                               target_count);
+                               target_count,
+                               target_disp * win->dispUnit);
 
     return MPI_SUCCESS;
 }
@@ -564,6 +571,7 @@ int MPI_Put(const void* origin_addr,
 int MPI_Win_free(MPI_Win* win)
 {
     getMpiLogger()->debug("MPI_Win_free");
+    getExecutingWorld().freeWindow((*win)->rank);
     free(*win);
 
     return MPI_SUCCESS;
@@ -666,8 +674,13 @@ int MPI_Isend(const void* buf,
 
     faabric::scheduler::MpiWorld& world = getExecutingWorld();
     (*request) = (faabric_request_t*)malloc(sizeof(faabric_request_t));
-    int requestId = world.isend(
-      executingContext.getRank(), dest, (uint8_t*)buf, datatype, count);
+    int requestId = world.isend(executingContext.getRank(),
+                                dest,
+                                (uint8_t*)buf,
+                                datatype,
+                                count,
+                                faabric::MPIMessage::NORMAL,
+                                tag);
     (*request)->id = requestId;
 
     return MPI_SUCCESS;
@@ -686,8 +699,13 @@ int MPI_Irecv(void* buf,
 
     faabric::scheduler::MpiWorld& world = getExecutingWorld();
     (*request) = (faabric_request_t*)malloc(sizeof(faabric_request_t));
-    int requestId = world.irecv(
-      source, executingContext.getRank(), (uint8_t*)buf, datatype, count);
+    int requestId = world.irecv(source,
+                                executingContext.getRank(),
+                                (uint8_t*)buf,
+                                datatype,
+                                count,
+                                faabric::MPIMessage::NORMAL,
+                                tag);
     (*request)->id = requestId;
 
     return MPI_SUCCESS;
@@ -700,10 +718,39 @@ double MPI_Wtime()
     return getExecutingWorld().getWTime();
 }
 
+static void freeRequest(MPI_Request* request)
+{
+    free(*request);
+    *request = MPI_REQUEST_NULL;
+}
+
 int MPI_Wait(MPI_Request* request, MPI_Status* status)
 {
     getMpiLogger()->debug("MPI_Wait");
-    getExecutingWorld().awaitAsyncRequest((*request)->id);
+
+    if (*request == MPI_REQUEST_NULL) {
+        return MPI_SUCCESS;
+    }
+
+    getExecutingWorld().awaitAsyncRequest((*request)->id, status);
+    freeRequest(request);
+
+    return MPI_SUCCESS;
+}
+
+int MPI_Test(MPI_Request* request, int* flag, MPI_Status* status)
+{
+    getMpiLogger()->debug("MPI_Test");
+
+    if (*request == MPI_REQUEST_NULL) {
+        *flag = 1;
+        return MPI_SUCCESS;
+    }
+
+    *flag = getExecutingWorld().testAsyncRequest((*request)->id, status);
+    if (*flag) {
+        freeRequest(request);
+    }
 
     return MPI_SUCCESS;
 }
@@ -712,7 +759,14 @@ int MPI_Waitall(int count,
                 MPI_Request array_of_requests[],
                 MPI_Status* array_of_statuses)
 {
-    notImplemented("MPI_Waitall");
+    getMpiLogger()->debug("MPI_Waitall {}", count);
+
+    for (int i = 0; i < count; i++) {
+        MPI_Status* status = array_of_statuses == MPI_STATUSES_IGNORE
+                               ? MPI_STATUS_IGNORE
+                               : &array_of_statuses[i];
+        MPI_Wait(&array_of_requests[i], status);
+    }
 
     return MPI_SUCCESS;
 }
@@ -722,7 +776,26 @@ int MPI_Waitany(int count,
                 int* index,
                 MPI_Status* status)
 {
-    notImplemented("MPI_Waitany");
+    getMpiLogger()->debug("MPI_Waitany {}", count);
+
+    // Only wait on active requests, keeping track of where they came from
+    std::vector<int> requestIds;
+    std::vector<int> requestIdxs;
+    for (int i = 0; i < count; i++) {
+        if (array_of_requests[i] != MPI_REQUEST_NULL) {
+            requestIds.push_back(array_of_requests[i]->id);
+            requestIdxs.push_back(i);
+        }
+    }
+
+    if (requestIds.empty()) {
+        *index = MPI_UNDEFINED;
+        return MPI_SUCCESS;
+    }
+
+    int idx = getExecutingWorld().awaitAnyAsyncRequest(requestIds, status);
+    *index = requestIdxs.at(idx);
+    freeRequest(&array_of_requests[*index]);
 
     return MPI_SUCCESS;
 }
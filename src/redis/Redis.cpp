@@ -90,11 +90,16 @@ Redis::~Redis()
  *  ------ Utils ------
  */
 
+static RedisInstance& getStateInstance()
+{
+    static RedisInstance stateInstance(STATE);
+    return stateInstance;
+}
+
 Redis& Redis::getState()
 {
     // Hiredis requires one instance per thread
-    static RedisInstance stateInstance(STATE);
-    static thread_local redis::Redis redisState(stateInstance);
+    static thread_local redis::Redis redisState(getStateInstance());
     return redisState;
 }
 
@@ -343,6 +348,26 @@ void Redis::flushPipeline(long pipelineLength)
     }
 }
 
+void Redis::setPipeline(const std::string& key,
+                        const uint8_t* value,
+                        size_t size)
+{
+    redisAppendCommand(context, "SET %s %b", key.c_str(), value, size);
+}
+
+void Redis::expirePipeline(const std::string& key, long expiry)
+{
+    redisAppendCommand(context, "EXPIRE %s %ld", key.c_str(), expiry);
+}
+
+void Redis::enqueueBytesPipeline(const std::string& queueName,
+                                 const uint8_t* buffer,
+                                 size_t bufferLen)
+{
+    redisAppendCommand(
+      context, "RPUSH %s %b", queueName.c_str(), buffer, bufferLen);
+}
+
 void Redis::sadd(const std::string& key, const std::string& value)
 {
     auto reply = (redisReply*)redisCommand(
@@ -530,6 +555,72 @@ void Redis::getRange(const std::string& key,
     freeReplyObject(reply);
 }
 
+/**
+ * Appends a GETRANGE to the pipeline, start/end are both inclusive. Replies
+ * must be read back in order with readRangePipelineReply.
+ */
+void Redis::getRangePipeline(const std::string& key, long start, long end)
+{
+    redisAppendCommand(context, "GETRANGE %s %li %li", key.c_str(), start, end);
+    pendingReplies++;
+}
+
+void Redis::readRangePipelineReply(const std::string& key,
+                                   uint8_t* buffer,
+                                   size_t bufferLen)
+{
+    redisReply* reply = readPipelineReply();
+
+    if (reply == nullptr || reply->type == REDIS_REPLY_ERROR) {
+        const std::shared_ptr<spdlog::logger>& logger =
+          faabric::util::getLogger();
+        logger->error("Failed pipelined GETRANGE on {}", key);
+        abortPipeline(reply);
+        throw std::runtime_error("Failed pipelined GETRANGE " + key);
+    }
+
+    try {
+        getBytesFromReply(key, reply, buffer, bufferLen);
+    } catch (std::runtime_error& ex) {
+        abortPipeline(reply);
+        throw;
+    }
+
+    freeReplyObject(reply);
+}
+
+redisReply* Redis::readPipelineReply()
+{
+    void* reply = nullptr;
+    redisGetReply(context, &reply);
+    pendingReplies--;
+
+    return (redisReply*)reply;
+}
+
+/**
+ * Frees the failed reply, reads and drops the rest of the pipeline, then
+ * reconnects so that later commands can't pick up its replies.
+ */
+void Redis::abortPipeline(void* reply)
+{
+    if (reply != nullptr) {
+        freeReplyObject(reply);
+    }
+
+    while (pendingReplies > 0) {
+        reply = readPipelineReply();
+        if (reply == nullptr) {
+            break;
+        }
+
+        freeReplyObject(reply);
+    }
+
+    pendingReplies = 0;
+    refresh();
+}
+
 /**
  *  ------ Locking ------
  */
@@ -556,6 +647,29 @@ void Redis::releaseLock(const std::string& key, uint32_t lockId)
     this->delIfEq(lockKey, lockId);
 }
 
+void Redis::notifyLockReleased(const std::string& key, int expirySeconds)
+{
+    // Keep at most one token on the list so a single waiter wakes, and one
+    // that hasn't started waiting yet won't miss it
+    std::string notifyKey = key + "_lock_notify";
+    redisAppendCommand(context, "RPUSH %s 1", notifyKey.c_str());
+    redisAppendCommand(context, "LTRIM %s -1 -1", notifyKey.c_str());
+    redisAppendCommand(
+      context, "EXPIRE %s %d", notifyKey.c_str(), expirySeconds);
+    flushPipeline(3);
+}
+
+bool Redis::waitOnLockRelease(const std::string& key, int timeoutMs)
+{
+    try {
+        dequeue(key + "_lock_notify", timeoutMs);
+    } catch (RedisNoResponseException& ex) {
+        return false;
+    }
+
+    return true;
+}
+
 void Redis::delIfEq(const std::string& key, uint32_t value)
 {
     // Invoke the script
@@ -715,6 +829,42 @@ std::string Redis::dequeue(const std::string& queueName, int timeoutMs)
     return result;
 }
 
+/**
+ * Appends a non-blocking pop to the pipeline. Replies must be read back in
+ * order with readDequeuePipelineReply.
+ */
+void Redis::dequeueBytesPipeline(const std::string& queueName)
+{
+    redisAppendCommand(context, "LPOP %s", queueName.c_str());
+    pendingReplies++;
+}
+
+/**
+ * Reads the reply to a pipelined pop, which is empty if the queue was.
+ */
+std::vector<uint8_t> Redis::readDequeuePipelineReply(
+  const std::string& queueName)
+{
+    redisReply* reply = readPipelineReply();
+
+    if (reply == nullptr || reply->type == REDIS_REPLY_ERROR) {
+        const std::shared_ptr<spdlog::logger>& logger =
+          faabric::util::getLogger();
+        logger->error("Failed pipelined LPOP on {}", queueName);
+        abortPipeline(reply);
+        throw std::runtime_error("Failed pipelined LPOP " + queueName);
+    }
+
+    std::vector<uint8_t> replyBytes;
+    if (reply->type != REDIS_REPLY_NIL) {
+        replyBytes = getBytesFromReply(reply);
+    }
+
+    freeReplyObject(reply);
+
+    return replyBytes;
+}
+
 void Redis::dequeueMultiple(const std::string& queueName,
                             uint8_t* buff,
                             long buffLen,
@@ -0,0 +1,82 @@
+#include <faabric/scheduler/CallRateTracker.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace faabric::scheduler {
+CallRateTracker::CallRateTracker(double alphaIn)
+  : alpha(alphaIn)
+{}
+
+void CallRateTracker::recordArrival(const std::string& funcStr, long nowMs)
+{
+    FunctionCallRate& r = rates[funcStr];
+
+    if (r.nArrivals > 0) {
+        double gap = std::max<long>(nowMs - r.lastArrivalMs, 0);
+        if (r.nArrivals == 1) {
+            r.interArrivalMs = gap;
+        } else {
+            r.interArrivalMs = alpha * gap + (1 - alpha) * r.interArrivalMs;
+        }
+    }
+
+    r.nArrivals++;
+    r.lastArrivalMs = nowMs;
+}
+
+void CallRateTracker::recordCompletion(const std::string& funcStr,
+                                       long residencyMs)
+{
+    FunctionCallRate& r = rates[funcStr];
+
+    double sample = std::max<long>(residencyMs, 0);
+    if (r.residencyMs == 0) {
+        r.residencyMs = sample;
+    } else {
+        r.residencyMs = alpha * sample + (1 - alpha) * r.residencyMs;
+    }
+}
+
+int CallRateTracker::predictConcurrency(const std::string& funcStr,
+                                        long nowMs,
+                                        int headroomPct)
+{
+    auto it = rates.find(funcStr);
+    if (it == rates.end()) {
+        return 0;
+    }
+
+    const FunctionCallRate& r = it->second;
+    if (r.nArrivals < 2 || r.residencyMs == 0) {
+        return 0;
+    }
+
+    // If it's gone quiet, the rate can be no higher than one call since the
+    // last arrival
+    double interArrival =
+      std::max<double>(r.interArrivalMs, nowMs - r.lastArrivalMs);
+    interArrival = std::max<double>(interArrival, 1);
+
+    // Little's law: concurrent calls = arrival rate x time in system
+    double expected = r.residencyMs / interArrival;
+    expected *= 1 + (headroomPct / 100.0);
+
+    return (int)std::ceil(expected);
+}
+
+FunctionCallRate CallRateTracker::getRate(const std::string& funcStr)
+{
+    auto it = rates.find(funcStr);
+    if (it == rates.end()) {
+        return FunctionCallRate();
+    }
+
+    return it->second;
+}
+
+void CallRateTracker::clear()
+{
+    rates.clear();
+}
+}
@@ -5,6 +5,7 @@
 #include <grpcpp/security/credentials.h>
 
 #include <faabric/rpc/macros.h>
+#include <faabric/util/locks.h>
 #include <faabric/util/queue.h>
 #include <faabric/util/testing.h>
 
@@ -32,6 +33,21 @@ static std::unordered_map<std::string,
 static std::vector<std::pair<std::string, faabric::UnregisterRequest>>
   unregisterRequests;
 
+// Mock hosts are registered up front, then called from many threads
+static std::shared_mutex mockHostsMx;
+static std::unordered_map<std::string, std::shared_ptr<MockHost>> mockHosts;
+
+static std::shared_ptr<MockHost> getMockHost(const std::string& host)
+{
+    faabric::util::SharedLock lock(mockHostsMx);
+    auto it = mockHosts.find(host);
+    if (it == mockHosts.end()) {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
 std::vector<std::pair<std::string, faabric::Message>> getFunctionCalls()
 {
     return functionCalls;
@@ -82,6 +98,21 @@ void clearMockRequests()
         p.second.reset();
     }
     queuedResourceResponses.clear();
+
+    clearMockHosts();
+}
+
+void registerMockHost(const std::string& host,
+                      std::shared_ptr<MockHost> mockHost)
+{
+    faabric::util::FullLock lock(mockHostsMx);
+    mockHosts[host] = std::move(mockHost);
+}
+
+void clearMockHosts()
+{
+    faabric::util::FullLock lock(mockHostsMx);
+    mockHosts.clear();
 }
 
 // -----------------------------------
@@ -110,6 +141,12 @@ void FunctionCallClient::sendMPIMessage(
   const std::shared_ptr<faabric::MPIMessage> msg)
 {
     if (faabric::util::isMockMode()) {
+        std::shared_ptr<MockHost> mockHost = getMockHost(host);
+        if (mockHost != nullptr) {
+            mockHost->sendMPIMessage(msg);
+            return;
+        }
+
         mpiMessages.emplace_back(host, *msg);
     } else {
         ClientContext context;
@@ -124,6 +161,11 @@ faabric::HostResources FunctionCallClient::getResources(
     faabric::HostResources response;
 
     if (faabric::util::isMockMode()) {
+        std::shared_ptr<MockHost> mockHost = getMockHost(host);
+        if (mockHost != nullptr) {
+            return mockHost->getResources();
+        }
+
         // Register the request
         resourceRequests.emplace_back(host, req);
 
@@ -144,6 +186,12 @@ void FunctionCallClient::executeFunctions(
   const faabric::BatchExecuteRequest& req)
 {
     if (faabric::util::isMockMode()) {
+        std::shared_ptr<MockHost> mockHost = getMockHost(host);
+        if (mockHost != nullptr) {
+            mockHost->executeFunctions(req);
+            return;
+        }
+
         batchMessages.emplace_back(host, req);
     } else {
         ClientContext context;
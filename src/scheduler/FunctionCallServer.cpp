@@ -77,11 +77,12 @@ Status FunctionCallServer::ExecuteFunctions(
   const faabric::BatchExecuteRequest* request,
   faabric::FunctionStatusResponse* response)
 {
-    // TODO - avoiding having to copy the message here
+    // gRPC owns the request, so this is the one copy made on this host. The
+    // messages are then moved on to the queues.
     faabric::BatchExecuteRequest requestCopy = *request;
 
     // This host has now been told to execute these functions no matter what
-    scheduler.callFunctions(requestCopy, true);
+    scheduler.callFunctions(std::move(requestCopy), true);
 
     return Status::OK;
 }
@@ -0,0 +1,72 @@
+#include <faabric/scheduler/MpiRequestPool.h>
+#include <faabric/util/logging.h>
+
+#include <stdexcept>
+
+#define MPI_REQUEST_SLOT_MASK (MPI_MAX_OUTSTANDING_REQUESTS - 1)
+#define MPI_REQUEST_MAX_GENERATION (1 << 14)
+
+namespace faabric::scheduler {
+
+MpiRequest& MpiRequestPool::acquire()
+{
+    int slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        if (slots.size() >= MPI_MAX_OUTSTANDING_REQUESTS) {
+            faabric::util::getLogger()->error(
+              "Too many outstanding MPI requests ({})", slots.size());
+            throw std::runtime_error("Too many outstanding MPI requests");
+        }
+
+        slot = slots.size();
+        slots.emplace_back();
+        generations.push_back(0);
+    }
+
+    // Generations start at one so IDs are never zero
+    int generation =
+      (generations.at(slot) % (MPI_REQUEST_MAX_GENERATION - 1)) + 1;
+    generations.at(slot) = generation;
+
+    MpiRequest& req = slots.at(slot);
+    req = MpiRequest();
+    req.id = (generation << MPI_REQUEST_SLOT_BITS) | slot;
+    req.inUse = true;
+
+    return req;
+}
+
+MpiRequest* MpiRequestPool::get(int requestId)
+{
+    size_t slot = requestId & MPI_REQUEST_SLOT_MASK;
+    if (requestId <= 0 || slot >= slots.size()) {
+        return nullptr;
+    }
+
+    MpiRequest& req = slots.at(slot);
+    if (!req.inUse || req.id != requestId) {
+        return nullptr;
+    }
+
+    return &req;
+}
+
+void MpiRequestPool::release(int requestId)
+{
+    MpiRequest* req = get(requestId);
+    if (req == nullptr) {
+        return;
+    }
+
+    req->inUse = false;
+    freeSlots.push_back(requestId & MPI_REQUEST_SLOT_MASK);
+}
+
+size_t MpiRequestPool::getOutstandingCount()
+{
+    return slots.size() - freeSlots.size();
+}
+}
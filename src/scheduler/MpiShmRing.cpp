@@ -0,0 +1,347 @@
+#include <faabric/scheduler/MpiShmRing.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/macros.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define MPI_SHM_HEADER_SIZE 128
+
+// Each record starts with a word holding its length and these flags
+#define MPI_SHM_MORE_FLAG (1u << 31)
+#define MPI_SHM_ABORT_FLAG (1u << 30)
+#define MPI_SHM_LEN_MASK (MPI_SHM_ABORT_FLAG - 1)
+
+static_assert(sizeof(faabric::scheduler::MpiShmRingHeader) <=
+                MPI_SHM_HEADER_SIZE,
+              "Shared memory ring header too big");
+
+namespace faabric::scheduler {
+
+// Note, these futexes are shared between processes, so can't be private
+static void futexWait(std::atomic<uint32_t>* addr,
+                      uint32_t expected,
+                      int timeoutMs)
+{
+    struct timespec ts;
+    struct timespec* tsPtr = nullptr;
+    if (timeoutMs > 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+        tsPtr = &ts;
+    }
+
+    syscall(SYS_futex,
+            reinterpret_cast<uint32_t*>(addr),
+            FUTEX_WAIT,
+            expected,
+            tsPtr,
+            nullptr,
+            0);
+}
+
+static void futexWake(std::atomic<uint32_t>* addr, int nWaiters)
+{
+    syscall(SYS_futex,
+            reinterpret_cast<uint32_t*>(addr),
+            FUTEX_WAKE,
+            nWaiters,
+            nullptr,
+            nullptr,
+            0);
+}
+
+std::string MpiShmRing::getRingName(int worldId, const std::string& host)
+{
+    return "/faabric_mpi_" + std::to_string(worldId) + "_" + host;
+}
+
+std::shared_ptr<MpiShmRing> MpiShmRing::create(const std::string& name,
+                                               size_t capacity)
+{
+    auto logger = faabric::util::getLogger();
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        // Left behind by a previous process
+        logger->warn("Replacing stale shared memory ring {}", name);
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+
+    if (fd < 0) {
+        logger->error(
+          "Failed to create shared memory ring {}: {}", name, strerror(errno));
+        throw std::runtime_error("Failed to create shared memory ring");
+    }
+
+    size_t regionSize = MPI_SHM_HEADER_SIZE + capacity;
+    if (ftruncate(fd, regionSize) != 0) {
+        logger->error(
+          "Failed to size shared memory ring {}: {}", name, strerror(errno));
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to size shared memory ring");
+    }
+
+    void* ptr =
+      mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (ptr == MAP_FAILED) {
+        logger->error(
+          "Failed to map shared memory ring {}: {}", name, strerror(errno));
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to map shared memory ring");
+    }
+
+    // Writers ignore the ring until it's marked as ready
+    auto header = new (ptr) MpiShmRingHeader();
+    header->capacity = capacity;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&header->writeLock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    header->ready.store(1, std::memory_order_release);
+
+    return std::shared_ptr<MpiShmRing>(
+      new MpiShmRing(name, (uint8_t*)ptr, regionSize, true));
+}
+
+std::shared_ptr<MpiShmRing> MpiShmRing::open(const std::string& name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < MPI_SHM_HEADER_SIZE) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    size_t regionSize = st.st_size;
+    void* ptr =
+      mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (ptr == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto header = reinterpret_cast<MpiShmRingHeader*>(ptr);
+    if (header->ready.load(std::memory_order_acquire) != 1) {
+        munmap(ptr, regionSize);
+        return nullptr;
+    }
+
+    return std::shared_ptr<MpiShmRing>(
+      new MpiShmRing(name, (uint8_t*)ptr, regionSize, false));
+}
+
+MpiShmRing::MpiShmRing(const std::string& nameIn,
+                       uint8_t* regionIn,
+                       size_t regionSizeIn,
+                       bool isOwnerIn)
+  : name(nameIn)
+  , region(regionIn)
+  , regionSize(regionSizeIn)
+  , isOwner(isOwnerIn)
+  , header(reinterpret_cast<MpiShmRingHeader*>(regionIn))
+  , data(regionIn + MPI_SHM_HEADER_SIZE)
+{}
+
+MpiShmRing::~MpiShmRing()
+{
+    munmap(region, regionSize);
+
+    if (isOwner) {
+        shm_unlink(name.c_str());
+    }
+}
+
+void MpiShmRing::push(const faabric::MPIMessage& msg)
+{
+    std::string bytes;
+    msg.SerializeToString(&bytes);
+
+    // Fragments leave room for the reader to drain one while the next is
+    // written. All of them are written under the lock, so they can't be
+    // interleaved with other writers' messages.
+    size_t maxFragment = header->capacity / 4;
+    const uint8_t* src = BYTES_CONST(bytes.data());
+
+    lockWriters();
+
+    size_t offset = 0;
+    do {
+        size_t len = std::min(bytes.size() - offset, maxFragment);
+        bool more = offset + len < bytes.size();
+        header->writeOpen = more ? 1 : 0;
+
+        uint32_t word = len | (more ? MPI_SHM_MORE_FLAG : 0);
+        writeRecord(word, src + offset, len);
+        offset += len;
+    } while (offset < bytes.size());
+
+    unlockWriters();
+}
+
+bool MpiShmRing::pop(faabric::MPIMessage& msg, int timeoutMs)
+{
+    while (true) {
+        uint64_t tail = header->tail.load(std::memory_order_relaxed);
+        if (header->head.load(std::memory_order_acquire) == tail) {
+            // The sequence is read before re-checking, so a write in between
+            // stops the wait from sleeping
+            uint32_t seq = header->dataSeq.load(std::memory_order_acquire);
+            if (header->head.load(std::memory_order_acquire) == tail) {
+                futexWait(&header->dataSeq, seq, timeoutMs);
+            }
+
+            // Any fragments read so far are kept for the next call
+            if (header->head.load(std::memory_order_acquire) == tail) {
+                return false;
+            }
+        }
+
+        uint32_t word;
+        copyOut(tail, reinterpret_cast<uint8_t*>(&word), sizeof(uint32_t));
+
+        uint32_t len = word & MPI_SHM_LEN_MASK;
+        size_t offset = partial.size();
+        partial.resize(offset + len);
+        copyOut(tail + sizeof(uint32_t), BYTES(partial.data()) + offset, len);
+
+        header->tail.store(tail + sizeof(uint32_t) + len,
+                           std::memory_order_release);
+        header->spaceSeq.fetch_add(1, std::memory_order_release);
+        futexWake(&header->spaceSeq, INT_MAX);
+
+        if (word & MPI_SHM_ABORT_FLAG) {
+            // The writer died before finishing its message
+            if (!partial.empty()) {
+                faabric::util::getLogger()->warn(
+                  "Dropping unfinished message on shared memory ring {}",
+                  name);
+            }
+
+            partial.clear();
+            continue;
+        }
+
+        if (word & MPI_SHM_MORE_FLAG) {
+            continue;
+        }
+
+        bool parsed = msg.ParseFromString(partial);
+        partial.clear();
+
+        if (!parsed) {
+            faabric::util::getLogger()->error(
+              "Failed to parse MPI message from shared memory ring {}", name);
+            throw std::runtime_error("Failed to parse MPI message from ring");
+        }
+
+        return true;
+    }
+}
+
+size_t MpiShmRing::getCapacity()
+{
+    return header->capacity;
+}
+
+size_t MpiShmRing::getUsedBytes()
+{
+    return header->head.load(std::memory_order_acquire) -
+           header->tail.load(std::memory_order_acquire);
+}
+
+void MpiShmRing::lockWriters()
+{
+    int res = pthread_mutex_lock(&header->writeLock);
+    if (res == EOWNERDEAD) {
+        // Everything the dead writer committed is intact, but the reader has
+        // to drop any message it left unfinished
+        faabric::util::getLogger()->warn(
+          "Recovering writer lock on shared memory ring {}", name);
+
+        if (header->writeOpen) {
+            writeRecord(MPI_SHM_ABORT_FLAG, nullptr, 0);
+            header->writeOpen = 0;
+        }
+
+        pthread_mutex_consistent(&header->writeLock);
+    } else if (res != 0) {
+        faabric::util::getLogger()->error(
+          "Failed to lock shared memory ring {}: {}", name, strerror(res));
+        throw std::runtime_error("Failed to lock shared memory ring");
+    }
+}
+
+void MpiShmRing::unlockWriters()
+{
+    pthread_mutex_unlock(&header->writeLock);
+}
+
+// Must be called with the writer lock held
+void MpiShmRing::writeRecord(uint32_t word, const uint8_t* src, size_t len)
+{
+    size_t needed = sizeof(uint32_t) + len;
+
+    // Wait for the reader to make space
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    while (header->capacity -
+             (head - header->tail.load(std::memory_order_acquire)) <
+           needed) {
+        uint32_t seq = header->spaceSeq.load(std::memory_order_acquire);
+        if (header->capacity -
+              (head - header->tail.load(std::memory_order_acquire)) >=
+            needed) {
+            break;
+        }
+
+        futexWait(&header->spaceSeq, seq, MPI_SHM_POLL_TIMEOUT_MS);
+    }
+
+    copyIn(head, reinterpret_cast<uint8_t*>(&word), sizeof(uint32_t));
+    if (len > 0) {
+        copyIn(head + sizeof(uint32_t), src, len);
+    }
+    header->head.store(head + needed, std::memory_order_release);
+
+    header->dataSeq.fetch_add(1, std::memory_order_release);
+    futexWake(&header->dataSeq, 1);
+}
+
+void MpiShmRing::copyIn(uint64_t offset, const uint8_t* src, size_t len)
+{
+    size_t pos = offset % header->capacity;
+    size_t first = std::min<size_t>(len, header->capacity - pos);
+    std::memcpy(data + pos, src, first);
+    std::memcpy(data, src + first, len - first);
+}
+
+void MpiShmRing::copyOut(uint64_t offset, uint8_t* dst, size_t len)
+{
+    size_t pos = offset % header->capacity;
+    size_t first = std::min<size_t>(len, header->capacity - pos);
+    std::memcpy(dst, data + pos, first);
+    std::memcpy(dst + first, data, len - first);
+}
+}
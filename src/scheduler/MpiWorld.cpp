@@ -1,7 +1,7 @@
 #include <faabric/mpi/mpi.h>
 
 #include <faabric/scheduler/FunctionCallClient.h>
-#include <faabric/scheduler/MpiThreadPool.h>
+#include <faabric/scheduler/MpiRequestPool.h>
 #include <faabric/scheduler/MpiWorld.h>
 #include <faabric/scheduler/Scheduler.h>
 #include <faabric/state/State.h>
@@ -9,11 +9,33 @@
 #include <faabric/util/gids.h>
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
+#include <faabric/util/metrics.h>
 #include <faabric/util/timing.h>
+#include <faabric/util/tracing.h>
 
-static thread_local std::unordered_map<int, std::future<void>> futureMap;
+#include <cstring>
+
+#define MPI_ANY_POLL_TIMEOUT_MS 1
+#define MPI_RMA_BATCH_BYTES (1024 * 1024)
+
+// Below this block size all-to-all sends fewer, bigger messages
+#define MPI_ALLTOALL_BRUCK_MAX_BYTES 256
 
 namespace faabric::scheduler {
+
+// Requests are only ever progressed by the rank, hence thread, that made them
+static thread_local MpiRequestPool requestPool;
+
+static bool isMatch(const faabric::MPIMessage& m,
+                    int sendRank,
+                    int tag,
+                    faabric::MPIMessage::MPIMessageType messageType)
+{
+    return m.messagetype() == messageType &&
+           (sendRank == MPI_ANY_SOURCE || m.sender() == sendRank) &&
+           (tag == MPI_ANY_TAG || m.tag() == tag);
+}
+
 MpiWorld::MpiWorld()
   : id(-1)
   , size(-1)
@@ -22,6 +44,11 @@ MpiWorld::MpiWorld()
   , cartProcsPerDim(2)
 {}
 
+MpiWorld::~MpiWorld()
+{
+    stopShmTransport();
+}
+
 std::string getWorldStateKey(int worldId)
 {
     if (worldId <= 0) {
@@ -42,10 +69,9 @@ std::string getRankStateKey(int worldId, int rankId)
     return "mpi_rank_" + std::to_string(worldId) + "_" + std::to_string(rankId);
 }
 
-std::string getWindowStateKey(int worldId, int rank, size_t size)
+std::string getWindowStateKey(int worldId, int rank)
 {
-    return "mpi_win_" + std::to_string(worldId) + "_" + std::to_string(rank) +
-           "_" + std::to_string(size);
+    return "mpi_win_" + std::to_string(worldId) + "_" + std::to_string(rank);
 }
 
 void MpiWorld::setUpStateKV()
@@ -64,20 +90,6 @@ std::shared_ptr<state::StateKeyValue> MpiWorld::getRankHostState(int rank)
     return state.getKV(user, stateKey, MPI_HOST_STATE_LEN);
 }
 
-int MpiWorld::getMpiThreadPoolSize()
-{
-    auto logger = faabric::util::getLogger();
-    int usableCores = faabric::util::getUsableCores();
-    int worldSize = size;
-
-    if ((worldSize > usableCores) && (worldSize % usableCores != 0)) {
-        logger->warn("Over-provisioning threads in the MPI thread pool.");
-        logger->warn("To avoid this, set an MPI world size multiple of the "
-                     "number of cores per machine.");
-    }
-    return std::min<int>(worldSize, usableCores);
-}
-
 void MpiWorld::create(const faabric::Message& call, int newId, int newSize)
 {
     id = newId;
@@ -85,8 +97,6 @@ void MpiWorld::create(const faabric::Message& call, int newId, int newSize)
     function = call.function();
 
     size = newSize;
-    threadPool = std::make_shared<faabric::scheduler::MpiAsyncThreadPool>(
-      getMpiThreadPoolSize());
 
     // Write this to state
     setUpStateKV();
@@ -95,23 +105,49 @@ void MpiWorld::create(const faabric::Message& call, int newId, int newSize)
     // Register this as the master
     registerRank(0);
 
-    // Dispatch all the chained calls
+    // Make sure other processes can reach us before any ranks start
+    startShmTransport();
+
+    // Dispatch all the chained calls in a single batch, so that they are
+    // placed together
     // NOTE - with the master being rank zero, we want to spawn
     // (size - 1) new functions starting with rank 1
-    scheduler::Scheduler& sch = scheduler::getScheduler();
+    if (size < 2) {
+        return;
+    }
+
+    // Build the messages in the request, which is then handed over
+    faabric::BatchExecuteRequest req;
+    req.set_id(faabric::util::generateGid());
+    req.mutable_messages()->Reserve(size - 1);
     for (int i = 1; i < size; i++) {
-        faabric::Message msg = faabric::util::messageFactory(user, function);
+        faabric::Message& msg = *req.add_messages();
+        msg = faabric::util::messageFactory(user, function);
         msg.set_ismpi(true);
         msg.set_mpiworldid(id);
         msg.set_mpirank(i);
+        msg.set_mpiworldsize(size);
         msg.set_cmdline(call.cmdline());
+    }
 
-        sch.callFunction(msg);
+    scheduler::Scheduler& sch = scheduler::getScheduler();
+    std::vector<std::string> executedHosts = sch.callFunctions(std::move(req));
+
+    // Record the ranks sent elsewhere. Those executed on this host register
+    // themselves when they join the world.
+    faabric::util::FullLock lock(worldMutex);
+    for (int i = 0; i < (int)executedHosts.size(); i++) {
+        const std::string& host = executedHosts.at(i);
+        if (!host.empty() && host != sch.getThisHost()) {
+            rankHostMap[i + 1] = host;
+        }
     }
 }
 
 void MpiWorld::destroy()
 {
+    stopShmTransport();
+
     setUpStateKV();
     state::getGlobalState().deleteKV(stateKV->user, stateKV->key);
 
@@ -137,8 +173,110 @@ void MpiWorld::initialiseFromState(const faabric::Message& msg, int worldId)
     stateKV->pull();
     stateKV->get(BYTES(&s));
     size = s.worldSize;
-    threadPool = std::make_shared<faabric::scheduler::MpiAsyncThreadPool>(
-      getMpiThreadPoolSize());
+
+    // Take the rank-to-host map from the message if it's been scheduled with
+    // one, to avoid looking up each rank in state
+    faabric::util::FullLock lock(worldMutex);
+    for (int i = 0; i < msg.mpirankhosts_size(); i++) {
+        rankHostMap[i] = msg.mpirankhosts(i);
+    }
+    lock.unlock();
+
+    startShmTransport();
+}
+
+void MpiWorld::startShmTransport()
+{
+    if (faabric::util::getSystemConfig().mpiShmTransport != "on") {
+        return;
+    }
+
+    faabric::util::FullLock lock(worldMutex);
+    if (shmInbox != nullptr) {
+        return;
+    }
+
+    shmInbox = MpiShmRing::create(MpiShmRing::getRingName(id, thisHost),
+                                  MPI_SHM_RING_SIZE);
+
+    // Messages from the ring are handled just like those over the network
+    shmRunning = true;
+    shmThread = std::thread([this, inbox = shmInbox] {
+        const std::shared_ptr<spdlog::logger>& logger =
+          faabric::util::getLogger();
+
+        faabric::MPIMessage msg;
+        while (shmRunning) {
+            try {
+                if (inbox->pop(msg, MPI_SHM_POLL_TIMEOUT_MS)) {
+                    enqueueMessage(msg);
+                }
+            } catch (std::exception& ex) {
+                logger->error("Failed handling shared memory message for "
+                              "world {}: {}",
+                              id,
+                              ex.what());
+            }
+        }
+    });
+}
+
+void MpiWorld::stopShmTransport()
+{
+    shmRunning = false;
+    if (shmThread.joinable()) {
+        shmThread.join();
+    }
+
+    faabric::util::FullLock lock(worldMutex);
+    shmPeers.clear();
+    shmInbox = nullptr;
+}
+
+bool MpiWorld::sendShm(const std::string& otherHost,
+                       const faabric::MPIMessage& msg)
+{
+    // Hosts we failed to open a ring for are kept with a null ring, so that
+    // we only try once. This also means messages to a host never switch
+    // transport part way through, which would break their ordering.
+    std::shared_ptr<MpiShmRing> ring;
+    {
+        faabric::util::SharedLock lock(worldMutex);
+        if (shmInbox == nullptr) {
+            return false;
+        }
+
+        auto it = shmPeers.find(otherHost);
+        if (it != shmPeers.end()) {
+            if (it->second == nullptr) {
+                return false;
+            }
+
+            ring = it->second;
+        }
+    }
+
+    // Only processes on this machine will have a ring we can open
+    if (ring == nullptr) {
+        faabric::util::FullLock lock(worldMutex);
+        auto it = shmPeers.find(otherHost);
+        if (it == shmPeers.end()) {
+            it = shmPeers
+                   .emplace(otherHost,
+                            MpiShmRing::open(
+                              MpiShmRing::getRingName(id, otherHost)))
+                   .first;
+        }
+
+        if (it->second == nullptr) {
+            return false;
+        }
+
+        ring = it->second;
+    }
+
+    ring->push(msg);
+    return true;
 }
 
 void MpiWorld::pushToState()
@@ -326,28 +464,19 @@ int MpiWorld::isend(int sendRank,
                     const uint8_t* buffer,
                     faabric_datatype_t* dataType,
                     int count,
-                    faabric::MPIMessage::MPIMessageType messageType)
+                    faabric::MPIMessage::MPIMessageType messageType,
+                    int tag)
 {
-    int requestId = (int)faabric::util::generateGid();
-
-    std::promise<void> resultPromise;
-    std::future<void> resultFuture = resultPromise.get_future();
-    threadPool->getMpiReqQueue()->enqueue(
-      std::make_tuple(requestId,
-                      std::bind(&MpiWorld::send,
-                                this,
-                                sendRank,
-                                recvRank,
-                                buffer,
-                                dataType,
-                                count,
-                                messageType),
-                      std::move(resultPromise)));
+    // Sends are eager, the data is copied into the message before returning,
+    // so the request is complete straight away
+    send(sendRank, recvRank, buffer, dataType, count, messageType, tag);
 
-    // Place the promise in a map to wait for it later
-    futureMap.emplace(std::make_pair(requestId, std::move(resultFuture)));
+    MpiRequest& req = requestPool.acquire();
+    req.sendRank = sendRank;
+    req.recvRank = recvRank;
+    req.complete = true;
 
-    return requestId;
+    return req.id;
 }
 
 int MpiWorld::irecv(int sendRank,
@@ -355,29 +484,191 @@ int MpiWorld::irecv(int sendRank,
                     uint8_t* buffer,
                     faabric_datatype_t* dataType,
                     int count,
-                    faabric::MPIMessage::MPIMessageType messageType)
+                    faabric::MPIMessage::MPIMessageType messageType,
+                    int tag)
+{
+    MpiRequest& req = requestPool.acquire();
+    req.isRecv = true;
+    req.sendRank = sendRank;
+    req.recvRank = recvRank;
+    req.buffer = buffer;
+    req.dataType = dataType;
+    req.count = count;
+    req.tag = tag;
+    req.messageType = messageType;
+
+    // Anything that's arrived goes to earlier receives first
+    pullAllMessages(recvRank);
+
+    std::shared_ptr<faabric::MPIMessage> m =
+      findUnexpected(sendRank, recvRank, tag, messageType, true);
+    if (m != nullptr) {
+        doRecv(m, buffer, dataType, count, &req.status);
+        req.complete = true;
+    } else {
+        MpiMatchState& state = getMatchState(recvRank);
+        faabric::util::UniqueLock lock(state.mx);
+        state.postedRecvs.push_back(req.id);
+    }
+
+    return req.id;
+}
+
+MpiMatchState& MpiWorld::getMatchState(int recvRank)
+{
+    checkRankOnThisHost(recvRank);
+
+    // Other ranks may be adding their own state, so the map is only read
+    // under the lock. States themselves don't move once they're added.
+    {
+        faabric::util::SharedLock lock(worldMutex);
+        auto it = matchStates.find(recvRank);
+        if (it != matchStates.end()) {
+            return it->second;
+        }
+    }
+
+    faabric::util::FullLock lock(worldMutex);
+    return matchStates.try_emplace(recvRank).first->second;
+}
+
+bool MpiWorld::pullMessage(int sendRank,
+                           int recvRank,
+                           bool block,
+                           long timeoutMs)
+{
+    std::shared_ptr<InMemoryMpiQueue> queue =
+      getLocalQueue(sendRank, recvRank);
+
+    std::shared_ptr<faabric::MPIMessage> m;
+    if (!block) {
+        if (!queue->tryDequeue(m)) {
+            return false;
+        }
+    } else {
+        try {
+            m = queue->dequeue(timeoutMs);
+        } catch (faabric::util::QueueTimeoutException& ex) {
+            return false;
+        }
+    }
+
+    matchArrived(recvRank, m);
+    return true;
+}
+
+void MpiWorld::pullAllMessages(int recvRank)
+{
+    for (int sendRank = 0; sendRank < size; sendRank++) {
+        while (pullMessage(sendRank, recvRank, false)) {
+            ;
+        }
+    }
+}
+
+bool MpiWorld::waitForMessage(int sendRank, int recvRank, long timeoutMs)
+{
+    if (sendRank != MPI_ANY_SOURCE) {
+        return pullMessage(sendRank, recvRank, true, timeoutMs);
+    }
+
+    // Every sender signals the receiver's match state, so we can wait for
+    // anything to arrive, then check all the queues
+    MpiMatchState& state = getMatchState(recvRank);
+    util::TimePoint start = util::startTimer();
+    while (true) {
+        uint64_t seen;
+        {
+            faabric::util::UniqueLock lock(state.mx);
+            seen = state.nArrived;
+        }
+
+        bool pulled = false;
+        for (int r = 0; r < size; r++) {
+            pulled |= pullMessage(r, recvRank, false);
+        }
+
+        if (pulled) {
+            return true;
+        }
+
+        auto arrived = [&state, seen] { return state.nArrived != seen; };
+
+        faabric::util::UniqueLock lock(state.mx);
+        if (timeoutMs <= 0) {
+            state.arrivedCv.wait(lock, arrived);
+            continue;
+        }
+
+        long remainingMs = timeoutMs - util::getTimeDiffMillis(start);
+        if (remainingMs <= 0 ||
+            !state.arrivedCv.wait_for(
+              lock, std::chrono::milliseconds(remainingMs), arrived)) {
+            return false;
+        }
+    }
+}
+
+void MpiWorld::notifyArrived(int recvRank)
+{
+    MpiMatchState& state = getMatchState(recvRank);
+    {
+        faabric::util::UniqueLock lock(state.mx);
+        state.nArrived++;
+    }
+
+    state.arrivedCv.notify_all();
+}
+
+void MpiWorld::matchArrived(int recvRank,
+                            std::shared_ptr<faabric::MPIMessage>& m)
 {
-    int requestId = (int)faabric::util::generateGid();
+    MpiMatchState& state = getMatchState(recvRank);
+    faabric::util::UniqueLock lock(state.mx);
+
+    auto it = state.postedRecvs.begin();
+    while (it != state.postedRecvs.end()) {
+        // Skip anything that's been released without completing
+        MpiRequest* req = requestPool.get(*it);
+        if (req == nullptr) {
+            it = state.postedRecvs.erase(it);
+            continue;
+        }
 
-    std::promise<void> resultPromise;
-    std::future<void> resultFuture = resultPromise.get_future();
-    threadPool->getMpiReqQueue()->enqueue(
-      std::make_tuple(requestId,
-                      std::bind(&MpiWorld::recv,
-                                this,
-                                sendRank,
-                                recvRank,
-                                buffer,
-                                dataType,
-                                count,
-                                nullptr,
-                                messageType),
-                      std::move(resultPromise)));
+        if (isMatch(*m, req->sendRank, req->tag, req->messageType)) {
+            state.postedRecvs.erase(it);
+            doRecv(m, req->buffer, req->dataType, req->count, &req->status);
+            req->complete = true;
+            return;
+        }
 
-    // Place the promise in a map to wait for it later
-    futureMap.emplace(std::make_pair(requestId, std::move(resultFuture)));
+        ++it;
+    }
 
-    return requestId;
+    state.unexpected.push_back(m);
+}
+
+std::shared_ptr<faabric::MPIMessage> MpiWorld::findUnexpected(
+  int sendRank,
+  int recvRank,
+  int tag,
+  faabric::MPIMessage::MPIMessageType messageType,
+  bool remove)
+{
+    MpiMatchState& state = getMatchState(recvRank);
+    faabric::util::UniqueLock lock(state.mx);
+    for (auto it = state.unexpected.begin(); it != state.unexpected.end();
+         ++it) {
+        if (isMatch(**it, sendRank, tag, messageType)) {
+            std::shared_ptr<faabric::MPIMessage> m = *it;
+            if (remove) {
+                state.unexpected.erase(it);
+            }
+            return m;
+        }
+    }
+
+    return nullptr;
 }
 
 void MpiWorld::send(int sendRank,
@@ -385,7 +676,8 @@ void MpiWorld::send(int sendRank,
                     const uint8_t* buffer,
                     faabric_datatype_t* dataType,
                     int count,
-                    faabric::MPIMessage::MPIMessageType messageType)
+                    faabric::MPIMessage::MPIMessageType messageType,
+                    int tag)
 {
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
 
@@ -406,6 +698,13 @@ void MpiWorld::send(int sendRank,
     m->set_type(dataType->id);
     m->set_count(count);
     m->set_messagetype(messageType);
+    m->set_tag(tag);
+
+    // Receivers record their spans as children of this one
+    faabric::util::ScopedSpan span("mpi_send");
+    if (span.isActive()) {
+        m->mutable_tracecontext()->CopyFrom(span.context());
+    }
 
     // Work out whether the message is sent locally or to another host
     const std::string otherHost = getHostForRank(recvRank);
@@ -416,22 +715,47 @@ void MpiWorld::send(int sendRank,
         m->set_buffer(buffer, dataType->size * count);
     }
 
+    static faabric::util::Counter& sentMessages =
+      faabric::util::getMetrics().getCounter("mpi_sent_messages");
+    static faabric::util::Counter& sentBytes =
+      faabric::util::getMetrics().getCounter("mpi_sent_bytes");
+    sentMessages.inc();
+    sentBytes.inc(m->buffer().size());
+
     // Dispatch the message locally or globally
     if (isLocal) {
         if (messageType == faabric::MPIMessage::RMA_WRITE) {
             logger->trace("MPI - local RMA write {} -> {}", sendRank, recvRank);
-            synchronizeRmaWrite(*m, false);
+            synchronizeRmaWrite(*m);
         } else {
             logger->trace("MPI - send {} -> {}", sendRank, recvRank);
             getLocalQueue(sendRank, recvRank)->enqueue(std::move(m));
+            notifyArrived(recvRank);
         }
     } else {
-        logger->trace("MPI - send remote {} -> {}", sendRank, recvRank);
+        sendRemote(otherHost, m);
+    }
+}
+
+void MpiWorld::sendRemote(const std::string& otherHost,
+                          const std::shared_ptr<faabric::MPIMessage>& m)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
 
-        // TODO - avoid creating a client each time?
-        scheduler::FunctionCallClient client(otherHost);
-        client.sendMPIMessage(m);
+    // The shm ring returns before the target has applied an RMA write, but a
+    // fence needs the write to have landed, so these go the synchronous way
+    bool isRma = m->messagetype() == faabric::MPIMessage::RMA_WRITE;
+    if (!isRma && sendShm(otherHost, *m)) {
+        logger->trace(
+          "MPI - send shm {} -> {}", m->sender(), m->destination());
+        return;
     }
+
+    logger->trace("MPI - send remote {} -> {}", m->sender(), m->destination());
+
+    // TODO - avoid creating a client each time?
+    scheduler::FunctionCallClient client(otherHost);
+    client.sendMPIMessage(m);
 }
 
 void MpiWorld::recv(int sendRank,
@@ -440,31 +764,64 @@ void MpiWorld::recv(int sendRank,
                     faabric_datatype_t* dataType,
                     int count,
                     MPI_Status* status,
-                    faabric::MPIMessage::MPIMessageType messageType)
+                    faabric::MPIMessage::MPIMessageType messageType,
+                    int tag)
 {
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
-
-    // Listen to the in-memory queue for this rank and message type
     logger->trace("MPI - recv {} -> {}", sendRank, recvRank);
-    std::shared_ptr<faabric::MPIMessage> m =
-      getLocalQueue(sendRank, recvRank)->dequeue();
 
-    if (messageType != m->messagetype()) {
-        logger->error(
-          "Message types mismatched on {}->{} (expected={}, got={})",
-          sendRank,
-          recvRank,
-          messageType,
-          m->messagetype());
-        throw std::runtime_error("Mismatched message types");
+    static faabric::util::Histogram& recvWaitHist =
+      faabric::util::getMetrics().getHistogram("mpi_recv_wait_us");
+    const faabric::util::TimePoint waitStart = faabric::util::startTimer();
+
+    faabric::util::Tracer& tracer = faabric::util::getTracer();
+    uint64_t waitStartMicros =
+      tracer.isEnabled() ? faabric::util::getEpochMicros() : 0;
+
+    // Receives posted earlier get first pick of what arrives, so this only
+    // takes messages they've left unmatched
+    std::shared_ptr<faabric::MPIMessage> m;
+    while ((m = findUnexpected(
+              sendRank, recvRank, tag, messageType, true)) == nullptr) {
+        waitForMessage(sendRank, recvRank);
     }
 
+    recvWaitHist.record(faabric::util::getTimeDiffMicros(waitStart));
+
+    // The parent is the sender's span, so the wait shows up in its trace
+    if (tracer.isEnabled()) {
+        faabric::util::Span span =
+          tracer.startSpan("mpi_recv", m->tracecontext());
+        span.startMicros = waitStartMicros;
+        span.attributes["sender"] = std::to_string(sendRank);
+        span.attributes["receiver"] = std::to_string(recvRank);
+        tracer.finishSpan(span);
+    }
+
+    doRecv(m, buffer, dataType, count, status);
+}
+
+void MpiWorld::doRecv(std::shared_ptr<faabric::MPIMessage>& m,
+                      uint8_t* buffer,
+                      faabric_datatype_t* dataType,
+                      int count,
+                      MPI_Status* status)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
     if (m->count() > count) {
         logger->error(
           "Message too long for buffer (msg={}, buffer={})", m->count(), count);
         throw std::runtime_error("Message too long");
     }
 
+    static faabric::util::Counter& recvMessages =
+      faabric::util::getMetrics().getCounter("mpi_recv_messages");
+    static faabric::util::Counter& recvBytes =
+      faabric::util::getMetrics().getCounter("mpi_recv_bytes");
+    recvMessages.inc();
+    recvBytes.inc(m->buffer().size());
+
     // TODO - avoid copy here
     // Copy message data
     if (m->count() > 0) {
@@ -475,12 +832,10 @@ void MpiWorld::recv(int sendRank,
     if (status != nullptr) {
         status->MPI_SOURCE = m->sender();
         status->MPI_ERROR = MPI_SUCCESS;
+        status->MPI_TAG = m->tag();
 
         // Note, take the message size here as the receive count may be larger
         status->bytesSize = m->count() * dataType->size;
-
-        // TODO - thread through tag
-        status->MPI_TAG = -1;
     }
 }
 
@@ -493,7 +848,9 @@ void MpiWorld::sendRecv(uint8_t* sendBuffer,
                         faabric_datatype_t* recvDataType,
                         int recvRank,
                         int myRank,
-                        MPI_Status* status)
+                        MPI_Status* status,
+                        int sendTag,
+                        int recvTag)
 {
     auto logger = faabric::util::getLogger();
     logger->trace(
@@ -517,16 +874,18 @@ void MpiWorld::sendRecv(uint8_t* sendBuffer,
                        recvBuffer,
                        recvDataType,
                        recvCount,
-                       faabric::MPIMessage::SENDRECV);
+                       faabric::MPIMessage::SENDRECV,
+                       recvTag);
     // Then send the message
     send(myRank,
          sendRank,
          sendBuffer,
          sendDataType,
          sendCount,
-         faabric::MPIMessage::SENDRECV);
+         faabric::MPIMessage::SENDRECV,
+         sendTag);
     // And wait
-    awaitAsyncRequest(recvId);
+    awaitAsyncRequest(recvId, status);
 }
 
 void MpiWorld::broadcast(int sendRank,
@@ -695,58 +1054,164 @@ void MpiWorld::allGather(int rank,
 {
     checkSendRecvMatch(sendType, sendCount, recvType, recvCount);
 
-    int root = 0;
-
-    // Do a gather with a hard-coded root
-    gather(rank,
-           root,
-           sendBuffer,
-           sendType,
-           sendCount,
-           recvBuffer,
-           recvType,
-           recvCount);
-
-    // Note that sendCount and recvCount here are per-rank, so we need to work
-    // out the full buffer size
-    int fullCount = recvCount * size;
-    if (rank == root) {
-        // Broadcast the result
-        broadcast(root,
-                  recvBuffer,
-                  recvType,
-                  fullCount,
-                  faabric::MPIMessage::ALLGATHER);
+    size_t blockSize = recvCount * recvType->size;
+
+    // If operating in-place, this rank's data is already in position
+    if (sendBuffer != recvBuffer) {
+        std::copy(
+          sendBuffer, sendBuffer + blockSize, recvBuffer + rank * blockSize);
+    }
+
+    if ((size & (size - 1)) == 0) {
+        // Recursive doubling, swapping everything gathered so far with a
+        // partner each round
+        for (int k = 1; k < size; k <<= 1) {
+            int partner = rank ^ k;
+            exchange(rank,
+                     partner,
+                     recvBuffer + (rank / k) * k * blockSize,
+                     recvType,
+                     k * recvCount,
+                     partner,
+                     recvBuffer + (partner / k) * k * blockSize,
+                     recvType,
+                     k * recvCount,
+                     faabric::MPIMessage::ALLGATHER);
+        }
     } else {
-        // Await the broadcast from the master
-        recv(root,
-             rank,
-             recvBuffer,
-             recvType,
-             fullCount,
-             nullptr,
-             faabric::MPIMessage::ALLGATHER);
+        // Ring, passing on the block received in the previous step
+        int right = (rank + 1) % size;
+        int left = (rank - 1 + size) % size;
+        for (int step = 0; step < size - 1; step++) {
+            int sendBlock = (rank - step + size) % size;
+            int recvBlock = (rank - step - 1 + size) % size;
+            exchange(rank,
+                     right,
+                     recvBuffer + sendBlock * blockSize,
+                     recvType,
+                     recvCount,
+                     left,
+                     recvBuffer + recvBlock * blockSize,
+                     recvType,
+                     recvCount,
+                     faabric::MPIMessage::ALLGATHER);
+        }
     }
 }
 
-void MpiWorld::awaitAsyncRequest(int requestId)
+void MpiWorld::exchange(int rank,
+                        int sendRank,
+                        const uint8_t* sendBuffer,
+                        faabric_datatype_t* sendType,
+                        int sendCount,
+                        int recvRank,
+                        uint8_t* recvBuffer,
+                        faabric_datatype_t* recvType,
+                        int recvCount,
+                        faabric::MPIMessage::MPIMessageType messageType)
+{
+    // Post the receive first so it's matched as soon as the data arrives
+    int recvId =
+      irecv(recvRank, rank, recvBuffer, recvType, recvCount, messageType);
+    send(rank, sendRank, sendBuffer, sendType, sendCount, messageType);
+    awaitAsyncRequest(recvId);
+}
+
+void MpiWorld::awaitAsyncRequest(int requestId, MPI_Status* status)
 {
     faabric::util::getLogger()->trace("MPI - await {}", requestId);
 
-    auto it = futureMap.find(requestId);
-    if (it == futureMap.end()) {
+    MpiRequest* req = requestPool.get(requestId);
+    if (req == nullptr) {
         throw std::runtime_error(
           fmt::format("Error: waiting for unrecognized request {}", requestId));
     }
 
-    // This call blocks until requestId has finished.
-    it->second.wait();
-    futureMap.erase(it);
+    // Other receives posted by this rank may complete on the way
+    while (!req->complete) {
+        waitForMessage(req->sendRank, req->recvRank);
+    }
+
+    finishAsyncRequest(*req, status);
 
     faabric::util::getLogger()->debug("Finished awaitAsyncRequest on {}",
                                       requestId);
 }
 
+bool MpiWorld::testAsyncRequest(int requestId, MPI_Status* status)
+{
+    MpiRequest* req = requestPool.get(requestId);
+    if (req == nullptr) {
+        throw std::runtime_error(
+          fmt::format("Error: testing unrecognized request {}", requestId));
+    }
+
+    if (!req->complete && req->isRecv) {
+        pullAllMessages(req->recvRank);
+    }
+
+    if (!req->complete) {
+        return false;
+    }
+
+    finishAsyncRequest(*req, status);
+    return true;
+}
+
+int MpiWorld::awaitAnyAsyncRequest(const std::vector<int>& requestIds,
+                                   MPI_Status* status)
+{
+    if (requestIds.empty()) {
+        throw std::runtime_error("Waiting for any of no requests");
+    }
+
+    // Check everything, then wait for anything to arrive for the receiving
+    // rank. Requests are only ever for one receiving rank unless a thread is
+    // acting as several, in which case we can't block on just one of them.
+    while (true) {
+        for (size_t i = 0; i < requestIds.size(); i++) {
+            if (testAsyncRequest(requestIds.at(i), status)) {
+                return i;
+            }
+        }
+
+        int recvRank = -1;
+        bool singleRank = true;
+        for (int requestId : requestIds) {
+            MpiRequest* req = requestPool.get(requestId);
+            if (!req->isRecv || req->complete) {
+                continue;
+            }
+
+            if (recvRank >= 0 && req->recvRank != recvRank) {
+                singleRank = false;
+            }
+            recvRank = req->recvRank;
+        }
+
+        waitForMessage(
+          MPI_ANY_SOURCE, recvRank, singleRank ? 0 : MPI_ANY_POLL_TIMEOUT_MS);
+    }
+}
+
+size_t MpiWorld::getOutstandingRequestCount()
+{
+    return requestPool.getOutstandingCount();
+}
+
+void MpiWorld::finishAsyncRequest(MpiRequest& req, MPI_Status* status)
+{
+    if (status != nullptr) {
+        if (req.isRecv) {
+            *status = req.status;
+        } else {
+            status->MPI_ERROR = MPI_SUCCESS;
+        }
+    }
+
+    requestPool.release(req.id);
+}
+
 void MpiWorld::reduce(int sendRank,
                       int recvRank,
                       uint8_t* sendBuffer,
@@ -997,59 +1462,110 @@ void MpiWorld::allToAll(int rank,
 {
     checkSendRecvMatch(sendType, sendCount, recvType, recvCount);
 
-    size_t sendOffset = sendCount * sendType->size;
+    size_t blockSize = sendCount * sendType->size;
+    if (blockSize <= MPI_ALLTOALL_BRUCK_MAX_BYTES) {
+        bruckAllToAll(rank, sendBuffer, recvBuffer, blockSize);
+        return;
+    }
 
-    // Send out messages for this rank
-    for (int r = 0; r < size; r++) {
-        // Work out what data to send to this rank
-        size_t rankOffset = r * sendOffset;
-        uint8_t* sendChunk = sendBuffer + rankOffset;
-
-        if (r == rank) {
-            // Copy directly
-            std::copy(
-              sendChunk, sendChunk + sendOffset, recvBuffer + rankOffset);
-        } else {
-            // Send message to other rank
-            send(rank,
-                 r,
-                 sendChunk,
+    // Copy this rank's own block directly
+    uint8_t* ownBlock = sendBuffer + rank * blockSize;
+    std::copy(ownBlock, ownBlock + blockSize, recvBuffer + rank * blockSize);
+
+    // Pairwise exchange, each step sending to one rank and receiving from
+    // another
+    for (int step = 1; step < size; step++) {
+        int sendTo = (rank + step) % size;
+        int recvFrom = (rank - step + size) % size;
+        exchange(rank,
+                 sendTo,
+                 sendBuffer + sendTo * blockSize,
                  sendType,
                  sendCount,
+                 recvFrom,
+                 recvBuffer + recvFrom * blockSize,
+                 recvType,
+                 recvCount,
                  faabric::MPIMessage::ALLTOALL);
-        }
     }
+}
 
-    // Await incoming messages from others
-    for (int r = 0; r < size; r++) {
-        if (r == rank) {
-            continue;
+void MpiWorld::bruckAllToAll(int rank,
+                             const uint8_t* sendBuffer,
+                             uint8_t* recvBuffer,
+                             size_t blockSize)
+{
+    // Rotate so that block i is the one for rank + i
+    std::vector<uint8_t> blocks(size * blockSize);
+    for (int i = 0; i < size; i++) {
+        const uint8_t* src = sendBuffer + ((rank + i) % size) * blockSize;
+        std::copy(src, src + blockSize, blocks.data() + i * blockSize);
+    }
+
+    // In round k, the blocks with bit k set in their index move k ranks on,
+    // packed into a single message
+    std::vector<uint8_t> sendPacked;
+    std::vector<uint8_t> recvPacked;
+    for (int k = 1; k < size; k <<= 1) {
+        sendPacked.clear();
+        for (int i = k; i < size; i++) {
+            if (i & k) {
+                uint8_t* block = blocks.data() + i * blockSize;
+                sendPacked.insert(sendPacked.end(), block, block + blockSize);
+            }
         }
 
-        // Work out where to place the result from this rank
-        uint8_t* recvChunk = recvBuffer + (r * sendOffset);
+        recvPacked.resize(sendPacked.size());
+        exchange(rank,
+                 (rank + k) % size,
+                 sendPacked.data(),
+                 MPI_BYTE,
+                 (int)sendPacked.size(),
+                 (rank - k + size) % size,
+                 recvPacked.data(),
+                 MPI_BYTE,
+                 (int)recvPacked.size(),
+                 faabric::MPIMessage::ALLTOALL);
 
-        // Do the receive
-        recv(r,
-             rank,
-             recvChunk,
-             recvType,
-             recvCount,
-             nullptr,
-             faabric::MPIMessage::ALLTOALL);
+        uint8_t* next = recvPacked.data();
+        for (int i = k; i < size; i++) {
+            if (i & k) {
+                std::copy(
+                  next, next + blockSize, blocks.data() + i * blockSize);
+                next += blockSize;
+            }
+        }
+    }
+
+    // Block i now holds the data from rank - i
+    for (int i = 0; i < size; i++) {
+        uint8_t* block = blocks.data() + i * blockSize;
+        std::copy(block,
+                  block + blockSize,
+                  recvBuffer + ((rank - i + size) % size) * blockSize);
     }
 }
 
-void MpiWorld::probe(int sendRank, int recvRank, MPI_Status* status)
+void MpiWorld::probe(int sendRank,
+                     int recvRank,
+                     MPI_Status* status,
+                     int tag)
 {
-    const std::shared_ptr<InMemoryMpiQueue>& queue =
-      getLocalQueue(sendRank, recvRank);
-    std::shared_ptr<faabric::MPIMessage> m = *(queue->peek());
+    // Leave the message to be matched by a later receive
+    std::shared_ptr<faabric::MPIMessage> m;
+    while ((m = findUnexpected(sendRank,
+                               recvRank,
+                               tag,
+                               faabric::MPIMessage::NORMAL,
+                               false)) == nullptr) {
+        waitForMessage(sendRank, recvRank);
+    }
 
     faabric_datatype_t* datatype = getFaabricDatatypeFromId(m->type());
     status->bytesSize = m->count() * datatype->size;
     status->MPI_ERROR = 0;
     status->MPI_SOURCE = m->sender();
+    status->MPI_TAG = m->tag();
 }
 
 void MpiWorld::barrier(int thisRank)
@@ -1102,12 +1618,13 @@ void MpiWorld::enqueueMessage(faabric::MPIMessage& msg)
     if (msg.messagetype() == faabric::MPIMessage::RMA_WRITE) {
         // NOTE - RMA notifications must be processed synchronously to ensure
         // ordering
-        synchronizeRmaWrite(msg, true);
+        synchronizeRmaWrite(msg);
     } else {
         logger->trace(
           "Queueing message locally {} -> {}", msg.sender(), msg.destination());
         getLocalQueue(msg.sender(), msg.destination())
           ->enqueue(std::make_shared<faabric::MPIMessage>(msg));
+        notifyArrived(msg.destination());
     }
 }
 
@@ -1135,24 +1652,25 @@ void MpiWorld::rmaGet(int sendRank,
                       int sendCount,
                       uint8_t* recvBuffer,
                       faabric_datatype_t* recvType,
-                      int recvCount)
+                      int recvCount,
+                      long offset)
 {
     checkSendRecvMatch(sendType, sendCount, recvType, recvCount);
+    size_t length = sendType->size * sendCount;
 
-    // Get the state value that relates to this window
-    int buffLen = sendType->size * sendCount;
-    const std::string stateKey = getWindowStateKey(id, sendRank, buffLen);
-    state::State& state = state::getGlobalState();
-    const std::shared_ptr<state::StateKeyValue>& kv =
-      state.getKV(user, stateKey, buffLen);
-
-    // If it's remote, do a pull too
-    if (getHostForRank(sendRank) != thisHost) {
-        kv->pull();
+    // Windows on this host are read directly
+    if (getHostForRank(sendRank) == thisHost) {
+        uint8_t* windowPtr = getWindowRange(sendRank, offset, length);
+        std::memcpy(recvBuffer, windowPtr, length);
+        return;
     }
 
-    // Do the read
-    kv->get(recvBuffer);
+    // Other hosts publish their windows to state, so pull just the range
+    state::State& state = state::getGlobalState();
+    const std::shared_ptr<state::StateKeyValue>& kv =
+      state.getKV(user, getWindowStateKey(id, sendRank));
+    kv->pullChunk(offset, length);
+    kv->getChunk(offset, recvBuffer, length);
 }
 
 void MpiWorld::rmaPut(int sendRank,
@@ -1161,55 +1679,235 @@ void MpiWorld::rmaPut(int sendRank,
                       int sendCount,
                       int recvRank,
                       faabric_datatype_t* recvType,
-                      int recvCount)
+                      int recvCount,
+                      long offset)
 {
     checkSendRecvMatch(sendType, sendCount, recvType, recvCount);
+    size_t length = sendType->size * sendCount;
+
+    if (getHostForRank(recvRank) == thisHost) {
+        writeWindow(recvRank, offset, sendBuffer, length);
+        return;
+    }
+
+    // Puts to other hosts only have to land by the end of the epoch, so they
+    // are batched into one message per target
+    std::shared_ptr<faabric::MPIMessage> full;
+    {
+        faabric::util::FullLock lock(worldMutex);
+
+        std::string key =
+          std::to_string(sendRank) + "_" + std::to_string(recvRank);
+        std::shared_ptr<faabric::MPIMessage>& pending = pendingRmaPuts[key];
+        if (pending == nullptr) {
+            pending = std::make_shared<faabric::MPIMessage>();
+            pending->set_worldid(id);
+            pending->set_sender(sendRank);
+            pending->set_destination(recvRank);
+            pending->set_messagetype(faabric::MPIMessage::RMA_WRITE);
+        }
+
+        pending->add_rmaoffsets(offset);
+        pending->add_rmalengths(length);
+        pending->mutable_buffer()->append((char*)sendBuffer, length);
+
+        if (pending->buffer().size() >= MPI_RMA_BATCH_BYTES) {
+            full = pending;
+            pendingRmaPuts.erase(key);
+        }
+    }
+
+    if (full != nullptr) {
+        full->set_id((int)faabric::util::generateGid());
+        sendRemote(getHostForRank(recvRank), full);
+    }
+}
+
+void MpiWorld::rmaFlush(int sendRank)
+{
+    std::vector<std::shared_ptr<faabric::MPIMessage>> toSend;
+    {
+        faabric::util::FullLock lock(worldMutex);
+        for (auto it = pendingRmaPuts.begin(); it != pendingRmaPuts.end();) {
+            if (it->second->sender() == sendRank) {
+                toSend.emplace_back(it->second);
+                it = pendingRmaPuts.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& m : toSend) {
+        m->set_id((int)faabric::util::generateGid());
+        sendRemote(getHostForRank(m->destination()), m);
+    }
+
+    // Puts to windows on this host have landed, but other hosts only see them
+    // once they're published
+    std::vector<int> written;
+    {
+        faabric::util::SharedLock lock(worldMutex);
+        for (auto& p : unpublishedWrites) {
+            written.emplace_back(p.first);
+        }
+    }
+
+    for (int winRank : written) {
+        publishWrites(winRank);
+    }
+}
+
+void MpiWorld::rmaFence(int rank)
+{
+    // Puts must have landed by the end of the epoch
+    rmaFlush(rank);
+
+    // Writes to a window's memory by its owner are only seen by other hosts
+    // once it's republished
+    bool hasWindow;
+    {
+        faabric::util::SharedLock lock(worldMutex);
+        hasWindow = windows.count(rank) > 0;
+    }
+
+    if (hasWindow && isSpreadAcrossHosts()) {
+        publishWindow(rank);
+    }
+
+    barrier(rank);
+}
+
+void MpiWorld::synchronizeRmaWrite(const faabric::MPIMessage& msg)
+{
+    const uint8_t* data = BYTES_CONST(msg.buffer().data());
+    for (int i = 0; i < msg.rmaoffsets_size(); i++) {
+        writeWindow(msg.destination(),
+                    msg.rmaoffsets(i),
+                    data,
+                    msg.rmalengths(i));
+        data += msg.rmalengths(i);
+    }
+
+    // The sender's fence waits on this, so the batch is visible to other
+    // hosts before the epoch ends
+    publishWrites(msg.destination());
+}
+
+void MpiWorld::writeWindow(int winRank,
+                           long offset,
+                           const uint8_t* data,
+                           size_t length)
+{
+    std::memcpy(getWindowRange(winRank, offset, length), data, length);
+
+    // Other hosts read the window through state, which is only updated at the
+    // end of the epoch
+    faabric::util::FullLock lock(worldMutex);
+    unpublishedWrites[winRank].emplace_back(offset, length);
+}
+
+void MpiWorld::publishWrites(int winRank)
+{
+    std::vector<std::pair<long, size_t>> ranges;
+    MpiWindow win;
+    {
+        faabric::util::FullLock lock(worldMutex);
+        auto it = unpublishedWrites.find(winRank);
+        if (it == unpublishedWrites.end()) {
+            return;
+        }
+
+        ranges = std::move(it->second);
+        unpublishedWrites.erase(it);
+
+        auto winIt = windows.find(winRank);
+        if (winIt == windows.end()) {
+            return;
+        }
+        win = winIt->second;
+    }
+
+    if (!isSpreadAcrossHosts()) {
+        return;
+    }
 
-    // Get the state value for the window to write to
-    int buffLen = sendType->size * sendCount;
-    const std::string stateKey = getWindowStateKey(id, recvRank, buffLen);
     state::State& state = state::getGlobalState();
     const std::shared_ptr<state::StateKeyValue>& kv =
-      state.getKV(user, stateKey, buffLen);
+      state.getKV(user, getWindowStateKey(id, winRank), win.size);
+    for (auto& r : ranges) {
+        kv->setChunk(r.first, win.ptr + r.first, r.second);
+    }
+    kv->pushPartial();
+}
 
-    // Do the write
-    kv->set(sendBuffer);
+uint8_t* MpiWorld::getWindowRange(int winRank, long offset, size_t length)
+{
+    faabric::util::SharedLock lock(worldMutex);
 
-    // If it's remote, do a push too
-    if (getHostForRank(recvRank) != thisHost) {
-        kv->pushFull();
+    auto it = windows.find(winRank);
+    if (it == windows.end()) {
+        faabric::util::getLogger()->error("No window for rank {}", winRank);
+        throw std::runtime_error("No window for rank");
     }
 
-    // Notify the receiver of the push
-    // NOTE - must specify a count here to say how big the change is
-    send(sendRank,
-         recvRank,
-         nullptr,
-         MPI_INT,
-         sendCount,
-         faabric::MPIMessage::RMA_WRITE);
+    if (offset < 0 || offset + length > it->second.size) {
+        faabric::util::getLogger()->error(
+          "RMA access out of bounds on rank {} ({} + {} > {})",
+          winRank,
+          offset,
+          length,
+          it->second.size);
+        throw std::runtime_error("RMA access out of window bounds");
+    }
+
+    return it->second.ptr + offset;
 }
 
-void MpiWorld::synchronizeRmaWrite(const faabric::MPIMessage& msg,
-                                   bool isRemote)
+void MpiWorld::publishWindow(int winRank)
 {
-    faabric_datatype_t* datatype = getFaabricDatatypeFromId(msg.type());
-    int winSize = msg.count() * datatype->size;
-    const std::string key = getWindowStateKey(id, msg.destination(), winSize);
+    MpiWindow win;
+    {
+        faabric::util::FullLock lock(worldMutex);
+        win = windows.at(winRank);
+
+        // The whole window covers any writes not yet published
+        unpublishedWrites.erase(winRank);
+    }
 
-    // Get the state KV
     state::State& state = state::getGlobalState();
     const std::shared_ptr<state::StateKeyValue>& kv =
-      state.getKV(user, key, winSize);
+      state.getKV(user, getWindowStateKey(id, winRank), win.size);
+    kv->set(win.ptr);
+    kv->pushFull();
+}
 
-    // If remote, pull the state related to the window
-    if (isRemote) {
-        kv->pull();
+bool MpiWorld::isSpreadAcrossHosts()
+{
+    {
+        faabric::util::SharedLock lock(worldMutex);
+        if (spreadKnown) {
+            return spread;
+        }
     }
 
-    // Write the state to the pointer
-    uint8_t* windowPtr = windowPointerMap[key];
-    kv->get(windowPtr);
+    // Worlds joined without the full rank-to-host map only know about their
+    // local ranks, so look up the rest
+    bool isSpread = false;
+    for (int r = 0; r < size && !isSpread; r++) {
+        try {
+            isSpread = getHostForRank(r) != thisHost;
+        } catch (std::runtime_error& e) {
+            // Ranks that haven't registered yet could be anywhere, so don't
+            // cache the answer
+            return true;
+        }
+    }
+
+    faabric::util::FullLock lock(worldMutex);
+    spreadKnown = true;
+    spread = isSpread;
+    return spread;
 }
 
 long MpiWorld::getLocalQueueSize(int sendRank, int recvRank)
@@ -1240,20 +1938,20 @@ void MpiWorld::createWindow(const int winRank,
                             const int winSize,
                             uint8_t* windowPtr)
 {
-    const std::string key = getWindowStateKey(id, winRank, winSize);
-    state::State& state = state::getGlobalState();
-    const std::shared_ptr<state::StateKeyValue> windowKv =
-      state.getKV(user, key, winSize);
-
-    // Set initial value
-    windowKv->set(windowPtr);
-    windowKv->pushFull();
-
-    // Add pointer to map
     {
         faabric::util::FullLock lock(worldMutex);
-        windowPointerMap[key] = windowPtr;
+        windows[winRank] = { windowPtr, (size_t)winSize };
     }
+
+    // Ranks on other hosts read the window through state
+    publishWindow(winRank);
+}
+
+void MpiWorld::freeWindow(int winRank)
+{
+    faabric::util::FullLock lock(worldMutex);
+    windows.erase(winRank);
+    unpublishedWrites.erase(winRank);
 }
 
 double MpiWorld::getWTime()
@@ -0,0 +1,249 @@
+#include <faabric/scheduler/PlacementPolicy.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace faabric::scheduler {
+
+// ----------------------------------------
+// Context
+// ----------------------------------------
+
+const std::vector<std::string>& PlacementContext::getAllHosts()
+{
+    if (!fetchedAllHosts) {
+        allHosts = allHostsGetter();
+        fetchedAllHosts = true;
+    }
+
+    return allHosts;
+}
+
+std::vector<std::string> PlacementContext::getCandidateHosts()
+{
+    std::vector<std::string> candidates = { thisHost };
+    std::unordered_set<std::string> seen = { thisHost };
+
+    for (const auto& h : registeredHosts) {
+        if (seen.insert(h).second) {
+            candidates.push_back(h);
+        }
+    }
+
+    for (const auto& h : getAllHosts()) {
+        if (seen.insert(h).second) {
+            candidates.push_back(h);
+        }
+    }
+
+    return candidates;
+}
+
+int PlacementContext::getAvailable(const std::string& host)
+{
+    auto it = available.find(host);
+    if (it != available.end()) {
+        return it->second;
+    }
+
+    faabric::HostResources r = resourcesGetter(host);
+    int nAvailable = std::max<int>(r.cores() - r.functionsinflight(), 0);
+    available[host] = nAvailable;
+
+    return nAvailable;
+}
+
+void PlacementContext::assign(const std::string& host, int n)
+{
+    available[host] = std::max<int>(getAvailable(host) - n, 0);
+}
+
+// ----------------------------------------
+// Policies
+// ----------------------------------------
+
+void PlacementPolicy::fillHost(PlacementContext& ctx,
+                               const std::string& host,
+                               std::vector<std::string>& placement,
+                               int& nextIdx)
+{
+    // Avoid asking for resources when there's nothing left to place
+    int remainder = ctx.nMessages - nextIdx;
+    if (remainder <= 0) {
+        return;
+    }
+
+    int nOnHost = std::min<int>(ctx.getAvailable(host), remainder);
+    for (int i = 0; i < nOnHost; i++) {
+        placement.at(nextIdx++) = host;
+    }
+
+    ctx.assign(host, nOnHost);
+}
+
+std::vector<std::string> GreedyPolicy::place(PlacementContext& ctx)
+{
+    std::vector<std::string> placement(ctx.nMessages);
+    int nextIdx = 0;
+
+    fillHost(ctx, ctx.thisHost, placement, nextIdx);
+
+    for (const auto& h : ctx.registeredHosts) {
+        if (h != ctx.thisHost) {
+            fillHost(ctx, h, placement, nextIdx);
+        }
+    }
+
+    if (nextIdx < ctx.nMessages) {
+        std::unordered_set<std::string> registered(ctx.registeredHosts.begin(),
+                                                   ctx.registeredHosts.end());
+        for (const auto& h : ctx.getAllHosts()) {
+            if (h != ctx.thisHost && registered.count(h) == 0) {
+                fillHost(ctx, h, placement, nextIdx);
+            }
+        }
+    }
+
+    return placement;
+}
+
+std::vector<std::string> BinPackPolicy::place(PlacementContext& ctx)
+{
+    std::vector<std::string> placement(ctx.nMessages);
+    std::vector<std::string> candidates = ctx.getCandidateHosts();
+
+    int nextIdx = 0;
+    while (nextIdx < ctx.nMessages) {
+        int remainder = ctx.nMessages - nextIdx;
+
+        // Best fit if the rest fits anywhere, otherwise the emptiest host
+        std::string bestFit;
+        std::string emptiest;
+        for (const auto& h : candidates) {
+            int a = ctx.getAvailable(h);
+            if (a >= remainder &&
+                (bestFit.empty() || a < ctx.getAvailable(bestFit))) {
+                bestFit = h;
+            }
+
+            if (a > 0 && (emptiest.empty() || a > ctx.getAvailable(emptiest))) {
+                emptiest = h;
+            }
+        }
+
+        std::string target = bestFit.empty() ? emptiest : bestFit;
+        if (target.empty()) {
+            break;
+        }
+
+        fillHost(ctx, target, placement, nextIdx);
+    }
+
+    return placement;
+}
+
+std::vector<std::string> SpreadPolicy::place(PlacementContext& ctx)
+{
+    std::vector<std::string> placement(ctx.nMessages);
+    std::vector<std::string> candidates = ctx.getCandidateHosts();
+
+    int nextIdx = 0;
+    while (nextIdx < ctx.nMessages) {
+        // Emptiest first, keeping candidate order for ties
+        std::stable_sort(candidates.begin(),
+                         candidates.end(),
+                         [&ctx](const std::string& a, const std::string& b) {
+                             return ctx.getAvailable(a) > ctx.getAvailable(b);
+                         });
+
+        bool placed = false;
+        for (const auto& h : candidates) {
+            if (nextIdx >= ctx.nMessages) {
+                break;
+            }
+
+            if (ctx.getAvailable(h) > 0) {
+                placement.at(nextIdx++) = h;
+                ctx.assign(h, 1);
+                placed = true;
+            }
+        }
+
+        if (!placed) {
+            break;
+        }
+    }
+
+    return placement;
+}
+
+std::vector<std::string> LocalityPolicy::place(PlacementContext& ctx)
+{
+    std::vector<std::string> placement(ctx.nMessages);
+    int nextIdx = 0;
+
+    fillHost(ctx, ctx.thisHost, placement, nextIdx);
+
+    // Hosts with the snapshot, registered ones first
+    std::vector<std::string> candidates = ctx.getCandidateHosts();
+    for (const auto& h : candidates) {
+        if (ctx.snapshotHosts.count(h) > 0) {
+            fillHost(ctx, h, placement, nextIdx);
+        }
+    }
+
+    // Then hosts with executors for the function, then the rest
+    for (const auto& h : candidates) {
+        fillHost(ctx, h, placement, nextIdx);
+    }
+
+    return placement;
+}
+
+std::vector<std::string> MpiPackPolicy::place(PlacementContext& ctx)
+{
+    if (!ctx.isMpi) {
+        return GreedyPolicy().place(ctx);
+    }
+
+    std::vector<std::string> placement(ctx.nMessages);
+    int nextIdx = 0;
+
+    fillHost(ctx, ctx.thisHost, placement, nextIdx);
+
+    if (nextIdx < ctx.nMessages) {
+        std::vector<std::string> candidates = ctx.getCandidateHosts();
+        std::stable_sort(candidates.begin(),
+                         candidates.end(),
+                         [&ctx](const std::string& a, const std::string& b) {
+                             return ctx.getAvailable(a) > ctx.getAvailable(b);
+                         });
+
+        for (const auto& h : candidates) {
+            fillHost(ctx, h, placement, nextIdx);
+        }
+    }
+
+    return placement;
+}
+
+std::unique_ptr<PlacementPolicy> getPlacementPolicy(const std::string& name)
+{
+    if (name == "greedy") {
+        return std::make_unique<GreedyPolicy>();
+    } else if (name == "binpack") {
+        return std::make_unique<BinPackPolicy>();
+    } else if (name == "spread") {
+        return std::make_unique<SpreadPolicy>();
+    } else if (name == "locality") {
+        return std::make_unique<LocalityPolicy>();
+    } else if (name == "mpi") {
+        return std::make_unique<MpiPackPolicy>();
+    }
+
+    auto logger = faabric::util::getLogger();
+    logger->error("Unrecognised placement policy: {}", name);
+    throw std::runtime_error("Unrecognised placement policy");
+}
+}
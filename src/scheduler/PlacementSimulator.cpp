@@ -0,0 +1,139 @@
+#include <faabric/scheduler/PlacementSimulator.h>
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+namespace faabric::scheduler {
+
+double PlacementStats::meanHostsUsed() const
+{
+    if (nRequests == 0) {
+        return 0;
+    }
+
+    return (double)totalHostsUsed / nRequests;
+}
+
+PlacementSimulator::PlacementSimulator(int nHostsIn, int coresPerHostIn)
+  : nHosts(nHostsIn)
+  , coresPerHost(coresPerHostIn)
+{}
+
+std::string PlacementSimulator::hostName(int idx)
+{
+    return "host-" + std::to_string(idx);
+}
+
+PlacementStats PlacementSimulator::run(
+  PlacementPolicy& policy,
+  const std::vector<SimulatedRequest>& requests)
+{
+    PlacementStats stats;
+
+    std::vector<std::string> hosts;
+    std::unordered_map<std::string, int> inFlight;
+    for (int i = 0; i < nHosts; i++) {
+        hosts.push_back(hostName(i));
+        inFlight[hosts.back()] = 0;
+    }
+
+    std::unordered_map<std::string, std::unordered_set<std::string>>
+      registeredHosts;
+    std::unordered_map<std::string, std::unordered_set<std::string>>
+      snapshotHosts;
+
+    // Calls finishing, as (tick, host), earliest first
+    typedef std::pair<int, std::string> Completion;
+    std::priority_queue<Completion,
+                        std::vector<Completion>,
+                        std::greater<Completion>>
+      completions;
+
+    std::vector<SimulatedRequest> sorted = requests;
+    std::stable_sort(sorted.begin(),
+                     sorted.end(),
+                     [](const SimulatedRequest& a, const SimulatedRequest& b) {
+                         return a.arrivalTick < b.arrivalTick;
+                     });
+
+    for (const auto& req : sorted) {
+        // Retire everything that's finished by now
+        while (!completions.empty() &&
+               completions.top().first <= req.arrivalTick) {
+            inFlight[completions.top().second]--;
+            completions.pop();
+        }
+
+        std::string master = hostName(req.masterIdx % nHosts);
+        if (!req.snapshotKey.empty()) {
+            snapshotHosts[req.snapshotKey].insert(master);
+        }
+
+        PlacementContext ctx;
+        ctx.thisHost = master;
+        ctx.funcStr = req.funcStr;
+        ctx.nMessages = req.nMessages;
+        ctx.isMpi = req.isMpi;
+
+        auto& registered = registeredHosts[req.funcStr];
+        ctx.registeredHosts.assign(registered.begin(), registered.end());
+        std::sort(ctx.registeredHosts.begin(), ctx.registeredHosts.end());
+
+        if (!req.snapshotKey.empty()) {
+            ctx.snapshotHosts = snapshotHosts[req.snapshotKey];
+        }
+
+        ctx.allHostsGetter = [&hosts] { return hosts; };
+        ctx.resourcesGetter = [this, &inFlight](const std::string& host) {
+            faabric::HostResources r;
+            r.set_cores(coresPerHost);
+            r.set_functionsinflight(inFlight[host]);
+            return r;
+        };
+
+        std::vector<std::string> placement = policy.place(ctx);
+
+        std::unordered_set<std::string> used;
+        for (auto host : placement) {
+            // Unplaced messages get executed on the master
+            if (host.empty()) {
+                stats.nOverloaded++;
+                host = master;
+            }
+
+            used.insert(host);
+            inFlight[host]++;
+            completions.emplace(req.arrivalTick + req.durationTicks, host);
+
+            if (host != master) {
+                stats.nRemoteMessages++;
+                registered.insert(host);
+            }
+        }
+
+        if (!req.snapshotKey.empty()) {
+            for (const auto& host : used) {
+                if (snapshotHosts[req.snapshotKey].insert(host).second) {
+                    stats.nSnapshotPushes++;
+                }
+            }
+        }
+
+        stats.nRequests++;
+        stats.nMessages += req.nMessages;
+        stats.totalHostsUsed += used.size();
+        stats.maxHostsUsed = std::max<int>(stats.maxHostsUsed, used.size());
+
+        auto minMax = std::minmax_element(
+          inFlight.begin(), inFlight.end(), [](const auto& a, const auto& b) {
+              return a.second < b.second;
+          });
+        stats.maxLoadImbalance =
+          std::max<int>(stats.maxLoadImbalance,
+                        minMax.second->second - minMax.first->second);
+    }
+
+    return stats;
+}
+}
@@ -6,12 +6,16 @@
 #include <faabric/snapshot/SnapshotRegistry.h>
 #include <faabric/util/environment.h>
 #include <faabric/util/func.h>
+#include <faabric/util/gids.h>
 #include <faabric/util/logging.h>
+#include <faabric/util/metrics.h>
 #include <faabric/util/random.h>
 #include <faabric/util/snapshot.h>
 #include <faabric/util/testing.h>
 #include <faabric/util/timing.h>
+#include <faabric/util/tracing.h>
 
+#include <map>
 #include <unordered_set>
 
 #define FLUSH_TIMEOUT_MS 10000
@@ -82,6 +86,10 @@ void Scheduler::reset()
     registeredHosts.clear();
     faasletCounts.clear();
     inFlightCounts.clear();
+    callRates.clear();
+    prewarmCounts.clear();
+    prewarmBindMsgs.clear();
+    snapshotHosts.clear();
 
     // Records
     recordedMessagesAll.clear();
@@ -108,6 +116,19 @@ long Scheduler::getFunctionFaasletCount(const faabric::Message& msg)
     return faasletCounts[funcStr];
 }
 
+long Scheduler::getFunctionPrewarmCount(const faabric::Message& msg)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+    return prewarmCounts[funcStr];
+}
+
+FunctionCallRate Scheduler::getFunctionCallRate(const faabric::Message& msg)
+{
+    faabric::util::SharedLock lock(mx);
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+    return callRates.getRate(funcStr);
+}
+
 int Scheduler::getFunctionRegisteredHostCount(const faabric::Message& msg)
 {
     const std::string funcStr = faabric::util::funcToString(msg, false);
@@ -147,11 +168,29 @@ std::shared_ptr<InMemoryMessageQueue> Scheduler::getFunctionQueue(
 void Scheduler::notifyCallFinished(const faabric::Message& msg)
 {
     faabric::util::FullLock lock(mx);
+    decrementInFlightCount(msg);
+}
+
+void Scheduler::notifyCallsFinished(const std::vector<faabric::Message>& msgs)
+{
+    faabric::util::FullLock lock(mx);
+    for (const auto& msg : msgs) {
+        decrementInFlightCount(msg);
+    }
+}
 
+void Scheduler::decrementInFlightCount(const faabric::Message& msg)
+{
     const std::string funcStr = faabric::util::funcToString(msg, false);
 
     inFlightCounts[funcStr] = decrementAboveZero(inFlightCounts[funcStr]);
 
+    // Record how long the call was queued and executing
+    if (msg.timestamp() > 0) {
+        long residencyMs = getGlobalClock().epochMillis() - msg.timestamp();
+        callRates.recordCompletion(funcStr, residencyMs);
+    }
+
     int newInFlight = decrementAboveZero(thisHostResources.functionsinflight());
     thisHostResources.set_functionsinflight(newInFlight);
 }
@@ -193,11 +232,67 @@ void Scheduler::notifyFaasletFinished(const faabric::Message& msg)
     thisHostResources.set_boundexecutors(newBoundExecutors);
 }
 
+void Scheduler::notifyFaasletStarted(const faabric::Message& msg)
+{
+    faabric::util::FullLock lock(mx);
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    faasletCounts[funcStr]++;
+    thisHostResources.set_boundexecutors(
+      thisHostResources.boundexecutors() + 1);
+}
+
+void Scheduler::requeueCalls(std::vector<faabric::Message>& msgs)
+{
+    auto logger = faabric::util::getLogger();
+    faabric::util::FullLock lock(mx);
+
+    for (auto& msg : msgs) {
+        logger->debug("Requeueing {}", faabric::util::funcToString(msg, true));
+
+        // The call is still counted as in flight, so this binds a new faaslet
+        // if there aren't enough left for the function
+        addFaaslets(msg);
+        getFunctionQueue(msg)->enqueue(std::move(msg));
+    }
+
+    notifyWork();
+}
+
 std::shared_ptr<InMemoryMessageQueue> Scheduler::getBindQueue()
 {
     return bindQueue;
 }
 
+uint64_t Scheduler::getWorkEpoch()
+{
+    faabric::util::UniqueLock lock(workMx);
+    return workEpoch;
+}
+
+bool Scheduler::awaitWork(uint64_t epoch, long timeoutMs)
+{
+    faabric::util::UniqueLock lock(workMx);
+    auto changed = [this, epoch] { return workEpoch != epoch; };
+
+    if (timeoutMs <= 0) {
+        workCv.wait(lock, changed);
+        return true;
+    }
+
+    return workCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), changed);
+}
+
+void Scheduler::notifyWork()
+{
+    {
+        faabric::util::UniqueLock lock(workMx);
+        workEpoch++;
+    }
+
+    workCv.notify_all();
+}
+
 Scheduler& getScheduler()
 {
     // Note that this ref is shared between all faaslets on the given host
@@ -208,18 +303,60 @@ Scheduler& getScheduler()
 std::vector<std::string> Scheduler::callFunctions(
   faabric::BatchExecuteRequest& req,
   bool forceLocal)
+{
+    return doCallFunctions(req, forceLocal, false);
+}
+
+std::vector<std::string> Scheduler::callFunctions(
+  faabric::BatchExecuteRequest&& req,
+  bool forceLocal)
+{
+    return doCallFunctions(req, forceLocal, true);
+}
+
+/**
+ * Messages queued on this host are copied out of the request, or moved if the
+ * request is owned by the scheduler. Moving a message doesn't copy its input
+ * data, so an owned request's messages are only materialised once.
+ */
+std::vector<std::string> Scheduler::doCallFunctions(
+  faabric::BatchExecuteRequest& req,
+  bool forceLocal,
+  bool isOwned)
 {
     auto logger = faabric::util::getLogger();
 
+    static faabric::util::Histogram& dispatchHist =
+      faabric::util::getMetrics().getHistogram("scheduler_dispatch_us");
+    static faabric::util::Counter& callCounter =
+      faabric::util::getMetrics().getCounter("scheduler_calls");
+    static faabric::util::Counter& overloadedCounter =
+      faabric::util::getMetrics().getCounter("scheduler_overloaded_calls");
+    faabric::util::ScopedTimer timer(dispatchHist);
+
     int nMessages = req.messages_size();
     bool isThreads = req.type() == req.THREADS;
     std::vector<std::string> executed(nMessages);
+    callCounter.inc(nMessages);
+
+    // Everything downstream of this call is recorded as a child of this span
+    faabric::util::ScopedSpan span("scheduler_call_functions",
+                                   req.messages().at(0).tracecontext());
+    if (span.isActive()) {
+        faabric::TraceContext ctx = span.context();
+        req.mutable_tracecontext()->CopyFrom(ctx);
+        for (auto& m : *req.mutable_messages()) {
+            m.mutable_tracecontext()->CopyFrom(ctx);
+        }
+    }
 
     // Note, we assume all the messages are for the same function and master
-    // host
+    // host. The first message may be moved out of the request below.
     const faabric::Message& firstMsg = req.messages().at(0);
     std::string funcStr = faabric::util::funcToString(firstMsg, false);
+    span.setAttribute("function", funcStr);
     std::string masterHost = firstMsg.masterhost();
+    bool isMpi = firstMsg.ismpi();
     if (masterHost.empty()) {
         std::string funcStrWithId = faabric::util::funcToString(firstMsg, true);
         logger->error("Request {} has no master host", funcStrWithId);
@@ -246,6 +383,24 @@ std::vector<std::string> Scheduler::callFunctions(
 
     auto funcQueue = this->getFunctionQueue(firstMsg);
 
+    // Keep the IDs for the records, as messages may be moved
+    std::vector<unsigned int> messageIds;
+    if (faabric::util::isTestMode()) {
+        for (const auto& m : req.messages()) {
+            messageIds.push_back(m.id());
+        }
+    }
+
+    // Accounting is done before queueing, in case the message is moved
+    auto enqueueLocally = [&](int idx) {
+        if (isOwned) {
+            funcQueue->enqueue(std::move(*req.mutable_messages(idx)));
+        } else {
+            funcQueue->enqueue(req.messages().at(idx));
+        }
+        notifyWork();
+    };
+
     // TODO - more fine-grained locking. This blocks all functions
     // Lock the whole scheduler to be safe
     faabric::util::FullLock lock(mx);
@@ -255,12 +410,11 @@ std::vector<std::string> Scheduler::callFunctions(
         logger->debug("Executing {} x {} locally", nMessages, funcStr);
 
         for (int i = 0; i < nMessages; i++) {
-            faabric::Message msg = req.messages().at(i);
-
-            funcQueue->enqueue(msg);
+            const faabric::Message& msg = req.messages().at(i);
             incrementInFlightCount(msg);
             addFaaslets(msg);
 
+            enqueueLocally(i);
             executed.at(i) = thisHost;
         }
     } else {
@@ -278,16 +432,41 @@ std::vector<std::string> Scheduler::callFunctions(
         } else {
             // At this point we know we're the master host, and we've not been
             // asked to force full local execution.
+            std::vector<std::string> placement = placeFunctions(req);
+
+            // MPI ranks all get the full rank-to-host map up front
+            if (isMpi) {
+                setMpiRankHosts(req, placement);
+            }
+
+            // Execute those placed here, along with any there's no capacity
+            // for anywhere
+            int nLocally = 0;
+            for (int i = 0; i < nMessages; i++) {
+                const std::string& host = placement.at(i);
+                if (!host.empty() && host != thisHost) {
+                    continue;
+                }
 
-            // Work out how many we can handle locally
-            int cores = thisHostResources.cores();
-            int available = cores - thisHostResources.functionsinflight();
-            available = std::max<int>(available, 0);
-            int nLocally = std::min<int>(available, nMessages);
+                const faabric::Message& msg = req.messages().at(i);
+                incrementInFlightCount(msg);
+                nLocally++;
+
+                if (host.empty()) {
+                    overloadedCounter.inc();
+                    logger->warn("No capacity for {}{}",
+                                 funcStr,
+                                 isThreads ? " thread, returning to caller"
+                                           : ", executing locally");
+                }
 
-            // Keep track of what's been done
-            int remainder = nMessages;
-            int nextMsgIdx = 0;
+                // Threads are returned to the caller to execute
+                if (!isThreads) {
+                    addFaaslets(msg);
+                    enqueueLocally(i);
+                    executed.at(i) = thisHost;
+                }
+            }
 
             if (isThreads && nLocally > 0) {
                 logger->debug("Returning {} of {} {} for local threads",
@@ -299,131 +478,46 @@ std::vector<std::string> Scheduler::callFunctions(
                               nLocally,
                               nMessages,
                               funcStr);
-            } else {
-                logger->debug("No local capacity, distributing {} x {}",
-                              nMessages,
-                              funcStr);
             }
 
-            // Build list of messages to be executed locally
-            for (; nextMsgIdx < nLocally; nextMsgIdx++) {
-                faabric::Message msg = req.messages().at(nextMsgIdx);
-
-                remainder--;
-                incrementInFlightCount(msg);
-
-                // Provided we're not executing threads, execute the functions
-                // now
-                if (!isThreads) {
-                    funcQueue->enqueue(msg);
-                    executed.at(nextMsgIdx) = thisHost;
-                    addFaaslets(msg);
+            // Send the rest to other hosts, in the order they were chosen
+            std::vector<std::string> hostOrder;
+            std::unordered_map<std::string, std::vector<int>> hostIdxs;
+            for (int i = 0; i < nMessages; i++) {
+                const std::string& host = placement.at(i);
+                if (host.empty() || host == thisHost) {
+                    continue;
                 }
-            }
 
-            // If some are left, we need to distribute
-            if (remainder > 0) {
-                // At this point we have a remainder, so we need to distribute
-                // the rest Get the list of registered hosts for this function
-                std::unordered_set<std::string>& thisRegisteredHosts =
-                  registeredHosts[funcStr];
-
-                // Schedule the remainder on these other hosts
-                for (auto& h : thisRegisteredHosts) {
-                    int nOnThisHost =
-                      scheduleFunctionsOnHost(h, req, executed, nextMsgIdx);
-
-                    remainder -= nOnThisHost;
-                    if (remainder <= 0) {
-                        break;
-                    }
+                if (hostIdxs.count(host) == 0) {
+                    hostOrder.push_back(host);
                 }
+                hostIdxs[host].push_back(i);
             }
 
-            // Now we need to find hosts that aren't already registered for
-            // this function and add them
-            if (remainder > 0) {
-                std::unordered_set<std::string>& thisRegisteredHosts =
-                  registeredHosts[funcStr];
-
-                std::unordered_set<std::string> allHosts = getAvailableHosts();
+            std::unordered_set<std::string>& thisRegisteredHosts =
+              registeredHosts[funcStr];
+            for (const auto& host : hostOrder) {
+                scheduleFunctionsOnHost(
+                  host, funcStr, req, executed, hostIdxs[host]);
 
-                std::unordered_set<std::string> targetHosts;
-
-                // Build list of target hosts
-                for (auto& h : allHosts) {
-                    // Skip if already registered
-                    if (thisRegisteredHosts.find(h) !=
-                        thisRegisteredHosts.end()) {
-                        continue;
-                    }
-
-                    // Skip this host
-                    if (h == thisHost) {
-                        continue;
-                    }
-
-                    targetHosts.insert(h);
-                }
-
-                for (auto& h : targetHosts) {
-                    // Schedule functions on this host
-                    int nOnThisHost =
-                      scheduleFunctionsOnHost(h, req, executed, nextMsgIdx);
-
-                    remainder -= nOnThisHost;
-
-                    // Register the host if it's exected a function
-                    if (nOnThisHost > 0) {
-                        logger->debug("Registering {} for {}", h, funcStr);
-                        thisRegisteredHosts.insert(h);
-                    }
-
-                    // Stop if we've scheduled all functions
-                    if (remainder <= 0) {
-                        break;
-                    }
-                }
-            }
-
-            // At this point there's no more capacity in the system, so we
-            // just need to execute locally
-            if (remainder > 0) {
-                for (; nextMsgIdx < nMessages; nextMsgIdx++) {
-                    faabric::Message msg = req.messages().at(nextMsgIdx);
-                    incrementInFlightCount(msg);
-
-                    if (isThreads) {
-                        logger->warn(
-                          "No capacity for {} thread, returning to caller",
-                          funcStr);
-                        executed.at(nextMsgIdx) = "";
-                    } else {
-                        logger->warn("No capacity for {}, executing locally",
-                                     funcStr);
-
-                        funcQueue->enqueue(msg);
-                        executed.at(nextMsgIdx) = thisHost;
-                        addFaaslets(msg);
-                    }
+                if (thisRegisteredHosts.insert(host).second) {
+                    logger->debug("Registering {} for {}", host, funcStr);
                 }
             }
         }
     }
 
-    // Accounting
-    for (int i = 0; i < nMessages; i++) {
-        std::string executedHost = executed.at(i);
-        faabric::Message msg = req.messages().at(i);
+    // Log results if in test mode
+    for (size_t i = 0; i < messageIds.size(); i++) {
+        const std::string& executedHost = executed.at(i);
+        unsigned int msgId = messageIds.at(i);
 
-        // Log results if in test mode
-        if (faabric::util::isTestMode()) {
-            recordedMessagesAll.push_back(msg.id());
-            if (executedHost.empty() || executedHost == thisHost) {
-                recordedMessagesLocal.push_back(msg.id());
-            } else {
-                recordedMessagesShared.emplace_back(executedHost, msg.id());
-            }
+        recordedMessagesAll.push_back(msgId);
+        if (executedHost.empty() || executedHost == thisHost) {
+            recordedMessagesLocal.push_back(msgId);
+        } else {
+            recordedMessagesShared.emplace_back(executedHost, msgId);
         }
     }
 
@@ -442,73 +536,158 @@ void Scheduler::broadcastSnapshotDelete(const faabric::Message& msg,
         SnapshotClient c(host);
         c.deleteSnapshot(snapshotKey);
     }
+
+    snapshotHosts.erase(snapshotKey);
 }
 
-int Scheduler::scheduleFunctionsOnHost(const std::string& host,
-                                       faabric::BatchExecuteRequest& req,
-                                       std::vector<std::string>& records,
-                                       int offset)
+std::vector<std::string> Scheduler::placeFunctions(
+  const faabric::BatchExecuteRequest& req)
 {
-    auto logger = faabric::util::getLogger();
-    faabric::Message firstMsg = req.messages().at(0);
-    std::string funcStr = faabric::util::funcToString(firstMsg, false);
+    const faabric::Message& firstMsg = req.messages().at(0);
 
-    int nMessages = req.messages_size();
-    int remainder = nMessages - offset;
+    PlacementContext ctx;
+    ctx.thisHost = thisHost;
+    ctx.funcStr = faabric::util::funcToString(firstMsg, false);
+    ctx.nMessages = req.messages_size();
+    ctx.isMpi = firstMsg.ismpi();
+
+    std::unordered_set<std::string>& thisRegisteredHosts =
+      registeredHosts[ctx.funcStr];
+    ctx.registeredHosts.assign(thisRegisteredHosts.begin(),
+                               thisRegisteredHosts.end());
+
+    std::string snapshotKey = firstMsg.snapshotkey();
+    if (!snapshotKey.empty() && snapshotHosts.count(snapshotKey) > 0) {
+        ctx.snapshotHosts = snapshotHosts[snapshotKey];
+    }
+
+    ctx.allHostsGetter = [this] {
+        std::unordered_set<std::string> hosts = getAvailableHosts();
+        return std::vector<std::string>(hosts.begin(), hosts.end());
+    };
+
+    ctx.resourcesGetter = [this](const std::string& host) {
+        if (host == thisHost) {
+            return thisHostResources;
+        }
+
+        return getHostResources(host);
+    };
+
+    // MPI worlds are always packed onto as few hosts as possible
+    if (ctx.isMpi) {
+        return mpiPlacementPolicy.place(ctx);
+    }
+
+    if (placementPolicy == nullptr ||
+        placementPolicyName != conf.placementPolicy) {
+        placementPolicy = getPlacementPolicy(conf.placementPolicy);
+        placementPolicyName = conf.placementPolicy;
+    }
+
+    return placementPolicy->place(ctx);
+}
+
+void Scheduler::setMpiRankHosts(faabric::BatchExecuteRequest& req,
+                                const std::vector<std::string>& placement)
+{
+    // Rank zero is the master, which creates the world on this host. Any
+    // messages with no capacity elsewhere will also be executed here.
+    int worldSize = req.messages().at(0).mpiworldsize();
+    for (const auto& m : req.messages()) {
+        worldSize = std::max<int>(worldSize, m.mpirank() + 1);
+    }
 
-    // Execute as many as possible to this host
-    faabric::HostResources r = getHostResources(host);
-    int available = r.cores() - r.functionsinflight();
+    std::vector<std::string> rankHosts(worldSize, thisHost);
+    for (int i = 0; i < req.messages_size(); i++) {
+        const std::string& host = placement.at(i);
+        if (!host.empty()) {
+            rankHosts.at(req.messages().at(i).mpirank()) = host;
+        }
+    }
 
-    // Drop out if none available
-    if (available <= 0) {
-        logger->debug("Not scheduling {} on {}, no resources", funcStr, host);
-        return 0;
+    for (auto& m : *req.mutable_messages()) {
+        m.clear_mpirankhosts();
+        for (const auto& host : rankHosts) {
+            m.add_mpirankhosts(host);
+        }
     }
+}
+
+void Scheduler::scheduleFunctionsOnHost(const std::string& host,
+                                        const std::string& funcStr,
+                                        faabric::BatchExecuteRequest& req,
+                                        std::vector<std::string>& records,
+                                        const std::vector<int>& idxs)
+{
+    auto logger = faabric::util::getLogger();
 
-    int nOnThisHost = std::min<int>(available, remainder);
-    std::vector<faabric::Message> thisHostMsgs;
-    for (int i = offset; i < (offset + nOnThisHost); i++) {
-        thisHostMsgs.push_back(req.messages().at(i));
+    int nMessages = req.messages_size();
+    int nOnThisHost = idxs.size();
+
+    faabric::util::ScopedSpan span("scheduler_dispatch_remote",
+                                   req.tracecontext());
+    span.setAttribute("function", funcStr);
+    span.setAttribute("target", host);
+
+    // Messages are copied straight into the request for this host, as they
+    // have to be serialised anyway
+    faabric::BatchExecuteRequest hostRequest;
+    hostRequest.set_id(faabric::util::generateGid());
+    hostRequest.mutable_messages()->Reserve(nOnThisHost);
+    for (int i : idxs) {
+        faabric::Message* msg = hostRequest.add_messages();
+        *msg = req.messages().at(i);
         records.at(i) = host;
+
+        if (span.isActive()) {
+            msg->mutable_tracecontext()->CopyFrom(span.context());
+        }
     }
 
     // Push the snapshot if necessary
     if (req.type() == req.THREADS || req.type() == req.PROCESSES) {
-        std::string snapshotKey = firstMsg.snapshotkey();
+        std::string snapshotKey = hostRequest.messages().at(0).snapshotkey();
         SnapshotClient c(host);
         const SnapshotData& d =
           snapshot::getSnapshotRegistry().getSnapshot(snapshotKey);
         c.pushSnapshot(snapshotKey, d);
+
+        snapshotHosts[snapshotKey].insert(host);
     }
 
     logger->debug(
       "Sending {} of {} {} to {}", nOnThisHost, nMessages, funcStr, host);
 
     FunctionCallClient c(host);
-    faabric::BatchExecuteRequest hostRequest =
-      faabric::util::batchExecFactory(thisHostMsgs);
     hostRequest.set_snapshotkey(req.snapshotkey());
     hostRequest.set_snapshotsize(req.snapshotsize());
     hostRequest.set_type(req.type());
+    if (span.isActive()) {
+        hostRequest.mutable_tracecontext()->CopyFrom(span.context());
+    }
 
     c.executeFunctions(hostRequest);
-
-    return nOnThisHost;
 }
 
 void Scheduler::callFunction(faabric::Message& msg, bool forceLocal)
 {
-    // TODO - avoid this copy
+    // The caller keeps its message, so this is the one copy
     faabric::Message msgCopy = msg;
-    std::vector<faabric::Message> msgs = { msg };
-    faabric::BatchExecuteRequest req = faabric::util::batchExecFactory(msgs);
+    callFunction(std::move(msgCopy), forceLocal);
+}
+
+void Scheduler::callFunction(faabric::Message&& msg, bool forceLocal)
+{
+    faabric::BatchExecuteRequest req;
+    req.set_id(faabric::util::generateGid());
+    *req.add_messages() = std::move(msg);
 
     // Specify that this is a normal function, not a thread
     req.set_type(req.FUNCTIONS);
 
-    // Make the call
-    callFunctions(req, forceLocal);
+    // Make the call, handing over the request
+    callFunctions(std::move(req), forceLocal);
 }
 
 std::vector<unsigned int> Scheduler::getRecordedMessagesAll()
@@ -533,6 +712,13 @@ void Scheduler::incrementInFlightCount(const faabric::Message& msg)
     inFlightCounts[funcStr]++;
     thisHostResources.set_functionsinflight(
       thisHostResources.functionsinflight() + 1);
+
+    callRates.recordArrival(funcStr, getGlobalClock().epochMillis());
+
+    // Remember how to bind to this function for prewarming
+    if (conf.prewarmMode == "rate" && prewarmBindMsgs.count(funcStr) == 0) {
+        prewarmBindMsgs.emplace(funcStr, getBindMessage(msg));
+    }
 }
 
 void Scheduler::addFaaslets(const faabric::Message& msg)
@@ -549,25 +735,81 @@ void Scheduler::addFaaslets(const faabric::Message& msg)
         logger->debug(
           "Scaling {} {}->{} faaslets", funcStr, nFaaslets, nFaaslets + 1);
 
-        // Increment faaslet count
-        faasletCounts[funcStr]++;
-        thisHostResources.set_boundexecutors(
-          thisHostResources.boundexecutors() + 1);
+        sendBindMessage(msg);
+    }
+}
+
+void Scheduler::prewarmFaaslets()
+{
+    auto logger = faabric::util::getLogger();
+    faabric::util::FullLock lock(mx);
+
+    // Work out how far each function is below the number of faaslets its
+    // recent calls predict it needs, or the configured minimum
+    long nowMs = getGlobalClock().epochMillis();
+    std::vector<std::pair<std::string, int>> shortfalls;
+    for (const auto& p : prewarmBindMsgs) {
+        const std::string& funcStr = p.first;
+        int target = callRates.predictConcurrency(
+          funcStr, nowMs, conf.prewarmHeadroomPct);
+        target = std::max<int>(target, conf.prewarmMinExecutors);
+
+        int shortfall = target - (int)faasletCounts[funcStr];
+        if (shortfall > 0) {
+            shortfalls.emplace_back(funcStr, shortfall);
+        }
+    }
+
+    // Share out what's left of this host's capacity a faaslet at a time, so
+    // that one busy function can't take all of it
+    int spare = thisHostResources.cores() - thisHostResources.boundexecutors();
+    bool added = true;
+    while (spare > 0 && added) {
+        added = false;
+        for (auto& s : shortfalls) {
+            if (s.second == 0 || spare == 0) {
+                continue;
+            }
 
-        // Send bind message (i.e. request a new faaslet bind to this func)
-        faabric::Message bindMsg =
-          faabric::util::messageFactory(msg.user(), msg.function());
-        bindMsg.set_type(faabric::Message_MessageType_BIND);
-        bindMsg.set_ispython(msg.ispython());
-        bindMsg.set_istypescript(msg.istypescript());
-        bindMsg.set_pythonuser(msg.pythonuser());
-        bindMsg.set_pythonfunction(msg.pythonfunction());
-        bindMsg.set_issgx(msg.issgx());
+            logger->debug("Prewarming faaslet for {}", s.first);
+            sendBindMessage(prewarmBindMsgs.at(s.first));
+            prewarmCounts[s.first]++;
 
-        bindQueue->enqueue(bindMsg);
+            s.second--;
+            spare--;
+            added = true;
+        }
     }
 }
 
+faabric::Message Scheduler::getBindMessage(const faabric::Message& msg)
+{
+    faabric::Message bindMsg =
+      faabric::util::messageFactory(msg.user(), msg.function());
+    bindMsg.set_type(faabric::Message_MessageType_BIND);
+    bindMsg.set_ispython(msg.ispython());
+    bindMsg.set_istypescript(msg.istypescript());
+    bindMsg.set_pythonuser(msg.pythonuser());
+    bindMsg.set_pythonfunction(msg.pythonfunction());
+    bindMsg.set_issgx(msg.issgx());
+
+    return bindMsg;
+}
+
+void Scheduler::sendBindMessage(const faabric::Message& msg)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    // Increment faaslet count
+    faasletCounts[funcStr]++;
+    thisHostResources.set_boundexecutors(
+      thisHostResources.boundexecutors() + 1);
+
+    // Send bind message (i.e. request a new faaslet bind to this func)
+    bindQueue->enqueue(getBindMessage(msg));
+    notifyWork();
+}
+
 std::string Scheduler::getThisHost()
 {
     return thisHost;
@@ -615,6 +857,9 @@ void Scheduler::flushLocally()
         }
     }
 
+    // Parked executors pick these up too
+    notifyWork();
+
     // Wait for flush messages to be consumed, then clear the queues
     for (const auto& p : queueMap) {
         logger->debug("Waiting for {} to drain on flush", p.first);
@@ -627,6 +872,8 @@ void Scheduler::setFunctionResult(faabric::Message& msg)
 {
     redis::Redis& redis = redis::Redis::getQueue();
 
+    faabric::util::ScopedSpan span("scheduler_set_result", msg.tracecontext());
+
     // Record which host did the execution
     msg.set_executedhost(faabric::util::getSystemConfig().endpointHost);
 
@@ -647,7 +894,45 @@ void Scheduler::setFunctionResult(faabric::Message& msg)
 
     // Set long-lived result for function too
     redis.set(msg.statuskey(), inputData);
-    redis.expire(key, STATUS_KEY_EXPIRY);
+    redis.expire(msg.statuskey(), STATUS_KEY_EXPIRY);
+}
+
+void Scheduler::setFunctionResults(std::vector<faabric::Message>& msgs)
+{
+    redis::Redis& redis = redis::Redis::getQueue();
+
+    const std::string& thisHost = faabric::util::getSystemConfig().endpointHost;
+    long finishTimestamp = faabric::util::getGlobalClock().epochMillis();
+
+    // Batches hold calls to the same function, so are usually from one trace
+    faabric::util::ScopedSpan span(
+      "scheduler_set_results",
+      msgs.empty() ? faabric::TraceContext() : msgs.at(0).tracecontext());
+    if (span.isActive()) {
+        span.setAttribute("batch_size", std::to_string(msgs.size()));
+    }
+
+    for (auto& msg : msgs) {
+        if (msg.resultkey().empty()) {
+            throw std::runtime_error("Result key empty. Cannot publish result");
+        }
+    }
+
+    // Write all the results in one round trip, with the same commands as for
+    // a single result
+    for (auto& msg : msgs) {
+        msg.set_executedhost(thisHost);
+        msg.set_finishtimestamp(finishTimestamp);
+
+        std::vector<uint8_t> inputData = faabric::util::messageToBytes(msg);
+        redis.enqueueBytesPipeline(
+          msg.resultkey(), inputData.data(), inputData.size());
+        redis.expirePipeline(msg.resultkey(), RESULT_KEY_EXPIRY);
+        redis.setPipeline(msg.statuskey(), inputData.data(), inputData.size());
+        redis.expirePipeline(msg.statuskey(), STATUS_KEY_EXPIRY);
+    }
+
+    redis.flushPipeline(4 * msgs.size());
 }
 
 faabric::Message Scheduler::getFunctionResult(unsigned int messageId,
@@ -659,6 +944,11 @@ faabric::Message Scheduler::getFunctionResult(unsigned int messageId,
 
     redis::Redis& redis = redis::Redis::getQueue();
 
+    faabric::util::ScopedSpan span("scheduler_get_result");
+    if (span.isActive()) {
+        span.setAttribute("message_id", std::to_string(messageId));
+    }
+
     bool isBlocking = timeoutMs > 0;
 
     std::string resultKey = faabric::util::resultKeyFromMessageId(messageId);
@@ -715,6 +1005,34 @@ void Scheduler::setThisHostResources(faabric::HostResources& res)
     thisHostResources = res;
 }
 
+std::vector<FunctionMetrics> Scheduler::getFunctionMetrics()
+{
+    faabric::util::SharedLock lock(mx);
+
+    // Every function with a queue, plus any with counts but no queue yet
+    std::map<std::string, FunctionMetrics> byFunc;
+    for (const auto& p : queueMap) {
+        byFunc[p.first].queueDepth = p.second->size();
+    }
+
+    for (const auto& p : inFlightCounts) {
+        byFunc[p.first].inFlight = p.second;
+    }
+
+    for (const auto& p : faasletCounts) {
+        byFunc[p.first].faaslets = p.second;
+    }
+
+    std::vector<FunctionMetrics> result;
+    result.reserve(byFunc.size());
+    for (auto& p : byFunc) {
+        p.second.funcStr = p.first;
+        result.emplace_back(p.second);
+    }
+
+    return result;
+}
+
 faabric::HostResources Scheduler::getHostResources(const std::string& host)
 {
     // Get the resources for that host
@@ -5,6 +5,7 @@
 
 #include <faabric/rpc/macros.h>
 #include <faabric/util/logging.h>
+#include <faabric/util/metrics.h>
 #include <faabric/util/queue.h>
 #include <faabric/util/testing.h>
 
@@ -52,11 +53,19 @@ void SnapshotClient::pushSnapshot(const std::string& key,
 {
     auto logger = faabric::util::getLogger();
 
+    static faabric::util::Counter& pushBytes =
+      faabric::util::getMetrics().getCounter("snapshot_push_bytes");
+    pushBytes.inc(req.size);
+
     if (faabric::util::isMockMode()) {
         snapshotPushes.emplace_back(host, req);
     } else {
         logger->debug("Pushing snapshot {} to {}", key, host);
 
+        static faabric::util::Histogram& pushHist =
+          faabric::util::getMetrics().getHistogram("snapshot_push_us");
+        faabric::util::ScopedTimer timer(pushHist);
+
         ClientContext context;
 
         // TODO - avoid copying data here
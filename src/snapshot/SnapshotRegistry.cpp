@@ -4,6 +4,7 @@
 #include <faabric/util/logging.h>
 #include <faabric/util/memory.h>
 
+#include <cstring>
 #include <sys/mman.h>
 
 namespace faabric::snapshot {
@@ -37,14 +38,59 @@ void SnapshotRegistry::mapSnapshot(const std::string& key, uint8_t* target)
         throw std::runtime_error("Mapping non-restorable snapshot");
     }
 
-    void* mmapRes =
-      mmap(target, d.size, PROT_WRITE, MAP_PRIVATE | MAP_FIXED, d.fd, 0);
+    faabric::util::AllocationClass allocClass =
+      faabric::util::getAllocationClass(d.size);
+
+    // Huge page mappings are rounded up to whole huge pages, which with
+    // MAP_FIXED would silently replace whatever follows the target region.
+    // Huge page files are therefore only mapped directly when the size and
+    // target are huge page aligned, and copied into a normal private mapping
+    // otherwise.
+    void* mmapRes = MAP_FAILED;
+    bool hugeAligned =
+      d.size == faabric::util::getHugePageAlignedSize(d.size) &&
+      ((uintptr_t)target) % DEFAULT_HUGE_PAGE_SIZE == 0;
+    if (!d.hugeTlb || hugeAligned) {
+        mmapRes =
+          mmap(target, d.size, PROT_WRITE, MAP_PRIVATE | MAP_FIXED, d.fd, 0);
+    }
+
+    if (mmapRes == MAP_FAILED && d.hugeTlb) {
+        logger->debug("Copying huge page snapshot {} to target", key);
+        mmapRes = copySnapshotFromFd(d, target);
+    }
 
     if (mmapRes == MAP_FAILED) {
         logger->error(
           "mmapping snapshot failed: {} ({})", errno, ::strerror(errno));
         throw std::runtime_error("mmapping snapshot failed");
     }
+
+    // Place the private copy according to the policy for this size
+    faabric::util::applyAllocationClass(target, d.size, allocClass);
+}
+
+void* SnapshotRegistry::copySnapshotFromFd(
+  const faabric::util::SnapshotData& d,
+  uint8_t* target)
+{
+    void* src = mmap(nullptr, d.size, PROT_READ, MAP_SHARED, d.fd, 0);
+    if (src == MAP_FAILED) {
+        return src;
+    }
+
+    void* res = mmap(target,
+                     d.size,
+                     PROT_WRITE,
+                     MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS,
+                     -1,
+                     0);
+    if (res != MAP_FAILED) {
+        std::memcpy(target, src, d.size);
+    }
+
+    munmap(src, faabric::util::getHugePageAlignedSize(d.size));
+    return res;
 }
 
 void SnapshotRegistry::takeSnapshot(const std::string& key,
@@ -88,6 +134,18 @@ size_t SnapshotRegistry::getSnapshotCount()
     return snapshotMap.size();
 }
 
+size_t SnapshotRegistry::getSnapshotBytes()
+{
+    faabric::util::UniqueLock lock(snapshotsMx);
+
+    size_t bytes = 0;
+    for (const auto& p : snapshotMap) {
+        bytes += p.second.size;
+    }
+
+    return bytes;
+}
+
 SnapshotRegistry& getSnapshotRegistry()
 {
     static SnapshotRegistry reg;
@@ -109,14 +167,35 @@ int SnapshotRegistry::writeSnapshotToFd(const std::string& key)
 {
     auto logger = faabric::util::getLogger();
 
-    int fd = ::memfd_create(key.c_str(), 0);
     faabric::util::SnapshotData snapData = getSnapshot(key);
+    faabric::util::AllocationClass allocClass =
+      faabric::util::getAllocationClass(snapData.size);
+
+    bool isHugeTlb = false;
+    int fd =
+      faabric::util::createMemoryFd(key, snapData.size, allocClass, isHugeTlb);
+
+    // Huge page files don't support write, so copy in through a mapping. If
+    // there aren't enough huge pages this fails, so fall back to a normal fd
+    if (isHugeTlb) {
+        size_t hugeSize = faabric::util::getHugePageAlignedSize(snapData.size);
+        void* mapped = mmap(
+          nullptr, hugeSize, PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            std::memcpy(mapped, snapData.data, snapData.size);
+            munmap(mapped, hugeSize);
+
+            getSnapshot(key).fd = fd;
+            getSnapshot(key).hugeTlb = true;
+            logger->debug("Wrote snapshot {} to huge page fd {}", key, fd);
+            return fd;
+        }
+
+        logger->debug("Mapping huge page fd for {} failed, falling back", key);
+        ::close(fd);
 
-    // Make the fd big enough
-    int ferror = ::ftruncate(fd, snapData.size);
-    if (ferror) {
-        logger->error("ferror call failed with error {}", ferror);
-        throw std::runtime_error("Failed writing memory to fd (ftruncate)");
+        fd = faabric::util::createMemoryFd(
+          key, snapData.size, faabric::util::AllocationClass(), isHugeTlb);
     }
 
     // Write the data
@@ -3,6 +3,9 @@
 #include <cstdio>
 
 #include <faabric/util/bytes.h>
+#include <faabric/util/config.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
 #include <faabric/util/state.h>
 
@@ -64,7 +67,10 @@ InMemoryStateKeyValue::InMemoryStateKeyValue(const std::string& userIn,
   , status(masterIP == thisIP ? InMemoryStateKeyStatus::MASTER
                               : InMemoryStateKeyStatus::NOT_MASTER)
   , stateRegistry(getInMemoryStateRegistry())
-{}
+{
+    // Only copies of values mastered elsewhere can be dropped
+    evictable = status == InMemoryStateKeyStatus::NOT_MASTER;
+}
 
 InMemoryStateKeyValue::InMemoryStateKeyValue(const std::string& userIn,
                                              const std::string& keyIn,
@@ -84,19 +90,228 @@ bool InMemoryStateKeyValue::isMaster()
 void InMemoryStateKeyValue::lockGlobal()
 {
     if (status == InMemoryStateKeyStatus::MASTER) {
-        globalLock.lock();
-    } else {
-        masterClient.lock();
+        StateLease lease = acquireLease(thisIP, false);
+        masterLeaseId = lease.id;
+        return;
+    }
+
+    // Threads on this host take turns with the lease
+    localLockMx.lock();
+
+    {
+        faabric::util::UniqueLock lock(cachedLeaseMx);
+        if (hasValidCachedLease()) {
+            inCriticalSection = true;
+            return;
+        }
+    }
+
+    while (true) {
+        auto requested = std::chrono::steady_clock::now();
+
+        StateLease lease;
+        try {
+            lease = masterClient.lock(thisIP);
+        } catch (...) {
+            localLockMx.unlock();
+            throw;
+        }
+
+        faabric::util::UniqueLock lock(cachedLeaseMx);
+
+        // Retry if the master revoked the lease before it got here
+        if (lease.id <= revokedLeaseId) {
+            continue;
+        }
+
+        cachedLeaseId = lease.id;
+        cachedLeaseContended = lease.contended;
+        cachedLeaseExpiry =
+          requested + std::chrono::milliseconds(lease.leaseMs);
+        inCriticalSection = true;
+        cachedLeaseCv.notify_all();
+        return;
     }
 }
 
 void InMemoryStateKeyValue::unlockGlobal()
 {
     if (status == InMemoryStateKeyStatus::MASTER) {
-        globalLock.unlock();
-    } else {
-        masterClient.unlock();
+        releaseLease(thisIP, masterLeaseId);
+        return;
+    }
+
+    // Hand the lease straight back if others are waiting or it has run out,
+    // otherwise keep it for the next local lock
+    uint64_t releaseId = 0;
+    {
+        faabric::util::UniqueLock lock(cachedLeaseMx);
+        inCriticalSection = false;
+
+        if (cachedLeaseId > revokedLeaseId &&
+            (cachedLeaseContended || !hasValidCachedLease())) {
+            releaseId = cachedLeaseId;
+            revokedLeaseId = cachedLeaseId;
+        }
+
+        cachedLeaseCv.notify_all();
+    }
+
+    if (releaseId > 0) {
+        try {
+            masterClient.unlock(thisIP, releaseId);
+        } catch (std::runtime_error& ex) {
+            // The master will reclaim the lease when it expires
+            logger->warn("Failed to release lease {} on {}/{}",
+                         releaseId,
+                         user,
+                         key);
+        }
     }
+
+    localLockMx.unlock();
+}
+
+bool InMemoryStateKeyValue::hasValidCachedLease()
+{
+    return cachedLeaseId > revokedLeaseId &&
+           std::chrono::steady_clock::now() < cachedLeaseExpiry;
+}
+
+// ----------------------------------------
+// Lock leases
+// ----------------------------------------
+
+StateLease InMemoryStateKeyValue::acquireLease(const std::string& host,
+                                               bool isRemote)
+{
+    int leaseMs = faabric::util::getSystemConfig().stateLockLeaseMs;
+    faabric::util::UniqueLock lock(leaseMx);
+
+    // Requests are served strictly in the order they arrive
+    uint64_t ticket = nextTicket++;
+    while (ticket != servingTicket || !leaseHolder.empty()) {
+        if (ticket != servingTicket || !leaseHolderRemote) {
+            leaseCv.wait(lock);
+            continue;
+        }
+
+        // Threads on a host take turns, so a host asking again has already
+        // finished with its previous lease
+        if (leaseHolder == host) {
+            leaseHolder.clear();
+            continue;
+        }
+
+        // Ask the remote holder to give up its lease
+        std::string holder = leaseHolder;
+        uint64_t holderId = leaseHolderId;
+        auto expiry = leaseExpiry;
+
+        lock.unlock();
+        bool released = false;
+        bool reachable = true;
+        try {
+            released = revokeRemoteLease(holder, holderId, leaseMs);
+        } catch (std::runtime_error& ex) {
+            reachable = false;
+        }
+        lock.lock();
+
+        if (leaseHolder.empty() || leaseHolderId != holderId) {
+            continue;
+        }
+
+        if (released) {
+            leaseHolder.clear();
+        } else if (reachable) {
+            // Holder is still in its critical section and will release the
+            // lease when it's done
+            leaseCv.wait(lock, [this, holderId] {
+                return leaseHolder.empty() || leaseHolderId != holderId;
+            });
+        } else {
+            // Holder can't be reached, so fall back to the lease running out
+            leaseCv.wait_until(lock, expiry, [this, holderId] {
+                return leaseHolder.empty() || leaseHolderId != holderId;
+            });
+
+            if (leaseHolderId == holderId) {
+                logger->warn("Lease {} on {}/{} expired on {}",
+                             holderId,
+                             user,
+                             key,
+                             holder);
+                leaseHolder.clear();
+            }
+        }
+    }
+
+    servingTicket++;
+    leaseHolder = host;
+    leaseHolderRemote = isRemote;
+    leaseHolderId = nextLeaseId++;
+    leaseExpiry =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(leaseMs);
+
+    StateLease lease;
+    lease.id = leaseHolderId;
+    lease.leaseMs = leaseMs;
+    lease.contended = nextTicket != servingTicket;
+
+    // Wake the next in line
+    leaseCv.notify_all();
+
+    return lease;
+}
+
+void InMemoryStateKeyValue::releaseLease(const std::string& host,
+                                         uint64_t leaseId)
+{
+    faabric::util::UniqueLock lock(leaseMx);
+
+    // Ignore stale releases of leases that have already been reclaimed
+    if (leaseHolder == host && leaseHolderId == leaseId) {
+        leaseHolder.clear();
+        leaseCv.notify_all();
+    }
+}
+
+bool InMemoryStateKeyValue::revokeLease(uint64_t leaseId, int timeoutMs)
+{
+    faabric::util::UniqueLock lock(cachedLeaseMx);
+
+    // Let the lease be used at least once and wait for any critical section
+    // under it to finish
+    bool idle = cachedLeaseCv.wait_for(
+      lock, std::chrono::milliseconds(timeoutMs), [this, leaseId] {
+          return revokedLeaseId >= leaseId ||
+                 (cachedLeaseId >= leaseId && !inCriticalSection);
+      });
+
+    if (!idle && cachedLeaseId >= leaseId) {
+        // Still busy, so make sure the lease is handed back on unlock
+        cachedLeaseContended = true;
+        return false;
+    }
+
+    // If the grant never arrived it will be discarded when it does
+    revokedLeaseId = std::max(revokedLeaseId, leaseId);
+    return true;
+}
+
+bool InMemoryStateKeyValue::revokeRemoteLease(const std::string& holder,
+                                              uint64_t leaseId,
+                                              int leaseMs)
+{
+    logger->debug("Revoking lease {} on {}/{} from {}",
+                  leaseId,
+                  user,
+                  key,
+                  holder);
+
+    StateClient holderClient(user, key, holder);
+    return holderClient.releaseLease(leaseId, 2 * leaseMs);
 }
 
 void InMemoryStateKeyValue::pullFromRemote()
@@ -1,10 +1,19 @@
 #include <faabric/state/RedisStateKeyValue.h>
 
+#include <faabric/util/config.h>
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
 #include <faabric/util/state.h>
 #include <faabric/util/timing.h>
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <thread>
+
 /**
  * WARNING - key-value objects are shared between threads, BUT
  * hiredis is not thread-safe, so make sure you always retrieve
@@ -13,13 +22,161 @@
  */
 
 namespace faabric::state {
+
+namespace {
+/**
+ * Background thread that hands back remote locks when their lease runs out.
+ * Without it, a host that unlocks while uncontended would keep the lock until
+ * it expired in Redis, stalling any host that arrives in the meantime.
+ */
+class LeaseReaper
+{
+  public:
+    LeaseReaper()
+    {
+        std::thread([this] { run(); }).detach();
+    }
+
+    void schedule(RedisStateKeyValue* kv, faabric::util::TimePoint deadline)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mx);
+            deadlines[kv] = deadline;
+        }
+        cv.notify_all();
+    }
+
+    void cancel(RedisStateKeyValue* kv)
+    {
+        // Waits for any release in progress on this value
+        std::unique_lock<std::mutex> lock(mx);
+        deadlines.erase(kv);
+    }
+
+  private:
+    std::mutex mx;
+    std::condition_variable cv;
+    std::map<RedisStateKeyValue*, faabric::util::TimePoint> deadlines;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        while (true) {
+            if (deadlines.empty()) {
+                cv.wait(lock);
+                continue;
+            }
+
+            auto next = deadlines.begin();
+            for (auto it = deadlines.begin(); it != deadlines.end(); ++it) {
+                if (it->second < next->second) {
+                    next = it;
+                }
+            }
+
+            if (std::chrono::steady_clock::now() < next->second) {
+                cv.wait_until(lock, next->second);
+                continue;
+            }
+
+            // The value can't be destroyed while we hold the mutex
+            RedisStateKeyValue* kv = next->first;
+            deadlines.erase(next);
+            try {
+                kv->releaseExpiredLease();
+            } catch (std::exception& e) {
+                faabric::util::getLogger()->warn(
+                  "Failed to release expired state lock lease: {}", e.what());
+            }
+        }
+    }
+};
+
+LeaseReaper& getLeaseReaper()
+{
+    // Deliberately never destroyed, as values may outlive other statics
+    static LeaseReaper* reaper = new LeaseReaper();
+    return *reaper;
+}
+
+/**
+ * Threads that take stripes of large chunked transfers, each on its own state
+ * connection. They last as long as the process rather than being started for
+ * every transfer.
+ */
+class TransferHelpers
+{
+  public:
+    explicit TransferHelpers(size_t nThreadsIn)
+      : nThreads(nThreadsIn)
+    {
+        for (size_t i = 0; i < nThreads; i++) {
+            std::thread([this] { run(); }).detach();
+        }
+    }
+
+    size_t getThreadCount() { return nThreads; }
+
+    std::future<void> submit(std::function<void(redis::Redis&)> task)
+    {
+        auto packaged =
+          std::make_shared<std::packaged_task<void(redis::Redis&)>>(
+            std::move(task));
+        std::future<void> f = packaged->get_future();
+
+        {
+            std::unique_lock<std::mutex> lock(mx);
+            tasks.emplace_back(
+              [packaged](redis::Redis& conn) { (*packaged)(conn); });
+        }
+        cv.notify_one();
+
+        return f;
+    }
+
+  private:
+    const size_t nThreads;
+
+    std::mutex mx;
+    std::condition_variable cv;
+    std::deque<std::function<void(redis::Redis&)>> tasks;
+
+    void run()
+    {
+        redis::Redis& conn = redis::Redis::getState();
+
+        while (true) {
+            std::function<void(redis::Redis&)> task;
+            {
+                std::unique_lock<std::mutex> lock(mx);
+                cv.wait(lock, [this] { return !tasks.empty(); });
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+
+            task(conn);
+        }
+    }
+};
+
+TransferHelpers& getTransferHelpers()
+{
+    // Like the reaper, these are never destroyed
+    static TransferHelpers* helpers = new TransferHelpers(std::max(
+      faabric::util::getSystemConfig().redisStateConnections - 1, 0));
+    return *helpers;
+}
+}
+
 RedisStateKeyValue::RedisStateKeyValue(const std::string& userIn,
                                        const std::string& keyIn,
                                        size_t sizeIn)
   : StateKeyValue(userIn, keyIn, sizeIn)
-  , joinedKey(faabric::util::keyForUser(user, key)){
-
-  };
+  , joinedKey(faabric::util::keyForUser(user, key))
+{
+    // Redis holds the master copy of all values
+    evictable = true;
+}
 
 RedisStateKeyValue::RedisStateKeyValue(const std::string& userIn,
                                        const std::string& keyIn)
@@ -27,6 +184,11 @@ RedisStateKeyValue::RedisStateKeyValue(const std::string& userIn,
 
   };
 
+RedisStateKeyValue::~RedisStateKeyValue()
+{
+    getLeaseReaper().cancel(this);
+}
+
 size_t RedisStateKeyValue::getStateSizeFromRemote(const std::string& userIn,
                                                   const std::string& keyIn)
 {
@@ -48,27 +210,91 @@ void RedisStateKeyValue::clearAll(bool global)
     }
 }
 
-// TODO - the remote locking here is quite primitive since we ignore the fact
-// threads can run on the same machine. Redis is also aware of scheduling and so
-// we could optimise this.
+// Threads on this host take turns with the remote lock, and hold on to it for
+// a short lease so that repeated local locking doesn't go to Redis each time
 void RedisStateKeyValue::lockGlobal()
 {
-    faabric::util::FullLock lock(valueMutex);
-    lastRemoteLockId = waitOnRedisRemoteLock(joinedKey);
+    globalLockMutex.lock();
+
+    if (hasRemoteLease()) {
+        return;
+    }
+
+    if (lastRemoteLockId > 0) {
+        releaseRemoteLock();
+    }
+
+    try {
+        remoteLockAcquired = faabric::util::startTimer();
+        lastRemoteLockId = waitOnRedisRemoteLock(joinedKey);
+
+        redis::Redis& redis = redis::Redis::getState();
+        remoteLockContended = redis.getCounter(joinedKey + "_lock_waiters") > 0;
+    } catch (...) {
+        globalLockMutex.unlock();
+        throw;
+    }
 }
 
 void RedisStateKeyValue::unlockGlobal()
 {
-    faabric::util::FullLock lock(valueMutex);
-    redis::Redis::getState().releaseLock(joinedKey, lastRemoteLockId);
+    // Hand the lock back straight away if others are waiting or the lease has
+    // run out, otherwise make sure it's handed back when the lease ends
+    if (lastRemoteLockId > 0 && !hasRemoteLease()) {
+        releaseRemoteLock();
+    } else if (lastRemoteLockId > 0) {
+        getLeaseReaper().schedule(
+          this, remoteLockAcquired + std::chrono::milliseconds(getLeaseMs()));
+    }
+
+    globalLockMutex.unlock();
+}
+
+void RedisStateKeyValue::releaseExpiredLease()
+{
+    // If a thread holds the lock, it will release on unlock instead
+    std::unique_lock<std::mutex> lock(globalLockMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    if (lastRemoteLockId > 0 && !hasRemoteLease()) {
+        logger->debug("Releasing expired lock lease on {}", joinedKey);
+        releaseRemoteLock();
+    }
+}
+
+void RedisStateKeyValue::releaseRemoteLock()
+{
+    redis::Redis& redis = redis::Redis::getState();
+    redis.releaseLock(joinedKey, lastRemoteLockId);
+    redis.notifyLockReleased(joinedKey, REMOTE_LOCK_TIMEOUT_SECS);
+    lastRemoteLockId = 0;
+}
+
+bool RedisStateKeyValue::hasRemoteLease()
+{
+    if (lastRemoteLockId == 0 || remoteLockContended) {
+        return false;
+    }
+
+    return faabric::util::getTimeDiffMillis(remoteLockAcquired) < getLeaseMs();
+}
+
+int RedisStateKeyValue::getLeaseMs()
+{
+    // Leave most of the lock's expiry for the critical section itself
+    int leaseMs = faabric::util::getSystemConfig().stateLockLeaseMs;
+    return std::min(leaseMs, (REMOTE_LOCK_TIMEOUT_SECS * 1000) / 2);
 }
 
 void RedisStateKeyValue::pullFromRemote()
 {
     PROF_START(statePull)
 
-    // Read from the remote
     logger->debug("Pulling remote value for {}", joinedKey);
+
+    // Whole values are read in one go, so never see a half-written value
     auto memoryBytes = static_cast<uint8_t*>(sharedMemory);
     redis::Redis::getState().get(joinedKey, memoryBytes, valueSize);
 
@@ -84,14 +310,7 @@ void RedisStateKeyValue::pullChunkFromRemote(long offset, size_t length)
                   offset + length,
                   joinedKey);
 
-    // Note - redis ranges are inclusive, so we need to knock one off
-    size_t rangeStart = offset;
-    size_t rangeEnd = offset + length - 1;
-
-    // Read from the remote
-    auto buffer = BYTES(sharedMemory) + offset;
-    redis::Redis::getState().getRange(
-      joinedKey, buffer, length, rangeStart, rangeEnd);
+    transferChunks(splitIntoChunks(offset, length), false);
 
     PROF_END(stateChunkPull)
 }
@@ -102,6 +321,7 @@ void RedisStateKeyValue::pushToRemote()
 
     logger->debug("Pushing whole value for {}", joinedKey);
 
+    // A single SET replaces the value atomically, including its length
     redis::Redis::getState().set(
       joinedKey, static_cast<uint8_t*>(sharedMemory), valueSize);
 
@@ -113,18 +333,154 @@ void RedisStateKeyValue::pushPartialToRemote(
 {
     PROF_START(pushPartial)
 
-    redis::Redis& redis = redis::Redis::getState();
-
     // Pipeline the updates
+    std::vector<StateChunk> splitChunks = splitIntoChunks(chunks);
+    transferChunks(splitChunks, true);
+
+    logger->debug("Pipelined {} updates on {}", splitChunks.size(), joinedKey);
+
+    PROF_END(pushPartial)
+}
+
+std::vector<StateChunk> RedisStateKeyValue::splitIntoChunks(long offset,
+                                                            size_t length)
+{
+    std::vector<StateChunk> chunks = {
+        StateChunk(offset, length, BYTES(sharedMemory) + offset)
+    };
+
+    return splitIntoChunks(chunks);
+}
+
+std::vector<StateChunk> RedisStateKeyValue::splitIntoChunks(
+  const std::vector<StateChunk>& chunks)
+{
+    size_t chunkSize =
+      std::max(faabric::util::getSystemConfig().redisStateChunkSize, 1);
+
+    std::vector<StateChunk> splitChunks;
     for (auto& c : chunks) {
-        redis.setRangePipeline(joinedKey, c.offset, c.data, c.length);
+        for (size_t done = 0; done < c.length; done += chunkSize) {
+            size_t thisLength = std::min(chunkSize, c.length - done);
+            splitChunks.emplace_back(
+              c.offset + done, thisLength, c.data + done);
+        }
     }
 
-    // Flush the pipeline
-    logger->debug("Pipelined {} updates on {}", chunks.size(), joinedKey);
-    redis.flushPipeline(chunks.size());
+    return splitChunks;
+}
 
-    PROF_END(pushPartial)
+void RedisStateKeyValue::transferChunks(const std::vector<StateChunk>& chunks,
+                                        bool isPush)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    size_t nChunks = chunks.size();
+    size_t window = std::max(conf.redisStateWindow, 1);
+
+    // Only spread over several connections when there's more than a window's
+    // worth of chunks to transfer
+    size_t nConnections = std::max(conf.redisStateConnections, 1);
+    nConnections = std::min(nConnections, (nChunks + window - 1) / window);
+
+    if (nConnections <= 1) {
+        transferChunksOnConnection(
+          redis::Redis::getState(), chunks.data(), nChunks, isPush);
+        return;
+    }
+
+    // There's no point splitting into more stripes than there are helpers
+    TransferHelpers& helpers = getTransferHelpers();
+    nConnections = std::min(nConnections, helpers.getThreadCount() + 1);
+
+    logger->debug("Transferring {} chunks of {} over {} connections",
+                  nChunks,
+                  joinedKey,
+                  nConnections);
+
+    // Each connection gets a contiguous stripe of chunks. This thread handles
+    // the first stripe on its usual connection, and helpers take the rest.
+    size_t perConnection = (nChunks + nConnections - 1) / nConnections;
+    std::vector<std::future<void>> stripes;
+    for (size_t i = 1; i < nConnections; i++) {
+        size_t start = i * perConnection;
+        if (start >= nChunks) {
+            break;
+        }
+
+        size_t n = std::min(perConnection, nChunks - start);
+        stripes.emplace_back(helpers.submit(
+          [this, &chunks, start, n, isPush](redis::Redis& conn) {
+              transferChunksOnConnection(
+                conn, chunks.data() + start, n, isPush);
+          }));
+    }
+
+    std::exception_ptr error;
+    try {
+        transferChunksOnConnection(
+          redis::Redis::getState(), chunks.data(), perConnection, isPush);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    // Helpers use the chunks, so we have to wait for all of them to finish
+    for (auto& f : stripes) {
+        try {
+            f.get();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void RedisStateKeyValue::transferChunksOnConnection(redis::Redis& redis,
+                                                    const StateChunk* chunks,
+                                                    size_t nChunks,
+                                                    bool isPush)
+{
+    size_t window =
+      std::max(faabric::util::getSystemConfig().redisStateWindow, 1);
+
+    // Keep up to a window of commands in flight, reading the replies back in
+    // the order they were sent
+    size_t nSent = 0;
+    size_t nDone = 0;
+    try {
+        while (nDone < nChunks) {
+            while (nSent < nChunks && nSent - nDone < window) {
+                const StateChunk& c = chunks[nSent];
+                if (isPush) {
+                    redis.setRangePipeline(
+                      joinedKey, c.offset, c.data, c.length);
+                } else {
+                    // Note - redis ranges are inclusive, so we need to knock
+                    // one off
+                    redis.getRangePipeline(
+                      joinedKey, c.offset, c.offset + c.length - 1);
+                }
+                nSent++;
+            }
+
+            const StateChunk& c = chunks[nDone];
+            if (isPush) {
+                redis.flushPipeline(1);
+            } else {
+                redis.readRangePipelineReply(joinedKey, c.data, c.length);
+            }
+            nDone++;
+        }
+    } catch (...) {
+        // Any replies still in flight would be picked up by the next caller,
+        // so drop the connection and start afresh
+        redis.refresh();
+        throw;
+    }
 }
 
 void RedisStateKeyValue::appendToRemote(const uint8_t* data, size_t length)
@@ -12,6 +12,19 @@
 using namespace faabric::util;
 
 namespace faabric::state {
+// Epochs are unique across all state instances so that cached handles can't
+// be mistaken for those from another instance
+static std::atomic<uint64_t> nextCacheEpoch(1);
+
+class CachedKV
+{
+  public:
+    uint64_t epoch = 0;
+    std::weak_ptr<StateKeyValue> kv;
+};
+
+static thread_local std::array<CachedKV, STATE_KV_THREAD_CACHE_SIZE> kvCache;
+
 State& getGlobalState()
 {
     static State s(faabric::util::getSystemConfig().endpointHost);
@@ -20,8 +33,21 @@ State& getGlobalState()
 
 State::State(std::string thisIPIn)
   : thisIP(thisIPIn)
+  , cacheEpoch(nextCacheEpoch++)
 {}
 
+size_t State::KVMapKeyHash::operator()(const KVMapKey& k) const
+{
+    size_t h = std::hash<std::string_view>{}(k.first);
+    return h ^ (std::hash<std::string_view>{}(k.second) + 0x9e3779b9 +
+                (h << 6) + (h >> 2));
+}
+
+State::KVMapShard& State::getShard(size_t hash)
+{
+    return shards[(hash >> 16) % STATE_KV_MAP_SHARDS];
+}
+
 void State::forceClearAll(bool global)
 {
     std::string stateMode = faabric::util::getSystemConfig().stateMode;
@@ -33,8 +59,12 @@ void State::forceClearAll(bool global)
         throw std::runtime_error("Unrecognised state mode: " + stateMode);
     }
 
-    faabric::util::SharedLock sharedLock(mapMutex);
-    kvMap.clear();
+    for (auto& shard : shards) {
+        FullLock fullLock(shard.mx);
+        shard.kvMap.clear();
+    }
+
+    cacheEpoch = nextCacheEpoch++;
 }
 
 size_t State::getStateSize(const std::string& user, const std::string& keyIn)
@@ -43,24 +73,17 @@ size_t State::getStateSize(const std::string& user, const std::string& keyIn)
         throw std::runtime_error("Attempting to access state with empty user");
     }
 
-    std::string lookupKey = faabric::util::keyForUser(user, keyIn);
-
     // See if we have the value locally
+    KVMapKey lookupKey(user, keyIn);
+    KVMapShard& shard = getShard(KVMapKeyHash{}(lookupKey));
     {
-        faabric::util::SharedLock sharedLock(mapMutex);
-        if (kvMap.count(lookupKey) > 0) {
-            return kvMap[lookupKey]->size();
+        SharedLock sharedLock(shard.mx);
+        auto it = shard.kvMap.find(lookupKey);
+        if (it != shard.kvMap.end()) {
+            return it->second->size();
         }
     }
 
-    // Full lock
-    FullLock fullLock(mapMutex);
-
-    // Double check
-    if (kvMap.count(lookupKey) > 0) {
-        return kvMap[lookupKey]->size();
-    }
-
     // Get from remote
     // TODO - cache this?
     std::string stateMode = faabric::util::getSystemConfig().stateMode;
@@ -90,9 +113,12 @@ void State::deleteKV(const std::string& userIn, const std::string& keyIn)
 
 void State::deleteKVLocally(const std::string& userIn, const std::string& keyIn)
 {
-    FullLock fullLock(mapMutex);
-    std::string lookupKey = faabric::util::keyForUser(userIn, keyIn);
-    kvMap.erase(lookupKey);
+    KVMapKey lookupKey(userIn, keyIn);
+    KVMapShard& shard = getShard(KVMapKeyHash{}(lookupKey));
+
+    FullLock fullLock(shard.mx);
+    shard.kvMap.erase(lookupKey);
+    cacheEpoch = nextCacheEpoch++;
 }
 
 std::shared_ptr<StateKeyValue> State::getKV(const std::string& user,
@@ -120,59 +146,96 @@ std::shared_ptr<StateKeyValue> State::doGetKV(const std::string& user,
           key));
     }
 
-    std::string lookupKey = faabric::util::keyForUser(user, key);
+    KVMapKey lookupKey(user, key);
+    size_t hash = KVMapKeyHash{}(lookupKey);
+
+    // Check this thread's cache of recently used key-values
+    uint64_t epoch = cacheEpoch.load(std::memory_order_acquire);
+    CachedKV& cached = kvCache[hash % STATE_KV_THREAD_CACHE_SIZE];
+    if (cached.epoch == epoch) {
+        std::shared_ptr<StateKeyValue> kv = cached.kv.lock();
+        if (kv != nullptr && kv->user == user && kv->key == key) {
+            return kv;
+        }
+    }
 
     // See if we have locally
+    KVMapShard& shard = getShard(hash);
     {
-        SharedLock sharedLock(mapMutex);
-        if (kvMap.count(lookupKey) > 0) {
-            return kvMap[lookupKey];
+        SharedLock sharedLock(shard.mx);
+        auto it = shard.kvMap.find(lookupKey);
+        if (it != shard.kvMap.end()) {
+            cached.epoch = epoch;
+            cached.kv = it->second;
+            return it->second;
         }
     }
 
-    // Full lock
-    FullLock fullLock(mapMutex);
+    // Full lock on this shard only
+    FullLock fullLock(shard.mx);
 
     // Double check condition
-    if (kvMap.count(lookupKey) > 0) {
-        return kvMap[lookupKey];
+    auto it = shard.kvMap.find(lookupKey);
+    if (it != shard.kvMap.end()) {
+        return it->second;
     }
 
     // Sanity check on size if not sizeless
     if (!sizeless && size == 0) {
         throw StateKeyValueException(
-          "Must specify size for creating key-value " + lookupKey);
+          "Must specify size for creating key-value " +
+          faabric::util::keyForUser(user, key));
     }
 
     // Create new KV
+    std::shared_ptr<StateKeyValue> kv;
     std::string stateMode = faabric::util::getSystemConfig().stateMode;
     if (stateMode == "redis") {
         if (sizeless) {
-            auto kv = new RedisStateKeyValue(user, key);
-            kvMap.emplace(lookupKey, kv);
+            kv = std::make_shared<RedisStateKeyValue>(user, key);
         } else {
-            auto kv = new RedisStateKeyValue(user, key, size);
-            kvMap.emplace(lookupKey, kv);
+            kv = std::make_shared<RedisStateKeyValue>(user, key, size);
         }
     } else if (stateMode == "inmemory") {
         // NOTE - passing IP here is crucial for testing
         if (sizeless) {
-            auto kv = new InMemoryStateKeyValue(user, key, thisIP);
-            kvMap.emplace(lookupKey, kv);
+            kv = std::make_shared<InMemoryStateKeyValue>(user, key, thisIP);
         } else {
-            auto kv = new InMemoryStateKeyValue(user, key, size, thisIP);
-            kvMap.emplace(lookupKey, kv);
+            kv =
+              std::make_shared<InMemoryStateKeyValue>(user, key, size, thisIP);
         }
     } else {
         throw std::runtime_error("Unrecognised state mode: " + stateMode);
     }
 
-    return kvMap[lookupKey];
+    // Key on the key-value's own strings, which live as long as the entry
+    shard.kvMap.emplace(KVMapKey(kv->user, kv->key), kv);
+
+    return kv;
 }
 
 size_t State::getKVCount()
 {
-    return kvMap.size();
+    size_t count = 0;
+    for (auto& shard : shards) {
+        SharedLock sharedLock(shard.mx);
+        count += shard.kvMap.size();
+    }
+
+    return count;
+}
+
+size_t State::getLocalBytes()
+{
+    size_t bytes = 0;
+    for (auto& shard : shards) {
+        SharedLock sharedLock(shard.mx);
+        for (const auto& p : shard.kvMap) {
+            bytes += p.second->size();
+        }
+    }
+
+    return bytes;
 }
 
 std::string State::getThisIP()
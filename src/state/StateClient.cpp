@@ -178,27 +178,55 @@ void StateClient::deleteState()
     CHECK_RPC("state_delete", stub->Delete(&context, request, &response))
 }
 
-void StateClient::lock()
+StateLease StateClient::lock(const std::string& requestHost)
 {
     faabric::StateRequest request;
     faabric::StateResponse response;
 
     request.set_user(user);
     request.set_key(key);
+    request.set_host(requestHost);
 
     ClientContext context;
     CHECK_RPC("state_lock", stub->Lock(&context, request, &response))
+
+    StateLease lease;
+    lease.id = response.leaseid();
+    lease.leaseMs = response.leasems();
+    lease.contended = response.contended();
+    return lease;
 }
 
-void StateClient::unlock()
+void StateClient::unlock(const std::string& requestHost, uint64_t leaseId)
 {
     faabric::StateRequest request;
     faabric::StateResponse response;
 
     request.set_user(user);
     request.set_key(key);
+    request.set_host(requestHost);
+    request.set_leaseid(leaseId);
 
     ClientContext context;
     CHECK_RPC("state_unlock", stub->Unlock(&context, request, &response))
 }
+
+bool StateClient::releaseLease(uint64_t leaseId, int timeoutMs)
+{
+    faabric::StateRequest request;
+    faabric::StateResponse response;
+
+    request.set_user(user);
+    request.set_key(key);
+    request.set_leaseid(leaseId);
+
+    // Don't hang on unreachable holders, the lease expires anyway
+    ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() +
+                         std::chrono::milliseconds(timeoutMs));
+    CHECK_RPC("state_release_lease",
+              stub->ReleaseLease(&context, request, &response))
+
+    return response.released();
+}
 }
@@ -1,10 +1,12 @@
 #include <faabric/state/StateKeyValue.h>
+#include <faabric/state/StateMemoryManager.h>
 
 #include <faabric/util/config.h>
 #include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
 #include <faabric/util/memory.h>
+#include <faabric/util/metrics.h>
 #include <faabric/util/timing.h>
 
 #include <sys/mman.h>
@@ -34,6 +36,21 @@ StateKeyValue::StateKeyValue(const std::string& userIn,
     if (sizeIn > 0) {
         configureSize();
     }
+
+    getStateMemoryManager().registerKV(this);
+}
+
+StateKeyValue::~StateKeyValue()
+{
+    getStateMemoryManager().unregisterKV(this);
+
+    // Values handed out as raw pointers may still be in use elsewhere
+    if (sharedMemory != nullptr && !pinned) {
+        munmap(sharedMemory, sharedMemSize);
+    }
+
+    delete[] BYTES(dirtyMask);
+    delete[] BYTES(pulledMask);
 }
 
 void StateKeyValue::configureSize()
@@ -48,6 +65,8 @@ void StateKeyValue::configureSize()
 
     pulledMask = new uint8_t[valueSize];
     memset(pulledMask, 0, valueSize);
+
+    allocatedPages.resize(nHostPages, 0);
 }
 
 void StateKeyValue::checkSizeConfigured()
@@ -64,6 +83,13 @@ void StateKeyValue::pull()
     doPull(false);
 }
 
+void StateKeyValue::pullChunk(long offset, size_t length)
+{
+    logger->debug(
+      "Pulling state chunk for {}/{} ({}, {})", user, key, offset, length);
+    doPullChunk(false, offset, length);
+}
+
 bool StateKeyValue::isChunkPulled(long offset, size_t length)
 {
     checkSizeConfigured();
@@ -85,6 +111,8 @@ bool StateKeyValue::isChunkPulled(long offset, size_t length)
 
 void StateKeyValue::get(uint8_t* buffer)
 {
+    // Stop the value being evicted between pulling and copying
+    ActiveRead read(*this);
     doPull(true);
 
     SharedLock lock(valueMutex);
@@ -94,12 +122,15 @@ void StateKeyValue::get(uint8_t* buffer)
 
 uint8_t* StateKeyValue::get()
 {
+    // The pointer may be held indefinitely, so this value can't be evicted
+    pin();
     doPull(true);
     return BYTES(sharedMemory);
 }
 
 void StateKeyValue::getChunk(long offset, uint8_t* buffer, size_t length)
 {
+    ActiveRead read(*this);
     doPullChunk(true, offset, length);
 
     SharedLock lock(valueMutex);
@@ -109,10 +140,31 @@ void StateKeyValue::getChunk(long offset, uint8_t* buffer, size_t length)
 
 uint8_t* StateKeyValue::getChunk(long offset, long len)
 {
+    pin();
     doPullChunk(true, offset, len);
     return BYTES(sharedMemory) + offset;
 }
 
+// Pins and reads are registered under the lock, so that eviction either sees
+// them or has already finished and marked the value as needing a pull
+void StateKeyValue::pin()
+{
+    SharedLock lock(valueMutex);
+    pinned = true;
+}
+
+StateKeyValue::ActiveRead::ActiveRead(StateKeyValue& kvIn)
+  : kv(kvIn)
+{
+    SharedLock lock(kv.valueMutex);
+    kv.nActiveReads++;
+}
+
+StateKeyValue::ActiveRead::~ActiveRead()
+{
+    kv.nActiveReads--;
+}
+
 std::vector<StateChunk> StateKeyValue::getAllChunks()
 {
     // Divide the whole value up into chunks
@@ -249,6 +301,12 @@ size_t StateKeyValue::getSharedMemorySize() const
     return sharedMemSize;
 }
 
+size_t StateKeyValue::getResidentSize()
+{
+    SharedLock lock(valueMutex);
+    return residentSize;
+}
+
 void StateKeyValue::mapSharedMemory(void* destination,
                                     long pagesOffset,
                                     long nPages)
@@ -264,6 +322,7 @@ void StateKeyValue::mapSharedMemory(void* destination,
 
     // Full lock to perform the shared mapping
     FullLock lock(valueMutex);
+    nMappings++;
 
     // Ensure the underlying memory is allocated
     size_t offset = pagesOffset * faabric::util::HOST_PAGE_SIZE;
@@ -325,6 +384,10 @@ void StateKeyValue::unmapSharedMemory(void* mappedAddr)
 
         throw std::runtime_error("Failed unmapping shared memory");
     }
+
+    if (nMappings > 0) {
+        nMappings--;
+    }
 }
 
 void StateKeyValue::allocateChunk(long offset, size_t length)
@@ -353,6 +416,23 @@ void StateKeyValue::allocateChunk(long offset, size_t length)
         throw std::runtime_error("Failed allocating memory for KV");
     }
 
+    // Account for any newly resident pages
+    size_t nNewPages = 0;
+    for (long p = chunk.nPagesOffset;
+         p < chunk.nPagesOffset + chunk.nPagesLength;
+         p++) {
+        if (allocatedPages.at(p) == 0) {
+            allocatedPages.at(p) = 1;
+            nNewPages++;
+        }
+    }
+
+    if (nNewPages > 0) {
+        size_t nNewBytes = nNewPages * HOST_PAGE_SIZE;
+        residentSize += nNewBytes;
+        getStateMemoryManager().addResident(this, nNewBytes);
+    }
+
     // Flag if we've now allocated the whole value
     if (offset == 0 && length == sharedMemSize) {
         fullyAllocated = true;
@@ -375,9 +455,10 @@ void StateKeyValue::reserveStorage()
                                      key);
     }
 
-    // Create shared memory region with no permissions
-    sharedMemory = mmap(
-      nullptr, sharedMemSize, PROT_NONE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    // Create shared memory region with no permissions, placed according to
+    // the policy for this size of value
+    AllocationClass allocClass = getAllocationClass(valueSize);
+    sharedMemory = allocateSharedMemory(sharedMemSize, allocClass);
     if (sharedMemory == MAP_FAILED) {
         logger->debug("Mmapping of storage size {} failed. errno: {}",
                       sharedMemSize,
@@ -434,6 +515,10 @@ void StateKeyValue::pushFull()
 
     pushToRemote();
 
+    static faabric::util::Counter& pushBytes =
+      faabric::util::getMetrics().getCounter("state_push_bytes");
+    pushBytes.inc(valueSize);
+
     // Remove any dirty flags
     isDirty = false;
     zeroDirtyMask();
@@ -442,6 +527,7 @@ void StateKeyValue::pushFull()
 void StateKeyValue::doPull(bool lazy)
 {
     checkSizeConfigured();
+    referenced = true;
 
     // Drop out if we already have the data and we don't care about updating
     {
@@ -465,11 +551,16 @@ void StateKeyValue::doPull(bool lazy)
     // Do the pull
     pullFromRemote();
     fullyPulled = true;
+
+    static faabric::util::Counter& pullBytes =
+      faabric::util::getMetrics().getCounter("state_pull_bytes");
+    pullBytes.inc(valueSize);
 }
 
 void StateKeyValue::doPullChunk(bool lazy, long offset, size_t length)
 {
     checkSizeConfigured();
+    referenced = true;
 
     // Check bounds
     size_t chunkEnd = offset + length;
@@ -504,6 +595,10 @@ void StateKeyValue::doPullChunk(bool lazy, long offset, size_t length)
     // Pull from remote
     pullChunkFromRemote(offset, length);
 
+    static faabric::util::Counter& pullBytes =
+      faabric::util::getMetrics().getCounter("state_pull_bytes");
+    pullBytes.inc(length);
+
     // Mark the chunk as pulled
     memset(BYTES(pulledMask) + offset, ONES_BITMASK, length);
 }
@@ -534,6 +629,12 @@ void StateKeyValue::doPushPartial(const uint8_t* dirtyMaskBytes)
     // Push
     pushPartialToRemote(chunks);
 
+    static faabric::util::Counter& pushBytes =
+      faabric::util::getMetrics().getCounter("state_push_bytes");
+    for (const auto& c : chunks) {
+        pushBytes.inc(c.length);
+    }
+
     // Update if necessary
     if (fullyAllocated) {
         pullFromRemote();
@@ -543,6 +644,50 @@ void StateKeyValue::doPushPartial(const uint8_t* dirtyMaskBytes)
     isDirty = false;
 }
 
+size_t StateKeyValue::evict()
+{
+    if (!evictable || sharedMemory == nullptr) {
+        return 0;
+    }
+
+    // Skip rather than wait if the value is in use. Pins, reads and mappings
+    // are only added under the lock, so must be checked while holding it.
+    FullLock lock(valueMutex, std::try_to_lock);
+    if (!lock.owns_lock() || pinned || nMappings > 0 || nActiveReads > 0 ||
+        isDirty || residentSize == 0) {
+        return 0;
+    }
+
+    // Release the pages, then mark everything as needing to be pulled again.
+    // Note that the whole range must be writable to remove it
+    int res = mprotect(sharedMemory, sharedMemSize, PROT_WRITE);
+    if (res == 0) {
+        res = madvise(sharedMemory, sharedMemSize, MADV_REMOVE);
+    }
+
+    if (res != 0) {
+        logger->warn("Failed to evict {}/{}: {} ({})",
+                     user,
+                     key,
+                     errno,
+                     strerror(errno));
+        return 0;
+    }
+
+    mprotect(sharedMemory, sharedMemSize, PROT_NONE);
+
+    memset(pulledMask, 0, valueSize);
+    std::fill(allocatedPages.begin(), allocatedPages.end(), 0);
+    fullyPulled = false;
+    fullyAllocated = false;
+
+    logger->debug("Evicted {} bytes of {}/{}", residentSize, user, key);
+
+    size_t freed = residentSize;
+    residentSize = 0;
+    return freed;
+}
+
 uint32_t StateKeyValue::waitOnRedisRemoteLock(const std::string& redisKey)
 {
     PROF_START(remoteLock)
@@ -550,24 +695,49 @@ uint32_t StateKeyValue::waitOnRedisRemoteLock(const std::string& redisKey)
     redis::Redis& redis = redis::Redis::getState();
     uint32_t remoteLockId =
       redis.acquireLock(redisKey, REMOTE_LOCK_TIMEOUT_SECS);
+    if (remoteLockId > 0) {
+        PROF_END(remoteLock)
+        return remoteLockId;
+    }
+
+    // Register as a waiter so the holder knows to hand the lock back. The
+    // count expires in case a waiter dies before deregistering.
+    std::string waitersKey = redisKey + "_lock_waiters";
+    redis.incr(waitersKey);
+    redis.expire(waitersKey,
+                 REMOTE_LOCK_TIMEOUT_SECS * (REMOTE_LOCK_MAX_RETRIES + 1));
+
     unsigned int retryCount = 0;
-    while (remoteLockId == 0) {
-        const std::shared_ptr<spdlog::logger>& logger =
-          faabric::util::getLogger();
-        logger->debug(
-          "Waiting on remote lock for {} (loop {})", redisKey, retryCount);
-
-        if (retryCount >= REMOTE_LOCK_MAX_RETRIES) {
-            logger->error("Timed out waiting for lock on {}", redisKey);
-            break;
-        }
+    try {
+        while (remoteLockId == 0) {
+            const std::shared_ptr<spdlog::logger>& logger =
+              faabric::util::getLogger();
+            logger->debug(
+              "Waiting on remote lock for {} (loop {})", redisKey, retryCount);
+
+            if (retryCount >= REMOTE_LOCK_MAX_RETRIES) {
+                logger->error("Timed out waiting for lock on {}", redisKey);
+                break;
+            }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            // Block until the holder releases the lock or it expires
+            redis.waitOnLockRelease(redisKey, REMOTE_LOCK_TIMEOUT_SECS * 1000);
 
-        remoteLockId = redis.acquireLock(redisKey, REMOTE_LOCK_TIMEOUT_SECS);
-        retryCount++;
+            remoteLockId =
+              redis.acquireLock(redisKey, REMOTE_LOCK_TIMEOUT_SECS);
+            retryCount++;
+        }
+    } catch (...) {
+        // Don't leave holders thinking someone is still waiting
+        try {
+            redis.decr(waitersKey);
+        } catch (...) {
+        }
+        throw;
     }
 
+    redis.decr(waitersKey);
+
     PROF_END(remoteLock)
     return remoteLockId;
 }
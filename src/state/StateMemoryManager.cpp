@@ -0,0 +1,90 @@
+#include <faabric/state/StateMemoryManager.h>
+
+#include <faabric/state/StateKeyValue.h>
+#include <faabric/util/config.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+
+namespace faabric::state {
+StateMemoryManager& getStateMemoryManager()
+{
+    static StateMemoryManager manager;
+    return manager;
+}
+
+void StateMemoryManager::registerKV(StateKeyValue* kv)
+{
+    faabric::util::UniqueLock lock(managerMutex);
+    kvs.push_back(kv);
+}
+
+void StateMemoryManager::unregisterKV(StateKeyValue* kv)
+{
+    faabric::util::UniqueLock lock(managerMutex);
+
+    auto it = std::find(kvs.begin(), kvs.end(), kv);
+    if (it != kvs.end()) {
+        kvs.erase(it);
+    }
+
+    residentBytes -= kv->residentSize;
+}
+
+void StateMemoryManager::addResident(StateKeyValue* kv, size_t nBytes)
+{
+    residentBytes += nBytes;
+
+    size_t budget =
+      (size_t)faabric::util::getSystemConfig().stateMemoryBudgetMb * 1024 *
+      1024;
+    if (budget == 0 || residentBytes <= budget) {
+        return;
+    }
+
+    faabric::util::UniqueLock lock(managerMutex);
+
+    // Sweep at most twice round the clock, giving recently used key-values a
+    // second chance on the first pass
+    size_t maxSteps = 2 * kvs.size();
+    for (size_t i = 0; i < maxSteps && residentBytes > budget; i++) {
+        clockHand %= kvs.size();
+        StateKeyValue* victim = kvs.at(clockHand);
+        clockHand++;
+
+        if (victim == kv || victim->referenced.exchange(false)) {
+            continue;
+        }
+
+        size_t freed = victim->evict();
+        if (freed > 0) {
+            residentBytes -= freed;
+            evictedBytes += freed;
+            evictionCount++;
+        }
+    }
+
+    if (residentBytes > budget) {
+        faabric::util::getLogger()->debug(
+          "State memory over budget after eviction ({} > {})",
+          residentBytes,
+          budget);
+    }
+}
+
+size_t StateMemoryManager::getResidentBytes()
+{
+    return residentBytes;
+}
+
+size_t StateMemoryManager::getEvictionCount()
+{
+    return evictionCount;
+}
+
+size_t StateMemoryManager::getEvictedBytes()
+{
+    return evictedBytes;
+}
+}
@@ -181,7 +181,13 @@ Status StateServer::Lock(grpc::ServerContext* context,
       "Lock {}/{}", request->user(), request->key());
 
     KV_FROM_REQUEST(request)
-    kv->lockWrite();
+    StateLease lease = kv->acquireLease(request->host(), true);
+
+    response->set_user(request->user());
+    response->set_key(request->key());
+    response->set_leaseid(lease.id);
+    response->set_leasems(lease.leaseMs);
+    response->set_contended(lease.contended);
 
     return Status::OK;
 }
@@ -194,7 +200,27 @@ Status StateServer::Unlock(grpc::ServerContext* context,
       "Unlock {}/{}", request->user(), request->key());
 
     KV_FROM_REQUEST(request)
-    kv->unlockWrite();
+    kv->releaseLease(request->host(), request->leaseid());
+
+    return Status::OK;
+}
+
+Status StateServer::ReleaseLease(grpc::ServerContext* context,
+                                 const faabric::StateRequest* request,
+                                 faabric::StateResponse* response)
+{
+    faabric::util::getLogger()->debug("Release lease {}/{} ({})",
+                                      request->user(),
+                                      request->key(),
+                                      request->leaseid());
+
+    KV_FROM_REQUEST(request)
+    int timeoutMs = faabric::util::getSystemConfig().stateLockLeaseMs;
+    bool released = kv->revokeLease(request->leaseid(), timeoutMs);
+
+    response->set_user(request->user());
+    response->set_key(request->key());
+    response->set_released(released);
 
     return Status::OK;
 }
@@ -34,15 +34,42 @@ void SystemConfig::initialise()
     wasmVm = getEnvVar("WASM_VM", "wavm");
     deltaSnapshotEncoding =
       getEnvVar("DELTA_SNAPSHOT_ENCODING", "pages=4096;xor;zstd=1");
+    memoryAllocPolicy =
+      AllocationPolicy(getEnvVar("MEMORY_ALLOC_POLICY", ""));
 
     // Redis
     redisStateHost = getEnvVar("REDIS_STATE_HOST", "localhost");
     redisQueueHost = getEnvVar("REDIS_QUEUE_HOST", "localhost");
     redisPort = getEnvVar("REDIS_PORT", "6379");
+    redisStateChunkSize =
+      this->getSystemConfIntParam("REDIS_STATE_CHUNK_SIZE", "65536");
+    redisStateWindow = this->getSystemConfIntParam("REDIS_STATE_WINDOW", "32");
+    redisStateConnections =
+      this->getSystemConfIntParam("REDIS_STATE_CONNECTIONS", "4");
+
+    // State
+    stateLockLeaseMs =
+      this->getSystemConfIntParam("STATE_LOCK_LEASE_MS", "100");
+    stateMemoryBudgetMb =
+      this->getSystemConfIntParam("STATE_MEMORY_BUDGET_MB", "0");
 
     // Scheduling
     noScheduler = this->getSystemConfIntParam("NO_SCHEDULER", "0");
     overrideCpuCount = this->getSystemConfIntParam("OVERRIDE_CPU_COUNT", "0");
+    placementPolicy = getEnvVar("PLACEMENT_POLICY", "greedy");
+    executorWarmCacheSize =
+      this->getSystemConfIntParam("EXECUTOR_WARM_CACHE_SIZE", "10");
+    executorLocalQueueSize =
+      this->getSystemConfIntParam("EXECUTOR_LOCAL_QUEUE_SIZE", "4");
+    executorBatchSize =
+      this->getSystemConfIntParam("EXECUTOR_BATCH_SIZE", "1");
+    prewarmMode = getEnvVar("PREWARM_MODE", "off");
+    prewarmMinExecutors =
+      this->getSystemConfIntParam("PREWARM_MIN_EXECUTORS", "0");
+    prewarmHeadroomPct =
+      this->getSystemConfIntParam("PREWARM_HEADROOM_PCT", "50");
+    prewarmIntervalMs =
+      this->getSystemConfIntParam("PREWARM_INTERVAL_MS", "100");
 
     // Worker-related timeouts (all in seconds)
     globalMessageTimeout =
@@ -64,6 +91,13 @@ void SystemConfig::initialise()
     // MPI
     defaultMpiWorldSize =
       this->getSystemConfIntParam("DEFAULT_MPI_WORLD_SIZE", "5");
+    mpiShmTransport = getEnvVar("MPI_SHM_TRANSPORT", "off");
+
+    // Tracing
+    traceMode = getEnvVar("TRACE_MODE", "off");
+    traceFile = getEnvVar("TRACE_FILE", "/tmp/faabric_traces.json");
+    traceCollectorUrl =
+      getEnvVar("TRACE_COLLECTOR_URL", "http://localhost:4318/v1/traces");
 
     // Endpoint
     endpointInterface = getEnvVar("ENDPOINT_INTERFACE", "");
@@ -71,6 +105,12 @@ void SystemConfig::initialise()
     endpointPort = this->getSystemConfIntParam("ENDPOINT_PORT", "8080");
     endpointNumThreads =
       this->getSystemConfIntParam("ENDPOINT_NUM_THREADS", "4");
+    endpointResultPollMs =
+      this->getSystemConfIntParam("ENDPOINT_RESULT_POLL_MS", "5");
+    endpointBacklog = this->getSystemConfIntParam("ENDPOINT_BACKLOG", "1024");
+    endpointMaxRequestSize =
+      this->getSystemConfIntParam("ENDPOINT_MAX_REQUEST_SIZE", "16777216");
+    endpointPinThreads = getEnvVar("ENDPOINT_PIN_THREADS", "off");
 
     if (endpointHost.empty()) {
         // Get the IP for this host
@@ -110,15 +150,32 @@ void SystemConfig::print()
     logger->info("STATE_MODE                 {}", stateMode);
     logger->info("WASM_VM                    {}", wasmVm);
     logger->info("DELTA_SNAPSHOT_ENCODING    {}", deltaSnapshotEncoding);
+    logger->info("MEMORY_ALLOC_POLICY        {}",
+                 memoryAllocPolicy.toString());
 
     logger->info("--- Redis ---");
     logger->info("REDIS_STATE_HOST           {}", redisStateHost);
     logger->info("REDIS_QUEUE_HOST           {}", redisQueueHost);
     logger->info("REDIS_PORT                 {}", redisPort);
+    logger->info("REDIS_STATE_CHUNK_SIZE     {}", redisStateChunkSize);
+    logger->info("REDIS_STATE_WINDOW         {}", redisStateWindow);
+    logger->info("REDIS_STATE_CONNECTIONS    {}", redisStateConnections);
+
+    logger->info("--- State ---");
+    logger->info("STATE_LOCK_LEASE_MS        {}", stateLockLeaseMs);
+    logger->info("STATE_MEMORY_BUDGET_MB     {}", stateMemoryBudgetMb);
 
     logger->info("--- Scheduling ---");
     logger->info("NO_SCHEDULER               {}", noScheduler);
     logger->info("OVERRIDE_CPU_COUNT         {}", overrideCpuCount);
+    logger->info("PLACEMENT_POLICY           {}", placementPolicy);
+    logger->info("EXECUTOR_WARM_CACHE_SIZE   {}", executorWarmCacheSize);
+    logger->info("EXECUTOR_LOCAL_QUEUE_SIZE  {}", executorLocalQueueSize);
+    logger->info("EXECUTOR_BATCH_SIZE        {}", executorBatchSize);
+    logger->info("PREWARM_MODE               {}", prewarmMode);
+    logger->info("PREWARM_MIN_EXECUTORS      {}", prewarmMinExecutors);
+    logger->info("PREWARM_HEADROOM_PCT       {}", prewarmHeadroomPct);
+    logger->info("PREWARM_INTERVAL_MS        {}", prewarmIntervalMs);
 
     logger->info("--- Timeouts ---");
     logger->info("GLOBAL_MESSAGE_TIMEOUT     {}", globalMessageTimeout);
@@ -135,11 +192,21 @@ void SystemConfig::print()
 
     logger->info("--- MPI ---");
     logger->info("DEFAULT_MPI_WORLD_SIZE  {}", defaultMpiWorldSize);
+    logger->info("MPI_SHM_TRANSPORT       {}", mpiShmTransport);
+
+    logger->info("--- Tracing ---");
+    logger->info("TRACE_MODE                 {}", traceMode);
+    logger->info("TRACE_FILE                 {}", traceFile);
+    logger->info("TRACE_COLLECTOR_URL        {}", traceCollectorUrl);
 
     logger->info("--- Endpoint ---");
     logger->info("ENDPOINT_INTERFACE         {}", endpointInterface);
     logger->info("ENDPOINT_HOST              {}", endpointHost);
     logger->info("ENDPOINT_PORT              {}", endpointPort);
     logger->info("ENDPOINT_NUM_THREADS       {}", endpointNumThreads);
+    logger->info("ENDPOINT_RESULT_POLL_MS    {}", endpointResultPollMs);
+    logger->info("ENDPOINT_BACKLOG           {}", endpointBacklog);
+    logger->info("ENDPOINT_MAX_REQUEST_SIZE  {}", endpointMaxRequestSize);
+    logger->info("ENDPOINT_PIN_THREADS       {}", endpointPinThreads);
 }
 }
@@ -1,6 +1,9 @@
 #include <faabric/util/config.h>
 #include <faabric/util/environment.h>
 
+#include <faabric/util/logging.h>
+
+#include <pthread.h>
 #include <thread>
 
 namespace faabric::util {
@@ -52,4 +55,21 @@ unsigned int getUsableCores()
 
     return nCores;
 }
+
+/**
+ * Restricts the calling thread to the given core.
+ */
+void pinThreadToCore(unsigned int core)
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+
+    int res = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (res != 0) {
+        const std::shared_ptr<spdlog::logger>& logger = getLogger();
+        logger->error("Failed to pin thread to core {} ({})", core, res);
+        throw std::runtime_error("Failed to pin thread to core");
+    }
+}
 }
@@ -75,4 +75,46 @@ std::vector<uint8_t> readFileFromUrlWithHeader(
 
     return faabric::util::stringToBytes(out.str());
 }
+
+void postToUrl(const std::string& url,
+               const std::string& body,
+               const std::string& contentType)
+{
+    Http::Client client;
+    client.init();
+
+    auto rb = client.post(url);
+    rb.header<Http::Header::ContentType>(Http::Mime::MediaType(contentType));
+
+    Async::Promise<Http::Response> resp =
+      rb.body(body)
+        .timeout(std::chrono::milliseconds(HTTP_FILE_TIMEOUT))
+        .send();
+
+    Http::Code respCode;
+    bool success = true;
+    resp.then(
+      [&](Http::Response response) {
+          respCode = response.code();
+          success = static_cast<int>(respCode) < 300;
+      },
+      [&](std::exception_ptr exc) {
+          PrintException excPrinter;
+          excPrinter(exc);
+          success = false;
+      });
+
+    // Make calls synchronous
+    Async::Barrier<Http::Response> barrier(resp);
+    std::chrono::milliseconds timeout(HTTP_FILE_TIMEOUT);
+    barrier.wait_for(timeout);
+
+    client.shutdown();
+
+    if (!success) {
+        std::string msg =
+          fmt::format("Error posting to {} ({})", url, respCode);
+        throw FaabricHttpException(msg);
+    }
+}
 }
@@ -8,6 +8,10 @@
 
 #include <cppcodec/base64_rfc4648.hpp>
 
+// Size of each thread's buffer for parsed JSON nodes. Larger documents spill
+// over into the heap.
+#define JSON_PARSE_BUFFER_SIZE 8192
+
 using namespace rapidjson;
 
 namespace faabric::util {
@@ -275,13 +279,27 @@ std::string getStringFromJson(Document& doc,
 }
 
 faabric::Message jsonToMessage(const std::string& jsonIn)
+{
+    std::string buffer = jsonIn;
+    return jsonToMessageInPlace(buffer);
+}
+
+faabric::Message jsonToMessageInPlace(std::string& jsonIn)
 {
     PROF_START(jsonDecode)
     auto logger = faabric::util::getLogger();
 
-    MemoryStream ms(jsonIn.c_str(), jsonIn.size());
-    Document d;
-    d.ParseStream(ms);
+    // Strings are left in the input and nodes come from a reused per-thread
+    // buffer, so parsing a typical message doesn't allocate
+    static thread_local char parseBuffer[JSON_PARSE_BUFFER_SIZE];
+    MemoryPoolAllocator<> allocator(parseBuffer, sizeof(parseBuffer));
+    Document d(&allocator);
+    d.ParseInsitu(jsonIn.data());
+
+    if (d.HasParseError() || !d.IsObject()) {
+        logger->error("Invalid JSON message at offset {}", d.GetErrorOffset());
+        throw std::runtime_error("Invalid JSON message");
+    }
 
     faabric::Message msg;
 
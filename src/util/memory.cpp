@@ -1,6 +1,16 @@
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
 #include <faabric/util/memory.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <linux/mempolicy.h>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 namespace faabric::util {
 bool isPageAligned(void* ptr)
@@ -57,4 +67,228 @@ AlignedChunk getPageAlignedChunk(long offset, long length)
 
     return c;
 }
+
+// ----------------------------------------
+// Allocation policies
+// ----------------------------------------
+
+AllocationPolicy::AllocationPolicy(const std::string& definition)
+{
+    std::stringstream ss(definition);
+    std::string part;
+    while (std::getline(ss, part, ';')) {
+        if (part.empty()) {
+            continue;
+        }
+
+        size_t sep = part.find(':');
+        if (sep == std::string::npos) {
+            throw std::invalid_argument(
+              std::string("Invalid allocation policy class: ") + part);
+        }
+
+        AllocationClass cls;
+        cls.minSize = std::stoul(part.substr(0, sep));
+
+        std::stringstream optStream(part.substr(sep + 1));
+        std::string opt;
+        while (std::getline(optStream, opt, ',')) {
+            if (opt == "none") {
+                cls.hugePages = HugePageMode::None;
+                cls.numa = NumaMode::Default;
+            } else if (opt == "thp") {
+                cls.hugePages = HugePageMode::Transparent;
+            } else if (opt == "hugetlb") {
+                cls.hugePages = HugePageMode::Explicit;
+            } else if (opt == "local") {
+                cls.numa = NumaMode::Local;
+            } else if (opt == "interleave") {
+                cls.numa = NumaMode::Interleave;
+            } else if (std::string_view pfx = "node=";
+                       opt.find(pfx.data(), 0) == 0) {
+                cls.numa = NumaMode::Bind;
+                cls.numaNode = std::stoi(opt.substr(pfx.size()));
+
+                if (cls.numaNode < 0 ||
+                    cls.numaNode >= (int)(8 * sizeof(unsigned long))) {
+                    throw std::invalid_argument(
+                      std::string("Invalid NUMA node: ") + opt);
+                }
+            } else {
+                throw std::invalid_argument(
+                  std::string("Invalid allocation policy option: ") + opt);
+            }
+        }
+
+        classes.push_back(cls);
+    }
+
+    std::sort(classes.begin(),
+              classes.end(),
+              [](const AllocationClass& a, const AllocationClass& b) {
+                  return a.minSize < b.minSize;
+              });
+}
+
+AllocationClass AllocationPolicy::getClass(size_t size) const
+{
+    // Take the largest class this size falls into
+    AllocationClass result;
+    for (const auto& cls : classes) {
+        if (size >= cls.minSize) {
+            result = cls;
+        }
+    }
+
+    return result;
+}
+
+std::string AllocationPolicy::toString() const
+{
+    std::stringstream ss;
+    for (const auto& cls : classes) {
+        ss << cls.minSize << ':';
+
+        std::vector<std::string> opts;
+        if (cls.hugePages == HugePageMode::Transparent) {
+            opts.emplace_back("thp");
+        } else if (cls.hugePages == HugePageMode::Explicit) {
+            opts.emplace_back("hugetlb");
+        }
+
+        if (cls.numa == NumaMode::Local) {
+            opts.emplace_back("local");
+        } else if (cls.numa == NumaMode::Interleave) {
+            opts.emplace_back("interleave");
+        } else if (cls.numa == NumaMode::Bind) {
+            opts.emplace_back("node=" + std::to_string(cls.numaNode));
+        }
+
+        if (opts.empty()) {
+            opts.emplace_back("none");
+        }
+
+        for (size_t i = 0; i < opts.size(); i++) {
+            ss << (i > 0 ? "," : "") << opts.at(i);
+        }
+        ss << ';';
+    }
+
+    return ss.str();
+}
+
+size_t getHugePageAlignedSize(size_t size)
+{
+    return ((size + DEFAULT_HUGE_PAGE_SIZE - 1) / DEFAULT_HUGE_PAGE_SIZE) *
+           DEFAULT_HUGE_PAGE_SIZE;
+}
+
+AllocationClass getAllocationClass(size_t size)
+{
+    return getSystemConfig().memoryAllocPolicy.getClass(size);
+}
+
+void* allocateSharedMemory(size_t size, const AllocationClass& cls)
+{
+    // Callers protect and remap this memory at host page granularity, which
+    // explicit huge pages don't support, so they get transparent huge pages
+    // instead (see applyAllocationClass)
+    void* ptr =
+      mmap(nullptr, size, PROT_NONE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return ptr;
+    }
+
+    applyAllocationClass(ptr, size, cls);
+
+    return ptr;
+}
+
+int createMemoryFd(const std::string& name,
+                   size_t size,
+                   const AllocationClass& cls,
+                   bool& isHugeTlb)
+{
+    auto logger = getLogger();
+    isHugeTlb = false;
+
+    if (cls.hugePages == HugePageMode::Explicit) {
+        // Huge page files must be sized in whole huge pages
+        size_t hugeSize = getHugePageAlignedSize(size);
+
+        int fd = ::memfd_create(name.c_str(), MFD_HUGETLB);
+        if (fd >= 0 && ::ftruncate(fd, hugeSize) == 0) {
+            isHugeTlb = true;
+            return fd;
+        }
+
+        logger->debug("Huge page fd for {} failed: {} ({})",
+                      name,
+                      errno,
+                      ::strerror(errno));
+
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    int fd = ::memfd_create(name.c_str(), 0);
+    if (fd < 0 || ::ftruncate(fd, size) != 0) {
+        logger->error("Creating memory fd for {} failed: {} ({})",
+                      name,
+                      errno,
+                      ::strerror(errno));
+        throw std::runtime_error("Failed creating memory fd");
+    }
+
+    return fd;
+}
+
+void applyAllocationClass(void* ptr, size_t size, const AllocationClass& cls)
+{
+    auto logger = getLogger();
+
+    // Failures here aren't fatal, e.g. if THP or NUMA are unavailable
+    if (cls.hugePages != HugePageMode::None) {
+        if (::madvise(ptr, size, MADV_HUGEPAGE) != 0) {
+            logger->debug("MADV_HUGEPAGE failed: {} ({})",
+                          errno,
+                          ::strerror(errno));
+        }
+    }
+
+    if (cls.numa == NumaMode::Default) {
+        return;
+    }
+
+    int mode = MPOL_DEFAULT;
+    unsigned long nodeMask = 0;
+    if (cls.numa == NumaMode::Local) {
+        // Place pages on the node of the thread that first touches them
+        mode = MPOL_LOCAL;
+    } else if (cls.numa == NumaMode::Interleave) {
+        // Interleave over all the nodes we're allowed to use
+        mode = MPOL_INTERLEAVE;
+        ::syscall(SYS_get_mempolicy,
+                  nullptr,
+                  &nodeMask,
+                  8 * sizeof(nodeMask) + 1,
+                  nullptr,
+                  MPOL_F_MEMS_ALLOWED);
+    } else if (cls.numa == NumaMode::Bind) {
+        mode = MPOL_BIND;
+        nodeMask = 1UL << cls.numaNode;
+    }
+
+    long res = ::syscall(SYS_mbind,
+                         ptr,
+                         size,
+                         mode,
+                         nodeMask == 0 ? nullptr : &nodeMask,
+                         nodeMask == 0 ? 0 : 8 * sizeof(nodeMask) + 1,
+                         0);
+    if (res != 0) {
+        logger->debug("NUMA binding failed: {} ({})", errno, ::strerror(errno));
+    }
+}
 }
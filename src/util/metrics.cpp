@@ -0,0 +1,480 @@
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/metrics.h>
+#include <faabric/util/timing.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace faabric::util {
+
+// Threads are spread over the shards in the order they first record a metric
+static std::atomic<size_t> nextShard = 0;
+
+static size_t getThreadShard()
+{
+    static thread_local size_t shard = nextShard.fetch_add(1);
+    return shard;
+}
+
+// ----------------------------------
+// Counter
+// ----------------------------------
+
+void Counter::inc(uint64_t n)
+{
+    shards[getThreadShard() % METRICS_SHARDS].value.fetch_add(
+      n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t total = 0;
+    for (const auto& s : shards) {
+        total += s.value.load(std::memory_order_relaxed);
+    }
+
+    return total;
+}
+
+void Counter::reset()
+{
+    for (auto& s : shards) {
+        s.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+// ----------------------------------
+// Gauge
+// ----------------------------------
+
+void Gauge::set(int64_t value)
+{
+    v.store(value, std::memory_order_relaxed);
+}
+
+void Gauge::inc(int64_t n)
+{
+    v.fetch_add(n, std::memory_order_relaxed);
+}
+
+void Gauge::dec(int64_t n)
+{
+    v.fetch_sub(n, std::memory_order_relaxed);
+}
+
+int64_t Gauge::value() const
+{
+    return v.load(std::memory_order_relaxed);
+}
+
+// ----------------------------------
+// Histogram
+// ----------------------------------
+
+size_t Histogram::getBucketIndex(uint64_t value)
+{
+    // Small values get a bucket each
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return value;
+    }
+
+    // Otherwise the top bits pick the power of two and the sub-bucket
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - HISTOGRAM_SUB_BITS;
+    size_t sub = (value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1);
+
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::getBucketUpperBound(size_t idx)
+{
+    if (idx < HISTOGRAM_SUB_BUCKETS) {
+        return idx;
+    }
+
+    int shift = (int)(idx / HISTOGRAM_SUB_BUCKETS) - 1;
+    uint64_t sub = idx % HISTOGRAM_SUB_BUCKETS;
+    uint64_t lower = (HISTOGRAM_SUB_BUCKETS + sub) << shift;
+
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+    Shard& shard = shards[getThreadShard() % HISTOGRAM_SHARDS];
+    shard.buckets[getBucketIndex(value)].fetch_add(1,
+                                                   std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+
+    // Only contended when the max changes
+    uint64_t currentMax = max.load(std::memory_order_relaxed);
+    while (value > currentMax &&
+           !max.compare_exchange_weak(
+             currentMax, value, std::memory_order_relaxed)) {
+        ;
+    }
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot snap;
+    snap.buckets.resize(HISTOGRAM_BUCKETS, 0);
+
+    for (const auto& shard : shards) {
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            snap.buckets[i] +=
+              shard.buckets[i].load(std::memory_order_relaxed);
+        }
+
+        snap.count += shard.count.load(std::memory_order_relaxed);
+        snap.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+
+    snap.max = max.load(std::memory_order_relaxed);
+
+    return snap;
+}
+
+uint64_t Histogram::getCount() const
+{
+    uint64_t count = 0;
+    for (const auto& shard : shards) {
+        count += shard.count.load(std::memory_order_relaxed);
+    }
+
+    return count;
+}
+
+void Histogram::reset()
+{
+    for (auto& shard : shards) {
+        for (auto& b : shard.buckets) {
+            b.store(0, std::memory_order_relaxed);
+        }
+
+        shard.count.store(0, std::memory_order_relaxed);
+        shard.sum.store(0, std::memory_order_relaxed);
+    }
+
+    max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t HistogramSnapshot::getPercentile(double percentile) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    // Rank of the value we want, counting from one
+    auto target = (uint64_t)((percentile / 100.0) * count + 0.5);
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return std::min(Histogram::getBucketUpperBound(i), max);
+        }
+    }
+
+    return max;
+}
+
+double HistogramSnapshot::getMean() const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    return (double)sum / (double)count;
+}
+
+// ----------------------------------
+// Timer
+// ----------------------------------
+
+ScopedTimer::ScopedTimer(Histogram& histIn)
+  : hist(histIn)
+  , start(startTimer())
+{}
+
+ScopedTimer::~ScopedTimer()
+{
+    hist.record(getTimeDiffMicros(start));
+}
+
+// ----------------------------------
+// Prometheus
+// ----------------------------------
+
+void PrometheusBuilder::addType(const std::string& name, const char* type)
+{
+    if (name == lastName) {
+        return;
+    }
+
+    lastName = name;
+    out += "# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void PrometheusBuilder::addSample(const std::string& name,
+                                  const std::string& labels,
+                                  const std::string& value)
+{
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+void PrometheusBuilder::addCounter(const std::string& name,
+                                   uint64_t value,
+                                   const std::string& labels)
+{
+    std::string cleanName = sanitiseName(name);
+    addType(cleanName, "counter");
+    addSample(cleanName, labels, std::to_string(value));
+}
+
+void PrometheusBuilder::addGauge(const std::string& name,
+                                 int64_t value,
+                                 const std::string& labels)
+{
+    std::string cleanName = sanitiseName(name);
+    addType(cleanName, "gauge");
+    addSample(cleanName, labels, std::to_string(value));
+}
+
+void PrometheusBuilder::addHistogram(const std::string& name,
+                                     const HistogramSnapshot& snap)
+{
+    std::string cleanName = sanitiseName(name);
+    addType(cleanName, "histogram");
+
+    // Emit a cumulative bucket at the end of each power of two, stopping at
+    // the one holding the max. The first group holds the exact small values.
+    const std::string bucketName = cleanName + "_bucket";
+    size_t lastBucket =
+      std::min(snap.buckets.size(), Histogram::getBucketIndex(snap.max) + 1);
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < lastBucket; i++) {
+        cumulative += snap.buckets[i];
+
+        bool endOfGroup = (i % HISTOGRAM_SUB_BUCKETS) ==
+                          (HISTOGRAM_SUB_BUCKETS - 1);
+        if (endOfGroup || i == lastBucket - 1) {
+            uint64_t upper = Histogram::getBucketUpperBound(
+              i | (HISTOGRAM_SUB_BUCKETS - 1));
+            addSample(bucketName,
+                      label("le", std::to_string(upper)),
+                      std::to_string(cumulative));
+        }
+    }
+
+    addSample(bucketName, "le=\"+Inf\"", std::to_string(snap.count));
+    addSample(cleanName + "_sum", "", std::to_string(snap.sum));
+    addSample(cleanName + "_count", "", std::to_string(snap.count));
+}
+
+std::string PrometheusBuilder::str() const
+{
+    return out;
+}
+
+std::string PrometheusBuilder::label(const std::string& name,
+                                     const std::string& value)
+{
+    std::string result = name + "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            result += '\\';
+            result += c;
+        } else if (c == '\n') {
+            result += "\\n";
+        } else {
+            result += c;
+        }
+    }
+
+    result += '"';
+    return result;
+}
+
+std::string PrometheusBuilder::sanitiseName(const std::string& name)
+{
+    std::string result = name;
+    for (size_t i = 0; i < result.size(); i++) {
+        char c = result[i];
+        bool valid = std::isalpha(c) || c == '_' || c == ':' ||
+                     (i > 0 && std::isdigit(c));
+        if (!valid) {
+            result[i] = '_';
+        }
+    }
+
+    return result;
+}
+
+// ----------------------------------
+// Registry
+// ----------------------------------
+
+template<typename T>
+static T& getOrCreate(std::shared_mutex& mx,
+                      std::unordered_map<std::string, std::unique_ptr<T>>& map,
+                      const std::string& name)
+{
+    {
+        SharedLock lock(mx);
+        auto it = map.find(name);
+        if (it != map.end()) {
+            return *it->second;
+        }
+    }
+
+    FullLock lock(mx);
+    std::unique_ptr<T>& ptr = map[name];
+    if (ptr == nullptr) {
+        ptr = std::make_unique<T>();
+    }
+
+    return *ptr;
+}
+
+Counter& MetricsRegistry::getCounter(const std::string& name)
+{
+    return getOrCreate(mx, counters, name);
+}
+
+Gauge& MetricsRegistry::getGauge(const std::string& name)
+{
+    return getOrCreate(mx, gauges, name);
+}
+
+Histogram& MetricsRegistry::getHistogram(const std::string& name)
+{
+    return getOrCreate(mx, histograms, name);
+}
+
+std::map<std::string, uint64_t> MetricsRegistry::getCounterValues()
+{
+    SharedLock lock(mx);
+
+    std::map<std::string, uint64_t> values;
+    for (auto& p : counters) {
+        values[p.first] = p.second->value();
+    }
+
+    return values;
+}
+
+std::map<std::string, int64_t> MetricsRegistry::getGaugeValues()
+{
+    SharedLock lock(mx);
+
+    std::map<std::string, int64_t> values;
+    for (auto& p : gauges) {
+        values[p.first] = p.second->value();
+    }
+
+    return values;
+}
+
+std::map<std::string, HistogramSnapshot>
+MetricsRegistry::getHistogramSnapshots()
+{
+    SharedLock lock(mx);
+
+    std::map<std::string, HistogramSnapshot> snaps;
+    for (auto& p : histograms) {
+        snaps[p.first] = p.second->snapshot();
+    }
+
+    return snaps;
+}
+
+void MetricsRegistry::printMetrics()
+{
+    printf("---------- METRICS ----------\n");
+    for (auto& p : getCounterValues()) {
+        printf("%-40s %lu\n", p.first.c_str(), p.second);
+    }
+
+    for (auto& p : getGaugeValues()) {
+        printf("%-40s %li\n", p.first.c_str(), p.second);
+    }
+
+    printf("\n%-40s %10s %10s %10s %10s %10s\n",
+           "Histogram",
+           "Count",
+           "Mean",
+           "p50",
+           "p99",
+           "Max");
+    for (auto& p : getHistogramSnapshots()) {
+        const HistogramSnapshot& s = p.second;
+        printf("%-40s %10lu %10.1f %10lu %10lu %10lu\n",
+               p.first.c_str(),
+               s.count,
+               s.getMean(),
+               s.getPercentile(50),
+               s.getPercentile(99),
+               s.max);
+    }
+
+    printf("\n");
+}
+
+void MetricsRegistry::writePrometheus(PrometheusBuilder& builder,
+                                      const std::string& prefix)
+{
+    for (auto& p : getCounterValues()) {
+        builder.addCounter(prefix + p.first, p.second);
+    }
+
+    for (auto& p : getGaugeValues()) {
+        builder.addGauge(prefix + p.first, p.second);
+    }
+
+    for (auto& p : getHistogramSnapshots()) {
+        builder.addHistogram(prefix + p.first, p.second);
+    }
+}
+
+void MetricsRegistry::reset()
+{
+    SharedLock lock(mx);
+
+    for (auto& p : counters) {
+        p.second->reset();
+    }
+
+    for (auto& p : gauges) {
+        p.second->set(0);
+    }
+
+    for (auto& p : histograms) {
+        p.second->reset();
+    }
+}
+
+MetricsRegistry& getMetrics()
+{
+    static MetricsRegistry metrics;
+    return metrics;
+}
+}
@@ -2,8 +2,6 @@
 #include <faabric/util/timing.h>
 
 faabric::util::TimePoint globalStart;
-std::unordered_map<std::string, std::atomic<long>> timerTotals;
-std::unordered_map<std::string, std::atomic<int>> timerCounts;
 
 namespace faabric::util {
 faabric::util::TimePoint startTimer()
@@ -37,13 +35,11 @@ double getTimeDiffMillis(const faabric::util::TimePoint& begin)
 void logEndTimer(const std::string& label,
                  const faabric::util::TimePoint& begin)
 {
-    double millis = getTimeDiffMillis(begin);
+    long micros = getTimeDiffMicros(begin);
     const std::shared_ptr<spdlog::logger>& l = faabric::util::getLogger();
-    l->trace("TIME = {:.2f}ms ({})", millis, label);
+    l->trace("TIME = {:.2f}ms ({})", micros / 1000.0, label);
 
-    // Record microseconds total
-    timerTotals[label] += long(millis * 1000L);
-    timerCounts[label]++;
+    getMetrics().getHistogram(label + "_us").record(micros);
 }
 
 void startGlobalTimer()
@@ -53,28 +49,9 @@ void startGlobalTimer()
 
 void printTimerTotals()
 {
-    // Stop global timer
-    double totalMillis = getTimeDiffMillis(globalStart);
-    double totalSeconds = totalMillis / 1000.0;
-
-    // Switch the pairs so we can use std::sort
-    std::vector<std::pair<long, std::string>> totals;
-    for (auto& p : timerTotals) {
-        totals.push_back({ p.second, p.first });
-    }
-
-    std::sort(totals.begin(), totals.end());
-
-    printf("---------- TIMER TOTALS ----------\n");
-    printf("Total (ms)  Avg (ms)   Count  Label\n");
-    for (auto& p : totals) {
-        double millis = double(p.first) / 1000.0;
-        int count = timerCounts[p.second];
-        double avg = millis / count;
-        printf(
-          "%-11.2f %-10.3f %5i  %s\n", millis, avg, count, p.second.c_str());
-    }
+    double totalSeconds = getTimeDiffMillis(globalStart) / 1000.0;
 
+    getMetrics().printMetrics();
     printf("Total running time: %.2fs\n\n", totalSeconds);
 }
 
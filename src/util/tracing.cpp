@@ -0,0 +1,413 @@
+#include <faabric/util/config.h>
+#include <faabric/util/http.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/metrics.h>
+#include <faabric/util/tracing.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+namespace faabric::util {
+
+// Context of the innermost scoped span on this thread
+static thread_local uint64_t currentTraceId = 0;
+static thread_local uint64_t currentSpanId = 0;
+
+static uint64_t generateId()
+{
+    static thread_local std::mt19937_64 gen(std::random_device{}());
+
+    // Zero means no ID
+    uint64_t id = 0;
+    while (id == 0) {
+        id = gen();
+    }
+
+    return id;
+}
+
+uint64_t getEpochMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// ----------------------------------
+// Encoding
+// ----------------------------------
+
+static void appendJsonString(std::string& out, const std::string& s)
+{
+    out += '"';
+    for (char c : s) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+// OTLP IDs are hex, and trace IDs are 128 bits so we pad ours
+static std::string toHexId(uint64_t id, bool isTraceId)
+{
+    char buf[33];
+    if (isTraceId) {
+        snprintf(buf, sizeof(buf), "%016lx%016lx", 0UL, id);
+    } else {
+        snprintf(buf, sizeof(buf), "%016lx", id);
+    }
+
+    return buf;
+}
+
+std::string spanToJson(const Span& span)
+{
+    std::string out = "{\"traceId\":\"" + toHexId(span.traceId, true) +
+                      "\",\"spanId\":\"" + toHexId(span.spanId, false) + "\"";
+
+    if (span.parentSpanId != 0) {
+        out += ",\"parentSpanId\":\"";
+        out += toHexId(span.parentSpanId, false) + "\"";
+    }
+
+    out += ",\"name\":";
+    appendJsonString(out, span.name);
+
+    // Times are 64-bit so are strings in the JSON encoding
+    out += ",\"kind\":1,\"startTimeUnixNano\":\"" +
+           std::to_string(span.startMicros * 1000) +
+           "\",\"endTimeUnixNano\":\"" + std::to_string(span.endMicros * 1000) +
+           "\",\"attributes\":[";
+
+    std::map<std::string, std::string> attributes = span.attributes;
+    attributes["host"] = span.host;
+
+    bool first = true;
+    for (const auto& p : attributes) {
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+
+        out += "{\"key\":";
+        appendJsonString(out, p.first);
+        out += ",\"value\":{\"stringValue\":";
+        appendJsonString(out, p.second);
+        out += "}}";
+    }
+
+    out += "]}";
+    return out;
+}
+
+// ----------------------------------
+// Exporters
+// ----------------------------------
+
+FileSpanExporter::FileSpanExporter(const std::string& filePath)
+  : out(filePath, std::ios::out | std::ios::app)
+{
+    if (!out.is_open()) {
+        const std::shared_ptr<spdlog::logger>& logger = getLogger();
+        logger->error("Could not open trace file {}", filePath);
+        throw std::runtime_error("Could not open trace file");
+    }
+}
+
+void FileSpanExporter::exportSpans(const std::vector<Span>& spans)
+{
+    std::string lines;
+    for (const auto& s : spans) {
+        lines += spanToJson(s);
+        lines += '\n';
+    }
+
+    std::unique_lock<std::mutex> lock(mx);
+    out << lines;
+    out.flush();
+}
+
+OtlpSpanExporter::OtlpSpanExporter(const std::string& urlIn)
+  : url(urlIn)
+{}
+
+void OtlpSpanExporter::exportSpans(const std::vector<Span>& spans)
+{
+    std::string body =
+      "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":"
+      "\"service.name\",\"value\":{\"stringValue\":\"faabric\"}}]},"
+      "\"scopeSpans\":[{\"scope\":{\"name\":\"faabric\"},\"spans\":[";
+
+    for (size_t i = 0; i < spans.size(); i++) {
+        if (i > 0) {
+            body += ',';
+        }
+        body += spanToJson(spans.at(i));
+    }
+
+    body += "]}]}]}";
+
+    // Losing spans shouldn't take down the caller
+    try {
+        postToUrl(url, body);
+    } catch (FaabricHttpException& e) {
+        const std::shared_ptr<spdlog::logger>& logger = getLogger();
+        logger->warn("Failed to export {} spans: {}", spans.size(), e.what());
+    }
+}
+
+void InMemorySpanExporter::exportSpans(const std::vector<Span>& spansIn)
+{
+    std::unique_lock<std::mutex> lock(mx);
+    spans.insert(spans.end(), spansIn.begin(), spansIn.end());
+}
+
+std::vector<Span> InMemorySpanExporter::getSpans()
+{
+    std::unique_lock<std::mutex> lock(mx);
+    return spans;
+}
+
+void InMemorySpanExporter::clear()
+{
+    std::unique_lock<std::mutex> lock(mx);
+    spans.clear();
+}
+
+// ----------------------------------
+// Tracer
+// ----------------------------------
+
+Tracer::Tracer()
+{
+    std::thread(&Tracer::runExporter, this).detach();
+    reset();
+}
+
+bool Tracer::isEnabled() const
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::setExporter(std::shared_ptr<SpanExporter> exporterIn)
+{
+    flush();
+
+    std::unique_lock<std::mutex> lock(mx);
+    exporter = std::move(exporterIn);
+    enabled = exporter != nullptr;
+}
+
+Span Tracer::startSpan(const std::string& name,
+                       const faabric::TraceContext& parent)
+{
+    Span span;
+    span.name = name;
+    span.host = thisHost;
+    span.spanId = generateId();
+    span.startMicros = getEpochMicros();
+
+    if (parent.traceid() != 0) {
+        span.traceId = parent.traceid();
+        span.parentSpanId = parent.spanid();
+    } else {
+        span.traceId = generateId();
+    }
+
+    return span;
+}
+
+void Tracer::finishSpan(Span& span)
+{
+    span.endMicros = getEpochMicros();
+    recordSpan(span);
+}
+
+void Tracer::recordSpan(Span span)
+{
+    static Counter& droppedSpans =
+      getMetrics().getCounter("trace_dropped_spans");
+
+    std::unique_lock<std::mutex> lock(mx);
+    if (exporter == nullptr) {
+        return;
+    }
+
+    pending.emplace_back(std::move(span));
+    if (pending.size() < TRACE_EXPORT_BATCH_SIZE) {
+        return;
+    }
+
+    // Losing spans is better than holding up the caller
+    if (queued.size() >= TRACE_EXPORT_MAX_QUEUED_BATCHES) {
+        droppedSpans.inc(pending.size());
+        pending.clear();
+        return;
+    }
+
+    queued.emplace_back(exporter, std::vector<Span>());
+    queued.back().second.swap(pending);
+    lock.unlock();
+
+    queuedCv.notify_one();
+}
+
+void Tracer::flush()
+{
+    std::unique_lock<std::mutex> lock(mx);
+    if (exporter != nullptr && !pending.empty()) {
+        queued.emplace_back(exporter, std::vector<Span>());
+        queued.back().second.swap(pending);
+        queuedCv.notify_one();
+    }
+    pending.clear();
+
+    exportedCv.wait(lock, [this] { return queued.empty() && !exporting; });
+}
+
+void Tracer::runExporter()
+{
+    std::unique_lock<std::mutex> lock(mx);
+    while (true) {
+        queuedCv.wait(lock, [this] { return !queued.empty(); });
+
+        std::pair<std::shared_ptr<SpanExporter>, std::vector<Span>> batch =
+          std::move(queued.front());
+        queued.pop_front();
+        exporting = true;
+        lock.unlock();
+
+        try {
+            batch.first->exportSpans(batch.second);
+        } catch (std::exception& e) {
+            const std::shared_ptr<spdlog::logger>& logger = getLogger();
+            logger->error("Failed to export {} spans: {}",
+                          batch.second.size(),
+                          e.what());
+        }
+
+        lock.lock();
+        exporting = false;
+        if (queued.empty()) {
+            exportedCv.notify_all();
+        }
+    }
+}
+
+void Tracer::reset()
+{
+    SystemConfig& conf = getSystemConfig();
+    thisHost = conf.endpointHost;
+
+    std::shared_ptr<SpanExporter> newExporter;
+    if (conf.traceMode == "file") {
+        newExporter = std::make_shared<FileSpanExporter>(conf.traceFile);
+    } else if (conf.traceMode == "otlp") {
+        newExporter =
+          std::make_shared<OtlpSpanExporter>(conf.traceCollectorUrl);
+    } else if (conf.traceMode != "off") {
+        const std::shared_ptr<spdlog::logger>& logger = getLogger();
+        logger->error("Unrecognised trace mode: {}", conf.traceMode);
+        throw std::runtime_error("Unrecognised trace mode");
+    }
+
+    setExporter(newExporter);
+}
+
+Tracer& getTracer()
+{
+    // Leaked so it outlives the detached exporter thread
+    static Tracer* tracer = new Tracer();
+    return *tracer;
+}
+
+faabric::TraceContext getCurrentTraceContext()
+{
+    faabric::TraceContext ctx;
+    ctx.set_traceid(currentTraceId);
+    ctx.set_spanid(currentSpanId);
+    return ctx;
+}
+
+// ----------------------------------
+// Scoped span
+// ----------------------------------
+
+ScopedSpan::ScopedSpan(const char* name, const faabric::TraceContext& parent)
+{
+    Tracer& tracer = getTracer();
+    if (!tracer.isEnabled()) {
+        return;
+    }
+
+    active = true;
+    previousTraceId = currentTraceId;
+    previousSpanId = currentSpanId;
+
+    if (parent.traceid() != 0) {
+        span = tracer.startSpan(name, parent);
+    } else {
+        span = tracer.startSpan(name, getCurrentTraceContext());
+    }
+
+    currentTraceId = span.traceId;
+    currentSpanId = span.spanId;
+}
+
+ScopedSpan::~ScopedSpan()
+{
+    if (!active) {
+        return;
+    }
+
+    currentTraceId = previousTraceId;
+    currentSpanId = previousSpanId;
+
+    getTracer().finishSpan(span);
+}
+
+bool ScopedSpan::isActive() const
+{
+    return active;
+}
+
+faabric::TraceContext ScopedSpan::context() const
+{
+    faabric::TraceContext ctx;
+    if (active) {
+        ctx.set_traceid(span.traceId);
+        ctx.set_spanid(span.spanId);
+    }
+
+    return ctx;
+}
+
+void ScopedSpan::setAttribute(const std::string& key, const std::string& value)
+{
+    if (active) {
+        span.attributes[key] = value;
+    }
+}
+}
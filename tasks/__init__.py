@@ -1,5 +1,6 @@
 from invoke import Collection
 
+from . import bench
 from . import call
 from . import container
 from . import dev
@@ -8,6 +9,7 @@ from . import git
 from . import mpi_native
 
 ns = Collection(
+    bench,
     call,
     container,
     dev,
@@ -0,0 +1,76 @@
+from os import makedirs
+from os.path import exists, join
+from subprocess import run, check_output
+
+from invoke import task
+
+from tasks.util.env import (
+    PROJ_ROOT,
+    FAABRIC_SHARED_BUILD_DIR,
+    FAABRIC_STATIC_BUILD_DIR,
+)
+
+BENCH_RESULTS_DIR = join(PROJ_ROOT, "bench_results")
+
+
+@task(default=True)
+def run_bench(ctx, bench_filter=None, shared=False):
+    """
+    Runs the microbenchmarks, writing JSON results named after the commit
+    """
+    build_dir = (
+        FAABRIC_SHARED_BUILD_DIR if shared else FAABRIC_STATIC_BUILD_DIR
+    )
+
+    if not exists(BENCH_RESULTS_DIR):
+        makedirs(BENCH_RESULTS_DIR)
+
+    commit = (
+        check_output("git rev-parse --short HEAD", shell=True, cwd=PROJ_ROOT)
+        .decode("utf-8")
+        .strip()
+    )
+    out_file = join(BENCH_RESULTS_DIR, "{}.json".format(commit))
+
+    cmd = [
+        join(build_dir, "bin", "faabric_bench"),
+        "--benchmark_out={}".format(out_file),
+        "--benchmark_out_format=json",
+    ]
+
+    if bench_filter:
+        cmd.append("--benchmark_filter={}".format(bench_filter))
+
+    run(" ".join(cmd), check=True, shell=True)
+    print("Results written to {}".format(out_file))
+
+
+@task
+def compare(ctx, before, after, shared=False):
+    """
+    Compares two sets of JSON results with Google Benchmark's compare script
+    """
+    build_dir = (
+        FAABRIC_SHARED_BUILD_DIR if shared else FAABRIC_STATIC_BUILD_DIR
+    )
+    compare_script = join(
+        build_dir, "_deps", "benchmark_ext-src", "tools", "compare.py"
+    )
+
+    run(
+        "python3 {} benchmarks {} {}".format(compare_script, before, after),
+        check=True,
+        shell=True,
+    )
+
+
+@task
+def mpi_osu(ctx, shared=False):
+    """
+    Runs the in-process OSU-style MPI benchmarks
+    """
+    build_dir = (
+        FAABRIC_SHARED_BUILD_DIR if shared else FAABRIC_STATIC_BUILD_DIR
+    )
+
+    run(join(build_dir, "bin", "faabric_mpi_osu"), check=True, shell=True)
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include <faabric/util/delta.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace faabric::util;
+
+namespace bench {
+
+static const std::vector<std::string> deltaConfigs = {
+    "pages=4096;xor;zstd=1",
+    "pages=4096",
+    "pages=4096;zstd=1",
+};
+
+// Builds an old and new value with the given percentage of pages changed
+static void setUpDeltaData(size_t size,
+                           int pctDirty,
+                           std::vector<uint8_t>& oldData,
+                           std::vector<uint8_t>& newData)
+{
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int> byteDist(0, 255);
+    std::uniform_int_distribution<int> pctDist(0, 99);
+
+    oldData.resize(size);
+    for (auto& b : oldData) {
+        b = byteDist(gen);
+    }
+
+    newData = oldData;
+    size_t pageSize = 4096;
+    for (size_t p = 0; p < size; p += pageSize) {
+        if (pctDist(gen) < pctDirty) {
+            size_t end = std::min(p + pageSize, size);
+            for (size_t i = p; i < end; i += 8) {
+                newData[i] = byteDist(gen);
+            }
+        }
+    }
+}
+
+// Args are the value size, percentage of pages changed, and delta config
+static void BM_SerializeDelta(benchmark::State& state)
+{
+    std::vector<uint8_t> oldData;
+    std::vector<uint8_t> newData;
+    setUpDeltaData(state.range(0), state.range(1), oldData, newData);
+
+    DeltaSettings cfg(deltaConfigs.at(state.range(2)));
+    state.SetLabel(cfg.toString());
+
+    size_t deltaSize = 0;
+    for (auto _ : state) {
+        std::vector<uint8_t> delta = serializeDelta(
+          cfg, oldData.data(), oldData.size(), newData.data(), newData.size());
+        deltaSize = delta.size();
+        benchmark::DoNotOptimize(delta);
+    }
+
+    state.SetBytesProcessed(state.iterations() * newData.size());
+    state.counters["delta_bytes"] = deltaSize;
+}
+
+static void BM_ApplyDelta(benchmark::State& state)
+{
+    std::vector<uint8_t> oldData;
+    std::vector<uint8_t> newData;
+    setUpDeltaData(state.range(0), state.range(1), oldData, newData);
+
+    DeltaSettings cfg(deltaConfigs.at(state.range(2)));
+    state.SetLabel(cfg.toString());
+
+    std::vector<uint8_t> delta = serializeDelta(
+      cfg, oldData.data(), oldData.size(), newData.data(), newData.size());
+
+    std::vector<uint8_t> target(oldData.size());
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::memcpy(target.data(), oldData.data(), oldData.size());
+        state.ResumeTiming();
+
+        applyDelta(
+          delta,
+          [&target](uint32_t size) { target.resize(size); },
+          [&target]() { return target.data(); });
+    }
+
+    state.SetBytesProcessed(state.iterations() * newData.size());
+}
+
+static void deltaArgs(benchmark::internal::Benchmark* b)
+{
+    for (long size : { 64L * 1024, 4L * 1024 * 1024 }) {
+        for (long pctDirty : { 1, 25, 100 }) {
+            for (long cfg = 0; cfg < (long)deltaConfigs.size(); cfg++) {
+                b->Args({ size, pctDirty, cfg });
+            }
+        }
+    }
+}
+
+BENCHMARK(BM_SerializeDelta)->Apply(deltaArgs);
+BENCHMARK(BM_ApplyDelta)->Apply(deltaArgs);
+}
@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+
+#include <faabric/mpi/mpi.h>
+#include <faabric/scheduler/MpiWorld.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/func.h>
+#include <faabric/util/gids.h>
+#include <faabric/util/macros.h>
+#include <faabric/util/testing.h>
+
+#include <vector>
+
+using namespace faabric::scheduler;
+
+namespace bench {
+
+// Sets up a world with two ranks on this host. The world's state lives in
+// Redis, so the benchmark is skipped if it isn't available.
+static bool setUpWorld(benchmark::State& state, MpiWorld& world)
+{
+    faabric::util::setMockMode(true);
+
+    faabric::HostResources res;
+    res.set_cores(10);
+    getScheduler().setThisHostResources(res);
+
+    try {
+        faabric::Message msg = faabric::util::messageFactory("mpi", "bench");
+        world.create(msg, (int)faabric::util::generateGid(), 2);
+        world.registerRank(1);
+    } catch (std::exception& e) {
+        state.SkipWithError("Could not create MPI world (is Redis running?)");
+        faabric::util::setMockMode(false);
+        return false;
+    }
+
+    return true;
+}
+
+static void tearDownWorld(MpiWorld& world)
+{
+    world.destroy();
+    getScheduler().reset();
+    faabric::util::setMockMode(false);
+}
+
+// Arg is the message size in bytes
+static void BM_MpiSendRecv(benchmark::State& state)
+{
+    MpiWorld world;
+    if (!setUpWorld(state, world)) {
+        return;
+    }
+
+    int count = state.range(0);
+    std::vector<uint8_t> sendBuffer(count, 1);
+    std::vector<uint8_t> recvBuffer(count);
+
+    for (auto _ : state) {
+        world.send(0, 1, sendBuffer.data(), MPI_BYTE, count);
+        world.recv(1, 0, recvBuffer.data(), MPI_BYTE, count, nullptr);
+    }
+
+    state.SetBytesProcessed(state.iterations() * count);
+    tearDownWorld(world);
+}
+BENCHMARK(BM_MpiSendRecv)->RangeMultiplier(16)->Range(8, 1 << 20);
+
+// Round trip through non-blocking receives posted ahead of the send
+static void BM_MpiIrecvSend(benchmark::State& state)
+{
+    MpiWorld world;
+    if (!setUpWorld(state, world)) {
+        return;
+    }
+
+    int count = state.range(0);
+    std::vector<uint8_t> sendBuffer(count, 1);
+    std::vector<uint8_t> recvBuffer(count);
+
+    for (auto _ : state) {
+        int reqId = world.irecv(0, 1, recvBuffer.data(), MPI_BYTE, count);
+        world.send(0, 1, sendBuffer.data(), MPI_BYTE, count);
+        world.awaitAsyncRequest(reqId);
+    }
+
+    state.SetBytesProcessed(state.iterations() * count);
+    tearDownWorld(world);
+}
+BENCHMARK(BM_MpiIrecvSend)->RangeMultiplier(16)->Range(8, 1 << 20);
+
+// Args are the element count and the datatype (0 for int, 1 for double)
+static void BM_MpiOpReduce(benchmark::State& state)
+{
+    MpiWorld world;
+
+    int count = state.range(0);
+    bool isDouble = state.range(1) == 1;
+    faabric_datatype_t* datatype = isDouble ? MPI_DOUBLE : MPI_INT;
+    state.SetLabel(isDouble ? "double" : "int");
+
+    std::vector<uint8_t> inBuffer(count * datatype->size, 1);
+    std::vector<uint8_t> outBuffer(count * datatype->size, 2);
+
+    for (auto _ : state) {
+        world.op_reduce(
+          MPI_SUM, datatype, count, inBuffer.data(), outBuffer.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * datatype->size);
+}
+BENCHMARK(BM_MpiOpReduce)
+  ->ArgsProduct({ benchmark::CreateRange(16, 1 << 20, 16), { 0, 1 } });
+}
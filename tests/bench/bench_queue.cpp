@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include <faabric/proto/faabric.pb.h>
+#include <faabric/util/queue.h>
+
+#include <thread>
+
+using namespace faabric::util;
+
+namespace bench {
+
+// Enqueues then dequeues a run of messages on a single thread
+static void BM_QueueEnqueueDequeue(benchmark::State& state)
+{
+    Queue<faabric::Message> q;
+    faabric::Message msg;
+    msg.set_user("demo");
+    msg.set_function("echo");
+
+    int nMessages = state.range(0);
+    for (auto _ : state) {
+        for (int i = 0; i < nMessages; i++) {
+            q.enqueue(msg);
+        }
+
+        for (int i = 0; i < nMessages; i++) {
+            benchmark::DoNotOptimize(q.dequeue());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * nMessages);
+}
+BENCHMARK(BM_QueueEnqueueDequeue)->RangeMultiplier(8)->Range(1, 512);
+
+// Dequeues in batches of the given size
+static void BM_QueueDequeueBatch(benchmark::State& state)
+{
+    Queue<faabric::Message> q;
+    faabric::Message msg;
+    msg.set_user("demo");
+    msg.set_function("echo");
+
+    int nMessages = 512;
+    size_t batchSize = state.range(0);
+    for (auto _ : state) {
+        for (int i = 0; i < nMessages; i++) {
+            q.enqueue(msg);
+        }
+
+        while (q.size() > 0) {
+            benchmark::DoNotOptimize(q.dequeueBatch(batchSize));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * nMessages);
+}
+BENCHMARK(BM_QueueDequeueBatch)->RangeMultiplier(4)->Range(1, 64);
+
+// Hands messages from this thread to a consumer on another
+static void BM_QueueHandoff(benchmark::State& state)
+{
+    Queue<int> q;
+    long nMessages = state.max_iterations;
+
+    std::thread consumer([&q, nMessages] {
+        for (long i = 0; i < nMessages; i++) {
+            q.dequeue();
+        }
+    });
+
+    for (auto _ : state) {
+        q.enqueue(1);
+    }
+
+    consumer.join();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_QueueHandoff)->UseRealTime();
+}
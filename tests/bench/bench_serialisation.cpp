@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+
+#include <faabric/util/func.h>
+#include <faabric/util/json.h>
+
+using namespace faabric::util;
+
+namespace bench {
+
+// Arg is the size of the input data
+static faabric::Message benchMessage(size_t inputSize)
+{
+    faabric::Message msg = messageFactory("demo", "echo");
+    msg.set_inputdata(std::string(inputSize, 'a'));
+    msg.set_masterhost("foo");
+    msg.set_isasync(true);
+
+    return msg;
+}
+
+static void BM_MessageToJson(benchmark::State& state)
+{
+    faabric::Message msg = benchMessage(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(messageToJson(msg));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MessageToJson)->Arg(0)->Arg(1024)->Arg(64 * 1024);
+
+static void BM_JsonToMessage(benchmark::State& state)
+{
+    std::string json = messageToJson(benchMessage(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(jsonToMessage(json));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_JsonToMessage)->Arg(0)->Arg(1024)->Arg(64 * 1024);
+
+static void BM_MessageToBytes(benchmark::State& state)
+{
+    faabric::Message msg = benchMessage(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(messageToBytes(msg));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MessageToBytes)->Arg(0)->Arg(1024)->Arg(64 * 1024);
+
+static void BM_MessageFromBytes(benchmark::State& state)
+{
+    std::vector<uint8_t> bytes = messageToBytes(benchMessage(state.range(0)));
+    for (auto _ : state) {
+        faabric::Message msg;
+        msg.ParseFromArray(bytes.data(), (int)bytes.size());
+        benchmark::DoNotOptimize(msg);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MessageFromBytes)->Arg(0)->Arg(1024)->Arg(64 * 1024);
+}
@@ -0,0 +1,113 @@
+#include <benchmark/benchmark.h>
+
+#include <faabric/state/StateKeyValue.h>
+
+#include <vector>
+
+using namespace faabric::state;
+
+namespace bench {
+
+/**
+ * Key-value with no remote, so that only the local chunk tracking is timed.
+ */
+class LocalStateKeyValue final : public StateKeyValue
+{
+  public:
+    explicit LocalStateKeyValue(size_t sizeIn)
+      : StateKeyValue("bench", "local", sizeIn)
+    {}
+
+    void lockGlobal() override {}
+
+    void unlockGlobal() override {}
+
+    size_t nPushedChunks = 0;
+
+  private:
+    void pullFromRemote() override {}
+
+    void pullChunkFromRemote(long offset, size_t length) override {}
+
+    void pushToRemote() override {}
+
+    void appendToRemote(const uint8_t* data, size_t length) override {}
+
+    void pullAppendedFromRemote(uint8_t* data,
+                                size_t length,
+                                long nValues) override
+    {}
+
+    void clearAppendedFromRemote() override {}
+
+    void pushPartialToRemote(
+      const std::vector<StateChunk>& dirtyChunks) override
+    {
+        nPushedChunks += dirtyChunks.size();
+    }
+};
+
+#define BENCH_STATE_SIZE (4 * 1024 * 1024)
+
+// Arg is the chunk size, chunks are spread over the whole value
+static void BM_StateSetChunk(benchmark::State& state)
+{
+    LocalStateKeyValue kv(BENCH_STATE_SIZE);
+    size_t chunkSize = state.range(0);
+    std::vector<uint8_t> chunk(chunkSize, 1);
+
+    long offset = 0;
+    for (auto _ : state) {
+        kv.setChunk(offset, chunk.data(), chunkSize);
+        offset = (offset + 7 * chunkSize) % (BENCH_STATE_SIZE - chunkSize);
+    }
+
+    state.SetBytesProcessed(state.iterations() * chunkSize);
+}
+BENCHMARK(BM_StateSetChunk)->RangeMultiplier(16)->Range(8, 64 * 1024);
+
+static void BM_StateGetChunk(benchmark::State& state)
+{
+    LocalStateKeyValue kv(BENCH_STATE_SIZE);
+    std::vector<uint8_t> value(BENCH_STATE_SIZE, 2);
+    kv.set(value.data());
+
+    size_t chunkSize = state.range(0);
+    std::vector<uint8_t> chunk(chunkSize);
+
+    long offset = 0;
+    for (auto _ : state) {
+        kv.getChunk(offset, chunk.data(), chunkSize);
+        offset = (offset + 7 * chunkSize) % (BENCH_STATE_SIZE - chunkSize);
+    }
+
+    state.SetBytesProcessed(state.iterations() * chunkSize);
+}
+BENCHMARK(BM_StateGetChunk)->RangeMultiplier(16)->Range(8, 64 * 1024);
+
+// Arg is the number of dirty chunks found and pushed on each push
+static void BM_StatePushPartial(benchmark::State& state)
+{
+    LocalStateKeyValue kv(BENCH_STATE_SIZE);
+    std::vector<uint8_t> value(BENCH_STATE_SIZE, 3);
+    kv.set(value.data());
+    kv.pushFull();
+
+    long nChunks = state.range(0);
+    long stride = BENCH_STATE_SIZE / nChunks;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (long i = 0; i < nChunks; i++) {
+            kv.flagChunkDirty(i * stride, 64);
+        }
+        state.ResumeTiming();
+
+        kv.pushPartial();
+    }
+
+    state.counters["chunks"] =
+      benchmark::Counter(kv.nPushedChunks, benchmark::Counter::kAvgIterations);
+    state.SetBytesProcessed(state.iterations() * BENCH_STATE_SIZE);
+}
+BENCHMARK(BM_StatePushPartial)->RangeMultiplier(16)->Range(1, 4096);
+}
@@ -0,0 +1,22 @@
+#include <benchmark/benchmark.h>
+
+#include <faabric/util/logging.h>
+#include <faabric/util/testing.h>
+
+int main(int argc, char** argv)
+{
+    faabric::util::setTestMode(true);
+
+    // Keep logging out of the timings
+    faabric::util::getLogger()->set_level(spdlog::level::off);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
@@ -0,0 +1,575 @@
+#include <faabric/mpi/mpi.h>
+#include <faabric/scheduler/FunctionCallClient.h>
+#include <faabric/scheduler/MpiWorld.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/environment.h>
+#include <faabric/util/func.h>
+#include <faabric/util/gids.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/testing.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+/**
+ * OSU-style point-to-point and collective benchmarks, run in-process against
+ * MpiWorld. Each rank is a thread, and ranks are spread over this host and a
+ * number of mock hosts, each with its own world. Messages to mock hosts go
+ * through the function call client as they would between real hosts.
+ *
+ * The output matches mpi-native/examples/mpi_osu.cpp, which runs the same
+ * benchmarks across containers. Configured through the environment:
+ *
+ * - OSU_HOSTS: hosts including this one
+ * - OSU_RANKS_PER_HOST: ranks on each host
+ * - OSU_MAX_SIZE: largest message size in bytes
+ * - OSU_ITERATIONS: timed iterations for small messages
+ * - OSU_BENCHMARKS: comma-separated benchmarks to run, all by default
+ *
+ * The world's state lives in Redis, so this needs Redis to be running.
+ */
+
+// Messages in flight in each iteration of the bandwidth tests
+#define OSU_WINDOW_SIZE 64
+
+// Messages larger than this run a tenth of the iterations
+#define OSU_LARGE_MESSAGE 8192
+
+#define OSU_HOST_PREFIX "osu-host-"
+
+using namespace faabric::scheduler;
+
+namespace osu {
+
+struct OsuConfig
+{
+    int nHosts = 0;
+    int ranksPerHost = 0;
+    int maxSize = 0;
+    int iterations = 0;
+    std::vector<std::string> benchmarks;
+
+    int getIterations(int size) const
+    {
+        return size > OSU_LARGE_MESSAGE ? std::max(iterations / 10, 1)
+                                        : iterations;
+    }
+
+    int getWarmup(int size) const
+    {
+        return std::max(getIterations(size) / 10, 1);
+    }
+
+    bool shouldRun(const std::string& name) const
+    {
+        return benchmarks.empty() ||
+               std::find(benchmarks.begin(), benchmarks.end(), name) !=
+                 benchmarks.end();
+    }
+};
+
+static OsuConfig getOsuConfig()
+{
+    using faabric::util::getEnvVar;
+
+    OsuConfig c;
+    c.nHosts = std::stoi(getEnvVar("OSU_HOSTS", "2"));
+    c.ranksPerHost = std::stoi(getEnvVar("OSU_RANKS_PER_HOST", "2"));
+    c.maxSize = std::stoi(getEnvVar("OSU_MAX_SIZE", "1048576"));
+    c.iterations = std::stoi(getEnvVar("OSU_ITERATIONS", "100"));
+
+    std::stringstream benchmarks(getEnvVar("OSU_BENCHMARKS", ""));
+    std::string name;
+    while (std::getline(benchmarks, name, ',')) {
+        c.benchmarks.push_back(name);
+    }
+
+    return c;
+}
+
+static double getSeconds()
+{
+    return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// ----------------------------------
+// Cluster
+// ----------------------------------
+
+/**
+ * A host with its own instance of the world, which receives the MPI messages
+ * sent to it.
+ */
+class OsuHost final : public MockHost
+{
+  public:
+    explicit OsuHost(int coresIn)
+      : cores(coresIn)
+    {}
+
+    MpiWorld world;
+
+    // The message for the first rank placed here, holding the rank-host map
+    faabric::Message rankMsg;
+
+    faabric::HostResources getResources() override
+    {
+        faabric::HostResources res;
+        res.set_cores(cores);
+        return res;
+    }
+
+    void executeFunctions(const faabric::BatchExecuteRequest& req) override
+    {
+        rankMsg = req.messages().at(0);
+    }
+
+    void sendMPIMessage(std::shared_ptr<faabric::MPIMessage> msg) override
+    {
+        world.enqueueMessage(*msg);
+    }
+
+  private:
+    const int cores;
+};
+
+class OsuCluster
+{
+  public:
+    explicit OsuCluster(const OsuConfig& c)
+      : size(c.nHosts * c.ranksPerHost)
+    {
+        faabric::util::setMockMode(true);
+
+        // Rank zero is the master, so this host takes one fewer rank
+        Scheduler& sch = getScheduler();
+        sch.reset();
+        faabric::HostResources res;
+        res.set_cores(c.ranksPerHost - 1);
+        sch.setThisHostResources(res);
+
+        for (int h = 1; h < c.nHosts; h++) {
+            std::string hostName = OSU_HOST_PREFIX + std::to_string(h);
+            auto host = std::make_shared<OsuHost>(c.ranksPerHost);
+            registerMockHost(hostName, host);
+            sch.addHostToGlobalSet(hostName);
+
+            hostNames.push_back(hostName);
+            hosts[hostName] = host;
+        }
+
+        faabric::Message msg = faabric::util::messageFactory("mpi", "osu");
+        msg.set_mpiworldsize(size);
+        int worldId = (int)faabric::util::generateGid();
+        localWorld.create(msg, worldId, size);
+
+        // Set up the world on each mock host from the ranks it was sent
+        for (auto& p : hosts) {
+            if (!p.second->rankMsg.ismpi()) {
+                const std::shared_ptr<spdlog::logger>& logger =
+                  faabric::util::getLogger();
+                logger->error("No ranks placed on {}", p.first);
+                throw std::runtime_error("No ranks placed on mock host");
+            }
+
+            p.second->world.overrideHost(p.first);
+            p.second->world.initialiseFromState(p.second->rankMsg, worldId);
+        }
+
+        // Work out which world each rank uses
+        for (int r = 0; r < size; r++) {
+            std::string host = sch.getThisHost();
+            if (!hosts.empty()) {
+                host = hosts.begin()->second->rankMsg.mpirankhosts(r);
+            }
+
+            if (hosts.count(host) > 0) {
+                rankWorlds.push_back(&hosts[host]->world);
+            } else {
+                if (r > 0) {
+                    localWorld.registerRank(r);
+                }
+                rankWorlds.push_back(&localWorld);
+            }
+        }
+    }
+
+    ~OsuCluster()
+    {
+        localWorld.destroy();
+
+        Scheduler& sch = getScheduler();
+        for (const auto& h : hostNames) {
+            sch.removeHostFromGlobalSet(h);
+        }
+
+        clearMockHosts();
+        sch.reset();
+        faabric::util::setMockMode(false);
+    }
+
+    const int size;
+
+    MpiWorld& getWorld(int rank) { return *rankWorlds.at(rank); }
+
+    // Runs the function on every rank at once
+    template<typename F>
+    void runRanks(F f)
+    {
+        std::vector<std::thread> threads;
+        for (int r = 0; r < size; r++) {
+            threads.emplace_back([this, &f, r] { f(r, getWorld(r)); });
+        }
+
+        for (auto& t : threads) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+    }
+
+  private:
+    MpiWorld localWorld;
+
+    std::vector<std::string> hostNames;
+    std::unordered_map<std::string, std::shared_ptr<OsuHost>> hosts;
+
+    std::vector<MpiWorld*> rankWorlds;
+};
+
+// ----------------------------------
+// Output
+// ----------------------------------
+
+static void printHeader(const OsuConfig& c,
+                        const std::string& title,
+                        const std::string& valueLabel)
+{
+    printf("\n# %s\n", title.c_str());
+    printf("# Ranks: %i (%i hosts x %i)\n",
+           c.nHosts * c.ranksPerHost,
+           c.nHosts,
+           c.ranksPerHost);
+    printf("# %-10s %18s\n", "Size", valueLabel.c_str());
+}
+
+static void printRow(int size, double value)
+{
+    printf("%-12i %18.2f\n", size, value);
+    fflush(stdout);
+}
+
+// ----------------------------------
+// Point-to-point
+// ----------------------------------
+
+// Point-to-point tests run between the first and last ranks, which are on
+// different hosts whenever there's more than one
+static void runLatency(OsuCluster& cluster, const OsuConfig& c)
+{
+    printHeader(c, "OSU MPI Latency Test", "Latency (us)");
+
+    int peer = cluster.size - 1;
+    cluster.runRanks([&c, peer](int rank, MpiWorld& world) {
+        std::vector<uint8_t> sendBuf(c.maxSize, 'a');
+        std::vector<uint8_t> recvBuf(c.maxSize);
+
+        for (int size = 1; size <= c.maxSize; size *= 2) {
+            int iters = c.getIterations(size);
+            int warmup = c.getWarmup(size);
+            world.barrier(rank);
+
+            if (rank == 0) {
+                double start = 0;
+                for (int i = 0; i < warmup + iters; i++) {
+                    if (i == warmup) {
+                        start = getSeconds();
+                    }
+
+                    world.send(0, peer, sendBuf.data(), MPI_BYTE, size);
+                    world.recv(
+                      peer, 0, recvBuf.data(), MPI_BYTE, size, nullptr);
+                }
+
+                double elapsed = getSeconds() - start;
+                printRow(size, elapsed * 1e6 / (2.0 * iters));
+            } else if (rank == peer) {
+                for (int i = 0; i < warmup + iters; i++) {
+                    world.recv(
+                      0, peer, recvBuf.data(), MPI_BYTE, size, nullptr);
+                    world.send(peer, 0, sendBuf.data(), MPI_BYTE, size);
+                }
+            }
+        }
+    });
+}
+
+static void runBandwidth(OsuCluster& cluster,
+                         const OsuConfig& c,
+                         bool bidirectional)
+{
+    printHeader(c,
+                bidirectional ? "OSU MPI Bi-Directional Bandwidth Test"
+                              : "OSU MPI Bandwidth Test",
+                "Bandwidth (MB/s)");
+
+    int peer = cluster.size - 1;
+    cluster.runRanks([&c, peer, bidirectional](int rank, MpiWorld& world) {
+        std::vector<uint8_t> sendBuf(c.maxSize, 'a');
+        std::vector<uint8_t> recvBuf(c.maxSize);
+        uint8_t ack = 0;
+        std::vector<int> reqs;
+
+        bool isSender = rank == 0;
+        int other = isSender ? peer : 0;
+
+        for (int size = 1; size <= c.maxSize; size *= 2) {
+            int iters = c.getIterations(size);
+            int warmup = c.getWarmup(size);
+            world.barrier(rank);
+
+            if (rank != 0 && rank != peer) {
+                continue;
+            }
+
+            double start = 0;
+            for (int i = 0; i < warmup + iters; i++) {
+                if (i == warmup) {
+                    start = getSeconds();
+                }
+
+                reqs.clear();
+                if (!isSender || bidirectional) {
+                    for (int w = 0; w < OSU_WINDOW_SIZE; w++) {
+                        reqs.push_back(world.irecv(
+                          other, rank, recvBuf.data(), MPI_BYTE, size));
+                    }
+                }
+
+                if (isSender || bidirectional) {
+                    for (int w = 0; w < OSU_WINDOW_SIZE; w++) {
+                        reqs.push_back(world.isend(
+                          rank, other, sendBuf.data(), MPI_BYTE, size));
+                    }
+                }
+
+                for (int r : reqs) {
+                    world.awaitAsyncRequest(r);
+                }
+
+                // Unidirectional senders wait for the whole window to land
+                if (!bidirectional && isSender) {
+                    world.recv(other, rank, &ack, MPI_BYTE, 1, nullptr);
+                } else if (!bidirectional) {
+                    world.send(rank, other, &ack, MPI_BYTE, 1);
+                }
+            }
+
+            if (isSender) {
+                double elapsed = getSeconds() - start;
+                double bytes = (double)size * iters * OSU_WINDOW_SIZE;
+                if (bidirectional) {
+                    bytes *= 2;
+                }
+
+                printRow(size, bytes / (elapsed * 1e6));
+            }
+        }
+    });
+}
+
+// ----------------------------------
+// Collectives
+// ----------------------------------
+
+typedef std::function<
+  void(int rank, MpiWorld& world, int size, uint8_t* sendBuf, uint8_t* recvBuf)>
+  CollectiveOp;
+
+// Reports the latency of the operation averaged over all ranks
+static void runCollective(OsuCluster& cluster,
+                          const OsuConfig& c,
+                          const std::string& title,
+                          int minSize,
+                          const CollectiveOp& op)
+{
+    printHeader(c, title, "Avg Latency (us)");
+
+    std::vector<double> latencies(cluster.size);
+    size_t bufSize = (size_t)c.maxSize * cluster.size;
+
+    cluster.runRanks([&](int rank, MpiWorld& world) {
+        std::vector<uint8_t> sendBuf(bufSize, 1);
+        std::vector<uint8_t> recvBuf(bufSize);
+
+        for (int size = minSize; size <= c.maxSize; size *= 2) {
+            int iters = c.getIterations(size);
+            int warmup = c.getWarmup(size);
+            world.barrier(rank);
+
+            double start = 0;
+            for (int i = 0; i < warmup + iters; i++) {
+                if (i == warmup) {
+                    start = getSeconds();
+                }
+
+                op(rank, world, size, sendBuf.data(), recvBuf.data());
+            }
+
+            latencies.at(rank) = (getSeconds() - start) * 1e6 / iters;
+            world.barrier(rank);
+
+            if (rank == 0) {
+                double total = 0;
+                for (double l : latencies) {
+                    total += l;
+                }
+                printRow(size, total / cluster.size);
+            }
+        }
+    });
+}
+
+static void runBarrier(OsuCluster& cluster, const OsuConfig& c)
+{
+    printf("\n# OSU MPI Barrier Latency Test\n");
+    printf("# Ranks: %i (%i hosts x %i)\n",
+           cluster.size,
+           c.nHosts,
+           c.ranksPerHost);
+    printf("# %18s\n", "Avg Latency (us)");
+
+    std::vector<double> latencies(cluster.size);
+    cluster.runRanks([&](int rank, MpiWorld& world) {
+        int iters = c.getIterations(0);
+        int warmup = c.getWarmup(0);
+
+        double start = 0;
+        for (int i = 0; i < warmup + iters; i++) {
+            if (i == warmup) {
+                start = getSeconds();
+            }
+            world.barrier(rank);
+        }
+
+        latencies.at(rank) = (getSeconds() - start) * 1e6 / iters;
+        world.barrier(rank);
+
+        if (rank == 0) {
+            double total = 0;
+            for (double l : latencies) {
+                total += l;
+            }
+            printf("  %18.2f\n", total / cluster.size);
+        }
+    });
+}
+
+static void runAll(OsuCluster& cluster, const OsuConfig& c)
+{
+    if (c.shouldRun("latency")) {
+        runLatency(cluster, c);
+    }
+
+    if (c.shouldRun("bw")) {
+        runBandwidth(cluster, c, false);
+    }
+
+    if (c.shouldRun("bibw")) {
+        runBandwidth(cluster, c, true);
+    }
+
+    if (c.shouldRun("barrier")) {
+        runBarrier(cluster, c);
+    }
+
+    if (c.shouldRun("bcast")) {
+        runCollective(
+          cluster,
+          c,
+          "OSU MPI Broadcast Latency Test",
+          1,
+          [](int rank, MpiWorld& world, int size, uint8_t* s, uint8_t* r) {
+              if (rank == 0) {
+                  world.broadcast(0, s, MPI_BYTE, size);
+              } else {
+                  world.recv(0, rank, r, MPI_BYTE, size, nullptr);
+              }
+          });
+    }
+
+    // Reductions are over ints, so start at one int
+    if (c.shouldRun("reduce")) {
+        runCollective(
+          cluster,
+          c,
+          "OSU MPI Reduce Latency Test",
+          sizeof(int),
+          [](int rank, MpiWorld& world, int size, uint8_t* s, uint8_t* r) {
+              int count = size / sizeof(int);
+              world.reduce(rank, 0, s, r, MPI_INT, count, MPI_SUM);
+          });
+    }
+
+    if (c.shouldRun("allreduce")) {
+        runCollective(
+          cluster,
+          c,
+          "OSU MPI Allreduce Latency Test",
+          sizeof(int),
+          [](int rank, MpiWorld& world, int size, uint8_t* s, uint8_t* r) {
+              int count = size / sizeof(int);
+              world.allReduce(rank, s, r, MPI_INT, count, MPI_SUM);
+          });
+    }
+
+    if (c.shouldRun("allgather")) {
+        runCollective(
+          cluster,
+          c,
+          "OSU MPI Allgather Latency Test",
+          1,
+          [](int rank, MpiWorld& world, int size, uint8_t* s, uint8_t* r) {
+              world.allGather(rank, s, MPI_BYTE, size, r, MPI_BYTE, size);
+          });
+    }
+
+    if (c.shouldRun("alltoall")) {
+        runCollective(
+          cluster,
+          c,
+          "OSU MPI All-to-All Latency Test",
+          1,
+          [](int rank, MpiWorld& world, int size, uint8_t* s, uint8_t* r) {
+              world.allToAll(rank, s, MPI_BYTE, size, r, MPI_BYTE, size);
+          });
+    }
+}
+}
+
+int main()
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    osu::OsuConfig c = osu::getOsuConfig();
+    if (c.nHosts < 1 || c.nHosts * c.ranksPerHost < 2) {
+        logger->error("Need at least two ranks ({} hosts x {})",
+                      c.nHosts,
+                      c.ranksPerHost);
+        return 1;
+    }
+
+    // Keep logging out of the timings
+    logger->set_level(spdlog::level::err);
+
+    osu::OsuCluster cluster(c);
+    osu::runAll(cluster, c);
+
+    return 0;
+}
@@ -3,9 +3,17 @@
 #include "faabric_utils.h"
 
 #include <faabric/endpoint/FaabricEndpointHandler.h>
+#include <faabric/endpoint/ResultDispatcher.h>
 #include <faabric/scheduler/Scheduler.h>
+#include <faabric/state/State.h>
 #include <faabric/util/json.h>
 
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/util/delimited_message_util.h>
+
+#include <future>
+#include <sstream>
+
 using namespace Pistache;
 
 namespace tests {
@@ -70,6 +78,13 @@ TEST_CASE("Test empty invocation", "[endpoint]")
     REQUIRE(actual == "Empty request");
 }
 
+TEST_CASE("Test invalid JSON invocation", "[endpoint]")
+{
+    endpoint::FaabricEndpointHandler handler;
+    REQUIRE(handler.handleFunction("{\"user\": ") == "Invalid request");
+    REQUIRE(handler.handleFunction("[]") == "Invalid request");
+}
+
 TEST_CASE("Test empty JSON invocation", "[endpoint]")
 {
     faabric::Message call;
@@ -96,6 +111,282 @@ TEST_CASE("Test empty JSON invocation", "[endpoint]")
     REQUIRE(actual == expected);
 }
 
+TEST_CASE("Test binary calls to endpoint", "[endpoint]")
+{
+    cleanFaabric();
+
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    call.set_isasync(true);
+
+    // Include bytes that aren't valid in text
+    std::vector<uint8_t> inputBytes = { 0, 1, 2, 0, 255, 3 };
+    call.set_inputdata(inputBytes.data(), inputBytes.size());
+
+    endpoint::FaabricEndpointHandler handler;
+    std::string responseStr =
+      handler.handleBinaryFunction(call.SerializeAsString());
+
+    // The response is the scheduled message
+    faabric::Message response;
+    REQUIRE(response.ParseFromString(responseStr));
+    REQUIRE(response.id() > 0);
+
+    scheduler::Scheduler& sch = scheduler::getScheduler();
+    faabric::Message actualCall = sch.getFunctionQueue(call)->dequeue();
+    REQUIRE(actualCall.id() == response.id());
+    REQUIRE(actualCall.user() == call.user());
+    REQUIRE(actualCall.function() == call.function());
+    REQUIRE(actualCall.inputdata() == call.inputdata());
+}
+
+TEST_CASE("Test bad binary invocations", "[endpoint]")
+{
+    endpoint::FaabricEndpointHandler handler;
+
+    REQUIRE(handler.handleBinaryFunction("") == "Empty request");
+    REQUIRE(handler.handleBinaryFunction("\xff\xff\xff") ==
+            "Invalid request");
+
+    faabric::Message call;
+    call.set_isasync(true);
+    call.set_function("echo");
+    REQUIRE(handler.handleBinaryFunction(call.SerializeAsString()) ==
+            "Empty user");
+}
+
+TEST_CASE("Test synchronous calls to endpoint", "[endpoint]")
+{
+    cleanFaabric();
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    int originalTimeout = conf.globalMessageTimeout;
+
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    call.set_isasync(false);
+
+    bool isBinary = false;
+    bool setResult = true;
+    std::string expected;
+
+    SECTION("JSON")
+    {
+        expected = "foobar\n";
+        SECTION("Timeout")
+        {
+            setResult = false;
+            expected = "No response from function\n";
+        }
+    }
+
+    SECTION("Binary") { isBinary = true; }
+
+    if (!setResult) {
+        conf.globalMessageTimeout = 200;
+    }
+
+    // The handler returns before the result is ready
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    endpoint::ResponseCallback respond =
+      [promise](const std::string& responseStr) {
+          promise->set_value(responseStr);
+      };
+
+    endpoint::FaabricEndpointHandler handler;
+    if (isBinary) {
+        handler.handleBinaryFunction(call.SerializeAsString(), respond);
+    } else {
+        handler.handleFunction(faabric::util::messageToJson(call), respond);
+    }
+
+    REQUIRE(endpoint::getResultDispatcher().getPendingCount() == 1);
+
+    scheduler::Scheduler& sch = scheduler::getScheduler();
+    faabric::Message actualCall = sch.getFunctionQueue(call)->dequeue();
+    if (setResult) {
+        actualCall.set_outputdata("foobar");
+        sch.setFunctionResult(actualCall);
+    }
+
+    REQUIRE(future.wait_for(std::chrono::seconds(5)) ==
+            std::future_status::ready);
+    std::string actual = future.get();
+
+    if (isBinary) {
+        faabric::Message result;
+        REQUIRE(result.ParseFromString(actual));
+        REQUIRE(result.id() == actualCall.id());
+        REQUIRE(result.outputdata() == "foobar");
+    } else {
+        REQUIRE(actual == expected);
+    }
+
+    REQUIRE(endpoint::getResultDispatcher().getPendingCount() == 0);
+
+    conf.globalMessageTimeout = originalTimeout;
+}
+
+TEST_CASE("Test batch of async calls to endpoint", "[endpoint]")
+{
+    cleanFaabric();
+
+    int nCalls = 3;
+    std::string requestStr;
+    for (int i = 0; i < nCalls; i++) {
+        faabric::Message call;
+        call.set_user("demo");
+        call.set_function("echo");
+        call.set_isasync(true);
+        call.set_inputdata("input " + std::to_string(i));
+        requestStr += faabric::util::messageToJson(call) + "\n";
+    }
+
+    endpoint::FaabricEndpointHandler handler;
+    std::string responseStr = handler.handleBatch(requestStr, false);
+
+    // One line per call, each with its ID
+    std::vector<faabric::Message> responses;
+    std::stringstream ss(responseStr);
+    std::string line;
+    while (std::getline(ss, line)) {
+        responses.push_back(faabric::util::jsonToMessage(line));
+    }
+    REQUIRE(responses.size() == (size_t)nCalls);
+
+    // All calls scheduled together
+    scheduler::Scheduler& sch = scheduler::getScheduler();
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    REQUIRE(sch.getFunctionInFlightCount(call) == nCalls);
+
+    for (int i = 0; i < nCalls; i++) {
+        faabric::Message actual = sch.getFunctionQueue(call)->dequeue();
+        REQUIRE(actual.id() == responses.at(i).id());
+        REQUIRE(actual.inputdata() == "input " + std::to_string(i));
+    }
+}
+
+TEST_CASE("Test batch of sync calls to endpoint", "[endpoint]")
+{
+    cleanFaabric();
+
+    faabric::BatchExecuteRequest req;
+    int nCalls = 3;
+    for (int i = 0; i < nCalls; i++) {
+        faabric::Message* call = req.add_messages();
+        call->set_user("demo");
+        call->set_function("echo");
+    }
+
+    // Collect each result as it's streamed back
+    std::vector<std::string> chunks;
+    std::promise<void> finished;
+    endpoint::StreamCallback write = [&chunks, &finished](
+                                       const std::string& chunk, bool isLast) {
+        chunks.push_back(chunk);
+        if (isLast) {
+            finished.set_value();
+        }
+    };
+
+    endpoint::FaabricEndpointHandler handler;
+    handler.handleBatch(req.SerializeAsString(), true, write);
+
+    // Finish the calls in reverse
+    scheduler::Scheduler& sch = scheduler::getScheduler();
+    std::vector<faabric::Message> actualCalls;
+    for (int i = 0; i < nCalls; i++) {
+        actualCalls.push_back(
+          sch.getFunctionQueue(req.messages().at(0))->dequeue());
+    }
+
+    for (int i = nCalls - 1; i >= 0; i--) {
+        actualCalls.at(i).set_outputdata("output " + std::to_string(i));
+        sch.setFunctionResult(actualCalls.at(i));
+    }
+
+    REQUIRE(finished.get_future().wait_for(std::chrono::seconds(5)) ==
+            std::future_status::ready);
+
+    // Results are length-delimited messages
+    std::string responseStr;
+    for (const auto& c : chunks) {
+        responseStr += c;
+    }
+
+    google::protobuf::io::ArrayInputStream stream(responseStr.data(),
+                                                  (int)responseStr.size());
+    std::map<unsigned int, std::string> outputs;
+    faabric::Message result;
+    bool isEof = false;
+    while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+      &result, &stream, &isEof)) {
+        outputs[result.id()] = result.outputdata();
+    }
+    REQUIRE(isEof);
+
+    REQUIRE(outputs.size() == (size_t)nCalls);
+    for (int i = 0; i < nCalls; i++) {
+        REQUIRE(outputs[actualCalls.at(i).id()] ==
+                "output " + std::to_string(i));
+    }
+}
+
+TEST_CASE("Test bad batch invocations", "[endpoint]")
+{
+    cleanFaabric();
+
+    faabric::Message callA = faabric::util::messageFactory("demo", "echo");
+    faabric::Message callB = faabric::util::messageFactory("demo", "echo");
+    callA.set_isasync(true);
+    callB.set_isasync(true);
+
+    std::string requestStr;
+    std::string expected;
+    bool isBinary = false;
+
+    SECTION("Empty")
+    {
+        requestStr = "\n\n";
+        expected = "Empty request";
+    }
+
+    SECTION("Invalid JSON")
+    {
+        requestStr = faabric::util::messageToJson(callA) + "\n{\"user\": ";
+        expected = "Invalid request";
+    }
+
+    SECTION("Invalid binary")
+    {
+        requestStr = "\xff\xff\xff";
+        isBinary = true;
+        expected = "Invalid request";
+    }
+
+    SECTION("Empty function")
+    {
+        callB.clear_function();
+        requestStr = faabric::util::messageToJson(callA) + "\n" +
+                     faabric::util::messageToJson(callB);
+        expected = "Empty function";
+    }
+
+    SECTION("Mixed functions")
+    {
+        callB.set_function("foo");
+        requestStr = faabric::util::messageToJson(callA) + "\n" +
+                     faabric::util::messageToJson(callB);
+        expected = "Batch must be for a single function";
+    }
+
+    endpoint::FaabricEndpointHandler handler;
+    REQUIRE(handler.handleBatch(requestStr, isBinary) == expected);
+
+    // Nothing scheduled
+    scheduler::Scheduler& sch = scheduler::getScheduler();
+    REQUIRE(sch.getFunctionInFlightCount(callA) == 0);
+}
+
 TEST_CASE("Check getting function status from endpoint", "[endpoint]")
 {
     cleanFaabric();
@@ -136,4 +427,51 @@ TEST_CASE("Check getting function status from endpoint", "[endpoint]")
 
     REQUIRE(actual == expectedOutput);
 }
+
+TEST_CASE("Test metrics request", "[endpoint]")
+{
+    cleanFaabric();
+
+    // Queue up an async call so the function has something to report
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    call.set_isasync(true);
+
+    endpoint::FaabricEndpointHandler handler;
+    handler.handleFunction(faabric::util::messageToJson(call));
+
+    // Add some state
+    faabric::state::getGlobalState().getKV("demo", "metrics_test", 123);
+
+    std::string actual = handler.handleMetrics();
+
+    std::vector<std::string> expectedLines = {
+        "# TYPE faabric_host_cores gauge",
+        "faabric_host_cores 10",
+        "faabric_function_in_flight{function=\"demo/echo\"} 1",
+        "faabric_function_faaslets{function=\"demo/echo\"} 1",
+        "faabric_function_queue_depth{function=\"demo/echo\"} 1",
+        "faabric_bind_queue_depth 1",
+        "faabric_endpoint_pending_results 0",
+        "faabric_state_kv_count 1",
+        "faabric_state_bytes 123",
+        "faabric_snapshot_count 0",
+        "# TYPE faabric_scheduler_dispatch_us histogram",
+        "faabric_scheduler_calls ",
+    };
+
+    for (const auto& line : expectedLines) {
+        INFO(line);
+        REQUIRE(actual.find(line) != std::string::npos);
+    }
+
+    // Each metric has a single type line
+    size_t nTypeLines = 0;
+    size_t pos = 0;
+    while ((pos = actual.find("# TYPE faabric_function_in_flight ", pos)) !=
+           std::string::npos) {
+        nTypeLines++;
+        pos++;
+    }
+    REQUIRE(nTypeLines == 1);
+}
 }
@@ -0,0 +1,113 @@
+#include <catch.hpp>
+
+#include <faabric/endpoint/ResponseSequencer.h>
+
+using namespace faabric::endpoint;
+
+namespace tests {
+
+// Records everything sent on one connection
+static StreamCallback recordTo(std::vector<std::string>& sent, int idx)
+{
+    return [&sent, idx](const std::string& chunk, bool isLast) {
+        sent.push_back(std::to_string(idx) + ":" + chunk +
+                       (isLast ? "|" : ""));
+    };
+}
+
+TEST_CASE("Test responses sent in request order", "[endpoint]")
+{
+    ResponseSequencer sequencer;
+    std::vector<std::string> sent;
+
+    StreamCallback a = sequencer.reserve(1, recordTo(sent, 0));
+    StreamCallback b = sequencer.reserve(1, recordTo(sent, 1));
+    StreamCallback c = sequencer.reserve(1, recordTo(sent, 2));
+
+    // Later responses wait for earlier ones
+    c("c", true);
+    b("b", true);
+    REQUIRE(sent.empty());
+
+    a("a", true);
+    std::vector<std::string> expected = { "0:a|", "1:b|", "2:c|" };
+    REQUIRE(sent == expected);
+    REQUIRE(sequencer.getConnectionCount() == 0);
+}
+
+TEST_CASE("Test streamed responses in request order", "[endpoint]")
+{
+    ResponseSequencer sequencer;
+    std::vector<std::string> sent;
+
+    StreamCallback a = sequencer.reserve(1, recordTo(sent, 0));
+    StreamCallback b = sequencer.reserve(1, recordTo(sent, 1));
+    StreamCallback c = sequencer.reserve(1, recordTo(sent, 2));
+
+    // Chunks at the head go straight out, others are buffered
+    a("a1", false);
+    b("b1", false);
+    b("b2", false);
+    c("c", true);
+    a("a2", false);
+
+    std::vector<std::string> expected = { "0:a1", "0:a2" };
+    REQUIRE(sent == expected);
+
+    // Finishing the head sends what's buffered behind it
+    a("", true);
+    expected = { "0:a1", "0:a2", "0:|", "1:b1b2" };
+    REQUIRE(sent == expected);
+
+    b("b3", true);
+    expected = { "0:a1", "0:a2", "0:|", "1:b1b2", "1:b3|", "2:c|" };
+    REQUIRE(sent == expected);
+    REQUIRE(sequencer.getConnectionCount() == 0);
+}
+
+TEST_CASE("Test connections sequenced independently", "[endpoint]")
+{
+    ResponseSequencer sequencer;
+    std::vector<std::string> sentA;
+    std::vector<std::string> sentB;
+
+    StreamCallback a = sequencer.reserve(1, recordTo(sentA, 0));
+    StreamCallback b = sequencer.reserve(2, recordTo(sentB, 0));
+    REQUIRE(sequencer.getConnectionCount() == 2);
+
+    // One connection waiting doesn't hold up the other
+    b("b", true);
+    REQUIRE(sentA.empty());
+    REQUIRE(sentB == std::vector<std::string>({ "0:b|" }));
+    REQUIRE(sequencer.getConnectionCount() == 1);
+
+    a("a", true);
+    REQUIRE(sentA == std::vector<std::string>({ "0:a|" }));
+    REQUIRE(sequencer.getConnectionCount() == 0);
+}
+
+TEST_CASE("Test dropping a closed connection", "[endpoint]")
+{
+    ResponseSequencer sequencer;
+    std::vector<std::string> sent;
+
+    StreamCallback a = sequencer.reserve(1, recordTo(sent, 0));
+    StreamCallback b = sequencer.reserve(1, recordTo(sent, 1));
+    REQUIRE(sequencer.getConnectionCount() == 1);
+
+    sequencer.dropConnection(1);
+    REQUIRE(sequencer.getConnectionCount() == 0);
+
+    // Responses finishing after the connection closed go nowhere
+    b("b", true);
+    a("a", true);
+    REQUIRE(sent.empty());
+
+    // A new connection starts from scratch
+    StreamCallback c = sequencer.reserve(2, recordTo(sent, 2));
+    c("c", true);
+    std::vector<std::string> expected = { "2:c|" };
+    REQUIRE(sent == expected);
+    REQUIRE(sequencer.getConnectionCount() == 0);
+}
+}
@@ -0,0 +1,127 @@
+#include <catch.hpp>
+
+#include "faabric_utils.h"
+
+#include <faabric/endpoint/ResultDispatcher.h>
+#include <faabric/scheduler/Scheduler.h>
+
+#include <future>
+
+using namespace faabric::endpoint;
+
+namespace tests {
+
+static std::future<faabric::Message> awaitWithFuture(
+  ResultDispatcher& dispatcher,
+  unsigned int messageId,
+  int timeoutMs)
+{
+    auto promise = std::make_shared<std::promise<faabric::Message>>();
+    std::future<faabric::Message> future = promise->get_future();
+    dispatcher.awaitResult(
+      messageId, timeoutMs, [promise](faabric::Message& result) {
+          promise->set_value(result);
+      });
+
+    return future;
+}
+
+static faabric::Message getWithin(std::future<faabric::Message>& future,
+                                  int timeoutMs)
+{
+    REQUIRE(future.wait_for(std::chrono::milliseconds(timeoutMs)) ==
+            std::future_status::ready);
+    return future.get();
+}
+
+TEST_CASE("Test dispatching results", "[endpoint]")
+{
+    cleanFaabric();
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    ResultDispatcher dispatcher;
+
+    // Enough calls to need more than one batch
+    int nCalls = RESULT_POLL_BATCH_SIZE + 10;
+    std::vector<faabric::Message> msgs;
+    std::vector<std::future<faabric::Message>> futures;
+    for (int i = 0; i < nCalls; i++) {
+        msgs.push_back(faabric::util::messageFactory("demo", "echo"));
+        futures.push_back(awaitWithFuture(dispatcher, msgs.back().id(), 10000));
+    }
+
+    REQUIRE(dispatcher.getPendingCount() == (size_t)nCalls);
+
+    // Set results in reverse order
+    for (int i = nCalls - 1; i >= 0; i--) {
+        msgs.at(i).set_outputdata("result " + std::to_string(i));
+        sch.setFunctionResult(msgs.at(i));
+    }
+
+    for (int i = 0; i < nCalls; i++) {
+        faabric::Message result = getWithin(futures.at(i), 5000);
+        REQUIRE(result.id() == msgs.at(i).id());
+        REQUIRE(result.outputdata() == "result " + std::to_string(i));
+    }
+
+    REQUIRE(dispatcher.getPendingCount() == 0);
+}
+
+TEST_CASE("Test dispatching result timeouts", "[endpoint]")
+{
+    cleanFaabric();
+
+    ResultDispatcher dispatcher;
+
+    faabric::Message msgA = faabric::util::messageFactory("demo", "echo");
+    faabric::Message msgB = faabric::util::messageFactory("demo", "echo");
+    std::future<faabric::Message> futureA =
+      awaitWithFuture(dispatcher, msgA.id(), 100);
+    std::future<faabric::Message> futureB =
+      awaitWithFuture(dispatcher, msgB.id(), 10000);
+
+    // Timed out calls get an empty result
+    faabric::Message resultA = getWithin(futureA, 5000);
+    REQUIRE(resultA.type() == faabric::Message_MessageType_EMPTY);
+    REQUIRE(resultA.id() == msgA.id());
+    REQUIRE(dispatcher.getPendingCount() == 1);
+
+    // Shutting down completes anything left
+    dispatcher.shutdown();
+    faabric::Message resultB = getWithin(futureB, 1000);
+    REQUIRE(resultB.type() == faabric::Message_MessageType_EMPTY);
+    REQUIRE(resultB.id() == msgB.id());
+    REQUIRE(dispatcher.getPendingCount() == 0);
+}
+
+TEST_CASE("Test dispatching result to several callers", "[endpoint]")
+{
+    cleanFaabric();
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    ResultDispatcher dispatcher;
+
+    // Awaiting the same message again mustn't drop the first caller
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+    std::future<faabric::Message> futureA =
+      awaitWithFuture(dispatcher, msg.id(), 10000);
+    std::future<faabric::Message> futureB =
+      awaitWithFuture(dispatcher, msg.id(), 10000);
+    REQUIRE(dispatcher.getPendingCount() == 2);
+
+    msg.set_outputdata("shared result");
+    sch.setFunctionResult(msg);
+
+    faabric::Message resultA = getWithin(futureA, 5000);
+    faabric::Message resultB = getWithin(futureB, 5000);
+    REQUIRE(resultA.outputdata() == "shared result");
+    REQUIRE(resultB.outputdata() == "shared result");
+    REQUIRE(dispatcher.getPendingCount() == 0);
+}
+
+TEST_CASE("Test awaiting result with no ID", "[endpoint]")
+{
+    ResultDispatcher dispatcher;
+    REQUIRE_THROWS(dispatcher.awaitResult(0, 1000, [](faabric::Message&) {}));
+}
+}
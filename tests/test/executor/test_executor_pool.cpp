@@ -0,0 +1,265 @@
+#include <catch.hpp>
+
+#include <faabric/executor/FaabricPool.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric_utils.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace faabric::executor;
+
+namespace tests {
+
+static std::atomic<int> bindCount = 0;
+static std::atomic<int> finishCount = 0;
+
+class TestExecutor final : public FaabricExecutor
+{
+  public:
+    explicit TestExecutor(int threadIdx)
+      : FaabricExecutor(threadIdx)
+    {}
+
+  protected:
+    bool doExecute(faabric::Message& msg) override
+    {
+        msg.set_outputdata("Executed " + std::to_string(msg.id()));
+        return true;
+    }
+
+    void postBind(const faabric::Message& msg, bool force) override
+    {
+        bindCount++;
+    }
+
+    void postFinish() override { finishCount++; }
+};
+
+static std::atomic<int> batchCount = 0;
+
+class BatchTestExecutor final : public FaabricExecutor
+{
+  public:
+    explicit BatchTestExecutor(int threadIdx)
+      : FaabricExecutor(threadIdx)
+    {}
+
+  protected:
+    std::vector<std::string> doExecuteBatch(
+      std::vector<faabric::Message>& msgs) override
+    {
+        batchCount++;
+
+        std::vector<std::string> errors;
+        for (auto& msg : msgs) {
+            msg.set_outputdata("Executed " + std::to_string(msg.id()));
+            errors.emplace_back("");
+        }
+
+        return errors;
+    }
+};
+
+// Finishes after every call, like the MPI executor
+class FinishingTestExecutor final : public FaabricExecutor
+{
+  public:
+    explicit FinishingTestExecutor(int threadIdx)
+      : FaabricExecutor(threadIdx)
+    {}
+
+  protected:
+    bool doExecute(faabric::Message& msg) override
+    {
+        msg.set_outputdata("Executed " + std::to_string(msg.id()));
+        return true;
+    }
+
+    void postFinishCall() override
+    {
+        throw faabric::util::ExecutorFinishedException("Finished");
+    }
+
+    void postFinish() override { finishCount++; }
+};
+
+class TestPool : public FaabricPool
+{
+  public:
+    explicit TestPool(int nThreads)
+      : FaabricPool(nThreads)
+    {}
+
+  protected:
+    std::unique_ptr<FaabricExecutor> createExecutor(int threadIdx) override
+    {
+        if (useBatchExecutor) {
+            return std::make_unique<BatchTestExecutor>(threadIdx);
+        }
+
+        if (useFinishingExecutor) {
+            return std::make_unique<FinishingTestExecutor>(threadIdx);
+        }
+
+        return std::make_unique<TestExecutor>(threadIdx);
+    }
+
+  public:
+    bool useBatchExecutor = false;
+    bool useFinishingExecutor = false;
+};
+
+static void checkCallResult(const faabric::Message& msg)
+{
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    faabric::Message result = sch.getFunctionResult(msg.id(), 2000);
+    REQUIRE(result.returnvalue() == 0);
+    REQUIRE(result.outputdata() == "Executed " + std::to_string(msg.id()));
+}
+
+TEST_CASE("Test executor pool reuses warm executors", "[executor]")
+{
+    cleanFaabric();
+    bindCount = 0;
+    finishCount = 0;
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.boundTimeout = 100;
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    TestPool pool(1);
+    pool.startThreadPool();
+
+    faabric::Message msgA = faabric::util::messageFactory("demo", "echo");
+    sch.callFunction(msgA, true);
+    checkCallResult(msgA);
+    REQUIRE(bindCount == 1);
+
+    // Wait for the idle executor to be parked
+    for (int i = 0; i < 50 && pool.getWarmExecutorCount() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    REQUIRE(pool.getWarmExecutorCount() == 1);
+    REQUIRE(sch.getFunctionFaasletCount(msgA) == 0);
+
+    // Next call should pick up the warm executor rather than binding again
+    faabric::Message msgB = faabric::util::messageFactory("demo", "echo");
+    sch.callFunction(msgB, true);
+    checkCallResult(msgB);
+    REQUIRE(bindCount == 1);
+    REQUIRE(pool.getWarmExecutorCount() == 0);
+
+    pool.shutdown();
+    REQUIRE(finishCount == 1);
+
+    conf.reset();
+}
+
+TEST_CASE("Test executor pool drains backlogs", "[executor]")
+{
+    cleanFaabric();
+    bindCount = 0;
+    finishCount = 0;
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    int nThreads = 3;
+    TestPool pool(nThreads);
+    pool.startThreadPool();
+
+    // Make a backlog on two functions
+    std::vector<faabric::Message> msgs;
+    for (int i = 0; i < 20; i++) {
+        std::string func = i % 2 == 0 ? "echo" : "hello";
+        msgs.emplace_back(faabric::util::messageFactory("demo", func));
+        sch.callFunction(msgs.back(), true);
+    }
+
+    for (const auto& msg : msgs) {
+        checkCallResult(msg);
+    }
+
+    // Binding is bounded by the number of workers, not calls
+    REQUIRE(bindCount <= 2 * nThreads);
+
+    pool.shutdown();
+    REQUIRE(finishCount == bindCount);
+}
+
+TEST_CASE("Test executor pool batches calls", "[executor]")
+{
+    cleanFaabric();
+    batchCount = 0;
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.executorBatchSize = 10;
+    conf.executorLocalQueueSize = 10;
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    // Queue up calls before starting the pool so they're already waiting
+    int nCalls = 10;
+    std::vector<faabric::Message> msgs;
+    for (int i = 0; i < nCalls; i++) {
+        msgs.emplace_back(faabric::util::messageFactory("demo", "echo"));
+        sch.callFunction(msgs.back(), true);
+    }
+
+    TestPool pool(1);
+    pool.useBatchExecutor = true;
+    pool.startThreadPool();
+
+    for (const auto& msg : msgs) {
+        checkCallResult(msg);
+    }
+
+    // All the calls should have been run as a single batch
+    REQUIRE(batchCount == 1);
+    REQUIRE(sch.getFunctionInFlightCount(msgs.at(0)) == 0);
+
+    pool.shutdown();
+
+    conf.reset();
+}
+
+TEST_CASE("Test executor finishing with a non-empty local queue",
+          "[executor]")
+{
+    cleanFaabric();
+    finishCount = 0;
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.executorLocalQueueSize = 5;
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    // Queue up calls before starting the pool, so the first executor takes
+    // the rest into its local queue before it finishes
+    int nCalls = 5;
+    std::vector<faabric::Message> msgs;
+    for (int i = 0; i < nCalls; i++) {
+        msgs.emplace_back(faabric::util::messageFactory("demo", "echo"));
+        sch.callFunction(msgs.back(), true);
+    }
+
+    TestPool pool(1);
+    pool.useFinishingExecutor = true;
+    pool.startThreadPool();
+
+    // Calls left on the finished executor must be picked up by new ones
+    for (const auto& msg : msgs) {
+        checkCallResult(msg);
+    }
+
+    REQUIRE(sch.getFunctionInFlightCount(msgs.at(0)) == 0);
+
+    pool.shutdown();
+    REQUIRE(finishCount >= nCalls);
+
+    conf.reset();
+}
+}
@@ -354,6 +354,25 @@ TEST_CASE("Test acquire/ release lock for queue", "[redis]")
     checkLock(Redis::getQueue());
 }
 
+TEST_CASE("Test lock release notification", "[redis]")
+{
+    Redis& redis = Redis::getState();
+    redis.flushAll();
+
+    std::string key = "lock_notify_test";
+
+    // Nothing to pick up before a release
+    REQUIRE(!redis.waitOnLockRelease(key, 0));
+
+    // Check repeated releases only leave a single notification
+    redis.notifyLockReleased(key, 10);
+    redis.notifyLockReleased(key, 10);
+    REQUIRE(redis.listLength(key + "_lock_notify") == 1);
+
+    REQUIRE(redis.waitOnLockRelease(key, 0));
+    REQUIRE(!redis.waitOnLockRelease(key, 0));
+}
+
 TEST_CASE("Test set operations with empty sets", "[redis]")
 {
     Redis& redis = Redis::getQueue();
@@ -660,17 +679,116 @@ TEST_CASE("Test range set pipeline")
     REQUIRE(actual == expected);
 }
 
-void checkDequeueBytes(Redis& redis,
-                       const std::string& queueName,
-                       const std::vector<uint8_t> expected)
+TEST_CASE("Test queue and set pipeline", "[redis]")
 {
-    unsigned long bufferLen = expected.size();
-    auto buffer = new uint8_t[bufferLen];
+    Redis& redisQueue = Redis::getQueue();
+    redisQueue.flushAll();
 
-    redis.dequeueBytes(queueName, buffer, bufferLen);
+    std::string queueKey = "dummyQueuePipeline";
+    std::string setKey = "dummySetPipeline";
 
-    std::vector<uint8_t> actual(buffer, buffer + bufferLen);
-    REQUIRE(actual == expected);
+    std::vector<uint8_t> valueA = { 1, 2, 3 };
+    std::vector<uint8_t> valueB = { 4, 5 };
+    redisQueue.enqueueBytesPipeline(queueKey, valueA.data(), valueA.size());
+    redisQueue.enqueueBytesPipeline(queueKey, valueB.data(), valueB.size());
+    redisQueue.expirePipeline(queueKey, 100);
+    redisQueue.setPipeline(setKey, valueB.data(), valueB.size());
+    redisQueue.expirePipeline(setKey, 200);
+
+    redisQueue.flushPipeline(5);
+
+    REQUIRE(redisQueue.listLength(queueKey) == 2);
+    REQUIRE(redisQueue.dequeueBytes(queueKey) == valueA);
+    REQUIRE(redisQueue.dequeueBytes(queueKey) == valueB);
+    REQUIRE(redisQueue.get(setKey) == valueB);
+
+    long ttl = redisQueue.getTtl(setKey);
+    REQUIRE(ttl > 100);
+    REQUIRE(ttl <= 200);
+}
+
+TEST_CASE("Test range get pipeline", "[redis]")
+{
+    Redis& redisState = Redis::getState();
+    redisState.flushAll();
+
+    std::string key = "dummyGetPipeline";
+    std::vector<uint8_t> values = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    redisState.set(key, values);
+
+    // Note that ranges are inclusive
+    redisState.getRangePipeline(key, 0, 2);
+    redisState.getRangePipeline(key, 7, 9);
+    redisState.getRangePipeline(key, 4, 4);
+
+    std::vector<uint8_t> actualA(3, 0);
+    std::vector<uint8_t> actualB(3, 0);
+    std::vector<uint8_t> actualC(1, 0);
+    redisState.readRangePipelineReply(key, actualA.data(), actualA.size());
+    redisState.readRangePipelineReply(key, actualB.data(), actualB.size());
+    redisState.readRangePipelineReply(key, actualC.data(), actualC.size());
+
+    REQUIRE(actualA == std::vector<uint8_t>({ 0, 1, 2 }));
+    REQUIRE(actualB == std::vector<uint8_t>({ 7, 8, 9 }));
+    REQUIRE(actualC == std::vector<uint8_t>({ 4 }));
+}
+
+TEST_CASE("Test dequeue pipeline", "[redis]")
+{
+    Redis& redisQueue = Redis::getQueue();
+    redisQueue.flushAll();
+
+    std::vector<uint8_t> valueA = { 1, 2, 3 };
+    std::vector<uint8_t> valueB = { 4, 5 };
+    redisQueue.enqueueBytes("dequeuePipelineA", valueA);
+    redisQueue.enqueueBytes("dequeuePipelineB", valueB);
+
+    // Empty queues give empty replies
+    redisQueue.dequeueBytesPipeline("dequeuePipelineA");
+    redisQueue.dequeueBytesPipeline("dequeuePipelineEmpty");
+    redisQueue.dequeueBytesPipeline("dequeuePipelineB");
+    redisQueue.dequeueBytesPipeline("dequeuePipelineA");
+
+    REQUIRE(redisQueue.readDequeuePipelineReply("dequeuePipelineA") == valueA);
+    REQUIRE(
+      redisQueue.readDequeuePipelineReply("dequeuePipelineEmpty").empty());
+    REQUIRE(redisQueue.readDequeuePipelineReply("dequeuePipelineB") == valueB);
+    REQUIRE(redisQueue.readDequeuePipelineReply("dequeuePipelineA").empty());
+}
+
+TEST_CASE("Test failed pipeline replies are discarded", "[redis]")
+{
+    Redis& redis = Redis::getQueue();
+    redis.flushAll();
+
+    std::string key = "failedPipelineValue";
+    std::vector<uint8_t> values = { 0, 1, 2, 3, 4 };
+    redis.set(key, values);
+
+    SECTION("Dequeue pipeline")
+    {
+        redis.enqueueBytes("failedPipelineQueue", values);
+
+        // Popping a string is an error
+        redis.dequeueBytesPipeline(key);
+        redis.dequeueBytesPipeline("failedPipelineQueue");
+
+        REQUIRE_THROWS(redis.readDequeuePipelineReply(key));
+    }
+
+    SECTION("Range pipeline")
+    {
+        // Buffer is too small for the first reply
+        redis.getRangePipeline(key, 0, 4);
+        redis.getRangePipeline(key, 0, 1);
+
+        std::vector<uint8_t> actual(2, 0);
+        REQUIRE_THROWS(
+          redis.readRangePipelineReply(key, actual.data(), actual.size()));
+    }
+
+    // Later commands mustn't get replies left over from the pipeline
+    REQUIRE(redis.get(key) == values);
 }
 
 TEST_CASE("Test enqueue dequeue bytes pointers", "[redis]")
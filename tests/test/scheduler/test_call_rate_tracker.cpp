@@ -0,0 +1,59 @@
+#include <catch.hpp>
+
+#include <faabric/scheduler/CallRateTracker.h>
+
+using namespace faabric::scheduler;
+
+namespace tests {
+TEST_CASE("Test call rate averages", "[scheduler]")
+{
+    CallRateTracker tracker(0.5);
+    std::string funcStr = "demo/echo";
+
+    REQUIRE(tracker.getRate(funcStr).nArrivals == 0);
+
+    tracker.recordArrival(funcStr, 1000);
+    tracker.recordArrival(funcStr, 1100);
+    REQUIRE(tracker.getRate(funcStr).interArrivalMs == 100);
+
+    tracker.recordArrival(funcStr, 1300);
+    REQUIRE(tracker.getRate(funcStr).interArrivalMs == 150);
+    REQUIRE(tracker.getRate(funcStr).nArrivals == 3);
+    REQUIRE(tracker.getRate(funcStr).lastArrivalMs == 1300);
+
+    tracker.recordCompletion(funcStr, 400);
+    REQUIRE(tracker.getRate(funcStr).residencyMs == 400);
+    tracker.recordCompletion(funcStr, 200);
+    REQUIRE(tracker.getRate(funcStr).residencyMs == 300);
+
+    tracker.clear();
+    REQUIRE(tracker.getRate(funcStr).nArrivals == 0);
+}
+
+TEST_CASE("Test call rate concurrency prediction", "[scheduler]")
+{
+    CallRateTracker tracker(0.5);
+    std::string funcStr = "demo/echo";
+
+    // Nothing known yet
+    REQUIRE(tracker.predictConcurrency(funcStr, 0) == 0);
+
+    // Calls every 10ms, each taking 45ms
+    for (int i = 0; i < 10; i++) {
+        tracker.recordArrival(funcStr, i * 10);
+    }
+    REQUIRE(tracker.predictConcurrency(funcStr, 90) == 0);
+
+    tracker.recordCompletion(funcStr, 45);
+    REQUIRE(tracker.predictConcurrency(funcStr, 90) == 5);
+
+    // Headroom on top
+    REQUIRE(tracker.predictConcurrency(funcStr, 90, 100) == 9);
+
+    // Prediction decays once calls stop arriving
+    REQUIRE(tracker.predictConcurrency(funcStr, 110) == 3);
+    REQUIRE(tracker.predictConcurrency(funcStr, 1000) == 1);
+
+    REQUIRE(tracker.predictConcurrency("demo/other", 90) == 0);
+}
+}
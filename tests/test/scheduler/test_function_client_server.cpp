@@ -321,4 +321,53 @@ TEST_CASE("Test unregister request", "[scheduler]")
     // Stop the server
     server.stop();
 }
+
+class MpiMockHost final : public MockHost
+{
+  public:
+    std::vector<faabric::MPIMessage> msgs;
+
+    faabric::HostResources getResources() override
+    {
+        return faabric::HostResources();
+    }
+
+    void executeFunctions(const faabric::BatchExecuteRequest& req) override {}
+
+    void sendMPIMessage(std::shared_ptr<faabric::MPIMessage> msg) override
+    {
+        msgs.push_back(*msg);
+    }
+};
+
+TEST_CASE("Test mock hosts receive MPI messages", "[scheduler]")
+{
+    cleanFaabric();
+    faabric::util::setMockMode(true);
+
+    std::string mockHostName = "mockHost";
+    auto mockHost = std::make_shared<MpiMockHost>();
+    registerMockHost(mockHostName, mockHost);
+
+    auto msg = std::make_shared<faabric::MPIMessage>();
+    msg->set_sender(1);
+    msg->set_destination(2);
+
+    FunctionCallClient cli(mockHostName);
+    cli.sendMPIMessage(msg);
+
+    // Messages to other hosts are still recorded
+    FunctionCallClient otherCli("otherHost");
+    otherCli.sendMPIMessage(msg);
+
+    REQUIRE(mockHost->msgs.size() == 1);
+    REQUIRE(mockHost->msgs.at(0).destination() == 2);
+
+    auto recorded = getMPIMessages();
+    REQUIRE(recorded.size() == 1);
+    REQUIRE(recorded.at(0).first == "otherHost");
+
+    clearMockHosts();
+    faabric::util::setMockMode(false);
+}
 }
@@ -0,0 +1,226 @@
+#include "faabric_utils.h"
+#include <catch.hpp>
+
+#include <faabric/scheduler/MpiShmRing.h>
+#include <faabric/scheduler/MpiWorldRegistry.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/macros.h>
+#include <faabric/util/network.h>
+
+#include <csignal>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace faabric::scheduler;
+
+namespace tests {
+
+static faabric::MPIMessage buildMessage(int id, int nBytes)
+{
+    faabric::MPIMessage msg;
+    msg.set_id(id);
+    msg.set_sender(1);
+    msg.set_destination(2);
+    msg.set_buffer(std::string(nBytes, (char)('a' + (id % 26))));
+    return msg;
+}
+
+TEST_CASE("Test shared memory ring push and pop", "[mpi]")
+{
+    std::string name = MpiShmRing::getRingName(123, "ring-test");
+    size_t capacity = 1024;
+
+    // Nothing to open before it's created
+    REQUIRE(MpiShmRing::open(name) == nullptr);
+
+    std::shared_ptr<MpiShmRing> owner = MpiShmRing::create(name, capacity);
+    std::shared_ptr<MpiShmRing> writer = MpiShmRing::open(name);
+    REQUIRE(writer != nullptr);
+    REQUIRE(writer->getCapacity() == capacity);
+
+    faabric::MPIMessage actual;
+
+    SECTION("Empty ring times out")
+    {
+        REQUIRE(!owner->pop(actual, 10));
+    }
+
+    SECTION("Messages come out in order")
+    {
+        for (int i = 0; i < 3; i++) {
+            writer->push(buildMessage(i, 10));
+        }
+
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(owner->pop(actual, 10));
+            REQUIRE(actual.id() == i);
+            REQUIRE(actual.buffer() == buildMessage(i, 10).buffer());
+        }
+
+        REQUIRE(owner->getUsedBytes() == 0);
+    }
+
+    SECTION("Messages wrap around the end of the ring")
+    {
+        for (int i = 0; i < 20; i++) {
+            writer->push(buildMessage(i, 300));
+            REQUIRE(owner->pop(actual, 10));
+            REQUIRE(actual.id() == i);
+            REQUIRE(actual.buffer() == buildMessage(i, 300).buffer());
+        }
+    }
+
+    // Ring is removed along with its owner
+    writer = nullptr;
+    owner = nullptr;
+    REQUIRE(MpiShmRing::open(name) == nullptr);
+}
+
+TEST_CASE("Test shared memory ring blocks writers when full", "[mpi]")
+{
+    std::string name = MpiShmRing::getRingName(124, "ring-test");
+    std::shared_ptr<MpiShmRing> owner = MpiShmRing::create(name, 512);
+
+    int nMessages = 50;
+    std::thread writerThread([&name, nMessages] {
+        std::shared_ptr<MpiShmRing> writer = MpiShmRing::open(name);
+        for (int i = 0; i < nMessages; i++) {
+            writer->push(buildMessage(i, 100));
+        }
+    });
+
+    faabric::MPIMessage actual;
+    for (int i = 0; i < nMessages; i++) {
+        REQUIRE(owner->pop(actual, 1000));
+        REQUIRE(actual.id() == i);
+    }
+
+    writerThread.join();
+}
+
+TEST_CASE("Test shared memory ring splits large messages", "[mpi]")
+{
+    std::string name = MpiShmRing::getRingName(127, "ring-test");
+    size_t capacity = 1024;
+    std::shared_ptr<MpiShmRing> owner = MpiShmRing::create(name, capacity);
+
+    // Large message is sent between small ones, and mustn't overtake them
+    int nMessages = 3;
+    std::vector<int> sizes = { 10, 5 * (int)capacity, 10 };
+    std::thread writerThread([&name, &sizes, nMessages] {
+        std::shared_ptr<MpiShmRing> writer = MpiShmRing::open(name);
+        for (int i = 0; i < nMessages; i++) {
+            writer->push(buildMessage(i, sizes.at(i)));
+        }
+    });
+
+    faabric::MPIMessage actual;
+    for (int i = 0; i < nMessages; i++) {
+        REQUIRE(owner->pop(actual, 1000));
+        REQUIRE(actual.id() == i);
+        REQUIRE(actual.buffer() == buildMessage(i, sizes.at(i)).buffer());
+    }
+
+    writerThread.join();
+    REQUIRE(owner->getUsedBytes() == 0);
+}
+
+TEST_CASE("Test shared memory ring recovers from dead writer", "[mpi]")
+{
+    std::string name = MpiShmRing::getRingName(128, "ring-test");
+    size_t capacity = 1024;
+    std::shared_ptr<MpiShmRing> owner = MpiShmRing::create(name, capacity);
+
+    // Child blocks part way through a message, holding the writer lock
+    pid_t child = fork();
+    if (child == 0) {
+        std::shared_ptr<MpiShmRing> writer = MpiShmRing::open(name);
+        writer->push(buildMessage(0, 5 * capacity));
+        _exit(0);
+    }
+
+    for (int i = 0; i < 100 && owner->getUsedBytes() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(owner->getUsedBytes() > 0);
+
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+
+    // Other writers can carry on, and the unfinished message is dropped
+    std::shared_ptr<MpiShmRing> writer = MpiShmRing::open(name);
+    writer->push(buildMessage(1, 10));
+
+    faabric::MPIMessage actual;
+    REQUIRE(owner->pop(actual, 1000));
+    REQUIRE(actual.id() == 1);
+    REQUIRE(actual.buffer() == buildMessage(1, 10).buffer());
+}
+
+TEST_CASE("Test shared memory ring across processes", "[mpi]")
+{
+    std::string name = MpiShmRing::getRingName(125, "ring-test");
+    std::shared_ptr<MpiShmRing> owner = MpiShmRing::create(name, 4096);
+
+    int nMessages = 100;
+    pid_t child = fork();
+    if (child == 0) {
+        std::shared_ptr<MpiShmRing> writer = MpiShmRing::open(name);
+        for (int i = 0; i < nMessages; i++) {
+            writer->push(buildMessage(i, 200));
+        }
+        _exit(0);
+    }
+
+    faabric::MPIMessage actual;
+    for (int i = 0; i < nMessages; i++) {
+        REQUIRE(owner->pop(actual, 1000));
+        REQUIRE(actual.id() == i);
+        REQUIRE(actual.buffer() == buildMessage(i, 200).buffer());
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+    REQUIRE(WEXITSTATUS(status) == 0);
+}
+
+TEST_CASE("Test MPI send over shared memory transport", "[mpi]")
+{
+    cleanFaabric();
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.mpiShmTransport = "on";
+
+    int worldId = 126;
+    faabric::Message msg = faabric::util::messageFactory("mpi", "hellompi");
+    msg.set_mpiworldid(worldId);
+    msg.set_mpiworldsize(3);
+
+    // Note, no server is running so messages can't go over the network
+    MpiWorld& localWorld =
+      getMpiWorldRegistry().createWorld(msg, worldId, LOCALHOST);
+
+    MpiWorld remoteWorld;
+    remoteWorld.overrideHost("shm-other");
+    remoteWorld.initialiseFromState(msg, worldId);
+
+    int rankA = 1;
+    int rankB = 2;
+    remoteWorld.registerRank(rankA);
+    localWorld.registerRank(rankB);
+
+    std::vector<int> messageData = { 0, 1, 2 };
+    remoteWorld.send(
+      rankA, rankB, BYTES(messageData.data()), MPI_INT, messageData.size());
+
+    std::vector<int> actual(3, -1);
+    localWorld.recv(rankA, rankB, BYTES(actual.data()), MPI_INT, 3, nullptr);
+    REQUIRE(actual == messageData);
+
+    remoteWorld.destroy();
+    localWorld.destroy();
+    conf.reset();
+}
+}
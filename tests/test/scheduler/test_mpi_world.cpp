@@ -2,6 +2,7 @@
 #include <catch.hpp>
 
 #include <faabric/mpi/mpi.h>
+#include <faabric/scheduler/FunctionCallClient.h>
 #include <faabric/scheduler/FunctionCallServer.h>
 #include <faabric/scheduler/MpiWorldRegistry.h>
 #include <faabric/scheduler/Scheduler.h>
@@ -9,6 +10,11 @@
 #include <faabric/util/macros.h>
 #include <faabric/util/network.h>
 #include <faabric/util/random.h>
+#include <faabric/util/testing.h>
+
+#include <set>
+#include <thread>
+#include <unistd.h>
 
 using namespace faabric::scheduler;
 
@@ -45,6 +51,8 @@ TEST_CASE("Test world creation", "[mpi]")
         REQUIRE(actualCall.ismpi());
         REQUIRE(actualCall.mpiworldid() == worldId);
         REQUIRE(actualCall.mpirank() == i);
+        REQUIRE(actualCall.mpiworldsize() == worldSize);
+        REQUIRE(actualCall.mpirankhosts_size() == worldSize);
     }
 
     // Check that this host is registered as the master
@@ -107,6 +115,63 @@ TEST_CASE("Test registering a rank", "[mpi]")
     REQUIRE(worldB.getHostForRank(rankB) == hostB);
 }
 
+TEST_CASE("Test world creation packs ranks in one batch", "[mpi]")
+{
+    cleanFaabric();
+    faabric::util::setMockMode(true);
+
+    Scheduler& sch = getScheduler();
+    std::string thisHost = sch.getThisHost();
+
+    // Set up capacity for two ranks here, the rest elsewhere
+    faabric::HostResources thisResources;
+    thisResources.set_cores(2);
+    sch.setThisHostResources(thisResources);
+
+    std::string otherHost = "other";
+    sch.addHostToGlobalSet(otherHost);
+
+    faabric::HostResources otherResources;
+    otherResources.set_cores(10);
+    queueResourceResponse(otherHost, otherResources);
+
+    int thisWorldSize = 6;
+    const faabric::Message& msg = faabric::util::messageFactory(user, func);
+    scheduler::MpiWorld world;
+    world.create(msg, worldId, thisWorldSize);
+
+    // Check the remote ranks are sent in a single batch
+    auto batchRequests = getBatchRequests();
+    REQUIRE(batchRequests.size() == 1);
+    REQUIRE(batchRequests.at(0).first == otherHost);
+
+    faabric::BatchExecuteRequest req = batchRequests.at(0).second;
+    REQUIRE(req.messages_size() == 3);
+
+    // Check every rank is given the full map
+    std::vector<std::string> expectedHosts = { thisHost,  thisHost,
+                                               thisHost,  otherHost,
+                                               otherHost, otherHost };
+    for (const auto& m : req.messages()) {
+        std::vector<std::string> actualHosts(m.mpirankhosts().begin(),
+                                             m.mpirankhosts().end());
+        REQUIRE(actualHosts == expectedHosts);
+    }
+
+    // Check the master knows about the remote ranks without them registering
+    REQUIRE(world.getHostForRank(3) == otherHost);
+    REQUIRE(world.getHostForRank(5) == otherHost);
+
+    // Check a world on the other host takes its map from the message
+    scheduler::MpiWorld otherWorld;
+    otherWorld.overrideHost(otherHost);
+    otherWorld.initialiseFromState(req.messages().at(0), worldId);
+    REQUIRE(otherWorld.getHostForRank(1) == thisHost);
+    REQUIRE(otherWorld.getHostForRank(4) == otherHost);
+
+    faabric::util::setMockMode(false);
+}
+
 TEST_CASE("Test cartesian communicator", "[mpi]")
 {
     cleanFaabric();
@@ -275,15 +340,35 @@ TEST_CASE("Test send and recv on same host", "[mpi]")
 
     SECTION("Test recv with type missmatch")
     {
-        // Receive a message from a different type
-        auto buffer = new int[messageData.size()];
-        REQUIRE_THROWS(world.recv(rankA1,
-                                  rankA2,
-                                  BYTES(buffer),
-                                  MPI_INT,
-                                  messageData.size(),
-                                  nullptr,
-                                  faabric::MPIMessage::SENDRECV));
+        // Receive of a different type doesn't match the message
+        std::vector<int> bufferA(messageData.size(), 0);
+        int recvId = world.irecv(rankA1,
+                                 rankA2,
+                                 BYTES(bufferA.data()),
+                                 MPI_INT,
+                                 messageData.size(),
+                                 faabric::MPIMessage::SENDRECV);
+        REQUIRE(!world.testAsyncRequest(recvId));
+
+        // Message is still there for a receive of the right type
+        std::vector<int> bufferB(messageData.size(), 0);
+        world.recv(rankA1,
+                   rankA2,
+                   BYTES(bufferB.data()),
+                   MPI_INT,
+                   messageData.size(),
+                   nullptr);
+        REQUIRE(bufferB == messageData);
+
+        // Matching message completes the pending receive
+        world.send(rankA1,
+                   rankA2,
+                   BYTES(messageData.data()),
+                   MPI_INT,
+                   messageData.size(),
+                   faabric::MPIMessage::SENDRECV);
+        world.awaitAsyncRequest(recvId);
+        REQUIRE(bufferA == messageData);
     }
 }
 
@@ -436,6 +521,129 @@ TEST_CASE("Test async send and recv", "[mpi]")
     REQUIRE(actualB == messageDataB);
 }
 
+TEST_CASE("Test many outstanding async receives", "[mpi]")
+{
+    cleanFaabric();
+
+    const faabric::Message& msg = faabric::util::messageFactory(user, func);
+    scheduler::MpiWorld world;
+    world.create(msg, worldId, worldSize);
+
+    int rankA = 1;
+    int rankB = 2;
+    world.registerRank(rankA);
+    world.registerRank(rankB);
+
+    // Post far more receives than there are cores before anything is sent
+    size_t nBefore = world.getOutstandingRequestCount();
+    int nMessages = 200;
+    std::vector<std::vector<int>> actual(nMessages, std::vector<int>(2, -1));
+    std::vector<int> recvIds;
+    for (int i = 0; i < nMessages; i++) {
+        recvIds.push_back(world.irecv(
+          rankA, rankB, BYTES(actual.at(i).data()), MPI_INT, 2));
+    }
+
+    REQUIRE(world.getOutstandingRequestCount() == nBefore + nMessages);
+
+    for (int i = 0; i < nMessages; i++) {
+        std::vector<int> data = { i, i * 2 };
+        world.send(rankA, rankB, BYTES(data.data()), MPI_INT, 2);
+    }
+
+    // Await in reverse, receives should still be matched in order
+    for (int i = nMessages - 1; i >= 0; i--) {
+        MPI_Status status{};
+        world.awaitAsyncRequest(recvIds.at(i), &status);
+        REQUIRE(status.MPI_SOURCE == rankA);
+        REQUIRE(status.bytesSize == 2 * sizeof(int));
+    }
+
+    for (int i = 0; i < nMessages; i++) {
+        REQUIRE(actual.at(i) == std::vector<int>({ i, i * 2 }));
+    }
+
+    REQUIRE(world.getOutstandingRequestCount() == nBefore);
+}
+
+TEST_CASE("Test testing and waiting on any async request", "[mpi]")
+{
+    cleanFaabric();
+
+    const faabric::Message& msg = faabric::util::messageFactory(user, func);
+    scheduler::MpiWorld world;
+    world.create(msg, worldId, worldSize);
+
+    int rankA = 1;
+    int rankB = 2;
+    int rankC = 3;
+    world.registerRank(rankA);
+    world.registerRank(rankB);
+    world.registerRank(rankC);
+
+    std::vector<int> actualA(3, -1);
+    std::vector<int> actualB(3, -1);
+    int recvA = world.irecv(rankA, rankC, BYTES(actualA.data()), MPI_INT, 3);
+    int recvB = world.irecv(rankB, rankC, BYTES(actualB.data()), MPI_INT, 3);
+
+    size_t nBefore = world.getOutstandingRequestCount();
+
+    // Nothing sent yet
+    REQUIRE(!world.testAsyncRequest(recvA));
+    REQUIRE(!world.testAsyncRequest(recvB));
+
+    // Send from B and check it's the one that completes
+    std::vector<int> dataB = { 4, 5, 6 };
+    world.send(rankB, rankC, BYTES(dataB.data()), MPI_INT, 3);
+
+    MPI_Status status{};
+    REQUIRE(world.awaitAnyAsyncRequest({ recvA, recvB }, &status) == 1);
+    REQUIRE(status.MPI_SOURCE == rankB);
+    REQUIRE(actualB == dataB);
+
+    // Send from A and test until done
+    std::vector<int> dataA = { 1, 2, 3 };
+    int sendA = world.isend(rankA, rankC, BYTES(dataA.data()), MPI_INT, 3);
+    REQUIRE(world.testAsyncRequest(sendA));
+    REQUIRE(world.testAsyncRequest(recvA));
+    REQUIRE(actualA == dataA);
+
+    // Finished requests can't be tested again
+    REQUIRE_THROWS(world.testAsyncRequest(recvA));
+    REQUIRE(world.getOutstandingRequestCount() == nBefore - 2);
+}
+
+TEST_CASE("Test blocking recv after posted async recv", "[mpi]")
+{
+    cleanFaabric();
+
+    const faabric::Message& msg = faabric::util::messageFactory(user, func);
+    scheduler::MpiWorld world;
+    world.create(msg, worldId, worldSize);
+
+    int rankA = 1;
+    int rankB = 2;
+    world.registerRank(rankA);
+    world.registerRank(rankB);
+
+    std::vector<int> dataA = { 1, 2 };
+    std::vector<int> dataB = { 3, 4 };
+
+    // The posted receive should get the first message
+    std::vector<int> actualA(2, -1);
+    int recvId = world.irecv(rankA, rankB, BYTES(actualA.data()), MPI_INT, 2);
+
+    world.send(rankA, rankB, BYTES(dataA.data()), MPI_INT, 2);
+    world.send(rankA, rankB, BYTES(dataB.data()), MPI_INT, 2);
+
+    std::vector<int> actualB(2, -1);
+    world.recv(rankA, rankB, BYTES(actualB.data()), MPI_INT, 2, nullptr);
+    REQUIRE(actualB == dataB);
+
+    world.awaitAsyncRequest(recvId);
+    REQUIRE(actualA == dataA);
+}
+
 TEST_CASE("Test send across hosts", "[mpi]")
 {
     cleanFaabric();
@@ -625,6 +833,168 @@ TEST_CASE("Test probe", "[mpi]")
     world.recv(1, 2, BYTES(bufferB), MPI_INT, sizeB * sizeof(int), nullptr);
 }
 
+TEST_CASE("Test recv matches on tag", "[mpi]")
+{
+    cleanFaabric();
+
+    const faabric::Message& msg = faabric::util::messageFactory(user, func);
+    scheduler::MpiWorld world;
+    world.create(msg, worldId, worldSize);
+
+    world.registerRank(1);
+    world.registerRank(2);
+
+    auto normal = faabric::MPIMessage::NORMAL;
+    std::vector<int> dataA = { 0, 1, 2 };
+    std::vector<int> dataB = { 3, 4, 5 };
+    std::vector<int> dataC = { 6, 7, 8 };
+    world.send(1, 2, BYTES(dataA.data()), MPI_INT, 3, normal, 10);
+    world.send(1, 2, BYTES(dataB.data()), MPI_INT, 3, normal, 20);
+    world.send(1, 2, BYTES(dataC.data()), MPI_INT, 3, normal, 30);
+
+    // Probe sees the first message with the tag
+    MPI_Status probeStatus{};
+    world.probe(1, 2, &probeStatus, 20);
+    REQUIRE(probeStatus.MPI_TAG == 20);
+
+    // Receive out of order by tag
+    MPI_Status status{};
+    std::vector<int> actual(3, -1);
+    world.recv(1, 2, BYTES(actual.data()), MPI_INT, 3, &status, normal, 20);
+    REQUIRE(actual == dataB);
+    REQUIRE(status.MPI_TAG == 20);
+
+    // Non-blocking receive matches on tag too
+    std::vector<int> asyncActual(3, -1);
+    int recvId =
+      world.irecv(1, 2, BYTES(asyncActual.data()), MPI_INT, 3, normal, 30);
+    MPI_Status asyncStatus{};
+    world.awaitAsyncRequest(recvId, &asyncStatus);
+    REQUIRE(asyncActual == dataC);
+    REQUIRE(asyncStatus.MPI_TAG == 30);
+
+    // Any tag gets what's left
+    world.recv(1, 2, BYTES(actual.data()), MPI_INT, 3, &status);
+    REQUIRE(actual == dataA);
+    REQUIRE(status.MPI_TAG == 10);
+
+    REQUIRE(world.getLocalQueueSize(1, 2) == 0);
+}
+
+TEST_CASE("Test recv from any source", "[mpi]")
+{
+    cleanFaabric();
+
+    const faabric::Message& msg = faabric::util::messageFactory(user, func);
+    scheduler::MpiWorld world;
+    world.create(msg, worldId, worldSize);
+
+    int recvRank = 1;
+    world.registerRank(recvRank);
+    world.registerRank(2);
+    world.registerRank(3);
+
+    std::vector<int> dataA = { 0, 1 };
+    std::vector<int> dataB = { 2, 3 };
+
+    SECTION("Messages already sent")
+    {
+        world.send(3, recvRank, BYTES(dataB.data()), MPI_INT, 2);
+        world.send(2, recvRank, BYTES(dataA.data()), MPI_INT, 2);
+
+        std::set<int> sources;
+        for (int i = 0; i < 2; i++) {
+            MPI_Status status{};
+            std::vector<int> actual(2, -1);
+            world.recv(MPI_ANY_SOURCE,
+                       recvRank,
+                       BYTES(actual.data()),
+                       MPI_INT,
+                       2,
+                       &status);
+            REQUIRE(actual == (status.MPI_SOURCE == 2 ? dataA : dataB));
+            sources.insert(status.MPI_SOURCE);
+        }
+
+        REQUIRE(sources == std::set<int>({ 2, 3 }));
+    }
+
+    SECTION("Message sent while waiting")
+    {
+        std::thread sender([&world, &dataB, recvRank] {
+            usleep(100 * 1000);
+            world.send(3, recvRank, BYTES(dataB.data()), MPI_INT, 2);
+        });
+
+        MPI_Status status{};
+        std::vector<int> actual(2, -1);
+        int recvId = world.irecv(
+          MPI_ANY_SOURCE, recvRank, BYTES(actual.data()), MPI_INT, 2);
+        world.awaitAsyncRequest(recvId, &status);
+
+        REQUIRE(actual == dataB);
+        REQUIRE(status.MPI_SOURCE == 3);
+
+        if (sender.joinable()) {
+            sender.join();
+        }
+    }
+
+    SECTION("Waiting on any request while a message is sent")
+    {
+        std::thread sender([&world, &dataA, recvRank] {
+            usleep(100 * 1000);
+            world.send(2, recvRank, BYTES(dataA.data()), MPI_INT, 2);
+        });
+
+        std::vector<int> actualA(2, -1);
+        std::vector<int> actualB(2, -1);
+        int recvA = world.irecv(2, recvRank, BYTES(actualA.data()), MPI_INT, 2);
+        int recvB = world.irecv(3, recvRank, BYTES(actualB.data()), MPI_INT, 2);
+
+        MPI_Status status{};
+        REQUIRE(world.awaitAnyAsyncRequest({ recvB, recvA }, &status) == 1);
+        REQUIRE(actualA == dataA);
+        REQUIRE(status.MPI_SOURCE == 2);
+
+        if (sender.joinable()) {
+            sender.join();
+        }
+
+        // Complete the other receive so it isn't left outstanding
+        world.send(3, recvRank, BYTES(dataB.data()), MPI_INT, 2);
+        world.awaitAsyncRequest(recvB);
+        REQUIRE(actualB == dataB);
+    }
+}
+
+TEST_CASE("Test collective and point-to-point messages interleaved", "[mpi]")
+{
+    cleanFaabric();
+
+    const faabric::Message& msg = faabric::util::messageFactory(user, func);
+    scheduler::MpiWorld world;
+    world.create(msg, worldId, worldSize);
+
+    world.registerRank(1);
+    world.registerRank(2);
+
+    // Point-to-point message arrives ahead of a collective one
+    auto gather = faabric::MPIMessage::GATHER;
+    std::vector<int> p2pData = { 0, 1, 2 };
+    std::vector<int> gatherData = { 3, 4, 5 };
+    world.send(1, 2, BYTES(p2pData.data()), MPI_INT, 3);
+    world.send(1, 2, BYTES(gatherData.data()), MPI_INT, 3, gather);
+
+    // Collective receive skips over the point-to-point message
+    std::vector<int> actual(3, -1);
+    world.recv(1, 2, BYTES(actual.data()), MPI_INT, 3, nullptr, gather);
+    REQUIRE(actual == gatherData);
+
+    world.recv(1, 2, BYTES(actual.data()), MPI_INT, 3, nullptr);
+    REQUIRE(actual == p2pData);
+}
+
 TEST_CASE("Test can't get in-memory queue for non-local ranks", "[mpi]")
 {
     cleanFaabric();
@@ -1683,6 +2053,202 @@ TEST_CASE("Test all-to-all", "[mpi]")
     }
 }
 
+TEST_CASE("Test all-to-all and allgather across world sizes", "[mpi]")
+{
+    cleanFaabric();
+
+    int thisWorldSize;
+    SECTION("Power of two") { thisWorldSize = 8; }
+    SECTION("Not a power of two") { thisWorldSize = 7; }
+
+    const faabric::Message& msg = faabric::util::messageFactory(user, func);
+    scheduler::MpiWorld world;
+    world.create(msg, worldId, thisWorldSize);
+
+    for (int r = 1; r < thisWorldSize; r++) {
+        world.registerRank(r);
+    }
+
+    // Small blocks are exchanged in log rounds, big ones pairwise
+    for (int nPerRank : { 2, 100 }) {
+        // Rank r sends value r * 1000 + i for element i
+        int fullSize = nPerRank * thisWorldSize;
+        std::vector<std::vector<int>> inputs(thisWorldSize,
+                                             std::vector<int>(fullSize));
+        for (int r = 0; r < thisWorldSize; r++) {
+            for (int i = 0; i < fullSize; i++) {
+                inputs[r][i] = r * 1000 + i;
+            }
+        }
+
+        std::vector<std::vector<int>> allToAllActual(
+          thisWorldSize, std::vector<int>(fullSize, -1));
+        std::vector<std::vector<int>> allGatherActual(
+          thisWorldSize, std::vector<int>(fullSize, -1));
+
+        std::vector<std::thread> threads;
+        for (int r = 0; r < thisWorldSize; r++) {
+            threads.emplace_back([&, r] {
+                world.allToAll(r,
+                               BYTES(inputs[r].data()),
+                               MPI_INT,
+                               nPerRank,
+                               BYTES(allToAllActual[r].data()),
+                               MPI_INT,
+                               nPerRank);
+
+                world.allGather(r,
+                                BYTES(inputs[r].data()),
+                                MPI_INT,
+                                nPerRank,
+                                BYTES(allGatherActual[r].data()),
+                                MPI_INT,
+                                nPerRank);
+            });
+        }
+
+        for (auto& t : threads) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+
+        for (int r = 0; r < thisWorldSize; r++) {
+            std::vector<int> expectedAllToAll;
+            std::vector<int> expectedAllGather;
+            for (int s = 0; s < thisWorldSize; s++) {
+                // Block r of rank s's input
+                auto block = inputs[s].begin() + r * nPerRank;
+                expectedAllToAll.insert(
+                  expectedAllToAll.end(), block, block + nPerRank);
+
+                // First block of rank s's input
+                expectedAllGather.insert(expectedAllGather.end(),
+                                         inputs[s].begin(),
+                                         inputs[s].begin() + nPerRank);
+            }
+
+            REQUIRE(allToAllActual[r] == expectedAllToAll);
+            REQUIRE(allGatherActual[r] == expectedAllGather);
+        }
+    }
+}
+
+TEST_CASE("Test RMA within a host", "[mpi]")
+{
+    cleanFaabric();
+
+    const faabric::Message& msg = faabric::util::messageFactory(user, func);
+    scheduler::MpiWorld world;
+    world.create(msg, worldId, worldSize);
+
+    int winRank = 1;
+    int otherRank = 2;
+    world.registerRank(winRank);
+    world.registerRank(otherRank);
+
+    std::vector<int> window = { 0, 1, 2, 3, 4, 5 };
+    world.createWindow(
+      winRank, window.size() * sizeof(int), BYTES(window.data()));
+
+    // Put into the middle of the window
+    std::vector<int> putData = { 10, 11 };
+    world.rmaPut(otherRank,
+                 BYTES(putData.data()),
+                 MPI_INT,
+                 2,
+                 winRank,
+                 MPI_INT,
+                 2,
+                 2 * sizeof(int));
+    REQUIRE(window == std::vector<int>({ 0, 1, 10, 11, 4, 5 }));
+
+    // Get a range that overlaps the put
+    std::vector<int> actual(3, -1);
+    world.rmaGet(
+      winRank, MPI_INT, 3, BYTES(actual.data()), MPI_INT, 3, sizeof(int));
+    REQUIRE(actual == std::vector<int>({ 1, 10, 11 }));
+
+    // Can't go past the end of the window
+    REQUIRE_THROWS(world.rmaGet(
+      winRank, MPI_INT, 3, BYTES(actual.data()), MPI_INT, 3, 4 * sizeof(int)));
+
+    // Can't access a window once it's freed
+    world.freeWindow(winRank);
+    REQUIRE_THROWS(
+      world.rmaGet(winRank, MPI_INT, 1, BYTES(actual.data()), MPI_INT, 1));
+}
+
+TEST_CASE("Test remote RMA puts are batched", "[mpi]")
+{
+    cleanFaabric();
+    faabric::util::setMockMode(true);
+
+    std::string otherHost = "192.168.9.3";
+
+    faabric::Message msg = faabric::util::messageFactory(user, func);
+    msg.set_mpiworldid(worldId);
+    msg.set_mpiworldsize(worldSize);
+
+    scheduler::MpiWorld localWorld;
+    localWorld.create(msg, worldId, worldSize);
+
+    scheduler::MpiWorld remoteWorld;
+    remoteWorld.overrideHost(otherHost);
+    remoteWorld.initialiseFromState(msg, worldId);
+
+    int localRank = 1;
+    int remoteRank = 2;
+    localWorld.registerRank(localRank);
+    remoteWorld.registerRank(remoteRank);
+
+    // Two puts to the same remote window
+    std::vector<int> dataA = { 1, 2 };
+    std::vector<int> dataB = { 3 };
+    localWorld.rmaPut(localRank,
+                      BYTES(dataA.data()),
+                      MPI_INT,
+                      2,
+                      remoteRank,
+                      MPI_INT,
+                      2);
+    localWorld.rmaPut(localRank,
+                      BYTES(dataB.data()),
+                      MPI_INT,
+                      1,
+                      remoteRank,
+                      MPI_INT,
+                      1,
+                      4 * sizeof(int));
+    REQUIRE(getMPIMessages().empty());
+
+    // Flushing sends them in a single message
+    localWorld.rmaFlush(localRank);
+    std::vector<std::pair<std::string, faabric::MPIMessage>> sent =
+      getMPIMessages();
+    REQUIRE(sent.size() == 1);
+    REQUIRE(sent.at(0).first == otherHost);
+
+    const faabric::MPIMessage& actual = sent.at(0).second;
+    REQUIRE(actual.messagetype() == faabric::MPIMessage::RMA_WRITE);
+    REQUIRE(actual.destination() == remoteRank);
+    REQUIRE(actual.rmaoffsets_size() == 2);
+    REQUIRE(actual.rmaoffsets(0) == 0);
+    REQUIRE(actual.rmaoffsets(1) == 4 * sizeof(int));
+    REQUIRE(actual.rmalengths(0) == 2 * sizeof(int));
+    REQUIRE(actual.rmalengths(1) == sizeof(int));
+    REQUIRE(actual.buffer().size() == 3 * sizeof(int));
+
+    // Applying the message writes only the ranges that were put
+    std::vector<int> window(6, 0);
+    remoteWorld.createWindow(
+      remoteRank, window.size() * sizeof(int), BYTES(window.data()));
+    remoteWorld.synchronizeRmaWrite(actual);
+    REQUIRE(window == std::vector<int>({ 1, 2, 0, 0, 3, 0 }));
+
+    faabric::util::setMockMode(false);
+}
+
 TEST_CASE("Test RMA across hosts", "[mpi]")
 {
     cleanFaabric();
@@ -1748,6 +2314,10 @@ TEST_CASE("Test RMA across hosts", "[mpi]")
                            MPI_INT,
                            dataCount);
 
+        // Nothing lands until the put is flushed
+        REQUIRE(dataA1 == std::vector<int>({ 0, 1, 2, 3 }));
+        remoteWorld.rmaFlush(rankB1);
+
         // Make sure it's been copied to the memory location
         REQUIRE(dataA1 == putData);
 
@@ -1756,8 +2326,61 @@ TEST_CASE("Test RMA across hosts", "[mpi]")
         localWorld.rmaGet(
           rankA1, MPI_INT, dataCount, BYTES(actual.data()), MPI_INT, dataCount);
         REQUIRE(actual == putData);
+
+        // The put is also visible from the other host once flushed
+        std::vector<int> remoteActual = { 0, 0, 0, 0 };
+        remoteWorld.rmaGet(rankA1,
+                           MPI_INT,
+                           dataCount,
+                           BYTES(remoteActual.data()),
+                           MPI_INT,
+                           dataCount);
+        REQUIRE(remoteActual == putData);
     }
 
     server.stop();
 }
+
+TEST_CASE("Test local RMA puts are published on flush", "[mpi]")
+{
+    cleanFaabric();
+
+    std::string otherHost = "192.168.9.4";
+    int thisWorldSize = 3;
+
+    faabric::Message msg = faabric::util::messageFactory(user, func);
+    msg.set_mpiworldid(worldId);
+    msg.set_mpiworldsize(thisWorldSize);
+
+    // Neither world is given the rank-to-host map
+    scheduler::MpiWorld localWorld;
+    localWorld.create(msg, worldId, thisWorldSize);
+
+    scheduler::MpiWorld remoteWorld;
+    remoteWorld.overrideHost(otherHost);
+    remoteWorld.initialiseFromState(msg, worldId);
+
+    int winRank = 1;
+    int remoteRank = 2;
+    localWorld.registerRank(winRank);
+    remoteWorld.registerRank(remoteRank);
+
+    std::vector<int> window = { 0, 1, 2, 3 };
+    localWorld.createWindow(
+      winRank, window.size() * sizeof(int), BYTES(window.data()));
+
+    std::vector<int> putData = { 10, 11 };
+    localWorld.rmaPut(
+      0, BYTES(putData.data()), MPI_INT, 2, winRank, MPI_INT, 2, sizeof(int));
+    REQUIRE(window == std::vector<int>({ 0, 10, 11, 3 }));
+
+    // The other host only sees the put once it's flushed
+    std::vector<int> actual(4, -1);
+    remoteWorld.rmaGet(winRank, MPI_INT, 4, BYTES(actual.data()), MPI_INT, 4);
+    REQUIRE(actual == std::vector<int>({ 0, 1, 2, 3 }));
+
+    localWorld.rmaFlush(0);
+    remoteWorld.rmaGet(winRank, MPI_INT, 4, BYTES(actual.data()), MPI_INT, 4);
+    REQUIRE(actual == window);
+}
 }
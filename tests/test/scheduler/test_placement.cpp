@@ -0,0 +1,260 @@
+#include <catch.hpp>
+
+#include <faabric/scheduler/FunctionCallClient.h>
+#include <faabric/scheduler/PlacementPolicy.h>
+#include <faabric/scheduler/PlacementSimulator.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/func.h>
+#include <faabric/util/testing.h>
+#include <faabric_utils.h>
+
+using namespace faabric::scheduler;
+
+namespace tests {
+
+static PlacementContext buildContext(
+  std::unordered_map<std::string, int>& available,
+  int nMessages)
+{
+    PlacementContext ctx;
+    ctx.thisHost = "this";
+    ctx.funcStr = "demo/echo";
+    ctx.nMessages = nMessages;
+
+    ctx.allHostsGetter = [] {
+        return std::vector<std::string>({ "this", "a", "b", "c" });
+    };
+
+    ctx.resourcesGetter = [&available](const std::string& host) {
+        faabric::HostResources r;
+        r.set_cores(available[host]);
+        return r;
+    };
+
+    return ctx;
+}
+
+static std::vector<std::string> repeatHost(const std::string& host, int n)
+{
+    return std::vector<std::string>(n, host);
+}
+
+TEST_CASE("Test greedy placement", "[scheduler]")
+{
+    std::unordered_map<std::string, int> available = {
+        { "this", 2 }, { "a", 1 }, { "b", 3 }, { "c", 10 }
+    };
+    PlacementContext ctx = buildContext(available, 5);
+    ctx.registeredHosts = { "b" };
+
+    GreedyPolicy policy;
+    std::vector<std::string> expected = { "this", "this", "b", "b", "b" };
+    REQUIRE(policy.place(ctx) == expected);
+}
+
+TEST_CASE("Test bin-pack placement", "[scheduler]")
+{
+    std::unordered_map<std::string, int> available = {
+        { "this", 2 }, { "a", 6 }, { "b", 4 }, { "c", 10 }
+    };
+
+    BinPackPolicy policy;
+    std::vector<std::string> expected;
+    int nMessages = 0;
+
+    SECTION("Fits on one host")
+    {
+        // Tightest fit is b, not the emptiest
+        nMessages = 4;
+        expected = repeatHost("b", 4);
+    }
+
+    SECTION("Doesn't fit on one host")
+    {
+        // Emptiest host first, then the tightest fit for the rest
+        nMessages = 13;
+        expected = repeatHost("c", 10);
+        expected.emplace_back("b");
+        expected.emplace_back("b");
+        expected.emplace_back("b");
+    }
+
+    SECTION("Not enough capacity")
+    {
+        nMessages = 25;
+        expected = repeatHost("c", 10);
+        for (auto& h : repeatHost("a", 6)) {
+            expected.push_back(h);
+        }
+        for (auto& h : repeatHost("b", 4)) {
+            expected.push_back(h);
+        }
+        for (auto& h : repeatHost("this", 2)) {
+            expected.push_back(h);
+        }
+        for (auto& h : repeatHost("", 3)) {
+            expected.push_back(h);
+        }
+    }
+
+    PlacementContext ctx = buildContext(available, nMessages);
+    REQUIRE(policy.place(ctx) == expected);
+}
+
+TEST_CASE("Test spread placement", "[scheduler]")
+{
+    std::unordered_map<std::string, int> available = {
+        { "this", 1 }, { "a", 2 }, { "b", 2 }, { "c", 3 }
+    };
+    PlacementContext ctx = buildContext(available, 6);
+
+    SpreadPolicy policy;
+    std::vector<std::string> expected = { "c", "a", "b", "this", "c", "a" };
+    REQUIRE(policy.place(ctx) == expected);
+}
+
+TEST_CASE("Test locality placement", "[scheduler]")
+{
+    std::unordered_map<std::string, int> available = {
+        { "this", 1 }, { "a", 2 }, { "b", 2 }, { "c", 3 }
+    };
+    PlacementContext ctx = buildContext(available, 6);
+    ctx.registeredHosts = { "a" };
+    ctx.snapshotHosts = { "c" };
+
+    LocalityPolicy policy;
+    std::vector<std::string> expected = { "this", "c", "c", "c", "a", "a" };
+    REQUIRE(policy.place(ctx) == expected);
+}
+
+TEST_CASE("Test MPI placement", "[scheduler]")
+{
+    std::unordered_map<std::string, int> available = {
+        { "this", 2 }, { "a", 2 }, { "b", 1 }, { "c", 3 }
+    };
+    PlacementContext ctx = buildContext(available, 6);
+    ctx.registeredHosts = { "b" };
+
+    MpiPackPolicy policy;
+    std::vector<std::string> expected;
+
+    SECTION("MPI request")
+    {
+        ctx.isMpi = true;
+        expected = { "this", "this", "c", "c", "c", "a" };
+    }
+
+    SECTION("Non-MPI request")
+    {
+        ctx.isMpi = false;
+        expected = { "this", "this", "b", "a", "a", "c" };
+    }
+
+    REQUIRE(policy.place(ctx) == expected);
+}
+
+TEST_CASE("Test getting placement policies", "[scheduler]")
+{
+    REQUIRE(dynamic_cast<GreedyPolicy*>(getPlacementPolicy("greedy").get()));
+    REQUIRE(dynamic_cast<BinPackPolicy*>(getPlacementPolicy("binpack").get()));
+    REQUIRE(dynamic_cast<SpreadPolicy*>(getPlacementPolicy("spread").get()));
+    REQUIRE(
+      dynamic_cast<LocalityPolicy*>(getPlacementPolicy("locality").get()));
+    REQUIRE(dynamic_cast<MpiPackPolicy*>(getPlacementPolicy("mpi").get()));
+    REQUIRE_THROWS(getPlacementPolicy("foo"));
+}
+
+TEST_CASE("Test comparing placement policies in simulation", "[scheduler]")
+{
+    // Bursts of batches from different masters, some sharing snapshots
+    std::vector<SimulatedRequest> requests;
+    for (int i = 0; i < 40; i++) {
+        SimulatedRequest req;
+        req.funcStr = "demo/func_" + std::to_string(i % 4);
+        req.nMessages = 3 + (i % 5);
+        req.masterIdx = i % 3;
+        req.snapshotKey = "snap_" + std::to_string(i % 4);
+        req.arrivalTick = i;
+        req.durationTicks = 6;
+        requests.push_back(req);
+    }
+
+    PlacementSimulator sim(8, 4);
+
+    GreedyPolicy greedy;
+    BinPackPolicy binPack;
+    SpreadPolicy spread;
+    LocalityPolicy locality;
+
+    PlacementStats greedyStats = sim.run(greedy, requests);
+    PlacementStats binPackStats = sim.run(binPack, requests);
+    PlacementStats spreadStats = sim.run(spread, requests);
+    PlacementStats localityStats = sim.run(locality, requests);
+
+    for (const auto& s :
+         { greedyStats, binPackStats, spreadStats, localityStats }) {
+        REQUIRE(s.nRequests == 40);
+        REQUIRE(s.nMessages > 0);
+    }
+
+    // Bin-packing uses fewest hosts per request, spreading the most
+    REQUIRE(binPackStats.meanHostsUsed() <= greedyStats.meanHostsUsed());
+    REQUIRE(spreadStats.meanHostsUsed() > binPackStats.meanHostsUsed());
+
+    // Spreading keeps load most even
+    REQUIRE(spreadStats.maxLoadImbalance <= binPackStats.maxLoadImbalance);
+
+    // Locality pushes snapshots least
+    REQUIRE(localityStats.nSnapshotPushes <= greedyStats.nSnapshotPushes);
+    REQUIRE(localityStats.nSnapshotPushes <= spreadStats.nSnapshotPushes);
+}
+
+TEST_CASE("Test scheduling with a placement policy", "[scheduler]")
+{
+    cleanFaabric();
+    faabric::util::setMockMode(true);
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.placementPolicy = "binpack";
+
+    Scheduler& sch = getScheduler();
+
+    // No capacity here, a big host and a small one
+    faabric::HostResources thisResources;
+    thisResources.set_cores(0);
+    sch.setThisHostResources(thisResources);
+
+    std::string smallHost = "small";
+    std::string bigHost = "big";
+    sch.addHostToGlobalSet(smallHost);
+    sch.addHostToGlobalSet(bigHost);
+
+    faabric::HostResources smallResources;
+    smallResources.set_cores(3);
+    faabric::HostResources bigResources;
+    bigResources.set_cores(10);
+    queueResourceResponse(smallHost, smallResources);
+    queueResourceResponse(bigHost, bigResources);
+
+    int nMessages = 8;
+    std::vector<faabric::Message> msgs;
+    for (int i = 0; i < nMessages; i++) {
+        msgs.push_back(faabric::util::messageFactory("demo", "echo"));
+    }
+    faabric::BatchExecuteRequest req = faabric::util::batchExecFactory(msgs);
+
+    std::vector<std::string> executed = sch.callFunctions(req);
+    REQUIRE(executed == repeatHost(bigHost, nMessages));
+
+    auto batchRequests = getBatchRequests();
+    REQUIRE(batchRequests.size() == 1);
+    REQUIRE(batchRequests.at(0).first == bigHost);
+    REQUIRE(batchRequests.at(0).second.messages_size() == nMessages);
+
+    REQUIRE(sch.getFunctionRegisteredHosts(msgs.at(0)) ==
+            std::unordered_set<std::string>({ bigHost }));
+
+    faabric::util::setMockMode(false);
+    conf.reset();
+}
+}
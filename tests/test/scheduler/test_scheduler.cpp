@@ -5,7 +5,9 @@
 #include <faabric/scheduler/SnapshotClient.h>
 #include <faabric/snapshot/SnapshotRegistry.h>
 #include <faabric/util/func.h>
+#include <faabric/util/metrics.h>
 #include <faabric/util/testing.h>
+#include <faabric/util/tracing.h>
 #include <faabric_utils.h>
 
 #include <faabric/redis/Redis.h>
@@ -470,6 +472,85 @@ TEST_CASE("Test counts can't go below zero", "[scheduler]")
     REQUIRE(sch.getFunctionInFlightCount(msg) == 0);
 }
 
+TEST_CASE("Test prewarming faaslets", "[scheduler]")
+{
+    cleanFaabric();
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    Scheduler& sch = scheduler::getScheduler();
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+
+    int expectedFaaslets = 0;
+    int expectedPrewarm = 0;
+
+    SECTION("Prewarming off")
+    {
+        conf.prewarmMode = "off";
+        conf.prewarmMinExecutors = 3;
+        expectedFaaslets = 1;
+    }
+
+    SECTION("Minimum warm count")
+    {
+        conf.prewarmMode = "rate";
+        conf.prewarmMinExecutors = 3;
+        expectedFaaslets = 3;
+        expectedPrewarm = 2;
+    }
+
+    SECTION("Minimum capped at host capacity")
+    {
+        conf.prewarmMode = "rate";
+        conf.prewarmMinExecutors = 50;
+        expectedFaaslets = sch.getThisHostResources().cores();
+        expectedPrewarm = expectedFaaslets - 1;
+    }
+
+    sch.callFunction(msg);
+
+    // Prewarming runs separately from calls, and running it again once the
+    // target is met changes nothing
+    sch.prewarmFaaslets();
+    sch.prewarmFaaslets();
+
+    REQUIRE(sch.getFunctionFaasletCount(msg) == expectedFaaslets);
+    REQUIRE(sch.getFunctionPrewarmCount(msg) == expectedPrewarm);
+    REQUIRE(sch.getBindQueue()->size() == expectedFaaslets);
+    REQUIRE(sch.getThisHostResources().boundexecutors() == expectedFaaslets);
+
+    REQUIRE(sch.getFunctionCallRate(msg).nArrivals == 1);
+
+    conf.reset();
+}
+
+TEST_CASE("Test prewarming shares host capacity", "[scheduler]")
+{
+    cleanFaabric();
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.prewarmMode = "rate";
+    conf.prewarmMinExecutors = 50;
+
+    Scheduler& sch = scheduler::getScheduler();
+    faabric::Message msgA = faabric::util::messageFactory("demo", "echo");
+    faabric::Message msgB = faabric::util::messageFactory("demo", "hello");
+
+    sch.callFunction(msgA);
+    sch.callFunction(msgB);
+    sch.prewarmFaaslets();
+
+    // Both functions get a share, but together they don't exceed the host
+    int cores = sch.getThisHostResources().cores();
+    long faasletsA = sch.getFunctionFaasletCount(msgA);
+    long faasletsB = sch.getFunctionFaasletCount(msgB);
+    REQUIRE(faasletsA + faasletsB == std::max(cores, 2));
+    REQUIRE(std::abs(faasletsA - faasletsB) <= 1);
+    REQUIRE(sch.getThisHostResources().boundexecutors() ==
+            faasletsA + faasletsB);
+
+    conf.reset();
+}
+
 TEST_CASE("Check test mode", "[scheduler]")
 {
     cleanFaabric();
@@ -536,6 +617,47 @@ TEST_CASE("Global message queue tests", "[scheduler]")
     checkMessageEquality(call, actualCall2);
 }
 
+TEST_CASE("Check setting batches of function results", "[scheduler]")
+{
+    cleanFaabric();
+
+    redis::Redis& redis = redis::Redis::getQueue();
+    scheduler::Scheduler& sch = scheduler::getScheduler();
+
+    std::vector<faabric::Message> msgs;
+    for (int i = 0; i < 3; i++) {
+        faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+        msg.set_outputdata("output " + std::to_string(i));
+        msgs.emplace_back(msg);
+
+        sch.callFunction(msg);
+    }
+
+    REQUIRE(sch.getFunctionInFlightCount(msgs.at(0)) == 3);
+
+    sch.notifyCallsFinished(msgs);
+    sch.setFunctionResults(msgs);
+
+    REQUIRE(sch.getFunctionInFlightCount(msgs.at(0)) == 0);
+    REQUIRE(sch.getThisHostResources().functionsinflight() == 0);
+
+    for (auto& msg : msgs) {
+        REQUIRE(msg.executedhost() == sch.getThisHost());
+        REQUIRE(msg.finishtimestamp() > 0);
+
+        REQUIRE(redis.getTtl(msg.resultkey()) > 10);
+        REQUIRE(redis.getTtl(msg.statuskey()) > 10);
+
+        faabric::Message result = sch.getFunctionResult(msg.id(), 1);
+        checkMessageEquality(msg, result);
+    }
+
+    // Empty result keys are rejected before anything is written
+    faabric::Message noKey;
+    std::vector<faabric::Message> badMsgs = { noKey };
+    REQUIRE_THROWS(sch.setFunctionResults(badMsgs));
+}
+
 TEST_CASE("Check multithreaded function results", "[scheduler]")
 {
     cleanFaabric();
@@ -794,4 +916,196 @@ TEST_CASE("Test broadcast snapshot deletion", "[scheduler]")
 
     REQUIRE(actualDeleteRequests == expectedDeleteRequests);
 }
+
+TEST_CASE("Test trace context propagated when scheduling", "[scheduler]")
+{
+    cleanFaabric();
+    faabric::util::setMockMode(true);
+
+    auto exporter = std::make_shared<faabric::util::InMemorySpanExporter>();
+    faabric::util::getTracer().setExporter(exporter);
+
+    scheduler::Scheduler& sch = scheduler::getScheduler();
+
+    // One call runs here, the other on another host
+    std::string otherHost = "beta";
+    sch.addHostToGlobalSet(otherHost);
+
+    faabric::HostResources thisResources;
+    thisResources.set_cores(1);
+    sch.setThisHostResources(thisResources);
+
+    faabric::HostResources otherResources;
+    otherResources.set_cores(1);
+    faabric::scheduler::queueResourceResponse(otherHost, otherResources);
+
+    std::vector<faabric::Message> msgs = {
+        faabric::util::messageFactory("foo", "bar"),
+        faabric::util::messageFactory("foo", "bar")
+    };
+    faabric::BatchExecuteRequest req = faabric::util::batchExecFactory(msgs);
+
+    // Make the call from within a span, as a chained call would be
+    faabric::TraceContext callerCtx;
+    {
+        faabric::util::ScopedSpan caller("caller");
+        callerCtx = caller.context();
+        sch.callFunctions(req);
+    }
+
+    faabric::util::getTracer().flush();
+    std::vector<faabric::util::Span> spans = exporter->getSpans();
+    faabric::util::getTracer().reset();
+
+    std::map<std::string, faabric::util::Span> spansByName;
+    for (const auto& s : spans) {
+        REQUIRE(s.traceId == callerCtx.traceid());
+        spansByName[s.name] = s;
+    }
+
+    REQUIRE(spansByName.count("scheduler_call_functions") == 1);
+    REQUIRE(spansByName.count("scheduler_dispatch_remote") == 1);
+
+    const faabric::util::Span& callSpan =
+      spansByName["scheduler_call_functions"];
+    const faabric::util::Span& dispatchSpan =
+      spansByName["scheduler_dispatch_remote"];
+    REQUIRE(callSpan.parentSpanId == callerCtx.spanid());
+    REQUIRE(dispatchSpan.parentSpanId == callSpan.spanId);
+    REQUIRE(dispatchSpan.attributes.at("target") == otherHost);
+
+    // The local call carries the scheduling span's context
+    faabric::Message localMsg = sch.getFunctionQueue(msgs.at(0))->dequeue();
+    REQUIRE(localMsg.tracecontext().traceid() == callerCtx.traceid());
+    REQUIRE(localMsg.tracecontext().spanid() == callSpan.spanId);
+
+    // The remote call carries the dispatch span's context
+    auto actualReqs = faabric::scheduler::getBatchRequests();
+    REQUIRE(actualReqs.size() == 1);
+    const faabric::BatchExecuteRequest& remoteReq = actualReqs.at(0).second;
+    REQUIRE(remoteReq.tracecontext().spanid() == dispatchSpan.spanId);
+    REQUIRE(remoteReq.messages(0).tracecontext().spanid() ==
+            dispatchSpan.spanId);
+
+    faabric::util::setMockMode(false);
+}
+
+TEST_CASE("Test calling functions with owned request", "[scheduler]")
+{
+    cleanFaabric();
+
+    Scheduler& sch = scheduler::getScheduler();
+
+    // Big enough to live outside the string's inline buffer
+    std::string input(1024, 'a');
+
+    faabric::Message msg = faabric::util::messageFactory("foo", "bar");
+    msg.set_inputdata(input);
+
+    SECTION("Borrowed request")
+    {
+        std::vector<faabric::Message> msgs = { msg };
+        faabric::BatchExecuteRequest req =
+          faabric::util::batchExecFactory(msgs);
+        sch.callFunctions(req);
+
+        // Caller's request is left as it was
+        REQUIRE(req.messages(0).inputdata() == input);
+
+        faabric::Message actual = sch.getFunctionQueue(msg)->dequeue();
+        REQUIRE(actual.id() == msg.id());
+        REQUIRE(actual.inputdata() == input);
+    }
+
+    SECTION("Owned request")
+    {
+        std::vector<faabric::Message> msgs = { msg };
+        faabric::BatchExecuteRequest req =
+          faabric::util::batchExecFactory(msgs);
+        const char* inputPtr = req.messages(0).inputdata().data();
+        sch.callFunctions(std::move(req));
+
+        // Input is handed over rather than copied
+        faabric::Message actual = sch.getFunctionQueue(msg)->dequeue();
+        REQUIRE(actual.id() == msg.id());
+        REQUIRE(actual.inputdata() == input);
+        REQUIRE(actual.inputdata().data() == inputPtr);
+    }
+
+    SECTION("Owned message")
+    {
+        faabric::Message msgCopy = msg;
+        const char* inputPtr = msgCopy.inputdata().data();
+        sch.callFunction(std::move(msgCopy));
+
+        faabric::Message actual = sch.getFunctionQueue(msg)->dequeue();
+        REQUIRE(actual.id() == msg.id());
+        REQUIRE(actual.inputdata().data() == inputPtr);
+    }
+}
+
+class TestMockHost final : public faabric::scheduler::MockHost
+{
+  public:
+    int cores = 0;
+    std::vector<faabric::BatchExecuteRequest> reqs;
+
+    faabric::HostResources getResources() override
+    {
+        faabric::HostResources res;
+        res.set_cores(cores);
+        return res;
+    }
+
+    void executeFunctions(const faabric::BatchExecuteRequest& req) override
+    {
+        reqs.push_back(req);
+    }
+};
+
+TEST_CASE("Test scheduling on mock hosts", "[scheduler]")
+{
+    cleanFaabric();
+    faabric::util::setMockMode(true);
+
+    Scheduler& sch = scheduler::getScheduler();
+    std::string thisHost = sch.getThisHost();
+
+    faabric::HostResources thisResources;
+    thisResources.set_cores(1);
+    sch.setThisHostResources(thisResources);
+
+    // The mock host answers for the other host in place of recording
+    std::string otherHost = "other";
+    auto mockHost = std::make_shared<TestMockHost>();
+    mockHost->cores = 2;
+    faabric::scheduler::registerMockHost(otherHost, mockHost);
+    sch.addHostToGlobalSet(otherHost);
+
+    faabric::util::Counter& overloaded =
+      faabric::util::getMetrics().getCounter("scheduler_overloaded_calls");
+    uint64_t overloadedBefore = overloaded.value();
+
+    // One more call than there's capacity for
+    std::vector<faabric::Message> msgs;
+    for (int i = 0; i < 4; i++) {
+        msgs.push_back(faabric::util::messageFactory("foo", "bar"));
+    }
+    faabric::BatchExecuteRequest req = faabric::util::batchExecFactory(msgs);
+    std::vector<std::string> executedHosts = sch.callFunctions(req);
+
+    std::vector<std::string> expectedHosts = {
+        thisHost, otherHost, otherHost, thisHost
+    };
+    REQUIRE(executedHosts == expectedHosts);
+    REQUIRE(overloaded.value() - overloadedBefore == 1);
+
+    REQUIRE(mockHost->reqs.size() == 1);
+    REQUIRE(mockHost->reqs.at(0).messages_size() == 2);
+    REQUIRE(faabric::scheduler::getBatchRequests().empty());
+    REQUIRE(faabric::scheduler::getResourceRequests().empty());
+
+    faabric::scheduler::clearMockHosts();
+    faabric::util::setMockMode(false);
+}
 }
@@ -4,12 +4,15 @@
 
 #include <faabric/redis/Redis.h>
 #include <faabric/state/State.h>
+#include <faabric/state/StateMemoryManager.h>
 #include <faabric/util/config.h>
 #include <faabric/util/memory.h>
 #include <faabric/util/state.h>
+#include <faabric/util/timing.h>
 
 #include <faabric/util/macros.h>
 #include <sys/mman.h>
+#include <thread>
 
 using namespace state;
 
@@ -574,4 +577,228 @@ TEST_CASE("Test redis state deletion", "[state]")
 
     resetStateMode();
 }
+
+TEST_CASE("Test redis chunked pull and push of large values", "[state]")
+{
+    setUpStateMode("redis");
+
+    // Use small chunks so that values span several windows and connections
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    int originalChunkSize = conf.redisStateChunkSize;
+    int originalWindow = conf.redisStateWindow;
+    int originalConnections = conf.redisStateConnections;
+
+    conf.redisStateChunkSize = 100;
+    conf.redisStateWindow = 4;
+
+    SECTION("Single connection")
+    {
+        conf.redisStateConnections = 1;
+    }
+
+    SECTION("Multiple connections")
+    {
+        conf.redisStateConnections = 3;
+    }
+
+    redis::Redis& redisState = redis::Redis::getState();
+
+    size_t valueSize = 5 * 1024 + 17;
+    std::vector<uint8_t> values(valueSize);
+    for (size_t i = 0; i < valueSize; i++) {
+        values.at(i) = (uint8_t)(i % 251);
+    }
+
+    // Push the whole value over a longer one and check it's replaced
+    auto kv = setupKV(valueSize);
+    std::string actualKey = faabric::util::keyForUser(kv->user, kv->key);
+    redisState.set(actualKey, std::vector<uint8_t>(2 * valueSize, 1));
+    kv->set(values.data());
+    kv->pushFull();
+    REQUIRE(redisState.get(actualKey) == values);
+
+    // Update Redis directly and check a full pull picks it up
+    std::vector<uint8_t> update(1500, 7);
+    redisState.setRange(actualKey, 2000, update.data(), update.size());
+    std::copy(update.begin(), update.end(), values.begin() + 2000);
+
+    kv->pull();
+    std::vector<uint8_t> actual(valueSize, 0);
+    kv->get(actual.data());
+    REQUIRE(actual == values);
+
+    // Check a fresh copy can pull a chunk spanning many Redis chunks
+    State& globalState = getGlobalState();
+    globalState.forceClearAll(false);
+    auto kvAfter = globalState.getKV(kv->user, kv->key, valueSize);
+
+    std::vector<uint8_t> actualChunk(2345, 0);
+    kvAfter->getChunk(1234, actualChunk.data(), actualChunk.size());
+    std::vector<uint8_t> expectedChunk(values.begin() + 1234,
+                                       values.begin() + 1234 + 2345);
+    REQUIRE(actualChunk == expectedChunk);
+
+    // Dirty a large region and check the partial push is split up correctly
+    std::vector<uint8_t> partial(3000, 9);
+    kvAfter->setChunk(1000, partial.data(), partial.size());
+    kvAfter->pushPartial();
+    std::copy(partial.begin(), partial.end(), values.begin() + 1000);
+    REQUIRE(redisState.get(actualKey) == values);
+
+    conf.redisStateChunkSize = originalChunkSize;
+    conf.redisStateWindow = originalWindow;
+    conf.redisStateConnections = originalConnections;
+
+    resetStateMode();
+}
+
+TEST_CASE("Test redis global lock lease", "[state]")
+{
+    setUpStateMode("redis");
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    int originalLeaseMs = conf.stateLockLeaseMs;
+
+    redis::Redis& redisState = redis::Redis::getState();
+
+    auto kv = setupKV(4);
+    std::string actualKey = faabric::util::keyForUser(kv->user, kv->key);
+    std::string lockKey = actualKey + "_lock";
+    std::string waitersKey = actualKey + "_lock_waiters";
+
+    SECTION("Lease kept between local locks")
+    {
+        conf.stateLockLeaseMs = 10000;
+
+        kv->lockGlobal();
+        long lockId = redisState.getLong(lockKey);
+        REQUIRE(lockId > 0);
+        kv->unlockGlobal();
+
+        // Check the remote lock is re-entered rather than acquired again
+        REQUIRE(redisState.getLong(lockKey) == lockId);
+        kv->lockGlobal();
+        REQUIRE(redisState.getLong(lockKey) == lockId);
+        kv->unlockGlobal();
+    }
+
+    SECTION("No lease")
+    {
+        conf.stateLockLeaseMs = 0;
+
+        kv->lockGlobal();
+        REQUIRE(redisState.getLong(lockKey) > 0);
+        kv->unlockGlobal();
+
+        // Check the lock is released and waiters notified
+        REQUIRE(redisState.getLong(lockKey) == 0);
+        REQUIRE(redisState.listLength(lockKey + "_notify") == 1);
+    }
+
+    SECTION("Lease given up when others are waiting")
+    {
+        conf.stateLockLeaseMs = 10000;
+        redisState.incr(waitersKey);
+
+        kv->lockGlobal();
+        REQUIRE(redisState.getLong(lockKey) > 0);
+        kv->unlockGlobal();
+
+        REQUIRE(redisState.getLong(lockKey) == 0);
+    }
+
+    SECTION("Lease released when it ends after an uncontended unlock")
+    {
+        conf.stateLockLeaseMs = 200;
+
+        kv->lockGlobal();
+        kv->unlockGlobal();
+        REQUIRE(redisState.getLong(lockKey) > 0);
+
+        // Another host arriving later must get the lock when the lease ends,
+        // well before the lock itself would expire
+        faabric::util::TimePoint start = faabric::util::startTimer();
+        uint32_t otherLockId = 0;
+        std::thread otherHost([&actualKey, &otherLockId] {
+            otherLockId = StateKeyValue::waitOnRedisRemoteLock(actualKey);
+        });
+        otherHost.join();
+
+        REQUIRE(otherLockId > 0);
+        REQUIRE(faabric::util::getTimeDiffMillis(start) <
+                (REMOTE_LOCK_TIMEOUT_SECS * 1000) * 0.8);
+        REQUIRE(redisState.getCounter(waitersKey) == 0);
+        REQUIRE(redisState.getTtl(waitersKey) > 0);
+
+        redisState.releaseLock(actualKey, otherLockId);
+    }
+
+    conf.stateLockLeaseMs = originalLeaseMs;
+    resetStateMode();
+}
+
+TEST_CASE("Test redis state eviction over memory budget", "[state]")
+{
+    setUpStateMode("redis");
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    int originalBudget = conf.stateMemoryBudgetMb;
+    conf.stateMemoryBudgetMb = 1;
+
+    StateMemoryManager& manager = getStateMemoryManager();
+    size_t evictionsBefore = manager.getEvictionCount();
+
+    redis::Redis& redisState = redis::Redis::getState();
+
+    // Two of these fit in the budget, but not three
+    size_t valueSize = 400 * 1024;
+    std::vector<std::shared_ptr<StateKeyValue>> kvs;
+    std::vector<std::string> redisKeys;
+    for (int i = 0; i < 3; i++) {
+        auto kv = setupKV(valueSize);
+        std::string redisKey = faabric::util::keyForUser(kv->user, kv->key);
+        redisState.set(redisKey, std::vector<uint8_t>(valueSize, i + 1));
+
+        kvs.push_back(kv);
+        redisKeys.push_back(redisKey);
+    }
+
+    std::vector<uint8_t> actual(valueSize, 0);
+    kvs.at(0)->get(actual.data());
+    kvs.at(1)->get(actual.data());
+    REQUIRE(manager.getEvictionCount() == evictionsBefore);
+
+    // Pulling the third evicts one of the others
+    kvs.at(2)->get(actual.data());
+    REQUIRE(actual == std::vector<uint8_t>(valueSize, 3));
+    REQUIRE(manager.getEvictionCount() == evictionsBefore + 1);
+
+    size_t residentSize = kvs.at(2)->getResidentSize();
+    REQUIRE(residentSize >= valueSize);
+
+    int evictedIdx = kvs.at(0)->getResidentSize() == 0 ? 0 : 1;
+    int keptIdx = 1 - evictedIdx;
+    REQUIRE(kvs.at(evictedIdx)->getResidentSize() == 0);
+    REQUIRE(kvs.at(keptIdx)->getResidentSize() == residentSize);
+
+    // Make the kept value dirty so it can't be evicted
+    std::vector<uint8_t> dirtyValues(valueSize, 9);
+    kvs.at(keptIdx)->set(dirtyValues.data());
+
+    // Check the evicted value is pulled again, this time evicting the third
+    std::vector<uint8_t> updated(valueSize, 7);
+    redisState.set(redisKeys.at(evictedIdx), updated);
+    kvs.at(evictedIdx)->get(actual.data());
+    REQUIRE(actual == updated);
+
+    REQUIRE(manager.getEvictionCount() == evictionsBefore + 2);
+    REQUIRE(kvs.at(2)->getResidentSize() == 0);
+    REQUIRE(kvs.at(keptIdx)->getResidentSize() == residentSize);
+
+    kvs.at(keptIdx)->get(actual.data());
+    REQUIRE(actual == dirtyValues);
+
+    conf.stateMemoryBudgetMb = originalBudget;
+    resetStateMode();
+}
 }
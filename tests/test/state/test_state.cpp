@@ -11,6 +11,7 @@
 
 #include <faabric/util/state.h>
 #include <sys/mman.h>
+#include <thread>
 
 using namespace faabric::state;
 
@@ -694,6 +695,60 @@ TEST_CASE("Test deletion", "[state]")
     server.stop();
 }
 
+TEST_CASE("Test key-value lookups across threads", "[state]")
+{
+    cleanFaabric();
+
+    State& state = getGlobalState();
+    std::string user = "demo";
+    int nKeys = 100;
+    int nThreads = 4;
+
+    // Create key-values from several threads at once
+    std::vector<std::vector<std::shared_ptr<StateKeyValue>>> results(
+      nThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&state, &results, &user, nKeys, t] {
+            for (int i = 0; i < nKeys; i++) {
+                std::string key = "lookup_" + std::to_string(i);
+                results.at(t).push_back(state.getKV(user, key, 8));
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // Check all threads see the same key-values
+    REQUIRE(state.getKVCount() == nKeys);
+    for (int i = 0; i < nKeys; i++) {
+        std::string key = "lookup_" + std::to_string(i);
+        std::shared_ptr<StateKeyValue> kv = state.getKV(user, key, 8);
+        REQUIRE(kv->user == user);
+        REQUIRE(kv->key == key);
+
+        for (int t = 0; t < nThreads; t++) {
+            REQUIRE(results.at(t).at(i) == kv);
+        }
+    }
+
+    // Check deleting locally isn't hidden by cached handles
+    std::shared_ptr<StateKeyValue> before = state.getKV(user, "lookup_0", 8);
+    state.deleteKVLocally(user, "lookup_0");
+    REQUIRE(state.getKVCount() == nKeys - 1);
+
+    std::shared_ptr<StateKeyValue> after = state.getKV(user, "lookup_0", 8);
+    REQUIRE(after != before);
+    REQUIRE(state.getKVCount() == nKeys);
+
+    // Check clearing drops everything
+    state.forceClearAll(false);
+    REQUIRE(state.getKVCount() == 0);
+    REQUIRE(state.getKV(user, "lookup_1", 8) != results.at(0).at(1));
+}
+
 TEST_CASE("Test appended state with KV", "[state]")
 {
     cleanFaabric();
@@ -10,6 +10,7 @@
 #include <faabric/util/bytes.h>
 #include <faabric/util/config.h>
 
+#include <thread>
 #include <wait.h>
 
 using namespace faabric::state;
@@ -234,6 +235,111 @@ TEST_CASE("Test state server as remote master", "[state]")
     resetStateMode();
 }
 
+TEST_CASE("Test state lock leases on master", "[state]")
+{
+    setUpStateMode();
+
+    auto kv = getKv(userA, keyA, dataA.size());
+    REQUIRE(kv->isMaster());
+
+    int leaseMs = faabric::util::getSystemConfig().stateLockLeaseMs;
+
+    // Check an uncontended lease
+    StateLease leaseA = kv->acquireLease("hostA", true);
+    REQUIRE(leaseA.id > 0);
+    REQUIRE(leaseA.leaseMs == leaseMs);
+    REQUIRE(!leaseA.contended);
+
+    // Same host asking again must have finished with its previous lease
+    StateLease leaseB = kv->acquireLease("hostA", true);
+    REQUIRE(leaseB.id > leaseA.id);
+
+    // Check stale releases are ignored, then release properly
+    kv->releaseLease("hostA", leaseA.id);
+    kv->releaseLease("hostB", leaseB.id);
+    kv->releaseLease("hostA", leaseB.id);
+
+    // Hold the lock locally and queue up two other hosts
+    kv->lockGlobal();
+
+    std::vector<std::string> order;
+    std::vector<bool> contended;
+    auto acquireAndRelease = [&kv, &order, &contended](std::string host) {
+        StateLease lease = kv->acquireLease(host, true);
+        order.push_back(host);
+        contended.push_back(lease.contended);
+        kv->releaseLease(host, lease.id);
+    };
+
+    std::thread tA(acquireAndRelease, "hostA");
+    usleep(1000 * 100);
+    std::thread tB(acquireAndRelease, "hostB");
+    usleep(1000 * 100);
+
+    kv->unlockGlobal();
+
+    tA.join();
+    tB.join();
+
+    // Check they're served in order, and the first knows the second is waiting
+    REQUIRE(order == std::vector<std::string>({ "hostA", "hostB" }));
+    REQUIRE(contended == std::vector<bool>({ true, false }));
+
+    resetStateMode();
+}
+
+TEST_CASE("Test state lock leases with remote master", "[state]")
+{
+    setUpStateMode();
+
+    DummyStateServer server;
+    server.dummyData = dataA;
+    server.dummyUser = userA;
+    server.dummyKey = keyA;
+    server.start();
+
+    auto localKv = getKv(userA, keyA, dataA.size());
+    REQUIRE(!localKv->isMaster());
+
+    // Leases from the dummy master start at one
+    uint64_t leaseId = 1;
+
+    SECTION("Revoke idle lease")
+    {
+        localKv->lockGlobal();
+        localKv->unlockGlobal();
+
+        REQUIRE(localKv->revokeLease(leaseId, 10));
+    }
+
+    SECTION("Revoke busy lease")
+    {
+        localKv->lockGlobal();
+
+        // Check the lease can't be revoked mid critical section
+        REQUIRE(!localKv->revokeLease(leaseId, 10));
+
+        // Unlocking hands it back to the master
+        localKv->unlockGlobal();
+        REQUIRE(localKv->revokeLease(leaseId, 10));
+    }
+
+    // Locking again needs a new lease from the master, which is then kept
+    localKv->lockGlobal();
+    localKv->unlockGlobal();
+
+    // This host can't be reached from the master, so check the master falls
+    // back to waiting for the lease to expire
+    auto remoteKv =
+      std::static_pointer_cast<InMemoryStateKeyValue>(server.getRemoteKv());
+    remoteKv->lockGlobal();
+    remoteKv->unlockGlobal();
+
+    server.stop();
+
+    resetStateMode();
+}
+
 TEST_CASE("Test state server with local master", "[state]")
 {
     setUpStateMode();
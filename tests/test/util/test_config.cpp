@@ -24,11 +24,26 @@ TEST_CASE("Test default system config initialisation", "[util]")
     REQUIRE(conf.captureStdout == "off");
     REQUIRE(conf.stateMode == "inmemory");
     REQUIRE(conf.wasmVm == "wavm");
+    REQUIRE(conf.memoryAllocPolicy.classes.empty());
 
     REQUIRE(conf.redisPort == "6379");
+    REQUIRE(conf.redisStateChunkSize == 65536);
+    REQUIRE(conf.redisStateWindow == 32);
+    REQUIRE(conf.redisStateConnections == 4);
+
+    REQUIRE(conf.stateLockLeaseMs == 100);
+    REQUIRE(conf.stateMemoryBudgetMb == 0);
 
     REQUIRE(conf.noScheduler == 0);
     REQUIRE(conf.overrideCpuCount == 0);
+    REQUIRE(conf.placementPolicy == "greedy");
+    REQUIRE(conf.executorWarmCacheSize == 10);
+    REQUIRE(conf.executorLocalQueueSize == 4);
+    REQUIRE(conf.executorBatchSize == 1);
+    REQUIRE(conf.prewarmMode == "off");
+    REQUIRE(conf.prewarmMinExecutors == 0);
+    REQUIRE(conf.prewarmHeadroomPct == 50);
+    REQUIRE(conf.prewarmIntervalMs == 100);
 
     REQUIRE(conf.globalMessageTimeout == 60000);
     REQUIRE(conf.boundTimeout == 30000);
@@ -36,6 +51,16 @@ TEST_CASE("Test default system config initialisation", "[util]")
     REQUIRE(conf.chainedCallTimeout == 300000);
 
     REQUIRE(conf.defaultMpiWorldSize == 5);
+    REQUIRE(conf.mpiShmTransport == "off");
+
+    REQUIRE(conf.traceMode == "off");
+    REQUIRE(conf.traceFile == "/tmp/faabric_traces.json");
+    REQUIRE(conf.traceCollectorUrl == "http://localhost:4318/v1/traces");
+
+    REQUIRE(conf.endpointResultPollMs == 5);
+    REQUIRE(conf.endpointBacklog == 1024);
+    REQUIRE(conf.endpointMaxRequestSize == 16777216);
+    REQUIRE(conf.endpointPinThreads == "off");
 }
 
 TEST_CASE("Test overriding system config initialisation", "[util]")
@@ -53,13 +78,29 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     std::string captureStdout = setEnvVar("CAPTURE_STDOUT", "on");
     std::string stateMode = setEnvVar("STATE_MODE", "foobar");
     std::string wasmVm = setEnvVar("WASM_VM", "blah");
+    std::string allocPolicy =
+      setEnvVar("MEMORY_ALLOC_POLICY", "1048576:thp,local");
 
     std::string redisState = setEnvVar("REDIS_STATE_HOST", "not-localhost");
     std::string redisQueue = setEnvVar("REDIS_QUEUE_HOST", "other-host");
     std::string redisPort = setEnvVar("REDIS_PORT", "1234");
+    std::string redisChunk = setEnvVar("REDIS_STATE_CHUNK_SIZE", "1024");
+    std::string redisWindow = setEnvVar("REDIS_STATE_WINDOW", "8");
+    std::string redisConns = setEnvVar("REDIS_STATE_CONNECTIONS", "2");
+
+    std::string lockLease = setEnvVar("STATE_LOCK_LEASE_MS", "250");
+    std::string memBudget = setEnvVar("STATE_MEMORY_BUDGET_MB", "512");
 
     std::string noScheduler = setEnvVar("NO_SCHEDULER", "1");
     std::string overrideCpuCount = setEnvVar("OVERRIDE_CPU_COUNT", "4");
+    std::string placementPolicy = setEnvVar("PLACEMENT_POLICY", "binpack");
+    std::string warmCacheSize = setEnvVar("EXECUTOR_WARM_CACHE_SIZE", "3");
+    std::string localQueueSize = setEnvVar("EXECUTOR_LOCAL_QUEUE_SIZE", "7");
+    std::string batchSize = setEnvVar("EXECUTOR_BATCH_SIZE", "16");
+    std::string prewarmMode = setEnvVar("PREWARM_MODE", "rate");
+    std::string prewarmMin = setEnvVar("PREWARM_MIN_EXECUTORS", "2");
+    std::string prewarmHeadroom = setEnvVar("PREWARM_HEADROOM_PCT", "25");
+    std::string prewarmInterval = setEnvVar("PREWARM_INTERVAL_MS", "20");
 
     std::string globalTimeout = setEnvVar("GLOBAL_MESSAGE_TIMEOUT", "9876");
     std::string boundTimeout = setEnvVar("BOUND_TIMEOUT", "6666");
@@ -69,6 +110,16 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     std::string faasmLocalDir = setEnvVar("FAASM_LOCAL_DIR", "/tmp/blah");
 
     std::string mpiSize = setEnvVar("DEFAULT_MPI_WORLD_SIZE", "2468");
+    std::string mpiShm = setEnvVar("MPI_SHM_TRANSPORT", "on");
+
+    std::string traceMode = setEnvVar("TRACE_MODE", "file");
+    std::string traceFile = setEnvVar("TRACE_FILE", "/tmp/foo.json");
+    std::string traceUrl = setEnvVar("TRACE_COLLECTOR_URL", "http://foo/bar");
+
+    std::string resultPoll = setEnvVar("ENDPOINT_RESULT_POLL_MS", "20");
+    std::string backlog = setEnvVar("ENDPOINT_BACKLOG", "333");
+    std::string maxRequest = setEnvVar("ENDPOINT_MAX_REQUEST_SIZE", "4444");
+    std::string pinThreads = setEnvVar("ENDPOINT_PIN_THREADS", "on");
 
     // Create new conf for test
     SystemConfig conf;
@@ -84,13 +135,28 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     REQUIRE(conf.captureStdout == "on");
     REQUIRE(conf.stateMode == "foobar");
     REQUIRE(conf.wasmVm == "blah");
+    REQUIRE(conf.memoryAllocPolicy.toString() == "1048576:thp,local;");
 
     REQUIRE(conf.redisStateHost == "not-localhost");
     REQUIRE(conf.redisQueueHost == "other-host");
     REQUIRE(conf.redisPort == "1234");
+    REQUIRE(conf.redisStateChunkSize == 1024);
+    REQUIRE(conf.redisStateWindow == 8);
+    REQUIRE(conf.redisStateConnections == 2);
+
+    REQUIRE(conf.stateLockLeaseMs == 250);
+    REQUIRE(conf.stateMemoryBudgetMb == 512);
 
     REQUIRE(conf.noScheduler == 1);
     REQUIRE(conf.overrideCpuCount == 4);
+    REQUIRE(conf.placementPolicy == "binpack");
+    REQUIRE(conf.executorWarmCacheSize == 3);
+    REQUIRE(conf.executorLocalQueueSize == 7);
+    REQUIRE(conf.executorBatchSize == 16);
+    REQUIRE(conf.prewarmMode == "rate");
+    REQUIRE(conf.prewarmMinExecutors == 2);
+    REQUIRE(conf.prewarmHeadroomPct == 25);
+    REQUIRE(conf.prewarmIntervalMs == 20);
 
     REQUIRE(conf.globalMessageTimeout == 9876);
     REQUIRE(conf.boundTimeout == 6666);
@@ -104,6 +170,16 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     REQUIRE(conf.sharedFilesStorageDir == "/tmp/blah/shared_store");
 
     REQUIRE(conf.defaultMpiWorldSize == 2468);
+    REQUIRE(conf.mpiShmTransport == "on");
+
+    REQUIRE(conf.traceMode == "file");
+    REQUIRE(conf.traceFile == "/tmp/foo.json");
+    REQUIRE(conf.traceCollectorUrl == "http://foo/bar");
+
+    REQUIRE(conf.endpointResultPollMs == 20);
+    REQUIRE(conf.endpointBacklog == 333);
+    REQUIRE(conf.endpointMaxRequestSize == 4444);
+    REQUIRE(conf.endpointPinThreads == "on");
 
     // Be careful with host type
     setEnvVar("HOST_TYPE", originalHostType);
@@ -118,13 +194,28 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     setEnvVar("CAPTURE_STDOUT", captureStdout);
     setEnvVar("STATE_MODE", stateMode);
     setEnvVar("WASM_VM", wasmVm);
+    setEnvVar("MEMORY_ALLOC_POLICY", allocPolicy);
 
     setEnvVar("REDIS_STATE_HOST", redisState);
     setEnvVar("REDIS_QUEUE_HOST", redisQueue);
     setEnvVar("REDIS_PORT", redisPort);
+    setEnvVar("REDIS_STATE_CHUNK_SIZE", redisChunk);
+    setEnvVar("REDIS_STATE_WINDOW", redisWindow);
+    setEnvVar("REDIS_STATE_CONNECTIONS", redisConns);
+
+    setEnvVar("STATE_LOCK_LEASE_MS", lockLease);
+    setEnvVar("STATE_MEMORY_BUDGET_MB", memBudget);
 
     setEnvVar("NO_SCHEDULER", noScheduler);
     setEnvVar("OVERRIDE_CPU_COUNT", overrideCpuCount);
+    setEnvVar("PLACEMENT_POLICY", placementPolicy);
+    setEnvVar("EXECUTOR_WARM_CACHE_SIZE", warmCacheSize);
+    setEnvVar("EXECUTOR_LOCAL_QUEUE_SIZE", localQueueSize);
+    setEnvVar("EXECUTOR_BATCH_SIZE", batchSize);
+    setEnvVar("PREWARM_MODE", prewarmMode);
+    setEnvVar("PREWARM_MIN_EXECUTORS", prewarmMin);
+    setEnvVar("PREWARM_HEADROOM_PCT", prewarmHeadroom);
+    setEnvVar("PREWARM_INTERVAL_MS", prewarmInterval);
 
     setEnvVar("GLOBAL_MESSAGE_TIMEOUT", globalTimeout);
     setEnvVar("BOUND_TIMEOUT", boundTimeout);
@@ -134,6 +225,23 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     setEnvVar("FAASM_LOCAL_DIR", faasmLocalDir);
 
     setEnvVar("DEFAULT_MPI_WORLD_SIZE", mpiSize);
+    setEnvVar("MPI_SHM_TRANSPORT", mpiShm);
+
+    setEnvVar("TRACE_MODE", traceMode);
+    setEnvVar("TRACE_FILE", traceFile);
+    setEnvVar("TRACE_COLLECTOR_URL", traceUrl);
+
+    setEnvVar("ENDPOINT_RESULT_POLL_MS", resultPoll);
+    setEnvVar("ENDPOINT_BACKLOG", backlog);
+    setEnvVar("ENDPOINT_MAX_REQUEST_SIZE", maxRequest);
+    setEnvVar("ENDPOINT_PIN_THREADS", pinThreads);
 }
 
+TEST_CASE("Test invalid allocation policy rejected on initialisation",
+          "[util]")
+{
+    std::string original = setEnvVar("MEMORY_ALLOC_POLICY", "1024:foo");
+    REQUIRE_THROWS_AS(SystemConfig(), std::invalid_argument);
+    setEnvVar("MEMORY_ALLOC_POLICY", original);
+}
 }
@@ -58,4 +58,26 @@ TEST_CASE("Test overriding CPU count", "[util]")
     // Check we're back to the default
     REQUIRE(getUsableCores() == defaultCores);
 }
+
+TEST_CASE("Test pinning thread to core", "[util]")
+{
+    // Pick a core this process can run on
+    cpu_set_t allowed;
+    pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed);
+    unsigned int core = 0;
+    while (!CPU_ISSET(core, &allowed)) {
+        core++;
+    }
+
+    // Pin a separate thread so the test thread is left alone
+    cpu_set_t actual;
+    std::thread t([core, &actual] {
+        pinThreadToCore(core);
+        pthread_getaffinity_np(pthread_self(), sizeof(actual), &actual);
+    });
+    t.join();
+
+    REQUIRE(CPU_COUNT(&actual) == 1);
+    REQUIRE(CPU_ISSET(core, &actual));
+}
 }
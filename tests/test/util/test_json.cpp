@@ -60,6 +60,32 @@ TEST_CASE("Test message to JSON round trip", "[util]")
     checkMessageEquality(msg, actual);
 }
 
+TEST_CASE("Test parsing JSON in place", "[util]")
+{
+    faabric::Message msg;
+    msg.set_user("demo");
+    msg.set_function("echo");
+    msg.set_inputdata("some \"escaped\" input\n");
+    msg.set_isasync(true);
+
+    std::string jsonString = faabric::util::messageToJson(msg);
+    faabric::Message actual = faabric::util::jsonToMessageInPlace(jsonString);
+
+    REQUIRE(actual.user() == msg.user());
+    REQUIRE(actual.function() == msg.function());
+    REQUIRE(actual.inputdata() == msg.inputdata());
+    REQUIRE(actual.isasync());
+}
+
+TEST_CASE("Test parsing invalid JSON", "[util]")
+{
+    std::string json;
+    SECTION("Truncated") { json = "{\"user\": \"demo\""; }
+    SECTION("Not an object") { json = "[1, 2, 3]"; }
+
+    REQUIRE_THROWS(faabric::util::jsonToMessage(json));
+}
+
 TEST_CASE("Test get JSON property from JSON string", "[util]")
 {
     // Valid lookups
@@ -1,6 +1,8 @@
 #include <catch.hpp>
+#include <faabric/util/config.h>
 #include <faabric/util/macros.h>
 #include <faabric/util/memory.h>
+#include <stdexcept>
 #include <sys/mman.h>
 #include <unistd.h>
 
@@ -228,4 +230,111 @@ TEST_CASE("Test already aligned memory chunk", "[util]")
     REQUIRE(actual.nBytesLength == 5 * faabric::util::HOST_PAGE_SIZE);
     REQUIRE(actual.offsetRemainder == 0);
 }
+
+TEST_CASE("Test parsing allocation policies", "[util]")
+{
+    AllocationPolicy policy("1073741824:hugetlb,node=1;1048576:thp,local");
+
+    // Classes are sorted by size
+    REQUIRE(policy.classes.size() == 2);
+    REQUIRE(policy.toString() ==
+            "1048576:thp,local;1073741824:hugetlb,node=1;");
+
+    AllocationClass small = policy.getClass(1024);
+    REQUIRE(small.hugePages == HugePageMode::None);
+    REQUIRE(small.numa == NumaMode::Default);
+
+    AllocationClass medium = policy.getClass(2 * 1048576);
+    REQUIRE(medium.minSize == 1048576);
+    REQUIRE(medium.hugePages == HugePageMode::Transparent);
+    REQUIRE(medium.numa == NumaMode::Local);
+
+    AllocationClass large = policy.getClass(1073741824);
+    REQUIRE(large.hugePages == HugePageMode::Explicit);
+    REQUIRE(large.numa == NumaMode::Bind);
+    REQUIRE(large.numaNode == 1);
+
+    REQUIRE(AllocationPolicy("").classes.empty());
+    REQUIRE(AllocationPolicy("0:interleave").toString() == "0:interleave;");
+    REQUIRE(AllocationPolicy("0:none").toString() == "0:none;");
+}
+
+TEST_CASE("Test invalid allocation policies", "[util]")
+{
+    REQUIRE_THROWS_AS(AllocationPolicy("thp"), std::invalid_argument);
+    REQUIRE_THROWS_AS(AllocationPolicy("1024:foo"), std::invalid_argument);
+    REQUIRE_THROWS_AS(AllocationPolicy("1024:node=-1"), std::invalid_argument);
+    REQUIRE_THROWS_AS(AllocationPolicy("abc:thp"), std::invalid_argument);
+}
+
+TEST_CASE("Test allocation class from config", "[util]")
+{
+    SystemConfig& conf = getSystemConfig();
+    AllocationPolicy original = conf.memoryAllocPolicy;
+
+    conf.memoryAllocPolicy = AllocationPolicy("4096:thp");
+    REQUIRE(getAllocationClass(100).hugePages == HugePageMode::None);
+    REQUIRE(getAllocationClass(8192).hugePages == HugePageMode::Transparent);
+
+    conf.memoryAllocPolicy = original;
+}
+
+TEST_CASE("Test allocating shared memory with a policy", "[util]")
+{
+    AllocationClass cls;
+
+    SECTION("Default") {}
+
+    SECTION("Transparent huge pages and local")
+    {
+        cls.hugePages = HugePageMode::Transparent;
+        cls.numa = NumaMode::Local;
+    }
+
+    SECTION("Explicit huge pages and interleaved")
+    {
+        cls.hugePages = HugePageMode::Explicit;
+        cls.numa = NumaMode::Interleave;
+    }
+
+    // Memory must still be usable at host page granularity
+    size_t size = 4 * DEFAULT_HUGE_PAGE_SIZE;
+    void* ptr = allocateSharedMemory(size, cls);
+    REQUIRE(ptr != MAP_FAILED);
+
+    uint8_t* bytes = BYTES(ptr) + HOST_PAGE_SIZE;
+    REQUIRE(mprotect(bytes, HOST_PAGE_SIZE, PROT_WRITE) == 0);
+    bytes[0] = 5;
+    bytes[HOST_PAGE_SIZE - 1] = 6;
+    REQUIRE(bytes[0] == 5);
+    REQUIRE(bytes[HOST_PAGE_SIZE - 1] == 6);
+
+    munmap(ptr, size);
+}
+
+TEST_CASE("Test creating memory fd with a policy", "[util]")
+{
+    // Explicit huge pages may not be available, in which case this falls back
+    // to a normal fd of exactly the right size
+    AllocationClass cls;
+    cls.hugePages = HugePageMode::Explicit;
+
+    size_t size = 3 * HOST_PAGE_SIZE;
+    bool isHugeTlb = false;
+    int fd = createMemoryFd("test_fd", size, cls, isHugeTlb);
+    REQUIRE(fd > 0);
+
+    size_t expectedSize = isHugeTlb ? DEFAULT_HUGE_PAGE_SIZE : size;
+    REQUIRE(::lseek(fd, 0, SEEK_END) == (off_t)expectedSize);
+    ::close(fd);
+
+    fd = createMemoryFd("test_fd", size, AllocationClass(), isHugeTlb);
+    REQUIRE(!isHugeTlb);
+    REQUIRE(::lseek(fd, 0, SEEK_END) == (off_t)size);
+    ::close(fd);
+
+    REQUIRE(getHugePageAlignedSize(1) == DEFAULT_HUGE_PAGE_SIZE);
+    REQUIRE(getHugePageAlignedSize(DEFAULT_HUGE_PAGE_SIZE) ==
+            DEFAULT_HUGE_PAGE_SIZE);
+}
 }
@@ -0,0 +1,180 @@
+#include <catch.hpp>
+
+#include <faabric/util/metrics.h>
+#include <faabric/util/timing.h>
+
+#include <thread>
+#include <unistd.h>
+
+using namespace faabric::util;
+
+namespace tests {
+
+TEST_CASE("Test counters across threads", "[util]")
+{
+    Counter& counter = getMetrics().getCounter("test_counter");
+    counter.reset();
+
+    int nThreads = 8;
+    int nIncs = 10000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back([&counter, nIncs] {
+            for (int j = 0; j < nIncs; j++) {
+                counter.inc();
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+
+    REQUIRE(counter.value() == nThreads * nIncs);
+    REQUIRE(getMetrics().getCounterValues()["test_counter"] ==
+            nThreads * nIncs);
+
+    // Same name gives the same counter
+    REQUIRE(&getMetrics().getCounter("test_counter") == &counter);
+}
+
+TEST_CASE("Test gauges", "[util]")
+{
+    Gauge& gauge = getMetrics().getGauge("test_gauge");
+    gauge.set(10);
+    gauge.inc(5);
+    gauge.dec(20);
+
+    REQUIRE(gauge.value() == -5);
+    REQUIRE(getMetrics().getGaugeValues()["test_gauge"] == -5);
+}
+
+TEST_CASE("Test histogram buckets", "[util]")
+{
+    // Small values are exact
+    for (uint64_t v = 0; v < HISTOGRAM_SUB_BUCKETS; v++) {
+        REQUIRE(Histogram::getBucketIndex(v) == v);
+        REQUIRE(Histogram::getBucketUpperBound(v) == v);
+    }
+
+    // Bigger values fall within their bucket, with bounded error
+    std::vector<uint64_t> values = { 16,     17,        100,
+                                     1000,   123456789, 1UL << 40,
+                                     ~0UL,   (1UL << 63) + 5 };
+    for (uint64_t v : values) {
+        size_t idx = Histogram::getBucketIndex(v);
+        REQUIRE(idx < HISTOGRAM_BUCKETS);
+
+        uint64_t upper = Histogram::getBucketUpperBound(idx);
+        REQUIRE(upper >= v);
+        REQUIRE(upper - v <= v / HISTOGRAM_SUB_BUCKETS);
+
+        if (idx > 0) {
+            REQUIRE(Histogram::getBucketUpperBound(idx - 1) < v);
+        }
+    }
+}
+
+TEST_CASE("Test histogram percentiles", "[util]")
+{
+    Histogram& hist = getMetrics().getHistogram("test_hist");
+    hist.reset();
+
+    // Record 1 to 1000 from a few threads
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&hist, t] {
+            for (uint64_t v = t + 1; v <= 1000; v += 4) {
+                hist.record(v);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+
+    HistogramSnapshot snap = hist.snapshot();
+    REQUIRE(snap.count == 1000);
+    REQUIRE(snap.sum == 500500);
+    REQUIRE(snap.max == 1000);
+    REQUIRE(snap.getMean() == 500.5);
+
+    // Percentiles are within the histogram's precision
+    auto checkPercentile = [&snap](double p, uint64_t expected) {
+        uint64_t actual = snap.getPercentile(p);
+        REQUIRE(actual >= expected);
+        REQUIRE(actual - expected <= expected / HISTOGRAM_SUB_BUCKETS);
+    };
+
+    checkPercentile(50, 500);
+    checkPercentile(90, 900);
+    checkPercentile(99, 990);
+    REQUIRE(snap.getPercentile(100) == 1000);
+
+    // Resetting keeps the same histogram
+    getMetrics().reset();
+    REQUIRE(hist.getCount() == 0);
+    REQUIRE(&getMetrics().getHistogram("test_hist") == &hist);
+}
+
+TEST_CASE("Test timers record to histograms", "[util]")
+{
+    Histogram& hist = getMetrics().getHistogram("testTimer_us");
+    hist.reset();
+
+    {
+        ScopedTimer timer(hist);
+        usleep(10 * 1000);
+    }
+
+    PROF_START(testTimer)
+    usleep(10 * 1000);
+    PROF_END(testTimer)
+
+    HistogramSnapshot snap = hist.snapshot();
+    REQUIRE(snap.count == 2);
+    REQUIRE(snap.sum >= 20 * 1000);
+}
+
+TEST_CASE("Test prometheus rendering", "[util]")
+{
+    PrometheusBuilder builder;
+
+    builder.addCounter("foo.calls", 5);
+    builder.addGauge("bar", 1, PrometheusBuilder::label("fn", "a/b"));
+    builder.addGauge("bar", -2, PrometheusBuilder::label("fn", "c\"d"));
+
+    HistogramSnapshot snap;
+    snap.buckets.resize(HISTOGRAM_BUCKETS, 0);
+    snap.buckets[Histogram::getBucketIndex(3)] = 2;
+    snap.buckets[Histogram::getBucketIndex(20)] = 1;
+    snap.buckets[Histogram::getBucketIndex(100)] = 1;
+    snap.count = 4;
+    snap.sum = 126;
+    snap.max = 100;
+    builder.addHistogram("lat_us", snap);
+
+    std::string expected = "# TYPE foo_calls counter\n"
+                           "foo_calls 5\n"
+                           "# TYPE bar gauge\n"
+                           "bar{fn=\"a/b\"} 1\n"
+                           "bar{fn=\"c\\\"d\"} -2\n"
+                           "# TYPE lat_us histogram\n"
+                           "lat_us_bucket{le=\"15\"} 2\n"
+                           "lat_us_bucket{le=\"31\"} 3\n"
+                           "lat_us_bucket{le=\"63\"} 3\n"
+                           "lat_us_bucket{le=\"127\"} 4\n"
+                           "lat_us_bucket{le=\"+Inf\"} 4\n"
+                           "lat_us_sum 126\n"
+                           "lat_us_count 4\n";
+
+    REQUIRE(builder.str() == expected);
+
+    REQUIRE(PrometheusBuilder::sanitiseName("1a-b:c") == "_a_b:c");
+}
+}
@@ -34,6 +34,43 @@ TEST_CASE("Test queue operations", "[util]")
     REQUIRE_THROWS(q.dequeue(1));
 }
 
+TEST_CASE("Test non-blocking dequeue", "[util]")
+{
+    IntQueue q;
+
+    int value = 0;
+    REQUIRE(!q.tryDequeue(value));
+
+    q.enqueue(1);
+    q.enqueue(2);
+
+    REQUIRE(q.tryDequeue(value));
+    REQUIRE(value == 1);
+    REQUIRE(q.tryDequeue(value));
+    REQUIRE(value == 2);
+
+    REQUIRE(!q.tryDequeue(value));
+    REQUIRE(value == 2);
+}
+
+TEST_CASE("Test batch dequeue", "[util]")
+{
+    IntQueue q;
+
+    for (int i = 0; i < 5; i++) {
+        q.enqueue(i);
+    }
+
+    std::vector<int> expectedA = { 0, 1, 2 };
+    REQUIRE(q.dequeueBatch(3) == expectedA);
+
+    std::vector<int> expectedB = { 3, 4 };
+    REQUIRE(q.dequeueBatch(3) == expectedB);
+    REQUIRE(q.size() == 0);
+
+    REQUIRE_THROWS_AS(q.dequeueBatch(3, 1), QueueTimeoutException);
+}
+
 TEST_CASE("Test drain queue", "[util]")
 {
     IntQueue q;
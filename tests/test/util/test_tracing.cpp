@@ -0,0 +1,210 @@
+#include <catch.hpp>
+
+#include <faabric/util/config.h>
+#include <faabric/util/files.h>
+#include <faabric/util/metrics.h>
+#include <faabric/util/tracing.h>
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <condition_variable>
+#include <unistd.h>
+
+using namespace faabric::util;
+
+namespace tests {
+
+TEST_CASE("Test nested scoped spans", "[util]")
+{
+    auto exporter = std::make_shared<InMemorySpanExporter>();
+    getTracer().setExporter(exporter);
+
+    faabric::TraceContext outerCtx;
+    faabric::TraceContext innerCtx;
+    {
+        ScopedSpan outer("outer");
+        outerCtx = outer.context();
+        REQUIRE(getCurrentTraceContext().spanid() == outerCtx.spanid());
+
+        {
+            ScopedSpan inner("inner");
+            inner.setAttribute("foo", "bar");
+            innerCtx = inner.context();
+            REQUIRE(getCurrentTraceContext().spanid() == innerCtx.spanid());
+        }
+
+        REQUIRE(getCurrentTraceContext().spanid() == outerCtx.spanid());
+    }
+
+    // Nothing open once both are finished
+    REQUIRE(getCurrentTraceContext().traceid() == 0);
+
+    // A span with an explicit parent, as if propagated from another host
+    {
+        ScopedSpan remote("remote", innerCtx);
+    }
+
+    // Spans are buffered until flushed
+    REQUIRE(exporter->getSpans().empty());
+    getTracer().flush();
+
+    std::vector<Span> spans = exporter->getSpans();
+    REQUIRE(spans.size() == 3);
+
+    const Span& inner = spans.at(0);
+    const Span& outer = spans.at(1);
+    const Span& remote = spans.at(2);
+
+    REQUIRE(outer.name == "outer");
+    REQUIRE(outer.traceId != 0);
+    REQUIRE(outer.parentSpanId == 0);
+    REQUIRE(outer.endMicros >= outer.startMicros);
+
+    REQUIRE(inner.name == "inner");
+    REQUIRE(inner.traceId == outer.traceId);
+    REQUIRE(inner.parentSpanId == outer.spanId);
+    REQUIRE(inner.attributes.at("foo") == "bar");
+    REQUIRE(inner.startMicros >= outer.startMicros);
+    REQUIRE(inner.endMicros <= outer.endMicros);
+
+    REQUIRE(remote.traceId == outer.traceId);
+    REQUIRE(remote.parentSpanId == inner.spanId);
+
+    getTracer().reset();
+}
+
+TEST_CASE("Test spans are not recorded when tracing is off", "[util]")
+{
+    getTracer().reset();
+    REQUIRE(!getTracer().isEnabled());
+
+    ScopedSpan span("foo");
+    REQUIRE(!span.isActive());
+    REQUIRE(span.context().traceid() == 0);
+    REQUIRE(getCurrentTraceContext().traceid() == 0);
+}
+
+TEST_CASE("Test exporting spans to a file", "[util]")
+{
+    SystemConfig& conf = getSystemConfig();
+    std::string filePath = "/tmp/faabric_test_traces.json";
+    boost::filesystem::remove(filePath);
+
+    conf.traceMode = "file";
+    conf.traceFile = filePath;
+    getTracer().reset();
+
+    int nSpans = TRACE_EXPORT_BATCH_SIZE + 5;
+    for (int i = 0; i < nSpans; i++) {
+        ScopedSpan span("file_span");
+        span.setAttribute("quoted", "a\"b");
+    }
+
+    // A full batch is exported in the background without flushing
+    std::string contents;
+    size_t nLines = 0;
+    for (int i = 0; i < 100 && nLines < TRACE_EXPORT_BATCH_SIZE; i++) {
+        usleep(10 * 1000);
+        contents = readFileToString(filePath);
+        nLines = std::count(contents.begin(), contents.end(), '\n');
+    }
+    REQUIRE(nLines == TRACE_EXPORT_BATCH_SIZE);
+
+    getTracer().flush();
+    contents = readFileToString(filePath);
+    nLines = std::count(contents.begin(), contents.end(), '\n');
+    REQUIRE(nLines == nSpans);
+
+    std::string firstLine = contents.substr(0, contents.find('\n'));
+    REQUIRE(firstLine.find("\"name\":\"file_span\"") != std::string::npos);
+    REQUIRE(firstLine.find("{\"key\":\"quoted\",\"value\":{\"stringValue\":"
+                           "\"a\\\"b\"}}") != std::string::npos);
+
+    conf.reset();
+    getTracer().reset();
+}
+
+class BlockingSpanExporter : public SpanExporter
+{
+  public:
+    void exportSpans(const std::vector<Span>& spans) override
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        cv.wait(lock, [this] { return released; });
+        nExported += spans.size();
+    }
+
+    void release()
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        released = true;
+        cv.notify_all();
+    }
+
+    size_t getExportedCount()
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        return nExported;
+    }
+
+  private:
+    std::mutex mx;
+    std::condition_variable cv;
+    bool released = false;
+    size_t nExported = 0;
+};
+
+TEST_CASE("Test spans are dropped when the exporter falls behind", "[util]")
+{
+    Counter& dropped = getMetrics().getCounter("trace_dropped_spans");
+    uint64_t droppedBefore = dropped.value();
+
+    auto exporter = std::make_shared<BlockingSpanExporter>();
+    getTracer().setExporter(exporter);
+
+    // One batch is held up in the exporter and the queue fills behind it, so
+    // the last batches are dropped rather than blocking this thread
+    int nBatches = TRACE_EXPORT_MAX_QUEUED_BATCHES + 3;
+    int nSpans = nBatches * TRACE_EXPORT_BATCH_SIZE;
+    for (int i = 0; i < nSpans; i++) {
+        ScopedSpan span("dropped_span");
+
+        // Give the exporter a chance to pick up the first batch
+        if (i == TRACE_EXPORT_BATCH_SIZE) {
+            usleep(50 * 1000);
+        }
+    }
+
+    uint64_t nDropped = dropped.value() - droppedBefore;
+    REQUIRE(nDropped == 2 * TRACE_EXPORT_BATCH_SIZE);
+
+    exporter->release();
+    getTracer().flush();
+    REQUIRE(exporter->getExportedCount() == (uint64_t)nSpans - nDropped);
+
+    getTracer().reset();
+}
+
+TEST_CASE("Test span JSON encoding", "[util]")
+{
+    Span span;
+    span.traceId = 0xab;
+    span.spanId = 0x12;
+    span.parentSpanId = 0x34;
+    span.name = "foo";
+    span.host = "bar";
+    span.startMicros = 5;
+    span.endMicros = 7;
+
+    std::string expected = "{\"traceId\":\"000000000000000000000000000000ab\","
+                           "\"spanId\":\"0000000000000012\","
+                           "\"parentSpanId\":\"0000000000000034\","
+                           "\"name\":\"foo\",\"kind\":1,"
+                           "\"startTimeUnixNano\":\"5000\","
+                           "\"endTimeUnixNano\":\"7000\","
+                           "\"attributes\":[{\"key\":\"host\",\"value\":"
+                           "{\"stringValue\":\"bar\"}}]}";
+
+    REQUIRE(spanToJson(span) == expected);
+}
+}